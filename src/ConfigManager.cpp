@@ -70,6 +70,24 @@ void ConfigManager::parseConfigFile(const std::string& content) {
                 } catch (const std::exception& e) {
                     std::cerr << "Error parsing network port: " << e.what() << std::endl;
                 }
+            } else if (key == "sync_mode") {
+                if (value == "rollback" || value == "lockstep" || value == "mirror") {
+                    m_syncMode = value;
+                } else {
+                    std::cerr << "Unknown sync_mode '" << value << "', using " << m_syncMode << std::endl;
+                }
+            } else if (key == "transport") {
+                if (value == "tcp" || value == "udp") {
+                    m_networkTransport = value;
+                } else {
+                    std::cerr << "Unknown transport '" << value << "', using " << m_networkTransport << std::endl;
+                }
+            } else if (key == "traffic_log_interval") {
+                try {
+                    m_trafficLogInterval = std::max(0.0f, std::stof(value));
+                } catch (const std::exception& e) {
+                    std::cerr << "Error parsing traffic_log_interval: " << e.what() << std::endl;
+                }
             }
         } else if (currentSection == "Game") {
             if (key == "default_target_lines") {
@@ -84,6 +102,34 @@ void ConfigManager::parseConfigFile(const std::string& content) {
                 } catch (const std::exception& e) {
                     std::cerr << "Error parsing ai_move_delay: " << e.what() << std::endl;
                 }
+            } else if (key == "ai_weights") {
+                m_aiWeightsFile = value;
+            } else if (key == "ai_profile") {
+                m_aiProfile = value;
+            } else if (key == "simulation_rate") {
+                try {
+                    m_simulationRate = std::max(1, std::stoi(value));
+                } catch (const std::exception& e) {
+                    std::cerr << "Error parsing simulation_rate: " << e.what() << std::endl;
+                }
+            } else if (key == "multiplayer_mode") {
+                if (value == "marathon" || value == "versus") {
+                    m_multiplayerMode = value;
+                } else {
+                    std::cerr << "Unknown multiplayer_mode '" << value << "', using " << m_multiplayerMode << std::endl;
+                }
+            }
+        } else if (currentSection == "Controls") {
+            try {
+                if (key == "das") {
+                    m_autoShiftDelay = std::stof(value);
+                } else if (key == "arr") {
+                    m_autoRepeatRate = std::stof(value);
+                } else if (key == "soft_drop_interval") {
+                    m_softDropInterval = std::stof(value);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error parsing " << key << ": " << e.what() << std::endl;
             }
         } else if (currentSection == "Display") {
             if (key == "window_height") {
@@ -105,6 +151,34 @@ void ConfigManager::parseConfigFile(const std::string& content) {
                     std::cerr << "Error parsing fps_limit: " << e.what() << std::endl;
                 }
             }
+        } else if (currentSection == "Server") {
+            try {
+                if (key == "port") {
+                    m_serverPort = static_cast<unsigned short>(std::stoi(value));
+                } else if (key == "players_per_match") {
+                    m_playersPerMatch = std::max(2, std::min(8, std::stoi(value)));
+                } else if (key == "threads") {
+                    m_serverThreads = std::max(0, std::stoi(value));
+                } else if (key == "stats_interval") {
+                    m_serverStatsInterval = std::max(1.0f, std::stof(value));
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error parsing " << key << ": " << e.what() << std::endl;
+            }
+        } else if (currentSection == "Replay") {
+            if (key == "record") {
+                if (value == "true" || value == "false") {
+                    m_recordReplays = value == "true";
+                } else {
+                    std::cerr << "Unknown record value '" << value << "', expected true or false" << std::endl;
+                }
+            } else if (key == "directory") {
+                m_replayDirectory = value;
+            }
+        } else if (currentSection == "Debug") {
+            if (key == "latency_csv") {
+                m_latencyCsvPath = value;
+            }
         }
     }
 }
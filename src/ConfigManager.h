@@ -13,16 +13,49 @@ public:
     
     // Network settings
     unsigned short getNetworkPort() const { return m_networkPort; }
+    // "rollback" or "lockstep" (exchange inputs, simulate both boards) or "mirror" (stream board states),
+    // the host's setting is used
+    const std::string& getSyncMode() const { return m_syncMode; }
+    // "tcp" or "udp" (selective reliability, the falling piece is never held back by a lost packet),
+    // both players need the same setting
+    const std::string& getNetworkTransport() const { return m_networkTransport; }
+    // Seconds between traffic log lines during a LAN session, 0 turns them off
+    float getTrafficLogInterval() const { return m_trafficLogInterval; }
     
     // Game settings
     int getDefaultTargetLines() const { return m_defaultTargetLines; }
     float getAIMoveDelay() const { return m_aiMoveDelay; }
+    // Evaluation weights file written by tetris-tune, empty for the built-in weights
+    const std::string& getAIWeightsFile() const { return m_aiWeightsFile; }
+    // Profile ([section]) of that file the AIs use, e.g. a difficulty tier
+    const std::string& getAIProfile() const { return m_aiProfile; }
+    int getSimulationRate() const { return m_simulationRate; }
+    // "marathon" (race to the target lines) or "versus" (line clears send garbage to the opponent)
+    const std::string& getMultiplayerMode() const { return m_multiplayerMode; }
+    
+    // Controls settings (seconds)
+    float getAutoShiftDelay() const { return m_autoShiftDelay; }
+    float getAutoRepeatRate() const { return m_autoRepeatRate; }
+    float getSoftDropInterval() const { return m_softDropInterval; }
     
     // Display settings
     int getWindowHeight() const { return m_windowHeight; }
     int getWindowWidth() const { return m_windowWidth; }
     int getFPSLimit() const { return m_fpsLimit; }
     
+    // Dedicated server settings
+    unsigned short getServerPort() const { return m_serverPort; }
+    int getPlayersPerMatch() const { return m_playersPerMatch; }
+    int getServerThreads() const { return m_serverThreads; }  // 0 means one per core
+    float getServerStatsInterval() const { return m_serverStatsInterval; }
+    
+    // Replay settings: solo games are recorded into replayDirectory when enabled
+    bool getRecordReplays() const { return m_recordReplays; }
+    const std::string& getReplayDirectory() const { return m_replayDirectory; }
+    
+    // Debug settings (empty path disables input latency measurement)
+    const std::string& getLatencyCsvPath() const { return m_latencyCsvPath; }
+    
 private:
     ConfigManager();
     
@@ -32,9 +65,26 @@ private:
     
     // Default values
     unsigned short m_networkPort = 53000;
+    std::string m_syncMode = "rollback";
+    std::string m_networkTransport = "tcp";
+    float m_trafficLogInterval = 10.0f;
     int m_defaultTargetLines = 40;
     float m_aiMoveDelay = 0.2f;
+    std::string m_aiWeightsFile;
+    std::string m_aiProfile;
+    int m_simulationRate = 120;
+    std::string m_multiplayerMode = "versus";
+    float m_autoShiftDelay = 0.1f;
+    float m_autoRepeatRate = 0.1f;
+    float m_softDropInterval = 0.05f;
     int m_windowHeight = 700;
     int m_windowWidth = 1400;
     int m_fpsLimit = 60;
+    unsigned short m_serverPort = 53100;
+    int m_playersPerMatch = 2;
+    int m_serverThreads = 0;
+    float m_serverStatsInterval = 5.0f;
+    bool m_recordReplays = true;
+    std::string m_replayDirectory = "replays";
+    std::string m_latencyCsvPath;
 };
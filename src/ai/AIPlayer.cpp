@@ -7,7 +7,7 @@ Board AIPlayer::simulateMove(const Board& board, const Tetromino& piece, int rot
         rotatedPiece.rotateClockwise();
     }
 
-    const std::vector<Point>& blocks = rotatedPiece.getBlocks();
+    const PieceBlocks& blocks = rotatedPiece.getBlocks();
 
     int row = 0;
     while (row < Board::Height){
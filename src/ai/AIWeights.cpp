@@ -0,0 +1,198 @@
+#include "AIWeights.h"
+#include "../ConfigManager.h"
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+const char* NEXT_PIECE_DISCOUNT_KEY = "next_piece_discount";
+
+std::string trim(const std::string& str) {
+    size_t start = str.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return str.substr(start, end - start + 1);
+}
+
+bool isSectionHeader(const std::string& line) {
+    const std::string trimmed = trim(line);
+    return !trimmed.empty() && trimmed[0] == '[' && trimmed[trimmed.length() - 1] == ']';
+}
+
+bool isBlankOrComment(const std::string& line) {
+    const std::string trimmed = trim(line);
+    return trimmed.empty() || trimmed[0] == ';' || trimmed[0] == '#';
+}
+
+} // namespace
+
+const char* AIWeights::featureKey(AIFeature feature) {
+    switch (feature) {
+        case AIFeature::LINES:
+            return "lines";
+        case AIFeature::HOLES:
+            return "holes";
+        case AIFeature::HEIGHT_DIFFERENCE:
+            return "height_difference";
+        case AIFeature::HOLE_COLUMNS:
+            return "hole_columns";
+        case AIFeature::BUMPINESS:
+            return "bumpiness";
+        case AIFeature::HEIGHT_SQUARED:
+            return "height_squared";
+    }
+    return "unknown";
+}
+
+bool AIWeights::load(const std::string& path, const std::string& profile) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Could not open AI weights file " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::string currentSection;
+    bool profileFound = profile.empty();
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == ';' || line[0] == '#') {
+            continue;
+        }
+        if (line[0] == '[' && line[line.length() - 1] == ']') {
+            currentSection = line.substr(1, line.length() - 2);
+            profileFound = profileFound || currentSection == profile;
+            continue;
+        }
+        // Shared keys, then the requested profile; other profiles are skipped
+        if (!currentSection.empty() && currentSection != profile) {
+            continue;
+        }
+
+        const size_t eqPos = line.find('=');
+        const std::string key = trim(line.substr(0, eqPos));
+        double* target = nullptr;
+        for (int i = 0; i < AI_FEATURE_COUNT; ++i) {
+            if (key == featureKey(static_cast<AIFeature>(i))) {
+                target = &coefficients[i];
+            }
+        }
+        if (key == NEXT_PIECE_DISCOUNT_KEY) {
+            target = &nextPieceDiscount;
+        }
+        if (eqPos == std::string::npos || target == nullptr) {
+            std::cerr << "Unknown AI weights line '" << line << "' in " << path << std::endl;
+            continue;
+        }
+        try {
+            *target = std::stod(line.substr(eqPos + 1));
+        } catch (const std::exception& e) {
+            std::cerr << "Error parsing AI weight " << key << ": " << e.what() << std::endl;
+        }
+    }
+
+    if (!profileFound) {
+        std::cerr << "No AI weights profile [" << profile << "] in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool AIWeights::save(const std::string& path, const std::string& profile, const std::string& comment) const {
+    // The lines already in the file, so that other profiles and the shared keys survive
+    std::vector<std::string> lines;
+    bool crlf = false;
+    {
+        std::ifstream existing(path, std::ios::binary);
+        std::string line;
+        while (std::getline(existing, line)) {
+            if (!line.empty() && line[line.length() - 1] == '\r') {
+                line.erase(line.length() - 1);
+                crlf = true;
+            }
+            lines.push_back(line);
+        }
+    }
+
+    std::vector<std::string> block;
+    std::ostringstream value;
+    value.precision(std::numeric_limits<double>::max_digits10);
+    if (!profile.empty()) {
+        block.push_back("[" + profile + "]");
+    }
+    block.push_back("# " + comment);
+    for (int i = 0; i < AI_FEATURE_COUNT; ++i) {
+        value.str("");
+        value << coefficients[i];
+        block.push_back(std::string(featureKey(static_cast<AIFeature>(i))) + "=" + value.str());
+    }
+    value.str("");
+    value << nextPieceDiscount;
+    block.push_back(std::string(NEXT_PIECE_DISCOUNT_KEY) + "=" + value.str());
+
+    // The block replaces the [profile] section, or the shared keys (and the "#" comment save wrote with them)
+    // before the first section when profile is empty. The comments and blank lines ahead of the next section
+    // belong to it and are kept, as are the ";" comments heading the file.
+    std::size_t start = 0;
+    if (!profile.empty()) {
+        while (start < lines.size() && trim(lines[start]) != "[" + profile + "]") {
+            ++start;
+        }
+    }
+    std::size_t end = start + (profile.empty() || start == lines.size() ? 0 : 1);
+    while (end < lines.size() && !isSectionHeader(lines[end])) {
+        ++end;
+    }
+    while (end > start && (profile.empty() ? trim(lines[end - 1]).empty() : isBlankOrComment(lines[end - 1]))) {
+        --end;
+    }
+    std::vector<std::string> kept;
+    if (profile.empty()) {
+        // Comments of the file's own header stay above the keys
+        for (std::size_t i = start; i < end; ++i) {
+            if (trim(lines[i]).rfind(';', 0) == 0) {
+                kept.push_back(lines[i]);
+            }
+        }
+    } else if (start == lines.size() && !lines.empty() && !trim(lines.back()).empty()) {
+        kept.push_back("");  // a new section after the last one
+    }
+    block.insert(block.begin(), kept.begin(), kept.end());
+    lines.erase(lines.begin() + static_cast<std::ptrdiff_t>(start), lines.begin() + static_cast<std::ptrdiff_t>(end));
+    lines.insert(lines.begin() + static_cast<std::ptrdiff_t>(start), block.begin(), block.end());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Could not create AI weights file " << path << std::endl;
+        return false;
+    }
+    for (const std::string& line : lines) {
+        file << line << (crlf ? "\r\n" : "\n");
+    }
+    return file.good();
+}
+
+const AIWeights& AIWeights::configured() {
+    static const AIWeights weights = [] {
+        const ConfigManager& config = ConfigManager::getInstance();
+        const std::string& path = config.getAIWeightsFile();
+        AIWeights loaded;
+        if (path.empty()) {
+            return loaded;
+        }
+        if (!loaded.load(path, config.getAIProfile())) {
+            std::cerr << "Using the built-in AI weights" << std::endl;
+            return AIWeights();
+        }
+        std::cout << "Loaded AI weights from: " << path;
+        if (!config.getAIProfile().empty()) {
+            std::cout << " [" << config.getAIProfile() << "]";
+        }
+        std::cout << std::endl;
+        return loaded;
+    }();
+    return weights;
+}
@@ -0,0 +1,52 @@
+#ifndef AI_WEIGHTS_H
+#define AI_WEIGHTS_H
+
+#include <array>
+#include <string>
+
+// Board features SimpleAI rates a placement with, oriented so that more is better (penalties are negated)
+enum class AIFeature {
+    LINES,              // line clear bonus, 100 x lines^2
+    HOLES,              // -empty cells under a block
+    HEIGHT_DIFFERENCE,  // -(highest - lowest column)
+    HOLE_COLUMNS,       // -cells of deep one-wide wells
+    BUMPINESS,          // -height steps between columns
+    HEIGHT_SQUARED      // -highest column^2
+};
+
+constexpr int AI_FEATURE_COUNT = 6;
+using AIFeatures = std::array<double, AI_FEATURE_COUNT>;
+
+// A weights profile: one coefficient per feature, a board's value is their dot product. The defaults are the
+// original hand tuned values, other profiles (difficulty tiers, tuned weights) come from a file of key=value
+// lines where [name] sections hold the profiles and keys before any section apply to all of them.
+struct AIWeights {
+    AIFeatures coefficients = {1.0, 10.0, 2.0, 5.0, 1.0, 0.5};
+    double nextPieceDiscount = 0.5;  // AdvancedAI: share of the best next piece placement in a move's cost
+
+    double& operator[](AIFeature feature) { return coefficients[static_cast<int>(feature)]; }
+    double operator[](AIFeature feature) const { return coefficients[static_cast<int>(feature)]; }
+
+    double evaluate(const AIFeatures& features) const {
+        double value = 0.0;
+        for (int i = 0; i < AI_FEATURE_COUNT; ++i) {
+            value += features[i] * coefficients[i];
+        }
+        return value;
+    }
+
+    // Keys missing from the file keep their value. False (and an error on std::cerr) if the file cannot be read or
+    // has no section for a non-empty profile.
+    bool load(const std::string& path, const std::string& profile = "");
+    // Written as the [profile] section (the shared keys if empty) with comment on a "#" line. The rest of an
+    // existing file, other profiles and shared keys, is kept.
+    bool save(const std::string& path, const std::string& profile, const std::string& comment) const;
+
+    static const char* featureKey(AIFeature feature);
+
+    // Weights of the AIs the game creates: profile ai_profile of the file ai_weights from config.ini, loaded on
+    // first use, or the defaults
+    static const AIWeights& configured();
+};
+
+#endif
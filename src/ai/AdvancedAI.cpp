@@ -90,7 +90,7 @@ double AdvancedAI::computeCostWithPosition(const Board& board, const Tetromino&
             }
         }
         
-        return firstCost + (minNextCost == std::numeric_limits<double>::infinity() ? 0 : minNextCost * 0.5);
+        return firstCost + (minNextCost == std::numeric_limits<double>::infinity() ? 0 : minNextCost * weights().nextPieceDiscount);
     } else {
         return firstCost;
     }
@@ -5,6 +5,8 @@
 
 class AdvancedAI : public SimpleAI {
 public:
+    using SimpleAI::SimpleAI;
+
     std::pair<int, int> chooseMove(const GameState& state) override;
 
 private:
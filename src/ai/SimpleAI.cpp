@@ -2,6 +2,10 @@
 #include <limits>
 #include <cmath>
 
+SimpleAI::SimpleAI() : m_weights(AIWeights::configured()) {}
+
+SimpleAI::SimpleAI(const AIWeights& weights) : m_weights(weights) {}
+
 std::pair<int, int> SimpleAI::chooseMove(const GameState& state){
     double bestScore = -std::numeric_limits<double>::infinity(); // we have a maximization problem
     int bestRotation = 0;
@@ -49,18 +53,22 @@ std::pair<int, int> SimpleAI::chooseMove(const GameState& state){
 }
 
 double SimpleAI::boardEvaluation(const Board& board) const{
-    double nbHole = (double) calculateHoles(board);
+    return m_weights.evaluate(boardFeatures(board));
+}
+
+AIFeatures SimpleAI::boardFeatures(const Board& board) const{
     double maxH = (double) countMaxHeight(board);
     double minH = (double) countMinHeight(board);
-    double line = isLine(board);
-    double holeColumn = (double) countHoleColumn(board, 2);
-    double bump = (double) calculateBumpiness(board);
-    
-    
-    double heightPenalty = maxH * maxH * 0.5;
-    double heightDiff = maxH - minH;
     
-    return line - (nbHole * 10.0) - (heightDiff * 2.0) - (holeColumn * 5.0) - (bump * 1.0) - heightPenalty;
+    AIFeatures features;
+    const auto set = [&features](AIFeature feature, double value) { features[static_cast<int>(feature)] = value; };
+    set(AIFeature::LINES, isLine(board));
+    set(AIFeature::HOLES, -(double) calculateHoles(board));
+    set(AIFeature::HEIGHT_DIFFERENCE, -(maxH - minH));
+    set(AIFeature::HOLE_COLUMNS, -(double) countHoleColumn(board, 2));
+    set(AIFeature::BUMPINESS, -(double) calculateBumpiness(board));
+    set(AIFeature::HEIGHT_SQUARED, -(maxH * maxH));
+    return features;
 }
 
 
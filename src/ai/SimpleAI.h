@@ -2,15 +2,25 @@
 #define SIMPLEAI_H
 
 #include "AIPlayer.h"
+#include "AIWeights.h"
 
 class SimpleAI : public AIPlayer{
 public:
+    // With the weights from config.ini (AIWeights::configured)
+    SimpleAI();
+    explicit SimpleAI(const AIWeights& weights);
+
     std::pair<int, int> chooseMove(const GameState& state) override;
 
 protected:
+    // Dot product of the board's features with the weights
     double boardEvaluation(const Board& board) const override;
+    AIFeatures boardFeatures(const Board& board) const;
+    const AIWeights& weights() const { return m_weights; }
 
 private:
+    AIWeights m_weights;
+
     int calculateBumpiness(const Board& board) const;
     int calculateCompleteLines(const Board& board) const;
     int calculateHoles(const Board& board) const;
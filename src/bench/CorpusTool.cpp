@@ -0,0 +1,254 @@
+#include "../model/AIMode.h"
+#include "../model/GameState.h"
+#include "../replay/CorpusReader.h"
+#include "../replay/CorpusWriter.h"
+#include "../replay/SoloGame.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// tetris-corpus: generates corpus files of headless AI games, or streams existing ones and prints their statistics.
+// Usage: tetris-corpus <file.tcr>...
+//        tetris-corpus --generate <file.tcr> [--games 1000] [--mode simple-ai|advanced-ai] [--pieces 500]
+//                      [--seed 1] [--threads N]
+// Generation plays game i with seed + i through the 120 Hz solo loop of the AI modes (the games tetris-replay
+// would record), on all cores. Games are written in seed order, so the same options give the same file.
+
+namespace {
+
+constexpr std::size_t GAMES_PER_THREAD_BATCH = 16;
+constexpr std::uint16_t FULL_ROW = (1u << Board::Width) - 1;
+
+struct GenerateOptions {
+    std::string path;
+    Replay::Mode mode = Replay::Mode::ADVANCED_AI;
+    std::size_t games = 1000;
+    int maxPieces = 500;
+    std::uint32_t seed = 1;
+    unsigned threads = 0;  // 0: one per core
+};
+
+struct GeneratedGame {
+    Corpus::GameEntry entry{};
+    std::vector<Corpus::PieceRecord> pieces;
+};
+
+// One AI game: before each update the board the AI is about to see is kept, and when the update made a move it
+// becomes that piece's record. What a piece scored is known when the next one is played.
+void playGame(Replay::Mode mode, std::uint32_t seed, int maxPieces, GeneratedGame& game) {
+    SoloGame solo(mode, seed);
+    const GameState& state = solo.state();
+    const AIMode* aiMode = solo.aiMode();
+
+    game.pieces.clear();
+    int scoreAtMove = 0;
+    int linesAtMove = 0;
+    const auto settleLast = [&](int score, int lines) {
+        if (!game.pieces.empty()) {
+            game.pieces.back().scoreGained = static_cast<std::uint32_t>(score - scoreAtMove);
+            game.pieces.back().linesCleared = static_cast<std::uint8_t>(lines - linesAtMove);
+        }
+    };
+
+    while (!state.isGameOver()) {
+        const Board board = state.board();
+        const TetrominoType piece = state.currentPiece().getType();
+        const TetrominoType nextPiece = state.nextPiece().getType();
+        const int score = state.score();
+        const int lines = aiMode->getLinesCleared();
+
+        if (solo.step().empty()) {
+            continue;
+        }
+        settleLast(score, lines);
+        if (static_cast<int>(game.pieces.size()) == maxPieces) {
+            break;
+        }
+        Corpus::PieceRecord record{};
+        Corpus::packBoard(board, record);
+        record.piece = static_cast<std::uint8_t>(piece);
+        record.nextPiece = static_cast<std::uint8_t>(nextPiece);
+        record.rotation = static_cast<std::uint8_t>(aiMode->lastPlacement().first);
+        record.column = static_cast<std::int8_t>(aiMode->lastPlacement().second);
+        game.pieces.push_back(record);
+        scoreAtMove = score;
+        linesAtMove = lines;
+    }
+    if (state.isGameOver()) {
+        settleLast(state.score(), aiMode->getLinesCleared());
+    }
+
+    game.entry.seed = seed;
+    game.entry.score = static_cast<std::uint32_t>(state.score());
+    game.entry.linesCleared = static_cast<std::uint32_t>(aiMode->getLinesCleared());
+    game.entry.mode = static_cast<std::uint8_t>(mode);
+    game.entry.gameOver = state.isGameOver() ? 1 : 0;
+}
+
+bool generate(const GenerateOptions& options) {
+    CorpusWriter writer;
+    if (!writer.open(options.path)) {
+        return false;
+    }
+    const unsigned threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    const auto started = std::chrono::steady_clock::now();
+
+    // Batches of games played in parallel, then written in order
+    std::vector<GeneratedGame> batch(threads * GAMES_PER_THREAD_BATCH);
+    for (std::size_t first = 0; first < options.games; first += batch.size()) {
+        const std::size_t count = std::min(batch.size(), options.games - first);
+        std::atomic<std::size_t> next(0);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&]() {
+                for (std::size_t i = next++; i < count; i = next++) {
+                    const std::uint32_t seed = options.seed + static_cast<std::uint32_t>(first + i);
+                    playGame(options.mode, seed, options.maxPieces, batch[i]);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            writer.addGame(batch[i].entry, batch[i].pieces);
+        }
+    }
+
+    const std::uint64_t games = writer.gameCount();
+    const std::uint64_t pieces = writer.pieceCount();
+    if (!writer.finish()) {
+        return false;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Generated " << games << " " << Replay::modeName(options.mode) << " games (" << pieces
+              << " pieces) into " << options.path << " on " << threads << " threads in " << std::fixed
+              << std::setprecision(1) << seconds << " s" << std::endl;
+    return true;
+}
+
+// Holes (empty cells under a filled one) and stack height of a record's board, straight from its row masks
+void measureBoard(const Corpus::PieceRecord& record, int& holes, int& height) {
+    std::uint16_t covered = 0;
+    holes = 0;
+    height = 0;
+    for (int y = 0; y < Board::Height; ++y) {
+        const std::uint16_t row = record.rows[y];
+        if (row != 0 && height == 0) {
+            height = Board::Height - y;
+        }
+        holes += static_cast<int>(std::bitset<Board::Width>(~row & covered & FULL_ROW).count());
+        covered |= row;
+    }
+}
+
+// One streaming pass over the mapped file: per game totals from the index, per piece statistics from the records
+bool summarize(const std::string& path) {
+    const auto started = std::chrono::steady_clock::now();
+    CorpusReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+
+    std::uint64_t totalScore = 0;
+    std::uint64_t gamesOver = 0;
+    for (const Corpus::GameEntry& game : reader.games()) {
+        totalScore += game.score;
+        gamesOver += game.gameOver;
+    }
+
+    std::array<std::uint64_t, 7> pieceTypes{};
+    std::uint64_t lines = 0;
+    std::uint64_t holes = 0;
+    std::uint64_t height = 0;
+    for (const Corpus::PieceRecord& piece : reader.pieces()) {
+        int boardHoles = 0;
+        int boardHeight = 0;
+        measureBoard(piece, boardHoles, boardHeight);
+        holes += static_cast<std::uint64_t>(boardHoles);
+        height += static_cast<std::uint64_t>(boardHeight);
+        lines += piece.linesCleared;
+        if (piece.piece < pieceTypes.size()) {
+            ++pieceTypes[piece.piece];
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    const double games = std::max<double>(1.0, static_cast<double>(reader.games().size()));
+    const double pieces = std::max<double>(1.0, static_cast<double>(reader.pieces().size()));
+    std::cout << path << ": " << reader.games().size() << " games, " << reader.pieces().size() << " pieces, "
+              << reader.fileSize() << " bytes" << std::fixed << std::setprecision(1) << "\n  per game: score "
+              << static_cast<double>(totalScore) / games << ", " << pieces / games << " pieces, "
+              << 100.0 * static_cast<double>(gamesOver) / games << "% ended by game over"
+              << "\n  per piece: " << std::setprecision(3) << static_cast<double>(lines) / pieces << " lines, "
+              << static_cast<double>(holes) / pieces << " holes, height " << static_cast<double>(height) / pieces
+              << "\n  pieces I J L O S T Z:";
+    for (std::uint64_t count : pieceTypes) {
+        std::cout << " " << count;
+    }
+    std::cout << std::setprecision(1) << "\n  read in " << seconds * 1000.0 << " ms ("
+              << static_cast<double>(reader.fileSize()) / (1024.0 * 1024.0) / std::max(seconds, 1e-9) << " MB/s, "
+              << pieces / std::max(seconds, 1e-9) / 1e6 << " M pieces/s)" << std::endl;
+    return true;
+}
+
+void printUsage() {
+    std::cerr << "Usage: tetris-corpus <file.tcr>...\n"
+              << "       tetris-corpus --generate <file.tcr> [--games 1000] [--mode simple-ai|advanced-ai] "
+                 "[--pieces 500] [--seed 1] [--threads N]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    GenerateOptions generateOptions;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--generate" && hasValue) {
+            generateOptions.path = argv[++i];
+        } else if (arg == "--games" && hasValue) {
+            generateOptions.games = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--mode" && hasValue) {
+            // Only the AI modes play on their own
+            if (!Replay::parseMode(argv[++i], generateOptions.mode) || generateOptions.mode == Replay::Mode::LEVEL) {
+                std::cerr << "Unknown AI mode " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pieces" && hasValue) {
+            generateOptions.maxPieces = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            generateOptions.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--threads" && hasValue) {
+            generateOptions.threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (!arg.empty() && arg[0] != '-') {
+            files.push_back(arg);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (generateOptions.path.empty() && files.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    bool ok = true;
+    if (!generateOptions.path.empty()) {
+        ok = generate(generateOptions) && summarize(generateOptions.path);
+    }
+    for (const std::string& file : files) {
+        ok = summarize(file) && ok;
+    }
+    return ok ? 0 : 1;
+}
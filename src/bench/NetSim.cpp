@@ -0,0 +1,513 @@
+#include "../model/GameState.h"
+#include "../model/Random.h"
+#include "../network/NetworkManager.h"
+#include "../network/NetworkMatch.h"
+#include "../network/SimulatedTransport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// tetris-netsim: LAN matches between two simulated clients in one process.
+// Usage: tetris-netsim [--mode match|pose] [--matches 20] [--seconds 60] [--sync rollback|lockstep] [--latency 40]
+//                      [--jitter 20] [--loss 5] [--reorder 2] [--bandwidth 0] [--outages 0] [--clock simulated|real]
+//                      [--seed 1]
+// Latency and jitter are in ms (one way), loss and reorder in percent, bandwidth in KB/s (0 for unlimited).
+// Each client is a NetworkManager over a SimulatedTransport running the match loop of the game (NetworkMatch,
+// lockstep or rollback, versus garbage) with bot inputs. --outages cuts the link that many times per match for
+// OUTAGE_US, long enough for both sides to drop it and resume the session. On the simulated clock the managers
+// are stepped without their network thread and the matches play as fast as the CPU allows; --clock real runs
+// their threads on the real clock, all matches at once. Once both clients have played every tick, each one's
+// copy of the opponent must equal the opponent's own board; a match that diverges, loses its connection or
+// never completes is reported and fails the run.
+// --mode pose instead streams a piece pose per tick for --seconds over each match's link, once RELIABLE and once
+// UNRELIABLE (newest wins), on the simulated clock. It prints the p50 and p99 latency of the poses the receiver
+// applied for both, and fails unless UNRELIABLE does better: lower p99, p50 no higher.
+
+namespace {
+
+constexpr unsigned short PORT = 53000;
+constexpr std::int64_t STEP_US = 1000;  // time between two client updates
+constexpr std::int64_t TICK_US = 1000000 / 60;
+constexpr std::int64_t OUTAGE_US = 3000000;  // longer than NetworkManager's link timeout, within its reconnect window
+
+struct Options {
+    bool poseLatency = false;
+    int matches = 20;
+    int seconds = 60;
+    SyncMode syncMode = SyncMode::ROLLBACK;
+    SimulatedNetwork::LinkSettings link;
+    int outages = 0;
+    bool realClock = false;
+    std::uint32_t seed = 1;
+};
+
+bool sameGame(const GameState& a, const GameState& b) {
+    for (int y = 0; y < Board::Height; ++y) {
+        for (int x = 0; x < Board::Width; ++x) {
+            if (a.board().getCell(x, y) != b.board().getCell(x, y)) {
+                return false;
+            }
+        }
+    }
+    return a.pieceX() == b.pieceX() && a.pieceY() == b.pieceY() &&
+           a.currentPiece().getType() == b.currentPiece().getType() &&
+           a.currentPiece().getRotationState() == b.currentPiece().getRotationState() && a.score() == b.score() &&
+           a.isGameOver() == b.isGameOver() && a.pendingGarbage() == b.pendingGarbage();
+}
+
+// One side of a match: what GameController does during a lockstep or rollback match, minus window and input
+class SimClient {
+public:
+    SimClient(const std::shared_ptr<SimulatedNetwork>& network, bool networkThread, std::uint32_t botSeed,
+              std::uint32_t matchTicks)
+        : m_network(network),
+          m_manager(std::make_unique<SimulatedTransport>(network), networkThread),
+          m_bot(botSeed),
+          m_matchTicks(matchTicks) {
+        m_manager.setTrafficLogInterval(0.0f);
+        m_match.setEndTick(matchTicks);
+    }
+
+    // The host starts the match as soon as the client is there
+    bool host(const MatchStart& start) {
+        m_start = start;
+        return m_manager.host(PORT);
+    }
+    bool connect() { return m_manager.connect("127.0.0.1", PORT); }
+
+    // The network thread's work, when the manager has none
+    void poll() { m_manager.poll(); }
+
+    void update() {
+        const std::int64_t nowUs = m_network->nowUs();
+        const float deltaTime = static_cast<float>(nowUs - m_lastUpdateUs) / 1e6f;
+        m_lastUpdateUs = nowUs;
+
+        m_manager.update();
+        if (!m_started) {
+            if (m_manager.isHost() && m_manager.isConnected()) {
+                m_manager.sendMatchStart(m_start);
+                startMatch(m_start);
+            } else if (auto start = m_manager.takeMatchStart()) {
+                startMatch(*start);
+            }
+            return;
+        }
+
+        if (!m_manager.isConnected()) {
+            m_lost = true;
+            return;
+        }
+        // Like the game, the match holds while the link is down and carries on once the session resumed
+        if (m_manager.isReconnecting()) {
+            m_wasReconnecting = true;
+            return;
+        }
+        if (m_wasReconnecting) {
+            m_wasReconnecting = false;
+            ++resumes;
+        }
+        m_match.update(deltaTime, m_local, m_remote, m_manager, [this] { return sampleInput(); });
+    }
+
+    // Every tick played, and in rollback every one of them confirmed by the opponent's real inputs
+    bool isDone() const { return m_started && m_match.currentTick() >= m_matchTicks && m_match.isConfirmed(); }
+    bool isLost() const { return m_lost; }
+
+    const GameState& local() const { return m_local; }
+    const GameState& remote() const { return m_remote; }
+    const NetworkMatch::Stats& stats() const { return m_match.stats(); }
+
+    std::uint32_t resumes = 0;
+
+private:
+    std::shared_ptr<SimulatedNetwork> m_network;
+    NetworkManager m_manager;
+    Random m_bot;
+    std::uint32_t m_matchTicks;
+    std::int64_t m_lastUpdateUs = 0;
+
+    MatchStart m_start;
+    bool m_started = false;
+    bool m_lost = false;
+    bool m_wasReconnecting = false;
+    GameState m_local;
+    GameState m_remote;
+    NetworkMatch m_match;
+
+    void startMatch(const MatchStart& start) {
+        m_match.start(start, m_local, m_remote);
+        m_started = true;
+    }
+
+    // A bot presses something on about one tick in six
+    InputFrame sampleInput() {
+        InputFrame frame;
+        if (!m_local.isGameOver() && m_bot.nextInt(6) == 0) {
+            frame.count = 1;
+            frame.actions[0] = static_cast<InputAction>(m_bot.nextInt(INPUT_ACTION_COUNT));
+        }
+        return frame;
+    }
+};
+
+// A match and its own link
+struct SimMatch {
+    int index = 0;
+    std::shared_ptr<SimulatedNetwork> network;
+    SimulatedNetwork::LinkSettings link;
+    std::unique_ptr<SimClient> host;
+    std::unique_ptr<SimClient> client;
+    std::vector<std::int64_t> outageStartsUs;  // on the network's clock
+    bool linkDown = false;
+    std::int64_t limitUs = 0;
+    bool finished = false;
+
+    // Cut the link (every datagram lost) during an outage, restore it afterwards
+    void updateOutages() {
+        const std::int64_t nowUs = network->nowUs();
+        bool down = false;
+        for (std::int64_t startUs : outageStartsUs) {
+            down = down || (nowUs >= startUs && nowUs < startUs + OUTAGE_US);
+        }
+        if (down != linkDown) {
+            SimulatedNetwork::LinkSettings settings = link;
+            settings.lossRate = down ? 1.0f : link.lossRate;
+            network->setSettings(settings);
+            linkDown = down;
+        }
+    }
+
+    bool isDone() const {
+        return (host->isDone() && client->isDone()) || host->isLost() || client->isLost() || network->nowUs() >= limitUs;
+    }
+};
+
+struct Totals {
+    int passed = 0;
+    int diverged = 0;
+    int incomplete = 0;
+    double simulatedSeconds = 0.0;
+    std::uint64_t resimulatedTicks = 0;
+    std::uint32_t longestRollback = 0;
+    double stalledSeconds = 0.0;
+    std::uint64_t droppedInputs = 0;
+    std::uint32_t resumes = 0;
+    SimulatedNetwork::Stats link;
+};
+
+std::unique_ptr<SimMatch> createMatch(const Options& options, int index) {
+    auto match = std::make_unique<SimMatch>();
+    match->index = index;
+    match->link = options.link;
+    match->link.seed = options.seed * 7919u + static_cast<std::uint32_t>(index);
+    match->network = std::make_shared<SimulatedNetwork>(match->link, !options.realClock);
+
+    const std::uint32_t matchTicks = static_cast<std::uint32_t>(options.seconds) * 60;
+    match->host = std::make_unique<SimClient>(match->network, options.realClock, match->link.seed ^ 0x51u, matchTicks);
+    match->client = std::make_unique<SimClient>(match->network, options.realClock, match->link.seed ^ 0xA7u, matchTicks);
+
+    MatchStart start;
+    start.seed = match->link.seed;
+    start.syncMode = options.syncMode;
+    start.versus = true;
+    if (!match->host->host(start) || !match->client->connect()) {
+        match->finished = true;
+    }
+
+    // Outages somewhere in the match, after it started
+    const std::int64_t nowUs = match->network->nowUs();
+    Random random(match->link.seed ^ 0x0D7Au);
+    for (int i = 0; i < options.outages; ++i) {
+        match->outageStartsUs.push_back(nowUs + 1000000 +
+                                        static_cast<std::int64_t>(random.nextInt(options.seconds * 1000)) * 1000);
+    }
+
+    // Generous limit: every tick stalled for a few round trips, and every outage, still finish well before it
+    match->limitUs = nowUs + static_cast<std::int64_t>(matchTicks) * TICK_US * 4 + 30000000 +
+                     options.outages * (OUTAGE_US + 10000000);
+    return match;
+}
+
+// The match is over: count it as identical, diverged or incomplete
+bool finishMatch(const SimMatch& match, Totals& totals) {
+    const bool done = match.host->isDone() && match.client->isDone();
+    const bool same = done && sameGame(match.host->local(), match.client->remote()) &&
+                      sameGame(match.client->local(), match.host->remote());
+    if (!done) {
+        ++totals.incomplete;
+        std::cout << "match " << match.index << ": "
+                  << (match.host->isLost() || match.client->isLost() ? "connection lost" : "did not complete")
+                  << std::endl;
+    } else if (!same) {
+        ++totals.diverged;
+        std::cout << "match " << match.index << ": boards diverged" << std::endl;
+    } else {
+        ++totals.passed;
+    }
+
+    totals.simulatedSeconds += static_cast<double>(match.network->nowUs() - 1000000) / 1e6;
+    for (const SimClient* side : {match.host.get(), match.client.get()}) {
+        const NetworkMatch::Stats& stats = side->stats();
+        totals.resimulatedTicks += stats.resimulatedTicks;
+        totals.longestRollback = std::max(totals.longestRollback, stats.longestRollback);
+        totals.stalledSeconds += stats.stalledSeconds;
+        totals.droppedInputs += stats.droppedInputs;
+    }
+    totals.resumes += match.client->resumes;
+    const SimulatedNetwork::Stats stats = match.network->stats();
+    totals.link.datagrams += stats.datagrams;
+    totals.link.bytes += stats.bytes;
+    totals.link.lost += stats.lost;
+    totals.link.queueDrops += stats.queueDrops;
+    totals.link.reordered += stats.reordered;
+    return done && same;
+}
+
+// Simulated clock: one match after the other, each step moves its clock and then runs both managers and clients
+void runSimulated(const Options& options, Totals& totals) {
+    for (int index = 0; index < options.matches; ++index) {
+        std::unique_ptr<SimMatch> match = createMatch(options, index);
+        while (!match->finished && !match->isDone()) {
+            match->network->advance(STEP_US);
+            match->updateOutages();
+            match->host->poll();
+            match->client->poll();
+            match->host->update();
+            match->client->update();
+        }
+        finishMatch(*match, totals);
+    }
+}
+
+// Real clock: all matches at once, the managers' threads run the links and this one updates the clients
+void runRealTime(const Options& options, Totals& totals) {
+    std::vector<std::unique_ptr<SimMatch>> matches;
+    for (int index = 0; index < options.matches; ++index) {
+        matches.push_back(createMatch(options, index));
+    }
+    std::size_t running = 0;
+    for (const std::unique_ptr<SimMatch>& match : matches) {
+        running += match->finished ? 0 : 1;
+    }
+    while (running > 0) {
+        for (const std::unique_ptr<SimMatch>& match : matches) {
+            if (match->finished) {
+                continue;
+            }
+            match->updateOutages();
+            match->host->update();
+            match->client->update();
+            if (match->isDone()) {
+                match->finished = true;
+                --running;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(STEP_US));
+    }
+    for (const std::unique_ptr<SimMatch>& match : matches) {
+        finishMatch(*match, totals);
+    }
+}
+
+// Poses streamed with one delivery: applied poses' latencies in microseconds, sorted
+struct PoseLatencies {
+    std::vector<std::int64_t> latenciesUs;
+    std::uint64_t sent = 0;
+    std::uint64_t skipped = 0;  // lost, or overtaken by a newer pose before they arrived
+
+    double percentileMs(double percentile) const {
+        if (latenciesUs.empty()) {
+            return 0.0;
+        }
+        const std::size_t index = std::min(latenciesUs.size() - 1,
+                                           static_cast<std::size_t>(percentile / 100.0 * latenciesUs.size()));
+        return static_cast<double>(latenciesUs[index]) / 1000.0;
+    }
+};
+
+// One pose per tick between two SimulatedTransports, on the link each match would get. A pose carries its number
+// and send time; the receiver applies it only if it is newer than the last one applied.
+PoseLatencies measurePoses(const Options& options, Delivery delivery) {
+    PoseLatencies result;
+    const std::uint32_t poses = static_cast<std::uint32_t>(options.seconds) * 60;
+    for (int index = 0; index < options.matches; ++index) {
+        SimulatedNetwork::LinkSettings link = options.link;
+        link.seed = options.seed * 7919u + static_cast<std::uint32_t>(index);
+        auto network = std::make_shared<SimulatedNetwork>(link, true);
+        SimulatedTransport sender(network);
+        SimulatedTransport receiver(network);
+        if (!sender.host(PORT) || !receiver.connect("127.0.0.1", PORT)) {
+            continue;
+        }
+        sender.update();  // accept the receiver
+
+        std::uint8_t pose[sizeof(std::uint32_t) + sizeof(std::int64_t)];
+        std::vector<std::uint8_t> message;
+        std::uint32_t nextPose = 0;
+        std::int64_t nextPoseUs = network->nowUs();
+        std::uint32_t applied = 0;  // newest pose applied plus one
+        // Stragglers get a few seconds after the last pose
+        const std::int64_t endUs = nextPoseUs + static_cast<std::int64_t>(poses) * TICK_US + 5000000;
+        while (network->nowUs() < endUs) {
+            network->advance(STEP_US);
+            const std::int64_t nowUs = network->nowUs();
+            if (nextPose < poses && nowUs >= nextPoseUs) {
+                std::memcpy(pose, &nextPose, sizeof(std::uint32_t));
+                std::memcpy(pose + sizeof(std::uint32_t), &nowUs, sizeof(std::int64_t));
+                sender.send(pose, sizeof(pose), delivery);
+                ++nextPose;
+                nextPoseUs += TICK_US;
+            }
+            sender.update();
+            receiver.update();
+            while (receiver.receive(message)) {
+                std::uint32_t number = 0;
+                std::int64_t sentUs = 0;
+                std::memcpy(&number, message.data(), sizeof(std::uint32_t));
+                std::memcpy(&sentUs, message.data() + sizeof(std::uint32_t), sizeof(std::int64_t));
+                if (number >= applied) {
+                    result.latenciesUs.push_back(nowUs - sentUs);
+                    applied = number + 1;
+                }
+            }
+        }
+        result.sent += nextPose;
+    }
+    result.skipped = result.sent - result.latenciesUs.size();
+    std::sort(result.latenciesUs.begin(), result.latenciesUs.end());
+    return result;
+}
+
+// RELIABLE against UNRELIABLE poses over the same links, true if UNRELIABLE has the lower latency
+bool comparePoseLatency(const Options& options) {
+    const PoseLatencies reliable = measurePoses(options, Delivery::RELIABLE);
+    const PoseLatencies unreliable = measurePoses(options, Delivery::UNRELIABLE);
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (const auto& entry : {std::make_pair("reliable", &reliable), std::make_pair("unreliable", &unreliable)}) {
+        const PoseLatencies& poses = *entry.second;
+        std::cout << "pose latency " << std::setw(10) << std::left << entry.first << std::right << ": p50 "
+                  << poses.percentileMs(50.0) << " ms, p99 " << poses.percentileMs(99.0) << " ms, "
+                  << poses.latenciesUs.size() << " of " << poses.sent << " poses applied, " << poses.skipped
+                  << " skipped" << std::endl;
+    }
+    const bool better = unreliable.percentileMs(99.0) < reliable.percentileMs(99.0) &&
+                        unreliable.percentileMs(50.0) <= reliable.percentileMs(50.0);
+    if (!better) {
+        std::cout << "unreliable poses are not faster than reliable ones" << std::endl;
+    }
+    return better;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    options.link.latencyUs = 40000;
+    options.link.jitterUs = 20000;
+    options.link.lossRate = 0.05f;
+    options.link.reorderRate = 0.02f;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--mode") {
+            if (value == "pose") {
+                options.poseLatency = true;
+            } else if (value == "match") {
+                options.poseLatency = false;
+            } else {
+                std::cerr << "Unknown mode " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "--matches") {
+            options.matches = std::max(1, std::atoi(value.c_str()));
+        } else if (option == "--seconds") {
+            options.seconds = std::max(1, std::atoi(value.c_str()));
+        } else if (option == "--sync") {
+            if (value == "lockstep") {
+                options.syncMode = SyncMode::LOCKSTEP;
+            } else if (value == "rollback") {
+                options.syncMode = SyncMode::ROLLBACK;
+            } else {
+                std::cerr << "Unknown sync mode " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "--latency") {
+            options.link.latencyUs = std::max(0, std::atoi(value.c_str())) * 1000;
+        } else if (option == "--jitter") {
+            options.link.jitterUs = std::max(0, std::atoi(value.c_str())) * 1000;
+        } else if (option == "--loss") {
+            options.link.lossRate = std::clamp(static_cast<float>(std::atof(value.c_str())) / 100.0f, 0.0f, 1.0f);
+        } else if (option == "--reorder") {
+            options.link.reorderRate = std::clamp(static_cast<float>(std::atof(value.c_str())) / 100.0f, 0.0f, 1.0f);
+        } else if (option == "--bandwidth") {
+            options.link.bandwidthBytesPerSecond = static_cast<std::uint64_t>(std::max(0, std::atoi(value.c_str()))) * 1000;
+        } else if (option == "--outages") {
+            options.outages = std::max(0, std::atoi(value.c_str()));
+        } else if (option == "--clock") {
+            if (value == "real") {
+                options.realClock = true;
+            } else if (value == "simulated") {
+                options.realClock = false;
+            } else {
+                std::cerr << "Unknown clock " << value << std::endl;
+                return 1;
+            }
+        } else if (option == "--seed") {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "tetris-netsim: " << options.matches << (options.poseLatency ? " pose streams" : " matches")
+              << " of " << options.seconds << " s, ";
+    if (!options.poseLatency) {
+        std::cout << (options.syncMode == SyncMode::LOCKSTEP ? "lockstep" : "rollback") << ", ";
+    }
+    std::cout << "latency " << options.link.latencyUs / 1000 << " ms + jitter " << options.link.jitterUs / 1000
+              << " ms, loss " << options.link.lossRate * 100.0f << "%, reorder " << options.link.reorderRate * 100.0f
+              << "%, bandwidth "
+              << (options.link.bandwidthBytesPerSecond > 0 ? std::to_string(options.link.bandwidthBytesPerSecond / 1000) + " KB/s"
+                                                           : std::string("unlimited"));
+    if (!options.poseLatency) {
+        std::cout << ", " << options.outages << " outages per match, " << (options.realClock ? "real" : "simulated")
+                  << " clock";
+    }
+    std::cout << std::endl;
+    if (options.poseLatency) {
+        return comparePoseLatency(options) ? 0 : 1;
+    }
+
+    Totals totals;
+    const auto wallStart = std::chrono::steady_clock::now();
+    if (options.realClock) {
+        runRealTime(options, totals);
+    } else {
+        runSimulated(options, totals);
+    }
+    const double wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "matches: " << totals.passed << " identical, " << totals.diverged << " diverged, " << totals.incomplete
+              << " incomplete" << std::endl;
+    std::cout << "time: " << totals.simulatedSeconds << " s simulated in " << wallSeconds << " s ("
+              << totals.simulatedSeconds / std::max(wallSeconds, 1e-6) << "x real time)" << std::endl;
+    std::cout << "link: " << totals.link.datagrams << " datagrams, " << totals.link.bytes / 1024 << " KB, "
+              << totals.link.lost << " lost, " << totals.link.reordered << " reordered, " << totals.link.queueDrops
+              << " queue drops, " << totals.resumes << " sessions resumed" << std::endl;
+    std::cout << "sync: " << totals.resimulatedTicks << " ticks re-simulated (longest rollback "
+              << totals.longestRollback << "), " << totals.stalledSeconds << " s waiting for the opponent, "
+              << totals.droppedInputs << " inputs outside the window" << std::endl;
+    return totals.passed == options.matches ? 0 : 1;
+}
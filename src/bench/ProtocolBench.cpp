@@ -0,0 +1,259 @@
+#include "../model/Random.h"
+#include "../network/Framing.h"
+#include "../network/Protocol.h"
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// tetris-bench: serialize/deserialize throughput of the game state stream, old paths against the current one.
+// Usage: tetris-bench [--states 200000]
+//  - fields: a new sf::Packet per state with all 218 fields pushed through operator<< / operator>>
+//  - packet: Protocol keyframes/deltas, each wrapped in a new sf::Packet (TcpTransport before pooled framing)
+//  - framed: Protocol keyframes/deltas framed in reused buffers (Framing.h), as TcpTransport does now
+// Every path writes its frames into one preallocated stream standing in for the socket and reads them back.
+// Allocations are counted by replacing the global operator new.
+
+static std::uint64_t g_allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++g_allocations;
+    if (void* memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A game-like sequence: a piece falls one row per state, drifts sideways and locks on the stack,
+// full rows are cleared and score follows
+std::vector<PacketData> makeStates(int count) {
+    std::vector<PacketData> states;
+    states.reserve(static_cast<std::size_t>(count));
+    Random random(42);
+    PacketData state;
+    state.currentPieceType = 1;
+    for (int i = 0; i < count; ++i) {
+        const int x = state.currentPieceX;
+        const int below = state.currentPieceY + 1;
+        if (below >= Protocol::ROWS || state.grid[below][x] != 0) {
+            state.grid[state.currentPieceY][x] = state.currentPieceType;
+            for (int y = 0; y < Protocol::ROWS; ++y) {
+                bool full = true;
+                for (int column = 0; column < Protocol::COLUMNS && full; ++column) {
+                    full = state.grid[y][column] != 0;
+                }
+                if (full) {
+                    for (int row = y; row > 0; --row) {
+                        std::memcpy(state.grid[row], state.grid[row - 1], sizeof(state.grid[row]));
+                    }
+                    std::memset(state.grid[0], 0, sizeof(state.grid[0]));
+                    state.score += 100 * state.level;
+                }
+            }
+            if (state.grid[1][x] != 0) {
+                state = PacketData();  // topped out, start over
+            }
+            state.currentPieceType = 1 + random.nextInt(7);
+            state.currentPieceX = random.nextInt(Protocol::COLUMNS);
+            state.currentPieceY = 0;
+            state.currentPieceRotation = random.nextInt(4);
+        } else {
+            state.currentPieceY = below;
+            if (random.nextInt(4) == 0) {
+                const int side = state.currentPieceX + (random.nextInt(2) == 0 ? -1 : 1);
+                if (side >= 0 && side < Protocol::COLUMNS && state.grid[state.currentPieceY][side] == 0) {
+                    state.currentPieceX = side;
+                }
+            }
+        }
+        states.push_back(state);
+    }
+    return states;
+}
+
+struct Result {
+    std::string name;
+    double encodeNs = 0.0;  // per state
+    double decodeNs = 0.0;
+    double bytes = 0.0;
+    double allocations = 0.0;
+    bool matches = false;  // the last decoded state equals the last one sent
+};
+
+bool sameState(const PacketData& a, const PacketData& b) {
+    return std::memcmp(a.grid, b.grid, sizeof(a.grid)) == 0 && a.currentPieceType == b.currentPieceType &&
+           a.currentPieceX == b.currentPieceX && a.currentPieceY == b.currentPieceY &&
+           a.currentPieceRotation == b.currentPieceRotation && a.score == b.score && a.level == b.level &&
+           a.isGameOver == b.isGameOver && a.isReady == b.isReady;
+}
+
+double nanoseconds(Clock::time_point start, Clock::time_point end, std::size_t count) {
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(count);
+}
+
+Result benchFields(const std::vector<PacketData>& states, std::vector<std::uint8_t>& stream) {
+    Result result;
+    result.name = "fields";
+    stream.clear();
+    std::uint64_t allocations = g_allocations;
+
+    const auto encodeStart = Clock::now();
+    for (const PacketData& state : states) {
+        sf::Packet packet;
+        for (int y = 0; y < Protocol::ROWS; ++y) {
+            for (int x = 0; x < Protocol::COLUMNS; ++x) {
+                packet << state.grid[y][x];
+            }
+        }
+        packet << state.currentPieceType << state.currentPieceX << state.currentPieceY << state.currentPieceRotation
+               << state.score << state.level << state.isGameOver << state.isReady;
+        Framing::appendFrame(stream, static_cast<const std::uint8_t*>(packet.getData()), packet.getDataSize());
+    }
+    const auto encodeEnd = Clock::now();
+    allocations = g_allocations - allocations;
+
+    // These frames are longer than FrameReader accepts, split the stream by hand
+    const std::uint64_t decodeAllocations = g_allocations;
+    PacketData decoded;
+    const auto decodeStart = Clock::now();
+    for (std::size_t offset = 0; offset + Framing::LENGTH_SIZE <= stream.size();) {
+        const std::uint8_t* header = stream.data() + offset;
+        const std::size_t size = (static_cast<std::size_t>(header[0]) << 24) | (static_cast<std::size_t>(header[1]) << 16) |
+                                 (static_cast<std::size_t>(header[2]) << 8) | header[3];
+        offset += Framing::LENGTH_SIZE + size;
+        sf::Packet packet;
+        packet.append(header + Framing::LENGTH_SIZE, size);
+        for (int y = 0; y < Protocol::ROWS; ++y) {
+            for (int x = 0; x < Protocol::COLUMNS; ++x) {
+                packet >> decoded.grid[y][x];
+            }
+        }
+        packet >> decoded.currentPieceType >> decoded.currentPieceX >> decoded.currentPieceY >>
+            decoded.currentPieceRotation >> decoded.score >> decoded.level >> decoded.isGameOver >> decoded.isReady;
+    }
+    const auto decodeEnd = Clock::now();
+    allocations += g_allocations - decodeAllocations;
+
+    result.encodeNs = nanoseconds(encodeStart, encodeEnd, states.size());
+    result.decodeNs = nanoseconds(decodeStart, decodeEnd, states.size());
+    result.bytes = static_cast<double>(stream.size()) / static_cast<double>(states.size());
+    result.allocations = static_cast<double>(allocations) / static_cast<double>(states.size());
+    result.matches = sameState(decoded, states.back());
+    return result;
+}
+
+Result benchProtocol(const std::vector<PacketData>& states, std::vector<std::uint8_t>& stream, bool pooled) {
+    Result result;
+    result.name = pooled ? "framed" : "packet";
+    stream.clear();
+    Protocol::StateEncoder encoder;
+    Protocol::StateDecoder decoder;
+    std::vector<std::uint8_t> message;
+    std::vector<std::uint8_t> received;
+    std::uint64_t allocations = g_allocations;
+
+    const auto encodeStart = Clock::now();
+    for (const PacketData& state : states) {
+        if (!encoder.encode(state, message)) {
+            continue;  // unchanged, nothing is sent
+        }
+        if (pooled) {
+            Framing::appendFrame(stream, message);
+        } else {
+            sf::Packet packet;
+            packet.append(message.data(), message.size());
+            Framing::appendFrame(stream, static_cast<const std::uint8_t*>(packet.getData()), packet.getDataSize());
+        }
+    }
+    const auto encodeEnd = Clock::now();
+    allocations = g_allocations - allocations;
+
+    Framing::FrameReader reader;
+    reader.buffer() = stream;  // stands in for the socket reads, not counted
+    const std::uint64_t decodeAllocations = g_allocations;
+    const std::uint8_t* frame = nullptr;
+    std::size_t size = 0;
+    bool valid = true;
+    const auto decodeStart = Clock::now();
+    while (reader.next(frame, size)) {
+        Protocol::DecodeResult decoded;
+        if (pooled) {
+            decoded = decoder.decode(frame, size);
+        } else {
+            sf::Packet packet;
+            packet.append(frame, size);
+            const auto* bytes = static_cast<const std::uint8_t*>(packet.getData());
+            received.assign(bytes, bytes + packet.getDataSize());
+            decoded = decoder.decode(received.data(), received.size());
+        }
+        valid = valid && decoded == Protocol::DecodeResult::STATE_UPDATED;
+    }
+    const auto decodeEnd = Clock::now();
+    allocations += g_allocations - decodeAllocations;
+
+    result.encodeNs = nanoseconds(encodeStart, encodeEnd, states.size());
+    result.decodeNs = nanoseconds(decodeStart, decodeEnd, states.size());
+    result.bytes = static_cast<double>(stream.size()) / static_cast<double>(states.size());
+    result.allocations = static_cast<double>(allocations) / static_cast<double>(states.size());
+    result.matches = valid && sameState(decoder.state(), states.back());
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int count = 200000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        if (option == "--states") {
+            count = std::max(1, std::atoi(argv[i + 1]));
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    const std::vector<PacketData> states = makeStates(count);
+    // Room for the largest path (fields: 218 values of up to 4 bytes each), so the stream never grows,
+    // and touch it once so no path pays for the page faults
+    std::vector<std::uint8_t> stream(states.size() * (Framing::LENGTH_SIZE + sizeof(PacketData)));
+
+    // One untimed round first so every path starts warm
+    benchProtocol(states, stream, true);
+
+    const Result results[] = {benchFields(states, stream), benchProtocol(states, stream, false),
+                              benchProtocol(states, stream, true)};
+
+    std::cout << "tetris-bench: " << count << " game states" << std::endl;
+    std::cout << std::left << std::setw(8) << "path" << std::right << std::setw(12) << "encode ns" << std::setw(12)
+              << "decode ns" << std::setw(12) << "states/s" << std::setw(10) << "bytes" << std::setw(10) << "allocs"
+              << "  (per state)" << std::endl;
+    bool ok = true;
+    for (const Result& result : results) {
+        std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(8) << result.name << std::right
+                  << std::setw(12) << result.encodeNs << std::setw(12) << result.decodeNs << std::setw(12)
+                  << std::setprecision(0) << 1e9 / (result.encodeNs + result.decodeNs) << std::setw(10)
+                  << std::setprecision(1) << result.bytes << std::setw(10) << std::setprecision(2) << result.allocations
+                  << (result.matches ? "" : "  MISMATCH") << std::endl;
+        ok = ok && result.matches;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+#include "../model/GameState.h"
+#include "../model/Random.h"
+#include "../replay/ReplayReader.h"
+#include "../replay/ReplayWriter.h"
+#include "../replay/SoloGame.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// tetris-replay: checks replay files, or records headless bot games into new ones.
+// Usage: tetris-replay <file.trp>...
+//        tetris-replay --record <file.trp> [--mode level|simple-ai|advanced-ai] [--minutes 10] [--seed 1]
+// Checking plays each file through a GameState and compares the final state with the one recorded, then seeks
+// to SEEK_SAMPLES positions in random order and compares each with the state linear playback had there.
+// Recording runs the solo game loop of GameController at 120 Hz: the AI modes play themselves, the level mode
+// gets a random key press (no hard drop) every few steps. A recording ends at game over or after --minutes.
+
+namespace {
+
+constexpr int SEEK_SAMPLES = 50;
+
+struct RecordOptions {
+    std::string path;
+    Replay::Mode mode = Replay::Mode::ADVANCED_AI;
+    int minutes = 10;
+    std::uint32_t seed = 1;
+};
+
+std::string formatTicks(std::uint32_t ticks, std::uint32_t tickRate) {
+    const std::uint32_t seconds = ticks / tickRate;
+    std::string text = std::to_string(seconds / 60) + ":";
+    if (seconds % 60 < 10) {
+        text += "0";
+    }
+    return text + std::to_string(seconds % 60);
+}
+
+// Seek in random order, each position must match what stepping from the start gave there
+bool checkSeeking(ReplayReader& reader, double& slowestMs) {
+    Random random(reader.header().seed);
+    std::vector<std::uint32_t> ticks;
+    for (int i = 0; i < SEEK_SAMPLES; ++i) {
+        ticks.push_back(static_cast<std::uint32_t>(random.next() % (reader.length() + 1)));
+    }
+    ticks.push_back(0);
+    ticks.push_back(reader.length());
+    std::sort(ticks.begin(), ticks.end());
+
+    GameState state;
+    std::vector<std::uint32_t> expected;
+    reader.start(state);
+    for (std::uint32_t tick : ticks) {
+        while (reader.tick() < tick) {
+            reader.step(state);
+        }
+        expected.push_back(Replay::checksum(state));
+    }
+
+    slowestMs = 0.0;
+    bool ok = true;
+    for (std::size_t n = 0; n < ticks.size(); ++n) {
+        const std::size_t i = (n * 7919) % ticks.size();  // jump around, back and forth
+        const auto started = std::chrono::steady_clock::now();
+        reader.seek(ticks[i], state);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        slowestMs = std::max(slowestMs, ms);
+        if (reader.tick() != ticks[i] || Replay::checksum(state) != expected[i]) {
+            std::cout << "  seek to tick " << ticks[i] << " gives a different game" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool checkReplay(const std::string& path) {
+    ReplayReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+
+    GameState state;
+    const bool matches = reader.play(state);
+    double slowestSeekMs = 0.0;
+    const bool seeks = checkSeeking(reader, slowestSeekMs);
+    const Replay::Header& header = reader.header();
+    const float minutes = static_cast<float>(reader.length()) / static_cast<float>(header.tickRate) / 60.0f;
+    std::cout << path << ": " << Replay::modeName(header.mode) << ", seed " << header.seed << ", "
+              << formatTicks(reader.length(), header.tickRate) << ", score " << state.score() << ", "
+              << reader.fileSize() << " bytes";
+    if (minutes > 0.0f) {
+        std::cout << " (" << std::fixed << std::setprecision(0) << static_cast<float>(reader.fileSize()) / minutes
+                  << " B/min)";
+    }
+    if (!reader.hasEnd()) {
+        std::cout << ", no end record (not verified)";
+    } else if (matches) {
+        std::cout << ", verified";
+    } else {
+        std::cout << ", MISMATCH (recorded score " << reader.endScore() << ")";
+    }
+    std::cout << ", " << reader.keyframeCount() << " keyframes, slowest seek " << std::setprecision(2) << slowestSeekMs
+              << " ms" << std::endl;
+    return matches && seeks;
+}
+
+// What GameController::update does for a solo game, with a bot in place of the keyboard
+bool recordGame(const RecordOptions& options) {
+    SoloGame game(options.mode, options.seed);
+    GameState& state = game.state();
+
+    Replay::Header header;
+    header.mode = options.mode;
+    header.seed = options.seed;
+    header.tickRate = Replay::TICK_RATE;
+    header.startTime = static_cast<std::uint32_t>(std::time(nullptr));
+    ReplayWriter writer;
+    if (!writer.open(options.path, header)) {
+        return false;
+    }
+
+    const std::uint32_t maxTicks = static_cast<std::uint32_t>(options.minutes) * 60 * Replay::TICK_RATE;
+    Random bot(options.seed ^ 0xB07u);
+    while (!state.isGameOver() && game.tick() < maxTicks) {
+        const std::uint32_t tick = game.tick();
+        for (InputAction action : game.step()) {
+            writer.record(tick, action);
+        }
+        writer.keyframeIfDue(game.tick(), state);
+        if (options.mode == Replay::Mode::LEVEL && bot.nextInt(12) == 0) {
+            // No hard drops (the last action), gravity does the dropping and games last longer
+            const InputAction action = static_cast<InputAction>(bot.nextInt(INPUT_ACTION_COUNT - 1));
+            state.applyInput(action);
+            writer.record(game.tick(), action);
+        }
+    }
+    writer.finish(game.tick(), state);
+    std::cout << "Recorded " << formatTicks(game.tick(), Replay::TICK_RATE) << " of "
+              << Replay::modeName(options.mode) << " into " << options.path << std::endl;
+    return true;
+}
+
+void printUsage() {
+    std::cerr << "Usage: tetris-replay <file.trp>...\n"
+              << "       tetris-replay --record <file.trp> [--mode level|simple-ai|advanced-ai] "
+                 "[--minutes 10] [--seed 1]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    RecordOptions record;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--record" && hasValue) {
+            record.path = argv[++i];
+        } else if (arg == "--mode" && hasValue) {
+            if (!Replay::parseMode(argv[++i], record.mode)) {
+                std::cerr << "Unknown mode " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--minutes" && hasValue) {
+            record.minutes = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            record.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (!arg.empty() && arg[0] != '-') {
+            files.push_back(arg);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (record.path.empty() && files.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    bool ok = true;
+    if (!record.path.empty()) {
+        ok = recordGame(record) && checkReplay(record.path);
+    }
+    for (const std::string& file : files) {
+        ok = checkReplay(file) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+#include "../ai/AIWeights.h"
+#include "../model/AIMode.h"
+#include "../replay/SoloGame.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// tetris-tune: tunes the evaluation weights of the AI with the cross-entropy method, a population based
+// (genetic style) search. Each generation samples candidates around the current mean, plays every candidate on the
+// same seeded games, keeps the best ones (the elite) and moves the mean and spread to theirs.
+// Usage: tetris-tune [--generations 20] [--population 32] [--games 100] [--pieces 500] [--elite 0.25]
+//                    [--noise 1] [--advanced] [--seed 1] [--threads N] [--validate 200] [--out ai_weights.ini]
+//                    [--profile tuned]
+//        tetris-tune --compare <weights file> <profile>... [--advanced] [--validate 200] [--pieces 500]
+// A game ends at game over or after --pieces pieces, a candidate's fitness is its mean lines cleared. Games are
+// seeded, so candidates of a generation are compared on identical piece sequences and a run with the same options
+// gives the same weights whatever the thread count. The final mean is checked against the built-in weights on
+// --validate games none of the candidates played, and written to --out as profile [--profile] if better (the other
+// profiles of an existing --out file are kept).
+// --compare is an A/B test of profiles (difficulty tiers, a tuned profile against the current one): each plays the
+// same --validate games.
+
+namespace {
+
+struct TuneOptions {
+    int generations = 20;
+    int population = 32;
+    int games = 100;
+    int maxPieces = 500;
+    double eliteShare = 0.25;
+    double noise = 1.0;
+    bool advanced = false;
+    std::uint32_t seed = 1;
+    unsigned threads = 0;  // 0: one per core
+    int validationGames = 200;
+    std::string out = "ai_weights.ini";
+    std::string profile = "tuned";
+    // --compare: play these profiles of compareFile instead of tuning
+    std::string compareFile;
+    std::vector<std::string> compareProfiles;
+};
+
+// The values the search moves: every penalty coefficient (the line bonus keeps its value and sets the scale),
+// and for the advanced AI its next piece discount
+std::vector<double*> tunedParameters(AIWeights& weights, bool advanced) {
+    std::vector<double*> parameters;
+    for (int i = 0; i < AI_FEATURE_COUNT; ++i) {
+        if (static_cast<AIFeature>(i) != AIFeature::LINES) {
+            parameters.push_back(&weights.coefficients[i]);
+        }
+    }
+    if (advanced) {
+        parameters.push_back(&weights.nextPieceDiscount);
+    }
+    return parameters;
+}
+
+std::string describe(const AIWeights& weights, bool advanced) {
+    std::string text;
+    char value[48];
+    for (int i = 0; i < AI_FEATURE_COUNT; ++i) {
+        std::snprintf(value, sizeof(value), "%s%s=%.3f", i == 0 ? "" : " ",
+                      AIWeights::featureKey(static_cast<AIFeature>(i)), weights.coefficients[i]);
+        text += value;
+    }
+    if (advanced) {
+        std::snprintf(value, sizeof(value), " next_piece_discount=%.3f", weights.nextPieceDiscount);
+        text += value;
+    }
+    return text;
+}
+
+// Lines one AI clears in a seeded game. Placements are played as AIMode plays them, but back to back: the next
+// piece is placed as soon as it spawns, so a game of 500 pieces takes milliseconds.
+int playGame(const AIWeights& weights, bool advanced, std::uint32_t seed, int maxPieces) {
+    SoloGame game(advanced ? Replay::Mode::ADVANCED_AI : Replay::Mode::SIMPLE_AI, seed, false, weights);
+    int pieces = 0;
+    while (pieces < maxPieces && game.playMove()) {
+        ++pieces;
+    }
+    game.finishClearing();
+    return game.aiMode()->getLinesCleared();
+}
+
+// Run job(0) ... job(count - 1) on all threads
+void runParallel(std::size_t count, unsigned threads, const std::function<void(std::size_t)>& job) {
+    std::atomic<std::size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (std::size_t i = next++; i < count; i = next++) {
+                job(i);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Mean lines of each candidate over the same games (seeds firstSeed, firstSeed + 1, ...)
+std::vector<double> evaluate(const std::vector<AIWeights>& candidates, const TuneOptions& options,
+                             std::uint32_t firstSeed, int games, unsigned threads) {
+    std::vector<int> lines(candidates.size() * static_cast<std::size_t>(games));
+    runParallel(lines.size(), threads, [&](std::size_t job) {
+        const std::size_t candidate = job / static_cast<std::size_t>(games);
+        const std::uint32_t seed = firstSeed + static_cast<std::uint32_t>(job % static_cast<std::size_t>(games));
+        lines[job] = playGame(candidates[candidate], options.advanced, seed, options.maxPieces);
+    });
+
+    std::vector<double> fitness(candidates.size());
+    for (std::size_t c = 0; c < candidates.size(); ++c) {
+        const auto first = lines.begin() + static_cast<std::ptrdiff_t>(c * static_cast<std::size_t>(games));
+        fitness[c] = static_cast<double>(std::accumulate(first, first + games, 0)) / static_cast<double>(games);
+    }
+    return fitness;
+}
+
+unsigned threadCount(const TuneOptions& options) {
+    return options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool tune(const TuneOptions& options) {
+    const unsigned threads = threadCount(options);
+    const int eliteCount = std::max(2, static_cast<int>(std::lround(options.population * options.eliteShare)));
+    const auto started = std::chrono::steady_clock::now();
+    std::mt19937 random(options.seed);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+
+    // Start from the built-in weights with a spread of their own size
+    AIWeights mean;
+    const std::size_t parameterCount = tunedParameters(mean, options.advanced).size();
+    std::vector<double> spread;
+    for (double* parameter : tunedParameters(mean, options.advanced)) {
+        spread.push_back(std::max(1.0, *parameter));
+    }
+
+    std::cout << "Tuning " << (options.advanced ? "advanced" : "simple") << " AI weights: " << options.generations
+              << " generations of " << options.population << " candidates x " << options.games << " games of up to "
+              << options.maxPieces << " pieces, " << threads << " threads" << std::endl;
+
+    std::uint32_t nextSeed = options.seed;
+    for (int generation = 0; generation < options.generations; ++generation) {
+        std::vector<AIWeights> candidates(static_cast<std::size_t>(options.population), mean);
+        for (AIWeights& candidate : candidates) {
+            const std::vector<double*> parameters = tunedParameters(candidate, options.advanced);
+            for (std::size_t p = 0; p < parameterCount; ++p) {
+                // Penalties stay penalties
+                *parameters[p] = std::max(0.0, *parameters[p] + spread[p] * gaussian(random));
+            }
+        }
+        // New games every generation, so the weights do not fit one set of piece sequences
+        const std::vector<double> fitness = evaluate(candidates, options, nextSeed, options.games, threads);
+        nextSeed += static_cast<std::uint32_t>(options.games);
+
+        std::vector<std::size_t> order(candidates.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::size_t a, std::size_t b) { return fitness[a] > fitness[b]; });
+
+        // Mean and spread of the elite, plus noise that fades over the run so the search does not collapse early
+        const double noise = options.noise * std::max(0.0, 1.0 - static_cast<double>(generation) / options.generations);
+        const std::vector<double*> meanParameters = tunedParameters(mean, options.advanced);
+        for (std::size_t p = 0; p < parameterCount; ++p) {
+            std::vector<double> elite;
+            for (int e = 0; e < eliteCount; ++e) {
+                elite.push_back(*tunedParameters(candidates[order[e]], options.advanced)[p]);
+            }
+            const double average = std::accumulate(elite.begin(), elite.end(), 0.0) / eliteCount;
+            double variance = 0.0;
+            for (double value : elite) {
+                variance += (value - average) * (value - average);
+            }
+            *meanParameters[p] = average;
+            spread[p] = std::sqrt(variance / eliteCount + noise);
+        }
+        double eliteFitness = 0.0;
+        for (int e = 0; e < eliteCount; ++e) {
+            eliteFitness += fitness[order[e]] / eliteCount;
+        }
+
+        std::cout << "generation " << std::setw(3) << generation + 1 << ": best " << std::fixed << std::setprecision(1)
+                  << fitness[order[0]] << " lines, elite " << eliteFitness << " | " << describe(mean, options.advanced)
+                  << std::endl;
+    }
+
+    // Tuned against built-in weights on games the search never saw
+    const std::vector<double> validation =
+        evaluate({AIWeights(), mean}, options, nextSeed, options.validationGames, threads);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Validation over " << options.validationGames << " games: built-in " << validation[0]
+              << " lines, tuned " << validation[1] << " lines (" << std::showpos
+              << 100.0 * (validation[1] - validation[0]) / std::max(validation[0], 1.0) << std::noshowpos << "%), "
+              << seconds << " s" << std::endl;
+    if (validation[1] <= validation[0]) {
+        std::cerr << "The tuned weights do not beat the built-in ones, " << options.out
+                  << " not written (try more --games or --generations)" << std::endl;
+        return false;
+    }
+
+    char comment[160];
+    std::snprintf(comment, sizeof(comment), "tetris-tune, %s AI, %d generations, %.1f lines per game of %d pieces",
+                  options.advanced ? "advanced" : "simple", options.generations, validation[1], options.maxPieces);
+    if (!mean.save(options.out, options.profile, comment)) {
+        return false;
+    }
+    std::cout << "Wrote profile [" << options.profile << "] to " << options.out << " (copy it into the ai_weights file "
+              << "of config.ini, or point ai_weights there, and set ai_profile=" << options.profile << ")" << std::endl;
+    return true;
+}
+
+// A/B test: every profile plays the same --validate games
+bool compare(const TuneOptions& options) {
+    std::vector<AIWeights> profiles;
+    for (const std::string& name : options.compareProfiles) {
+        AIWeights weights;
+        if (!weights.load(options.compareFile, name)) {
+            return false;
+        }
+        profiles.push_back(weights);
+    }
+    const std::vector<double> lines = evaluate(profiles, options, options.seed, options.validationGames,
+                                               threadCount(options));
+    std::cout << options.validationGames << " " << (options.advanced ? "advanced" : "simple") << " AI games of up to "
+              << options.maxPieces << " pieces per profile" << std::endl;
+    for (std::size_t i = 0; i < profiles.size(); ++i) {
+        std::cout << std::setw(12) << std::left << options.compareProfiles[i] << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(8) << lines[i] << " lines";
+        if (i > 0) {
+            std::cout << " (" << std::showpos << 100.0 * (lines[i] - lines[0]) / std::max(lines[0], 1.0)
+                      << std::noshowpos << "% vs " << options.compareProfiles[0] << ")";
+        }
+        std::cout << std::endl;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TuneOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--generations" && hasValue) {
+            options.generations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--population" && hasValue) {
+            options.population = std::max(4, std::atoi(argv[++i]));
+        } else if (arg == "--games" && hasValue) {
+            options.games = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--pieces" && hasValue) {
+            options.maxPieces = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--elite" && hasValue) {
+            options.eliteShare = std::min(1.0, std::max(0.0, std::atof(argv[++i])));
+        } else if (arg == "--noise" && hasValue) {
+            options.noise = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--advanced") {
+            options.advanced = true;
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--validate" && hasValue) {
+            options.validationGames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--out" && hasValue) {
+            options.out = argv[++i];
+        } else if (arg == "--profile" && hasValue) {
+            options.profile = argv[++i];
+        } else if (arg == "--compare" && hasValue) {
+            options.compareFile = argv[++i];
+        } else if (!options.compareFile.empty() && !arg.empty() && arg[0] != '-') {
+            options.compareProfiles.push_back(arg);
+        } else {
+            std::cerr << "Usage: tetris-tune [--generations 20] [--population 32] [--games 100] [--pieces 500] "
+                         "[--elite 0.25]\n"
+                      << "                   [--noise 1] [--advanced] [--seed 1] [--threads N] [--validate 200] "
+                         "[--out ai_weights.ini] [--profile tuned]\n"
+                      << "       tetris-tune --compare <weights file> <profile>... [--advanced] [--validate 200] "
+                         "[--pieces 500]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (!options.compareFile.empty()) {
+        return !options.compareProfiles.empty() && compare(options) ? 0 : 1;
+    }
+    return tune(options) ? 0 : 1;
+}
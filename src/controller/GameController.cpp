@@ -5,8 +5,22 @@
 #include "../ai/SimpleAI.h"
 #include "../ai/AdvancedAI.h"
 #include "../ConfigManager.h"
+#include "../util/Timestamp.h"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
 #include <iostream>
+#include <system_error>
 
+namespace {
+
+MultiplayerRule configuredMultiplayerRule() {
+    return ConfigManager::getInstance().getMultiplayerMode() == "versus" ? MultiplayerRule::VERSUS
+                                                                          : MultiplayerRule::MARATHON;
+}
+
+} // namespace
 
 // Initialize all game state variables
 GameController::GameController()
@@ -16,7 +30,6 @@ GameController::GameController()
       m_musicVolume(50.0f),                  // Default 50% volume
       m_networkManager(nullptr),             // No network by default
       m_networkMode(false),                  // Not in network mode
-      m_networkUpdateTimer(0.0f),            // Network update timer
       m_ipInput(""),                         // Empty IP input
       m_localPlayerReady(false),             // Local player not ready
       m_remotePlayerReady(false),            // Remote player not ready
@@ -31,12 +44,17 @@ GameController::GameController()
     m_remoteAIMoveTimer(0.0f),             // Timer for second player AI moves
       m_localAIModeWinnerId(-1),             // No winner yet
     m_localAIModeWinnerName(""),           // No winner name yet
-    m_leftHeld(false),
-    m_rightHeld(false),
-    m_downHeld(false),
-    m_leftHoldTimer(0.0f),
-    m_rightHoldTimer(0.0f),
-    m_downHoldTimer(0.0f) {
+    m_pendingLatencyCount(0),
+    m_lastAppliedInputId(0),
+    m_replayTick(0),
+    m_replayMode(false),
+    m_replayPaused(false),
+    m_replaySpeed(1),
+    m_replayAccumulator(0.0f) {
+    // Key repeat timings from config.ini
+    const ConfigManager& config = ConfigManager::getInstance();
+    m_inputHandler.setRepeatTimings(config.getAutoShiftDelay(), config.getAutoRepeatRate(), config.getSoftDropInterval());
+
     // Initialize music manager
     try {
         m_musicManager = std::make_unique<MusicManager>();
@@ -49,12 +67,30 @@ GameController::GameController()
 }
 
 // Clean up when controller is destroyed
-GameController::~GameController() = default;
+GameController::~GameController() {
+    // A solo game still running when the window closes keeps a complete replay
+    m_replayWriter.finish(m_replayTick, m_gameState);
+}
 
 //Handle SFML events (inputs from keyboard, mouse, ...)
-void GameController::handleEvent(const sf::Event& event) {
+void GameController::handleEvent(const sf::Event& event, std::uint64_t inputId, std::int64_t polledAtUs) {
+    // Key events are replayed by the InputHandler at the time they were polled
+    const std::int64_t eventTimeUs = polledAtUs != 0 ? polledAtUs : nowMicroseconds();
+
+    // A replay takes no game input, only its own playback keys
+    if (m_replayMode) {
+        if (const auto* keyPressed = event.getIf<sf::Event::KeyPressed>()) {
+            handleReplayKey(keyPressed->code);
+        }
+        return;
+    }
+
     // menu input
     if (m_currentMenuState != MenuState::NONE) {
+        // Keys released while a menu is open must not stay held once the game resumes
+        if (const auto* keyReleased = event.getIf<sf::Event::KeyReleased>()) {
+            m_inputHandler.handleKeyRelease(keyReleased->code, eventTimeUs);
+        }
         if (const auto* keyPressed = event.getIf<sf::Event::KeyPressed>()) {
             handleMenuInput(keyPressed->code);
         }
@@ -113,10 +149,18 @@ void GameController::handleEvent(const sf::Event& event) {
             // Only process input if AI is not controlling
             if (m_localAIMode && !m_localPlayerAI) {
                 // Local AI mode but local player is human - normal input handling
-                m_inputHandler.handleKeyPress(keyPressed->code);
+                m_inputHandler.handleKeyPress(keyPressed->code, eventTimeUs);
             } else if (!m_localAIMode) {
                 // Solo mode: normal input handling
-                m_inputHandler.handleKeyPress(keyPressed->code);
+                m_inputHandler.handleKeyPress(keyPressed->code, eventTimeUs);
+            }
+
+            if (inputId != 0 && m_pendingLatencyCount < m_pendingLatencySamples.size()) {
+                InputLatencySample& sample = m_pendingLatencySamples[m_pendingLatencyCount++];
+                sample = InputLatencySample();
+                sample.inputId = inputId;
+                sample.polledUs = polledAtUs;
+                sample.handledUs = nowMicroseconds();
             }
         }
         // If isAIControlling is true, input is ignored (AI handles everything)
@@ -136,7 +180,7 @@ void GameController::handleEvent(const sf::Event& event) {
         
         // Always update InputHandler for key releases (needed for movement tracking)
         if (!isAIControlling) {
-            m_inputHandler.handleKeyRelease(keyReleased->code);
+            m_inputHandler.handleKeyRelease(keyReleased->code, eventTimeUs);
         }
     }
 }
@@ -203,6 +247,7 @@ void GameController::handleMenuInput(const sf::Keyboard::Key& key) {
                 // Level Mode
                 m_gameState.setGameMode(std::make_unique<LevelBasedMode>());
                 m_currentSingleplayerMode = SingleplayerMode::LEVEL_MODE;
+                startSoloGame();
                 m_currentMenuState = MenuState::NONE;
             } else if (m_selectedOption == 1) {
                 // AI Mode - go to AI selection submenu
@@ -218,11 +263,13 @@ void GameController::handleMenuInput(const sf::Keyboard::Key& key) {
                 // Simple AI
                 m_gameState.setGameMode(std::make_unique<AIMode>(false));
                 m_currentSingleplayerMode = SingleplayerMode::SIMPLE_AI;
+                startSoloGame();
                 m_currentMenuState = MenuState::NONE;
             } else if (m_selectedOption == 1) {
                 // Advanced AI
                 m_gameState.setGameMode(std::make_unique<AIMode>(true));
                 m_currentSingleplayerMode = SingleplayerMode::ADVANCED_AI;
+                startSoloGame();
                 m_currentMenuState = MenuState::NONE;
             } else if (m_selectedOption == 2) {
                 // Back
@@ -295,7 +342,7 @@ void GameController::handleMenuInput(const sf::Keyboard::Key& key) {
                 m_remoteGameState.setGameMode(std::make_unique<LevelBasedMode>());
                 // Initialize multiplayer mode with config value
                 int targetLines = ConfigManager::getInstance().getDefaultTargetLines();
-                m_multiplayerMode = std::make_unique<MultiplayerGameMode>(targetLines);
+                m_multiplayerMode = std::make_unique<MultiplayerGameMode>(targetLines, configuredMultiplayerRule());
                 // Player 1 (left): Advanced AI, Player 2 (right): Simple AI
                 setLocalPlayerAI(true, true);
                 setRemotePlayerAI(true, false);
@@ -311,7 +358,7 @@ void GameController::handleMenuInput(const sf::Keyboard::Key& key) {
                 m_remoteGameState.setGameMode(std::make_unique<LevelBasedMode>());
                 // Initialize multiplayer mode with config value
                 int targetLines = ConfigManager::getInstance().getDefaultTargetLines();
-                m_multiplayerMode = std::make_unique<MultiplayerGameMode>(targetLines);
+                m_multiplayerMode = std::make_unique<MultiplayerGameMode>(targetLines, configuredMultiplayerRule());
                 // Player 1 (you): Human, Player 2 (opponent): Advanced AI
                 setLocalPlayerAI(false, false);
                 setRemotePlayerAI(true, true);
@@ -328,6 +375,7 @@ void GameController::handleMenuInput(const sf::Keyboard::Key& key) {
                 m_currentMenuState = MenuState::NONE;
             } else if (m_selectedOption == 2) {
                 // Return to Main Menu - reset all state
+                m_replayWriter.finish(m_replayTick, m_gameState);
                 m_localAIMode = false;
                 m_localPlayerAI = false;
                 m_remotePlayerAI = false;
@@ -353,7 +401,7 @@ void GameController::handleMenuInput(const sf::Keyboard::Key& key) {
                     m_gameState.setGameMode(std::make_unique<LevelBasedMode>());
                     m_remoteGameState.setGameMode(std::make_unique<LevelBasedMode>());
                     int targetLines = ConfigManager::getInstance().getDefaultTargetLines();
-                    m_multiplayerMode = std::make_unique<MultiplayerGameMode>(targetLines);
+                    m_multiplayerMode = std::make_unique<MultiplayerGameMode>(targetLines, configuredMultiplayerRule());
                     
                     if (m_currentLocalMultiplayerMode == LocalMultiplayerMode::AI_VS_AI) {
                         // Restart AI vs AI
@@ -379,6 +427,7 @@ void GameController::handleMenuInput(const sf::Keyboard::Key& key) {
                     } else if (m_currentSingleplayerMode == SingleplayerMode::ADVANCED_AI) {
                         m_gameState.setGameMode(std::make_unique<AIMode>(true));
                     }
+                    startSoloGame();
                     
                     m_currentMenuState = MenuState::NONE;  // Start playing immediately
                     m_selectedOption = 0;
@@ -427,6 +476,11 @@ void GameController::update(float deltaTime) {
         }
     }
     
+    if (m_replayMode) {
+        updateReplay(deltaTime);
+        return;
+    }
+    
     // If we're in a menu, don't update game state (unless we're networking)
     if (m_currentMenuState != MenuState::NONE && !(m_networkMode && m_networkManager)) {
         return;
@@ -434,6 +488,8 @@ void GameController::update(float deltaTime) {
     
     // Handle HOST_GAME menu: check if client connected, transition to NETWORK_READY
     if (m_currentMenuState == MenuState::HOST_GAME && m_networkMode && m_networkManager) {
+        // The network thread accepts the client, this picks up the connection
+        m_networkManager->update();
         if (m_networkManager->isConnected()) {
             m_localPlayerReady = false;
             m_remotePlayerReady = false;
@@ -494,90 +550,96 @@ void GameController::update(float deltaTime) {
 
     // Network multiplayer mode
     if (m_networkMode && m_networkManager) {
-        // Update network (accept connections if hosting)
+        // Apply what the network thread received since the last step
         m_networkManager->update();
         
         // If we're in NETWORK_READY state, wait for both players to be ready
         if (m_currentMenuState == MenuState::NETWORK_READY) {
-            // Sync ready status over network
-            m_networkUpdateTimer += deltaTime;
-            if (m_networkUpdateTimer >= NETWORK_UPDATE_INTERVAL) {
-                m_networkUpdateTimer = 0.0f;
+            // Sync ready status over network, only a toggle of the ready flag puts anything on the wire
+            if (m_networkManager->isConnected()) {
+                // Send local ready status (empty game state with just ready flag)
+                PacketData readyPacket = gameStateToPacket(m_gameState);
+                readyPacket.isReady = m_localPlayerReady;
+                m_networkManager->sendGameState(readyPacket);
                 
-                if (m_networkManager->isConnected()) {
-                    // Send local ready status (empty game state with just ready flag)
-                    PacketData readyPacket = gameStateToPacket(m_gameState);
-                    readyPacket.isReady = m_localPlayerReady;
-                    m_networkManager->sendGameState(readyPacket);
-                    
-                    // Receive opponent ready status
-                    auto opponentData = m_networkManager->receiveOpponentState();
-                    if (opponentData.has_value()) {
-                        m_remotePlayerReady = opponentData.value().isReady;
-                    }
+                // Receive opponent ready status
+                auto opponentData = m_networkManager->receiveOpponentState();
+                if (opponentData.has_value()) {
+                    m_remotePlayerReady = opponentData.value().isReady;
                 }
             }
             
-            // Check if both players are ready
-            if (m_localPlayerReady && m_remotePlayerReady && m_networkManager->isConnected()) {
-                // Start the game
-                m_gameState.reset();
-                m_remoteGameState.reset();
-                m_gameState.setGameMode(std::make_unique<LevelBasedMode>());
-                m_remoteGameState.setGameMode(std::make_unique<LevelBasedMode>());
-                m_currentMenuState = MenuState::NONE;
-                m_selectedOption = 0;
+            // The host picks the seed and sync mode once both players are ready, the client starts when told
+            if (m_networkManager->isHost()) {
+                if (m_localPlayerReady && m_remotePlayerReady && m_networkManager->isConnected()) {
+                    MatchStart start;
+                    start.seed = (static_cast<std::uint32_t>(std::rand()) << 16) ^ static_cast<std::uint32_t>(std::rand());
+                    const std::string& syncMode = ConfigManager::getInstance().getSyncMode();
+                    if (syncMode == "mirror") {
+                        start.syncMode = SyncMode::MIRROR;
+                    } else if (syncMode == "lockstep") {
+                        start.syncMode = SyncMode::LOCKSTEP;
+                    } else {
+                        start.syncMode = SyncMode::ROLLBACK;
+                    }
+                    start.versus = configuredMultiplayerRule() == MultiplayerRule::VERSUS;
+                    m_networkManager->sendMatchStart(start);
+                    startNetworkMatch(start);
+                }
+            } else if (auto start = m_networkManager->takeMatchStart()) {
+                startNetworkMatch(*start);
             }
             
             return;
         }
         
-        // Update local game state
-        m_gameState.update(deltaTime);
+        if (!m_networkManager->isConnected()) {
+            // Connection was lost during gameplay
+            m_currentMenuState = MenuState::PAUSE_MENU;
+            m_selectedOption = 0;
+            m_networkMode = false;
+            std::cerr << "Connection to opponent lost!" << std::endl;
+            return;
+        }
         
-        // Handle local player input (same flow as solo mode)
-        if (!m_gameState.isGameOver()) {
-            if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Left)) {
-                m_gameState.moveLeft();
-                m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Left);
-            } else if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Right)) {
-                m_gameState.moveRight();
-                m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Right);
-            } else if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Down)) {
-                m_gameState.softDrop();
-                m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Down);
-            }
-
-            processContinuousInput(deltaTime);
-            processDiscreteInput();
+        // Hold the match while the link is down, it resumes where it stopped once the peer is back
+        if (m_networkManager->isReconnecting()) {
+            return;
         }
         
-        // Network sync timer
-        m_networkUpdateTimer += deltaTime;
-        if (m_networkUpdateTimer >= NETWORK_UPDATE_INTERVAL) {
-            m_networkUpdateTimer = 0.0f;
+        if (m_networkMatch.syncMode() != SyncMode::MIRROR) {
+            if (m_networkMatch.update(deltaTime, m_gameState, m_remoteGameState, *m_networkManager,
+                                      [this] { return sampleLocalInput(); })) {
+                recordInputsApplied();
+            }
+        } else {
+            // Update local game state
+            m_gameState.update(deltaTime);
             
-            // Send local state to opponent
-            if (m_networkManager->isConnected()) {
-                PacketData localData = gameStateToPacket(m_gameState);
-                m_networkManager->sendGameState(localData);
-                
-                // Receive opponent state
-                auto opponentData = m_networkManager->receiveOpponentState();
-                if (opponentData.has_value()) {
-                    packetToGameState(opponentData.value(), m_remoteGameState);
-                }
-            } else {
-                // Connection was lost during gameplay
-                m_currentMenuState = MenuState::PAUSE_MENU;
-                m_selectedOption = 0;
-                m_networkMode = false;
-                std::cerr << "Connection to opponent lost!" << std::endl;
+            // Handle local player input (same flow as solo mode)
+            if (!m_gameState.isGameOver()) {
+                processPlayerInput();
+                recordInputsApplied();
+            }
+            if (m_networkMatch.isVersus()) {
+                exchangeMirroredGarbage();
+            }
+            
+            // Send local state to opponent: moves, locks and clears go out as they happen, paced by the
+            // network manager to what the link keeps up with
+            PacketData localData = gameStateToPacket(m_gameState);
+            m_networkManager->sendGameState(localData);
+            
+            // Receive opponent state
+            auto opponentData = m_networkManager->receiveOpponentState();
+            if (opponentData.has_value()) {
+                packetToGameState(opponentData.value(), m_remoteGameState);
             }
         }
         
-        // Check if either player has lost
-        if (m_gameState.isGameOver() || m_remoteGameState.isGameOver()) {
+        // Check if either player has lost (with rollback, only once the boards no longer rely on prediction)
+        if (m_currentMenuState != MenuState::GAME_OVER && m_networkMatch.isConfirmed() &&
+            (m_gameState.isGameOver() || m_remoteGameState.isGameOver())) {
             if (m_remoteGameState.isGameOver() && !m_gameState.isGameOver()) {
                 m_localAIModeWinnerId = 0;
                 m_localAIModeWinnerName = "You";
@@ -598,6 +660,7 @@ void GameController::update(float deltaTime) {
     // Solo mode: normal update
     // Check if game over and transition to game over menu
     if (m_gameState.isGameOver() && m_currentMenuState == MenuState::NONE) {
+        m_replayWriter.finish(m_replayTick, m_gameState);
         m_currentMenuState = MenuState::GAME_OVER;
         m_selectedOption = 0;
         return;
@@ -612,75 +675,189 @@ void GameController::update(float deltaTime) {
     if (aiMode) {
         // Game mode is AIMode
         isAIControlling = true;
+        // Its move was made at the start of this step, before the step's gravity
+        if (m_replayWriter.isOpen()) {
+            for (InputAction action : aiMode->lastMove()) {
+                m_replayWriter.record(m_replayTick, action);
+            }
+        }
     }
+    ++m_replayTick;
+    m_replayWriter.keyframeIfDue(m_replayTick, m_gameState);
     
     // Only process input if AI is not controlling
     if (!isAIControlling) {
-        // Check for immediate key presses
-        if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Left)) {
-            m_gameState.moveLeft();
-            m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Left);
-        } else if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Right)) {
-            m_gameState.moveRight();
-            m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Right);
-        } else if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Down)) {
-            m_gameState.softDrop();
-            m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Down);
-        }
-        
-        // Process continuous input
-        processContinuousInput(deltaTime);
-        
-        // Process discrete input
-        processDiscreteInput();
+        // Apply queued key presses and auto-repeats
+        processPlayerInput();
+        recordInputsApplied();
     }
 }
 
-// Process input that can be held down (continuous input)
-void GameController::processContinuousInput(float deltaTime) {
-    const auto handleHold = [&](bool isPressed, bool& wasHeld, float& timer,
-                                float interval, const auto& action) {
-        if (isPressed) {
-            if (!wasHeld) {
-                wasHeld = true;
-                timer = 0.0f; // Start delay after the initial keypress move
-            } else {
-                timer += deltaTime;
-                if (timer >= interval) {
-                    action();
-                    timer = 0.0f;
-                }
-            }
-        } else {
-            wasHeld = false;
-            timer = 0.0f;
+// Start a network match on both boards with the seed the host picked
+void GameController::startNetworkMatch(const MatchStart& start) {
+    m_networkMatch.start(start, m_gameState, m_remoteGameState);
+    m_inputHandler.reset();
+    
+    m_currentMenuState = MenuState::NONE;
+    m_selectedOption = 0;
+}
+
+// Send our attacks right away and queue the opponent's, minus the time they spent in flight
+void GameController::exchangeMirroredGarbage() {
+    const int outgoing = m_gameState.takeOutgoingGarbage();
+    if (outgoing > 0) {
+        m_networkManager->sendGarbage(outgoing);
+    }
+    
+    // The age comes from two clocks and an offset estimate: bound the delay to what the sender would have seen, so
+    // that a bad estimate cannot hold this attack (and the ones queued behind it) back
+    GarbageAttack attack;
+    while (m_networkManager->popGarbage(attack)) {
+        const float ageSeconds = static_cast<float>(m_networkManager->nowUs() - attack.sentUs) / 1000000.0f;
+        m_gameState.receiveGarbage(attack.lines,
+                                   std::clamp(GameState::GARBAGE_DELAY - ageSeconds, 0.0f, GameState::GARBAGE_DELAY));
+    }
+}
+
+InputFrame GameController::sampleLocalInput() {
+    InputFrame frame;
+    if (m_currentMenuState == MenuState::NONE && !m_gameState.isGameOver()) {
+        m_inputHandler.update(nowMicroseconds());
+        frame.count = static_cast<std::uint8_t>(std::min(m_inputHandler.actionCount(), frame.actions.size()));
+        for (std::size_t i = 0; i < frame.count; ++i) {
+            frame.actions[i] = m_inputHandler.action(i);
         }
-    };
+    }
+    return frame;
+}
 
-    handleHold(m_inputHandler.isLeftPressed(), m_leftHeld, m_leftHoldTimer,
-               MOVE_REPEAT_INTERVAL, [this]() { m_gameState.moveLeft(); });
-    handleHold(m_inputHandler.isRightPressed(), m_rightHeld, m_rightHoldTimer,
-               MOVE_REPEAT_INTERVAL, [this]() { m_gameState.moveRight(); });
-    handleHold(m_inputHandler.isDownPressed(), m_downHeld, m_downHoldTimer,
-               SOFT_DROP_REPEAT_INTERVAL, [this]() { m_gameState.softDrop(); });
+// Apply the actions the InputHandler produced since the last update, in the order they happened
+void GameController::processPlayerInput() {
+    m_inputHandler.update(nowMicroseconds());
+
+    for (std::size_t i = 0; i < m_inputHandler.actionCount(); ++i) {
+        m_gameState.applyInput(m_inputHandler.action(i));
+        m_replayWriter.record(m_replayTick, m_inputHandler.action(i));
+    }
 }
 
-// Process input that happens once per key press
-void GameController::processDiscreteInput() {
-    if (m_inputHandler.isRotateClockwisePressed()) {
-        m_gameState.rotateClockwise();
-        m_inputHandler.resetRotateFlags();
+// Seed the solo game just set up with setGameMode() and start recording its replay
+void GameController::startSoloGame() {
+    const std::uint32_t seed = (static_cast<std::uint32_t>(std::rand()) << 16) ^ static_cast<std::uint32_t>(std::rand());
+    m_gameState.resetWithSeed(seed);
+    m_replayWriter.close();
+    m_replayTick = 0;
+    
+    const ConfigManager& config = ConfigManager::getInstance();
+    if (!config.getRecordReplays()) {
+        return;
     }
     
-    if (m_inputHandler.isRotateCounterClockwisePressed()) {
-        m_gameState.rotateCounterClockwise();
-        m_inputHandler.resetRotateFlags();
+    Replay::Header header;
+    if (m_currentSingleplayerMode == SingleplayerMode::SIMPLE_AI) {
+        header.mode = Replay::Mode::SIMPLE_AI;
+    } else if (m_currentSingleplayerMode == SingleplayerMode::ADVANCED_AI) {
+        header.mode = Replay::Mode::ADVANCED_AI;
     }
+    header.seed = seed;
+    header.tickRate = static_cast<std::uint32_t>(config.getSimulationRate());
+    const std::time_t now = std::time(nullptr);
+    header.startTime = static_cast<std::uint32_t>(now);
     
-    if (m_inputHandler.isHardDropPressed()) {
-        m_gameState.hardDrop();
-        m_inputHandler.resetHardDropFlag();
+    std::error_code error;
+    std::filesystem::create_directories(config.getReplayDirectory(), error);
+    if (error) {
+        std::cerr << "Could not create replay directory " << config.getReplayDirectory() << ": " << error.message()
+                  << std::endl;
+        return;
+    }
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+    const std::filesystem::path path = std::filesystem::path(config.getReplayDirectory()) /
+                                       (std::string(stamp) + "-" + Replay::modeName(header.mode) + ".trp");
+    m_replayWriter.open(path.string(), header);
+}
+
+bool GameController::startReplay(const std::string& path) {
+    if (!m_replayReader.open(path)) {
+        return false;
+    }
+    m_replayWriter.close();
+    m_replayReader.start(m_gameState);
+    m_replayMode = true;
+    m_replayPaused = false;
+    m_replaySpeed = 1;
+    m_replayAccumulator = 0.0f;
+    m_currentMenuState = MenuState::NONE;
+    m_selectedOption = 0;
+    return true;
+}
+
+// Step the replay at its own tick rate times the playback speed, whatever rate this build simulates at
+void GameController::updateReplay(float deltaTime) {
+    if (m_replayPaused || m_replayReader.atEnd()) {
+        m_replayAccumulator = 0.0f;
+        return;
+    }
+    const float tickLength = 1.0f / static_cast<float>(m_replayReader.header().tickRate);
+    m_replayAccumulator += deltaTime * static_cast<float>(m_replaySpeed);
+    while (m_replayAccumulator >= tickLength && m_replayReader.step(m_gameState)) {
+        m_replayAccumulator -= tickLength;
+    }
+}
+
+// Up/Down: speed, Left/Right: seek, Space: pause, Home/End: start/end, Escape: back to the main menu
+void GameController::handleReplayKey(sf::Keyboard::Key key) {
+    const std::uint32_t seekTicks = REPLAY_SEEK_SECONDS * m_replayReader.header().tickRate;
+    const std::uint32_t tick = m_replayReader.tick();
+    switch (key) {
+        case sf::Keyboard::Key::Up:
+            m_replaySpeed = std::min(m_replaySpeed * 2, MAX_REPLAY_SPEED);
+            break;
+        case sf::Keyboard::Key::Down:
+            m_replaySpeed = std::max(m_replaySpeed / 2, 1);
+            break;
+        case sf::Keyboard::Key::Space:
+            m_replayPaused = !m_replayPaused;
+            break;
+        case sf::Keyboard::Key::Right:
+            m_replayReader.seek(tick + seekTicks, m_gameState);
+            break;
+        case sf::Keyboard::Key::Left:
+            m_replayReader.seek(tick > seekTicks ? tick - seekTicks : 0, m_gameState);
+            break;
+        case sf::Keyboard::Key::Home:
+            m_replayReader.seek(0, m_gameState);
+            break;
+        case sf::Keyboard::Key::End:
+            m_replayReader.seek(m_replayReader.length(), m_gameState);
+            break;
+        case sf::Keyboard::Key::Escape:
+            m_replayMode = false;
+            m_gameState.reset();
+            m_currentMenuState = MenuState::MAIN_MENU;
+            m_selectedOption = 0;
+            break;
+        default:
+            break;
     }
+    m_replayAccumulator = 0.0f;
+}
+
+// Stamp the key presses consumed by this update and pass them on to the window thread
+void GameController::recordInputsApplied() {
+    if (m_pendingLatencyCount == 0) {
+        return;
+    }
+
+    const std::int64_t now = nowMicroseconds();
+    for (std::size_t i = 0; i < m_pendingLatencyCount; ++i) {
+        InputLatencySample& sample = m_pendingLatencySamples[i];
+        sample.mutatedUs = now;
+        m_lastAppliedInputId = std::max(m_lastAppliedInputId, sample.inputId);
+        m_latencySamples.push(sample);  // dropped if the window thread is not measuring
+    }
+    m_pendingLatencyCount = 0;
 }
 
 const GameState& GameController::getGameState() const {
@@ -716,6 +893,46 @@ const MenuView& GameController::getMenuView() const {
     return m_menuView;
 }
 
+void GameController::fillSnapshot(RenderSnapshot& snapshot) const {
+    snapshot.isMultiplayer = isLocalMultiplayerMode() || isNetworkMultiplayerMode();
+    snapshot.local.capture(m_gameState);
+    if (snapshot.isMultiplayer) {
+        snapshot.remote.capture(m_remoteGameState);
+    }
+
+    snapshot.menuState = m_currentMenuState;
+    snapshot.selectedOption = m_selectedOption;
+    snapshot.winnerId = getWinnerId();
+    snapshot.winnerName = getWinnerName();
+    snapshot.isNetworkConnected = isNetworkConnected();
+    snapshot.isNetworkReconnecting = isNetworkConnected() && m_networkManager->isReconnecting();
+    snapshot.showNetworkStats = isNetworkConnected() && snapshot.isMultiplayer;
+    if (snapshot.showNetworkStats) {
+        snapshot.networkTraffic = m_networkManager->getTrafficRates();
+        const NetworkManager::LinkStats link = m_networkManager->getLinkStats();
+        snapshot.networkRttMs = link.valid ? link.rttMs : -1.0f;
+    }
+    if (m_currentMenuState == MenuState::HOST_GAME) {
+        snapshot.localIP = getLocalIP();
+    } else {
+        snapshot.localIP.clear();
+    }
+    snapshot.ipInput = m_ipInput;
+    snapshot.localPlayerReady = m_localPlayerReady;
+    snapshot.remotePlayerReady = m_remotePlayerReady;
+    snapshot.musicVolume = m_musicVolume;
+    snapshot.showReplay = m_replayMode;
+    if (m_replayMode) {
+        snapshot.replayTick = m_replayReader.tick();
+        snapshot.replayLength = m_replayReader.length();
+        snapshot.replayTickRate = m_replayReader.header().tickRate;
+        snapshot.replaySpeed = m_replaySpeed;
+        snapshot.replayPaused = m_replayPaused;
+    }
+    snapshot.shouldExit = m_shouldExit;
+    snapshot.lastAppliedInputId = m_lastAppliedInputId;
+}
+
 int GameController::getWinnerId() const {
     return m_localAIMode ? m_localAIModeWinnerId : -1;
 }
@@ -807,23 +1024,9 @@ void GameController::updateLocalPlayerInAIMode(float deltaTime) {
         makeAIMove(m_gameState, m_aiPlayer.get(), m_aiMoveTimer);
     } else {
         // Local player is human - process keyboard input (same as single-player)
-        // Check for immediate key presses
-        if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Left)) {
-            m_gameState.moveLeft();
-            m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Left);
-        } else if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Right)) {
-            m_gameState.moveRight();
-            m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Right);
-        } else if (m_inputHandler.wasKeyJustPressed(sf::Keyboard::Key::Down)) {
-            m_gameState.softDrop();
-            m_inputHandler.markKeyProcessed(sf::Keyboard::Key::Down);
-        }
-        
-        // Process continuous input
-        processContinuousInput(deltaTime);
-        
-        // Process discrete input
-        processDiscreteInput();
+        // Apply queued key presses and auto-repeats
+        processPlayerInput();
+        recordInputsApplied();
     }
 }
 
@@ -879,7 +1082,9 @@ void GameController::packetToGameState(const PacketData& packet, GameState& stat
 // LAN Network methods
 void GameController::startHosting(unsigned short port) {
     if (!m_networkManager) {
-        m_networkManager = std::make_unique<NetworkManager>();
+        m_networkManager = std::make_unique<NetworkManager>(
+            createTransport(ConfigManager::getInstance().getNetworkTransport()));
+        m_networkManager->setTrafficLogInterval(ConfigManager::getInstance().getTrafficLogInterval());
     }
     
     if (m_networkManager->host(port)) {
@@ -893,7 +1098,9 @@ void GameController::startHosting(unsigned short port) {
 
 void GameController::connectToHost(const std::string& ip, unsigned short port) {
     if (!m_networkManager) {
-        m_networkManager = std::make_unique<NetworkManager>();
+        m_networkManager = std::make_unique<NetworkManager>(
+            createTransport(ConfigManager::getInstance().getNetworkTransport()));
+        m_networkManager->setTrafficLogInterval(ConfigManager::getInstance().getTrafficLogInterval());
     }
     
     if (m_networkManager->connect(ip, port)) {
@@ -916,8 +1123,11 @@ bool GameController::isNetworkConnected() const {
     return m_networkMode && m_networkManager && m_networkManager->isConnected();
 }
 
-std::string GameController::getLocalIP() const {
-    return NetworkManager::getLocalIP();
+const std::string& GameController::getLocalIP() const {
+    if (m_localIP.empty()) {
+        m_localIP = NetworkManager::getLocalIP();
+    }
+    return m_localIP;
 }
 
 void GameController::setMusicVolume(float volume) {
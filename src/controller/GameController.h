@@ -3,9 +3,16 @@
 #include "InputHandler.h"
 #include "../view/MenuView.h"
 #include "../view/MusicManager.h"
+#include "../view/RenderSnapshot.h"
 #include "../ai/AIPlayer.h"
 #include "../network/NetworkManager.h"
+#include "../network/NetworkMatch.h"
+#include "../replay/ReplayReader.h"
+#include "../replay/ReplayWriter.h"
+#include "../util/LatencyTracker.h"
 #include <SFML/Window/Event.hpp>
+#include <array>
+#include <cstdint>
 #include <memory>
 
 class GameMode;
@@ -16,8 +23,12 @@ class GameController {
 public:
     GameController();
     ~GameController();
-    void handleEvent(const sf::Event& event);
+    // inputId and polledAtUs identify key presses for latency measurement (0 when not measured)
+    void handleEvent(const sf::Event& event, std::uint64_t inputId = 0, std::int64_t polledAtUs = 0);
     void update(float deltaTime);
+
+    // Watch a replay file instead of playing (--replay), false if it cannot be read
+    bool startReplay(const std::string& path);
     
     const GameState& getGameState() const;
     GameState& getGameState();
@@ -33,7 +44,14 @@ public:
     int getSelectedOption() const;
     
     // Get menu view for rendering
+    // (the render thread only calls its const drawing methods, the controller only asks it for option counts)
     const MenuView& getMenuView() const;
+
+    // Copy everything the view draws into a snapshot, called on the simulation thread after each update
+    void fillSnapshot(RenderSnapshot& snapshot) const;
+
+    // Measured key presses that reached the game state, consumed by the window thread
+    LatencySampleQueue& latencySamples() { return m_latencySamples; }
     
     // Check if application should close
     bool shouldExit() const { return m_shouldExit; }
@@ -51,7 +69,7 @@ public:
     void connectToHost(const std::string& ip, unsigned short port = 53000);
     void disconnectNetwork();
     bool isNetworkConnected() const;
-    std::string getLocalIP() const;
+    const std::string& getLocalIP() const;
     std::string getIPInput() const { return m_ipInput; }
     
     // Volume control
@@ -84,9 +102,8 @@ private:
     // Network multiplayer
     std::unique_ptr<NetworkManager> m_networkManager;
     bool m_networkMode;  // LAN network multiplayer mode
-    float m_networkUpdateTimer;
-    static constexpr float NETWORK_UPDATE_INTERVAL = 0.016f; // ~60 updates/sec
     std::string m_ipInput;  // For JOIN_GAME menu: IP address input
+    mutable std::string m_localIP;  // Resolved once, the host menu shows it every frame
     bool m_localPlayerReady;  // Local player ready status for network games
     bool m_remotePlayerReady;  // Remote player ready status for network games
     
@@ -123,25 +140,44 @@ private:
     
     std::unique_ptr<MultiplayerGameMode> m_multiplayerMode;
 
-    bool m_leftHeld;
-    bool m_rightHeld;
-    bool m_downHeld;
-    float m_leftHoldTimer;
-    float m_rightHoldTimer;
-    float m_downHoldTimer;
-    static constexpr float MOVE_REPEAT_INTERVAL = 0.1f;
-    static constexpr float SOFT_DROP_REPEAT_INTERVAL = 0.05f;
-    
-    // Process continuous input (hold arrow keys)
-    void processContinuousInput(float deltaTime);
+    // Latency measurement: key presses given to the InputHandler and not yet applied to the game state
+    std::array<InputLatencySample, 16> m_pendingLatencySamples;
+    std::size_t m_pendingLatencyCount;
+    std::uint64_t m_lastAppliedInputId;
+    LatencySampleQueue m_latencySamples;
+    void recordInputsApplied();
+
+    // Network match sync: state mirroring, input lockstep or rollback, chosen by the host
+    NetworkMatch m_networkMatch;
+    void startNetworkMatch(const MatchStart& start);
+    // Mirror mode has no shared simulation, attacks travel as messages
+    void exchangeMirroredGarbage();
+    // Local actions for one tick (none while a menu is open or the game is over)
+    InputFrame sampleLocalInput();
+
+    // Solo games are recorded as they are played, m_replayTick counts their simulation steps
+    ReplayWriter m_replayWriter;
+    std::uint32_t m_replayTick;
+    void startSoloGame();
+
+    // Replay playback: m_gameState follows the file, the keys change its speed and position
+    ReplayReader m_replayReader;
+    bool m_replayMode;
+    bool m_replayPaused;
+    int m_replaySpeed;  // 1x, 2x, 4x ... MAX_REPLAY_SPEED
+    float m_replayAccumulator;
+    static constexpr int MAX_REPLAY_SPEED = 64;
+    static constexpr std::uint32_t REPLAY_SEEK_SECONDS = 10;
+    void updateReplay(float deltaTime);
+    void handleReplayKey(sf::Keyboard::Key key);
+
+    // Apply queued key presses and held key repeats to the local game state
+    void processPlayerInput();
     
     void updateLocalPlayerInAIMode(float deltaTime);
     void updateRemotePlayerInAIMode(float deltaTime);
     void makeAIMove(GameState& gameState, AIPlayer* aiPlayer, float& moveTimer);
     
-    // Process discrete input (rotations, hard drop)
-    void processDiscreteInput();
-    
     // Handle menu input
     void handleMenuInput(const sf::Keyboard::Key& key);
 };
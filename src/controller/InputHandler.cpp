@@ -1,134 +1,156 @@
 #include "InputHandler.h"
+#include <algorithm>
+#include <iostream>
 
 
-// Initialize all keys as not pressed
+// Initialize all keys as not pressed, repeat timings match the classic 0.1s shift / 0.05s soft drop
 InputHandler::InputHandler()
-    : m_leftPressed(false),
-      m_rightPressed(false),
-      m_downPressed(false),
-      m_rotateClockwisePressed(false),
-      m_rotateCounterClockwisePressed(false),
-      m_hardDropPressed(false),
-      m_leftJustPressed(false),
-      m_rightJustPressed(false),
-      m_downJustPressed(false) {}
-
-//remember key press for some keys
-void InputHandler::handleKeyPress(sf::Keyboard::Key key) {
-    switch (key) {
-        case sf::Keyboard::Key::Left:
-            m_leftPressed = true;
-            m_leftJustPressed = true;
-            break;
-        case sf::Keyboard::Key::Right:
-            m_rightPressed = true;
-            m_rightJustPressed = true;
-            break;
-        case sf::Keyboard::Key::Down:
-            m_downPressed = true;
-            m_downJustPressed = true;
-            break;
-        case sf::Keyboard::Key::Up:
-            m_rotateClockwisePressed = true;
-            break;
-        case sf::Keyboard::Key::Z:
-            m_rotateCounterClockwisePressed = true;
-            break;
-        case sf::Keyboard::Key::Space:
-            m_hardDropPressed = true;
-            break;
-        default:
-            break;
-    }
-}
+    : m_eventHead(0),
+      m_eventCount(0),
+      m_actionCount(0),
+      m_horizontal(InputAction::MOVE_LEFT),
+      m_autoShiftDelayUs(100000),
+      m_autoRepeatUs(100000),
+      m_softDropUs(50000) {}
 
-void InputHandler::handleKeyRelease(sf::Keyboard::Key key) {
-    switch (key) {
-        case sf::Keyboard::Key::Left:
-            m_leftPressed = false;
-            break;
-        case sf::Keyboard::Key::Right:
-            m_rightPressed = false;
-            break;
-        case sf::Keyboard::Key::Down:
-            m_downPressed = false;
-            break;
-        case sf::Keyboard::Key::Up:
-            m_rotateClockwisePressed = false;
-            break;
-        case sf::Keyboard::Key::Z:
-            m_rotateCounterClockwisePressed = false;
-            break;
-        case sf::Keyboard::Key::Space:
-            m_hardDropPressed = false;
-            break;
-        default:
-            break;
-    }
+void InputHandler::setRepeatTimings(float autoShiftDelay, float autoRepeatRate, float softDropInterval) {
+    // Keep at least 1 ms between repeats so a zero setting cannot spin
+    const auto toUs = [](float seconds) {
+        return std::max<std::int64_t>(1000, static_cast<std::int64_t>(seconds * 1000000.0f));
+    };
+    m_autoShiftDelayUs = toUs(autoShiftDelay);
+    m_autoRepeatUs = toUs(autoRepeatRate);
+    m_softDropUs = toUs(softDropInterval);
 }
 
-bool InputHandler::isKeyPressed(sf::Keyboard::Key key) const {
-    return sf::Keyboard::isKeyPressed(key);
+void InputHandler::handleKeyPress(sf::Keyboard::Key key, std::int64_t timeUs) {
+    pushEvent(key, true, timeUs);
 }
 
-bool InputHandler::isLeftPressed() const {
-    return m_leftPressed;
+void InputHandler::handleKeyRelease(sf::Keyboard::Key key, std::int64_t timeUs) {
+    pushEvent(key, false, timeUs);
 }
 
-bool InputHandler::isRightPressed() const {
-    return m_rightPressed;
-}
+void InputHandler::pushEvent(sf::Keyboard::Key key, bool pressed, std::int64_t timeUs) {
+    if (m_eventCount == m_events.size()) {
+        std::cerr << "Warning: input event queue full, dropping key event" << std::endl;
+        return;
+    }
 
-bool InputHandler::isDownPressed() const {
-    return m_downPressed;
-}
+    // Events are processed in queue order, keep their timestamps from going backwards
+    if (m_eventCount > 0) {
+        const KeyEvent& last = m_events[(m_eventHead + m_eventCount - 1) % m_events.size()];
+        timeUs = std::max(timeUs, last.timeUs);
+    }
 
-bool InputHandler::isRotateClockwisePressed() const {
-    return m_rotateClockwisePressed;
+    m_events[(m_eventHead + m_eventCount) % m_events.size()] = KeyEvent{key, pressed, timeUs};
+    ++m_eventCount;
 }
 
-bool InputHandler::isRotateCounterClockwisePressed() const {
-    return m_rotateCounterClockwisePressed;
-}
+void InputHandler::update(std::int64_t nowUs) {
+    m_actionCount = 0;
 
-bool InputHandler::isHardDropPressed() const {
-    return m_hardDropPressed;
-}
+    // Repeats owed from a long gap between updates are not replayed in one burst
+    const std::int64_t oldestRepeatUs = nowUs - MAX_REPEAT_CATCH_UP_US;
+    for (RepeatState* state : {&m_left, &m_right, &m_down}) {
+        state->nextRepeatUs = std::max(state->nextRepeatUs, oldestRepeatUs);
+    }
 
-void InputHandler::resetRotateFlags() {
-    m_rotateClockwisePressed = false;
-    m_rotateCounterClockwisePressed = false;
-}
+    while (m_eventCount > 0) {
+        const KeyEvent event = m_events[m_eventHead];
+        m_eventHead = (m_eventHead + 1) % m_events.size();
+        --m_eventCount;
 
-void InputHandler::resetHardDropFlag() {
-    m_hardDropPressed = false;
+        emitRepeatsUntil(event.timeUs);
+        applyEvent(event);
+    }
+
+    emitRepeatsUntil(nowUs);
 }
 
-bool InputHandler::wasKeyJustPressed(sf::Keyboard::Key key) const {
-    switch (key) {
-        case sf::Keyboard::Key::Left:
-            return m_leftJustPressed;
-        case sf::Keyboard::Key::Right:
-            return m_rightJustPressed;
-        case sf::Keyboard::Key::Down:
-            return m_downJustPressed;
-        default:
-            return false;
-    }
+void InputHandler::reset() {
+    m_eventHead = 0;
+    m_eventCount = 0;
+    m_actionCount = 0;
+    m_left = RepeatState();
+    m_right = RepeatState();
+    m_down = RepeatState();
 }
 
-void InputHandler::markKeyProcessed(sf::Keyboard::Key key) {
-    switch (key) {
+//turn a key event into an immediate action and start or stop its auto-repeat
+void InputHandler::applyEvent(const KeyEvent& event) {
+    switch (event.key) {
         case sf::Keyboard::Key::Left:
-            m_leftJustPressed = false;
+        case sf::Keyboard::Key::Right: {
+            const bool isLeft = event.key == sf::Keyboard::Key::Left;
+            RepeatState& state = isLeft ? m_left : m_right;
+            RepeatState& other = isLeft ? m_right : m_left;
+            const InputAction action = isLeft ? InputAction::MOVE_LEFT : InputAction::MOVE_RIGHT;
+
+            if (event.pressed) {
+                if (!state.held) {
+                    state.held = true;
+                    state.nextRepeatUs = event.timeUs + m_autoShiftDelayUs;
+                    m_horizontal = action;
+                    emit(action);
+                }
+            } else {
+                state.held = false;
+                // Fall back to the other direction if it is still held, restarting its delay
+                if (m_horizontal == action && other.held) {
+                    m_horizontal = isLeft ? InputAction::MOVE_RIGHT : InputAction::MOVE_LEFT;
+                    other.nextRepeatUs = event.timeUs + m_autoShiftDelayUs;
+                }
+            }
+            break;
+        }
+        case sf::Keyboard::Key::Down:
+            if (event.pressed) {
+                if (!m_down.held) {
+                    m_down.held = true;
+                    m_down.nextRepeatUs = event.timeUs + m_softDropUs;
+                    emit(InputAction::SOFT_DROP);
+                }
+            } else {
+                m_down.held = false;
+            }
             break;
-        case sf::Keyboard::Key::Right:
-            m_rightJustPressed = false;
+        case sf::Keyboard::Key::Up:
+            if (event.pressed) {
+                emit(InputAction::ROTATE_CLOCKWISE);
+            }
             break;
-        case sf::Keyboard::Key::Down:
-            m_downJustPressed = false;
+        case sf::Keyboard::Key::Z:
+            if (event.pressed) {
+                emit(InputAction::ROTATE_COUNTER_CLOCKWISE);
+            }
+            break;
+        case sf::Keyboard::Key::Space:
+            if (event.pressed) {
+                emit(InputAction::HARD_DROP);
+            }
             break;
         default:
             break;
     }
 }
+
+void InputHandler::emitRepeatsUntil(std::int64_t timeUs) {
+    RepeatState& horizontal = (m_horizontal == InputAction::MOVE_LEFT) ? m_left : m_right;
+    emitRepeats(horizontal, m_horizontal, m_autoRepeatUs, timeUs);
+    emitRepeats(m_down, InputAction::SOFT_DROP, m_softDropUs, timeUs);
+}
+
+//emit every repeat that fell due up to timeUs, however many that is
+void InputHandler::emitRepeats(RepeatState& state, InputAction action, std::int64_t intervalUs, std::int64_t timeUs) {
+    while (state.held && state.nextRepeatUs <= timeUs && m_actionCount < m_actions.size()) {
+        emit(action);
+        state.nextRepeatUs += intervalUs;
+    }
+}
+
+void InputHandler::emit(InputAction action) {
+    if (m_actionCount < m_actions.size()) {
+        m_actions[m_actionCount++] = action;
+    }
+}
@@ -1,37 +1,71 @@
 #pragma once
+#include "../model/InputAction.h"
 #include <SFML/Window.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
 //Handling user inputs for game control
+//Key presses and releases are queued with their timestamp, update() turns them into actions in time order
+//and generates auto-repeat (DAS/ARR) at the exact times it is due, so the number of moves does not
+//depend on how often update() is called
 class InputHandler {
 public:
+    static constexpr std::size_t MAX_ACTIONS_PER_UPDATE = 64;
+
     InputHandler();
-    void handleKeyPress(sf::Keyboard::Key key);
-    void handleKeyRelease(sf::Keyboard::Key key);
-    
-    bool isKeyPressed(sf::Keyboard::Key key) const;
-    
-    bool isLeftPressed() const;
-    bool isRightPressed() const;
-    bool isDownPressed() const;
-    bool isRotateClockwisePressed() const;
-    bool isRotateCounterClockwisePressed() const;
-    bool isHardDropPressed() const;
-    void resetRotateFlags();
-    
-    void resetHardDropFlag();
-    
-    bool wasKeyJustPressed(sf::Keyboard::Key key) const;
-    
-    void markKeyProcessed(sf::Keyboard::Key key);
+
+    // Repeat timings in seconds: delay before auto-repeat starts, then interval between repeats
+    void setRepeatTimings(float autoShiftDelay, float autoRepeatRate, float softDropInterval);
+
+    void handleKeyPress(sf::Keyboard::Key key, std::int64_t timeUs);
+    void handleKeyRelease(sf::Keyboard::Key key, std::int64_t timeUs);
+
+    // Process queued key events and auto-repeats up to nowUs
+    void update(std::int64_t nowUs);
+    std::size_t actionCount() const { return m_actionCount; }
+    InputAction action(std::size_t index) const { return m_actions[index]; }
+
+    // Forget held keys and queued events (e.g. when a new game starts)
+    void reset();
 
 private:
-    bool m_leftPressed;
-    bool m_rightPressed;
-    bool m_downPressed;
-    bool m_rotateClockwisePressed;
-    bool m_rotateCounterClockwisePressed;
-    bool m_hardDropPressed;
-    bool m_leftJustPressed;
-    bool m_rightJustPressed;
-    bool m_downJustPressed;
+    struct KeyEvent {
+        sf::Keyboard::Key key;
+        bool pressed;
+        std::int64_t timeUs;
+    };
+
+    // Auto-repeat state of a held key
+    struct RepeatState {
+        bool held = false;
+        std::int64_t nextRepeatUs = 0;
+    };
+
+    static constexpr std::size_t EVENT_QUEUE_SIZE = 64;
+    // Auto-repeats owed for longer than this (e.g. while paused) are dropped instead of replayed
+    static constexpr std::int64_t MAX_REPEAT_CATCH_UP_US = 100000;
+
+    std::array<KeyEvent, EVENT_QUEUE_SIZE> m_events;
+    std::size_t m_eventHead;
+    std::size_t m_eventCount;
+
+    std::array<InputAction, MAX_ACTIONS_PER_UPDATE> m_actions;
+    std::size_t m_actionCount;
+
+    RepeatState m_left;
+    RepeatState m_right;
+    RepeatState m_down;
+    // Last pressed horizontal direction wins while both are held
+    InputAction m_horizontal;
+
+    std::int64_t m_autoShiftDelayUs;
+    std::int64_t m_autoRepeatUs;
+    std::int64_t m_softDropUs;
+
+    void pushEvent(sf::Keyboard::Key key, bool pressed, std::int64_t timeUs);
+    void applyEvent(const KeyEvent& event);
+    void emitRepeatsUntil(std::int64_t timeUs);
+    void emitRepeats(RepeatState& state, InputAction action, std::int64_t intervalUs, std::int64_t timeUs);
+    void emit(InputAction action);
 };
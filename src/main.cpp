@@ -1,14 +1,41 @@
 #include <SFML/Graphics.hpp>
 #include "controller/GameController.h"
 #include "view/GameView.h"
+#include "view/RenderSnapshot.h"
+#include "util/LatencyTracker.h"
+#include "util/SpscQueue.h"
+#include "util/Timestamp.h"
+#include "util/TripleBuffer.h"
 #include "ConfigManager.h"
+#include "ai/AIWeights.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
 
-int main() {
+// Longest stretch of time the simulation catches up in one go (avoids a burst of steps after a stall)
+static constexpr float MAX_SIMULATION_CATCH_UP = 0.25f;
+
+// Event handed from the window thread to the simulation thread, key events carry their poll time
+// and key presses a latency id when measuring
+struct PolledEvent {
+    sf::Event event;
+    std::uint64_t inputId;
+    std::int64_t polledAtUs;
+};
+
+int main(int argc, char** argv) {
     //Loading the configuration of the game stored in the config.ini file
     ConfigManager& config = ConfigManager::getInstance();
     config.load("config.ini");
+    // Read the AI weights file now rather than when the first AI game starts
+    AIWeights::configured();
     // Initialize a random seed    
     std::srand(static_cast<unsigned int>(std::time(nullptr)));
 
@@ -47,44 +74,101 @@ int main() {
     GameController controller;
     GameView view;
 
-    sf::Clock clock;
+    // --replay <file> watches a recorded game instead of opening the menu
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--replay") == 0 && !controller.startReplay(argv[i + 1])) {
+            std::cerr << "Could not play replay " << argv[i + 1] << std::endl;
+        }
+    }
+
+    // The window thread (this one) polls events and renders, the simulation thread owns the controller.
+    // Events go one way through a lock-free queue, render snapshots come back through a triple buffer,
+    // so neither side ever waits for the other.
+    SpscQueue<PolledEvent, 256> events;
+    TripleBuffer<RenderSnapshot> snapshots;
+    std::atomic<bool> running(true);
+
+    const std::string& latencyCsvPath = config.getLatencyCsvPath();
+    const bool measureLatency = !latencyCsvPath.empty();
+    LatencyTracker latencyTracker;
+    std::uint64_t nextInputId = 1;
+
+    controller.fillSnapshot(snapshots.writeBuffer());
+    snapshots.publish();
+
+    std::thread simulation([&]() {
+        const float step = 1.0f / static_cast<float>(config.getSimulationRate());
+        sf::Clock clock;
+        float accumulator = 0.0f;
+
+        while (running.load(std::memory_order_relaxed)) {
+            while (auto polled = events.pop()) {
+                controller.handleEvent(polled->event, polled->inputId, polled->polledAtUs);
+            }
+
+            // Fixed rate simulation, independent of the display rate and of vsync
+            accumulator = std::min(accumulator + clock.restart().asSeconds(), MAX_SIMULATION_CATCH_UP);
+            bool stepped = false;
+            while (accumulator >= step) {
+                controller.update(step);
+                accumulator -= step;
+                stepped = true;
+            }
+
+            if (stepped) {
+                controller.fillSnapshot(snapshots.writeBuffer());
+                snapshots.publish();
+            }
+
+            std::this_thread::sleep_for(std::chrono::duration<float>(step - accumulator));
+        }
+    });
+
     // Main loop
     while (window.isOpen()) {
-        float deltaTime = clock.restart().asSeconds();
-
         while (const auto event = window.pollEvent()) {
             
             if (event->is<sf::Event::Closed>()) {
                 window.close();
             }
 
-            controller.handleEvent(*event);
+            PolledEvent polled{*event, 0, 0};
+            if (event->is<sf::Event::KeyPressed>() || event->is<sf::Event::KeyReleased>()) {
+                // Timestamped here so the simulation applies key repeats at the time they actually happened
+                polled.polledAtUs = nowMicroseconds();
+                if (measureLatency && event->is<sf::Event::KeyPressed>()) {
+                    polled.inputId = nextInputId++;
+                }
+            }
+
+            if (!events.push(polled)) {
+                std::cerr << "Warning: input queue full, dropping event" << std::endl;
+            }
         }
 
-        controller.update(deltaTime);
-        
+        snapshots.fetch();
+        const RenderSnapshot& snapshot = snapshots.readBuffer();
+
         // Check if user requested exit
-        if (controller.shouldExit()) {
+        if (snapshot.shouldExit) {
             window.close();
         }
-        // Render current game state and menu taking into account multiplayer status
-        const bool isMultiplayer = controller.isLocalMultiplayerMode() || controller.isNetworkMultiplayerMode();
-        const GameState* remoteState = isMultiplayer ? &controller.getRemoteGameState() : nullptr;
-        
-        // Get connection status and IP for network menus
-        const bool isNetworkConnected = controller.isNetworkConnected();
-        const std::string localIP = controller.getLocalIP();
-        
-        view.render(window, controller.getGameState(), controller.getMenuView(),
-                   controller.getMenuState(), controller.getSelectedOption(),
-                   isMultiplayer, remoteState,
-                   controller.getWinnerId(), controller.getWinnerName(),
-                   isNetworkConnected, localIP,
-                   controller.getLocalPlayerReady(), controller.getRemotePlayerReady(),
-                   controller.getMusicVolume());
-        
-        view.setIPInput(controller.getIPInput());
+
+        // Render the latest state the simulation published
+        view.render(window, snapshot, controller.getMenuView());
+
+        if (measureLatency) {
+            latencyTracker.onFramePresented(controller.latencySamples(), snapshot.lastAppliedInputId, nowMicroseconds());
+        }
+    }
+
+    running.store(false, std::memory_order_relaxed);
+    simulation.join();
+
+    if (measureLatency) {
+        latencyTracker.printSummary(std::cout);
+        latencyTracker.writeCsv(latencyCsvPath);
     }
 
     return 0;
-}
\ No newline at end of file
+}
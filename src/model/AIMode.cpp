@@ -4,16 +4,31 @@
 #include "../ai/AdvancedAI.h"
 #include "../ConfigManager.h"
 
-AIMode::AIMode(bool useAdvanced) 
+AIMode::AIMode(bool useAdvanced, bool autoPlay) 
+    : AIMode(useAdvanced, autoPlay, AIWeights::configured()) {}
+
+AIMode::AIMode(bool useAdvanced, bool autoPlay, const AIWeights& weights)
     : m_useAdvanced(useAdvanced),
-      m_ai(useAdvanced ? static_cast<std::unique_ptr<AIPlayer>>(std::make_unique<AdvancedAI>()) 
-                        : static_cast<std::unique_ptr<AIPlayer>>(std::make_unique<SimpleAI>())),
+      m_weights(weights),
+      m_autoPlay(autoPlay),
+      m_lastPlacement(0, 0),
       m_moveTimer(0.0f),
       m_level(),
-      m_totalLinesCleared(0) {}
+      m_totalLinesCleared(0) {
+    m_ai = createAI();
+    m_lastMove.reserve(16);
+}
+
+std::unique_ptr<AIPlayer> AIMode::createAI() const {
+    if (m_useAdvanced) {
+        return std::make_unique<AdvancedAI>(m_weights);
+    }
+    return std::make_unique<SimpleAI>(m_weights);
+}
 
 void AIMode::update(float deltaTime, GameState& gameState) {
-    if (gameState.isClearingLines() || gameState.isGameOver()) {
+    m_lastMove.clear();
+    if (!m_autoPlay || gameState.isClearingLines() || gameState.isGameOver()) {
         return;
     }
     
@@ -23,24 +38,37 @@ void AIMode::update(float deltaTime, GameState& gameState) {
     float moveDelay = ConfigManager::getInstance().getAIMoveDelay();
     if (m_moveTimer >= moveDelay) {
         m_moveTimer = 0.0f;
-        
-        auto [rotation, column] = m_ai->chooseMove(gameState);
-        for (int i = 0; i < rotation; ++i) {
-            gameState.rotateClockwise();
+        playMove(gameState);
+    }
+}
+
+void AIMode::playMove(GameState& gameState) {
+    m_lastMove.clear();
+    m_lastPlacement = m_ai->chooseMove(gameState);
+    playPlacement(gameState, m_lastPlacement, m_lastMove);
+}
+
+void AIMode::playPlacement(GameState& gameState, std::pair<int, int> placement, std::vector<InputAction>& actions) {
+    const auto play = [&](InputAction action) {
+        actions.push_back(action);
+        gameState.applyInput(action);
+    };
+    const auto [rotation, column] = placement;
+    for (int i = 0; i < rotation; ++i) {
+        play(InputAction::ROTATE_CLOCKWISE);
+    }
+    
+    int currentX = gameState.pieceX();
+    if (column < currentX) {
+        for (int i = 0; i < currentX - column; ++i) {
+            play(InputAction::MOVE_LEFT);
         }
-        
-        int currentX = gameState.pieceX();
-        if (column < currentX) {
-            for (int i = 0; i < currentX - column; ++i) {
-                gameState.moveLeft();
-            }
-        } else if (column > currentX) {
-            for (int i = 0; i < column - currentX; ++i) {
-                gameState.moveRight();
-            }
+    } else if (column > currentX) {
+        for (int i = 0; i < column - currentX; ++i) {
+            play(InputAction::MOVE_RIGHT);
         }
-        gameState.hardDrop();
     }
+    play(InputAction::HARD_DROP);
 }
 
 float AIMode::getFallSpeed() const {
@@ -59,9 +87,22 @@ void AIMode::reset() {
     m_moveTimer = 0.0f;
     m_level = Level();
     m_totalLinesCleared = 0;
-    // Preserve the AI type in case the player wants to play again
-    m_ai = m_useAdvanced ? static_cast<std::unique_ptr<AIPlayer>>(std::make_unique<AdvancedAI>()) 
-                         : static_cast<std::unique_ptr<AIPlayer>>(std::make_unique<SimpleAI>());
+    // Preserve the AI type and weights in case the player wants to play again
+    m_ai = createAI();
+}
+
+// The AI players keep no state between moves, only the timer and level progress are saved
+void AIMode::saveState(GameModeState& state) const {
+    state.level = m_level.current();
+    state.levelLines = m_level.lines();
+    state.totalLinesCleared = m_totalLinesCleared;
+    state.timer = m_moveTimer;
+}
+
+void AIMode::restoreState(const GameModeState& state) {
+    m_level.set(state.level, state.levelLines);
+    m_totalLinesCleared = state.totalLinesCleared;
+    m_moveTimer = state.timer;
 }
 
 const char* AIMode::getModeName() const {
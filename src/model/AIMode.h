@@ -1,27 +1,53 @@
 #pragma once
 #include "GameMode.h"
+#include "InputAction.h"
 #include "Level.h"
 #include "../ai/AIPlayer.h"
+#include "../ai/AIWeights.h"
 #include <memory>
+#include <utility>
+#include <vector>
 
 //AI mode where an AI plays
 class AIMode : public GameMode {
 public:
-    AIMode(bool useAdvanced = true);
+    // Without autoPlay the AI makes no moves, for replays that bring their own
+    AIMode(bool useAdvanced = true, bool autoPlay = true);
+    // An AI playing with weights instead of the configured ones (tuning)
+    AIMode(bool useAdvanced, bool autoPlay, const AIWeights& weights);
 
     void update(float deltaTime, GameState& gameState) override;
     float getFallSpeed() const override;
     void onLinesClear(int linesCleared, GameState& gameState) override;
     void reset() override;
     const char* getModeName() const override;
+    void saveState(GameModeState& state) const override;
+    void restoreState(const GameModeState& state) override;
 
     // Accessors
     int getLinesCleared() const override;
     int getCurrentLevel() const;
+    // Actions of the move made by the last update(), empty if it made none
+    const std::vector<InputAction>& lastMove() const { return m_lastMove; }
+    // Rotation and column the AI chose for that move (as AIPlayer::chooseMove returns them)
+    std::pair<int, int> lastPlacement() const { return m_lastPlacement; }
+
+    // Choose and play a move now, as update() does once the move delay has passed
+    void playMove(GameState& gameState);
+
+    // Turn and shift the current piece to a placement chosen by an AIPlayer, then hard drop it,
+    // appending the actions applied to actions
+    static void playPlacement(GameState& gameState, std::pair<int, int> placement, std::vector<InputAction>& actions);
 
 private:
+    std::unique_ptr<AIPlayer> createAI() const;
+
     std::unique_ptr<AIPlayer> m_ai;
     bool m_useAdvanced;  // choose between the two types of AI
+    AIWeights m_weights;
+    bool m_autoPlay;
+    std::vector<InputAction> m_lastMove;
+    std::pair<int, int> m_lastPlacement;
     float m_moveTimer;
     Level m_level;
     int m_totalLinesCleared;
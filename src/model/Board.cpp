@@ -1,8 +1,7 @@
 #include "Board.h"
-#include "Tetromino.h"  // For Point definition
-#include <vector>
+#include <cstring>
 
-Board::Board() {
+Board::Board() : m_version(0) {
     clear();
 }
 //When x, y is passed, x corresponds to the row and y the column therefore, m_grid[y][x]!!!!
@@ -12,6 +11,7 @@ void Board::clear() {
             m_grid[y][x] = 0;
         }
     }
+    m_version++;
 }
 
 bool Board::isInside(int x, int y) const {
@@ -28,12 +28,43 @@ int Board::getCell(int x, int y) const {
 
 
 void Board::setCell(int x, int y, int value) {
-    if (isInside(x, y)) {
-        m_grid[y][x] = value;
+    if (isInside(x, y) && m_grid[y][x] != value) {
+        m_grid[y][x] = static_cast<std::int8_t>(value);
+        m_version++;
     }
 }
 
-bool Board::checkCollision(const std::vector<Point>& blocks, int posX, int posY) const {
+bool Board::insertGarbageRows(int count, int holeColumn) {
+    if (count <= 0) {
+        return true;
+    }
+    if (count > Height) {
+        count = Height;
+    }
+
+    bool fits = true;
+    for (int y = 0; y < count && fits; y++) {
+        for (int x = 0; x < Width; x++) {
+            if (m_grid[y][x] != 0) {
+                fits = false;
+                break;
+            }
+        }
+    }
+
+    // Rows are contiguous, one move shifts the whole stack
+    std::memmove(&m_grid[0][0], &m_grid[count][0], sizeof(m_grid[0]) * (Height - count));
+    for (int y = Height - count; y < Height; y++) {
+        std::memset(m_grid[y], GarbageCell, sizeof(m_grid[y]));
+        if (holeColumn >= 0 && holeColumn < Width) {
+            m_grid[y][holeColumn] = 0;
+        }
+    }
+    m_version++;
+    return fits;
+}
+
+bool Board::checkCollision(const PieceBlocks& blocks, int posX, int posY) const {
     for (const auto& block : blocks) {
         int x = posX + block.x;
         int y = posY + block.y;
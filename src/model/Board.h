@@ -1,13 +1,13 @@
 #pragma once
-#include <vector>
-
-struct Point;
+#include "Tetromino.h"
+#include <cstdint>
 
 //Tetris board class managing grid state
 class Board {
 public:
     static constexpr int Width  = 10;
     static constexpr int Height = 21; //one more row for the hidden spawn area
+    static constexpr int GarbageCell = 8; //cell value of garbage rows received from the opponent
 
     Board();
 
@@ -24,10 +24,21 @@ public:
     
 
 
+    // Push the whole stack up by count rows and fill the bottom with garbage rows that all have their hole
+    // at holeColumn. Returns false if filled cells were pushed off the top (the player topped out).
+    bool insertGarbageRows(int count, int holeColumn);
+
     //check if blocks yield collision at given position
-    bool checkCollision(const std::vector<Point>& blocks, int posX, int posY) const;
+    bool checkCollision(const PieceBlocks& blocks, int posX, int posY) const;
+
+    // Incremented on every cell change so the view knows when its cached board layer is stale
+    std::uint32_t version() const { return m_version; }
+    // After overwriting a board with an older copy (rollback), keep its version moving forward so
+    // the view never mistakes the new content for a layer it already cached
+    void advanceVersionPast(std::uint32_t version) { m_version = (version > m_version ? version : m_version) + 1; }
 
 private:
-    //initial grid a matrix 
-    int m_grid[Height][Width];
+    //initial grid a matrix (cell values range from -1 to 8, one byte each keeps the board copy small)
+    std::int8_t m_grid[Height][Width];
+    std::uint32_t m_version;
 };
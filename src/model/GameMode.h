@@ -3,6 +3,14 @@
 // Forward declaration
 class GameState;
 
+// Progress of a game mode as plain data, so GameState snapshots stay trivially copyable
+struct GameModeState {
+    int level = 0;
+    int levelLines = 0;
+    int totalLinesCleared = 0;
+    float timer = 0.0f;
+};
+
 //Abstract base class for all the different game modes implemented
 class GameMode {
 public:
@@ -13,4 +21,7 @@ public:
     virtual void reset() = 0;
     virtual const char* getModeName() const = 0;
     virtual int getLinesCleared() const = 0;
+    // Save and restore the mode's progress for GameState snapshots
+    virtual void saveState(GameModeState& state) const = 0;
+    virtual void restoreState(const GameModeState& state) = 0;
 };
@@ -2,7 +2,7 @@
 #include "GameMode.h"
 #include "LevelBasedMode.h"
 #include "AIMode.h"
-#include <cstdlib> // for rand()
+#include <cstdlib> // for rand(), seeds solo games
 #include <algorithm> // for std::sort, std::greater
 
 //Choice of permutation given by the bag system (shuffling the pieces)
@@ -12,7 +12,7 @@ void GameState::refillBag() {
         TetrominoType::O, TetrominoType::S, TetrominoType::T, TetrominoType::Z
     };
     for (int i = 6; i > 0; i--) {
-        int j = rand() % (i + 1);
+        int j = m_random.nextInt(i + 1);
         std::swap(m_pieceBag[i], m_pieceBag[j]);
     }
         
@@ -27,8 +27,15 @@ GameState::GameState()
       m_fallTimer(0.f),
       m_isClearingLines(false),
       m_clearAnimationTimer(0.0f),
+      m_linesToClear(0),
       m_gameOver(false),
-      m_gameMode(std::make_unique<LevelBasedMode>())
+      m_gameMode(std::make_unique<LevelBasedMode>()),
+      m_bagIndex(0),
+      m_pieceCount(0),
+      m_random(static_cast<std::uint32_t>(std::rand())),
+      m_garbageRandom(static_cast<std::uint32_t>(std::rand())),
+      m_incomingGarbageCount(0),
+      m_outgoingGarbage(0)
 {
     refillBag();
     spawnNewPiece();
@@ -36,6 +43,60 @@ GameState::GameState()
 
 GameState::~GameState() = default;
 
+void GameState::save(GameStateSnapshot& snapshot) const {
+    snapshot.board = m_board;
+    snapshot.currentPiece = m_currentPiece;
+    snapshot.nextPiece = m_nextPiece;
+    snapshot.pieceBag = m_pieceBag;
+    snapshot.bagIndex = m_bagIndex;
+    snapshot.pieceCount = m_pieceCount;
+    snapshot.randomState = m_random.state();
+    snapshot.x = m_x;
+    snapshot.y = m_y;
+    snapshot.fallTimer = m_fallTimer;
+    snapshot.isClearingLines = m_isClearingLines;
+    snapshot.clearAnimationTimer = m_clearAnimationTimer;
+    snapshot.linesToClear = m_linesToClear;
+    snapshot.gameOver = m_gameOver;
+    snapshot.score = m_score.value();
+    snapshot.mode = GameModeState();
+    if (m_gameMode) {
+        m_gameMode->saveState(snapshot.mode);
+    }
+    snapshot.incomingGarbage = m_incomingGarbage;
+    snapshot.incomingGarbageCount = m_incomingGarbageCount;
+    snapshot.outgoingGarbage = m_outgoingGarbage;
+    snapshot.garbageRandomState = m_garbageRandom.state();
+}
+
+void GameState::restore(const GameStateSnapshot& snapshot) {
+    // Keep the board version moving forward so the view never mistakes older content for a cached layer
+    const std::uint32_t boardVersion = m_board.version();
+    m_board = snapshot.board;
+    m_board.advanceVersionPast(boardVersion);
+
+    m_currentPiece = snapshot.currentPiece;
+    m_nextPiece = snapshot.nextPiece;
+    m_pieceBag = snapshot.pieceBag;
+    m_bagIndex = snapshot.bagIndex;
+    m_pieceCount = snapshot.pieceCount;
+    m_random.setState(snapshot.randomState);
+    m_x = snapshot.x;
+    m_y = snapshot.y;
+    m_fallTimer = snapshot.fallTimer;
+    m_isClearingLines = snapshot.isClearingLines;
+    m_clearAnimationTimer = snapshot.clearAnimationTimer;
+    m_linesToClear = snapshot.linesToClear;
+    m_gameOver = snapshot.gameOver;
+    m_score.set(snapshot.score);
+    if (m_gameMode) {
+        m_gameMode->restoreState(snapshot.mode);
+    }
+    m_incomingGarbage = snapshot.incomingGarbage;
+    m_incomingGarbageCount = snapshot.incomingGarbageCount;
+    m_outgoingGarbage = snapshot.outgoingGarbage;
+    m_garbageRandom.setState(snapshot.garbageRandomState);
+}
 
 void GameState::update(float deltaTime) {
     if (m_gameMode) {
@@ -52,6 +113,10 @@ void GameState::update(float deltaTime) {
         return;
     }
     
+    for (int i = 0; i < m_incomingGarbageCount; i++) {
+        m_incomingGarbage[i].delay -= deltaTime;
+    }
+    
     m_fallTimer += deltaTime;
     float fallSpeed = m_gameMode ? m_gameMode->getFallSpeed() : 0.5f;
     if (m_fallTimer > fallSpeed) {
@@ -145,6 +210,29 @@ void GameState::hardDrop() {
     lockPiece();
 }
 
+void GameState::applyInput(InputAction action) {
+    switch (action) {
+        case InputAction::MOVE_LEFT:
+            moveLeft();
+            break;
+        case InputAction::MOVE_RIGHT:
+            moveRight();
+            break;
+        case InputAction::SOFT_DROP:
+            softDrop();
+            break;
+        case InputAction::ROTATE_CLOCKWISE:
+            rotateClockwise();
+            break;
+        case InputAction::ROTATE_COUNTER_CLOCKWISE:
+            rotateCounterClockwise();
+            break;
+        case InputAction::HARD_DROP:
+            hardDrop();
+            break;
+    }
+}
+
 // Lock piece into the board
 void GameState::lockPiece() {
     for (const auto& block : m_currentPiece.getBlocks()) {
@@ -154,7 +242,7 @@ void GameState::lockPiece() {
             m_board.setCell(bx, by, m_currentPiece.getColorId());
         }
     }
-    std::vector<int> fullLines;
+    int fullLines = 0;
     for (int y = Board::Height - 1; y >= 0; y--) {
         bool full = true;
         for (int x = 0; x < Board::Width; x++) {
@@ -164,20 +252,19 @@ void GameState::lockPiece() {
             }
         }
         if (full) {
-            fullLines.push_back(y);
+            fullLines++;
+            for (int x = 0; x < Board::Width; x++) {
+                m_board.setCell(x, y, -1); // We mark the blocks of the line to be cleared
+            }
         }
     }
     
-    if (!fullLines.empty()) {
+    if (fullLines > 0) {
         m_isClearingLines = true;
         m_clearAnimationTimer = 0.0f;
         m_linesToClear = fullLines;
-        
-        for (int y : fullLines) {
-            for (int x = 0; x < Board::Width; x++) {
-                m_board.setCell(x, y, -1); // We mark the blocks of the line to be cleared
-            }
-        }
+    } else if (!insertReadyGarbage()) {
+        m_gameOver = true;
     } else {
         spawnNewPiece();
     }
@@ -209,7 +296,7 @@ void GameState::updateClearingAnimation(float deltaTime) {
             }
             writeY--;
         }
-        int linesCleared = static_cast<int>(m_linesToClear.size());
+        int linesCleared = m_linesToClear;
         int currentLevel = 0;
         if (m_gameMode) {
             const auto* levelMode = dynamic_cast<const LevelBasedMode*>(m_gameMode.get());
@@ -222,9 +309,10 @@ void GameState::updateClearingAnimation(float deltaTime) {
             m_gameMode->onLinesClear(linesCleared, *this);
         }
         m_score.addLineClear(linesCleared, currentLevel);
+        sendAttack(linesCleared);
         m_isClearingLines = false;
         m_clearAnimationTimer = 0.0f;
-        m_linesToClear.clear();
+        m_linesToClear = 0;
         
         if (!m_gameOver) {
             spawnNewPiece();
@@ -234,11 +322,14 @@ void GameState::updateClearingAnimation(float deltaTime) {
 
 void GameState::reset() {
     m_board.clear();
+    m_fallTimer = 0.f;
     m_score.reset();
     m_gameOver = false;
     m_isClearingLines = false;
     m_clearAnimationTimer = 0.0f;
-    m_linesToClear.clear();
+    m_linesToClear = 0;
+    m_incomingGarbageCount = 0;
+    m_outgoingGarbage = 0;
     
     if (m_gameMode) {
         m_gameMode->reset();
@@ -246,12 +337,19 @@ void GameState::reset() {
 
     refillBag();
     m_bagIndex = 0;
+    m_pieceCount = 0;
 
     spawnNewPiece();
 }
 
 
 
+void GameState::resetWithSeed(std::uint32_t seed) {
+    m_random.setSeed(seed);
+    m_garbageRandom.setSeed(seed ^ 0x5A5A5A5Au);
+    reset();
+}
+
 const Board& GameState::board() const { return m_board; }
 const Tetromino& GameState::currentPiece() const { return m_currentPiece; }
 const Tetromino& GameState::nextPiece() const { return m_nextPiece; }
@@ -302,30 +400,10 @@ GameMode* GameState::getGameMode() const {
 
 void GameState::addGarbageLines(int numLines) {
     if (numLines <= 0) return;
-    if (numLines >= Board::Height) {
+    if (!m_board.insertGarbageRows(numLines, m_garbageRandom.nextInt(Board::Width))) {
         m_gameOver = true;
         return;
     }
-    for (int y = 0; y < Board::Height - numLines; y++) {
-        for (int x = 0; x < Board::Width; x++) {
-            int sourceY = y + numLines;
-            int cellValue = m_board.getCell(x, sourceY);
-            m_board.setCell(x, y, cellValue);
-        }
-    }
-    
-    for (int line = 0; line < numLines; line++) {
-        int garbageY = Board::Height - numLines + line;
-        int holeX = rand() % Board::Width;
-        
-        for (int x = 0; x < Board::Width; x++) {
-            if (x == holeX) {
-                m_board.setCell(x, garbageY, 0);
-            } else {
-                m_board.setCell(x, garbageY, 8);
-            }
-        }
-    }
     
     if (m_board.checkCollision(m_currentPiece.getBlocks(), m_x, m_y)) {
         while (m_y > 0 && m_board.checkCollision(m_currentPiece.getBlocks(), m_x, m_y)) {
@@ -338,6 +416,69 @@ void GameState::addGarbageLines(int numLines) {
     }
 }
 
+void GameState::receiveGarbage(int lines, float delay) {
+    if (lines <= 0) return;
+    // A full queue folds the attack into the newest entry rather than losing it
+    if (m_incomingGarbageCount == MAX_PENDING_GARBAGE) {
+        m_incomingGarbage[MAX_PENDING_GARBAGE - 1].lines += lines;
+        return;
+    }
+    m_incomingGarbage[m_incomingGarbageCount++] = PendingGarbage{lines, delay};
+}
+
+int GameState::takeOutgoingGarbage() {
+    int lines = m_outgoingGarbage;
+    m_outgoingGarbage = 0;
+    return lines;
+}
+
+int GameState::pendingGarbage() const {
+    int lines = 0;
+    for (int i = 0; i < m_incomingGarbageCount; i++) {
+        lines += m_incomingGarbage[i].lines;
+    }
+    return lines;
+}
+
+void GameState::sendAttack(int linesCleared) {
+    static constexpr int ATTACK[5] = {0, 0, 1, 2, 4};
+    int attack = ATTACK[linesCleared < 0 ? 0 : (linesCleared > 4 ? 4 : linesCleared)];
+    
+    // Cancel the oldest garbage queued against us first
+    int cancelled = 0;
+    while (attack > 0 && cancelled < m_incomingGarbageCount) {
+        PendingGarbage& garbage = m_incomingGarbage[cancelled];
+        int used = attack < garbage.lines ? attack : garbage.lines;
+        garbage.lines -= used;
+        attack -= used;
+        if (garbage.lines == 0) {
+            cancelled++;
+        }
+    }
+    for (int i = cancelled; i < m_incomingGarbageCount; i++) {
+        m_incomingGarbage[i - cancelled] = m_incomingGarbage[i];
+    }
+    m_incomingGarbageCount -= cancelled;
+    
+    m_outgoingGarbage += attack;
+}
+
+bool GameState::insertReadyGarbage() {
+    int inserted = 0;
+    while (inserted < m_incomingGarbageCount && m_incomingGarbage[inserted].delay <= 0.0f) {
+        if (!m_board.insertGarbageRows(m_incomingGarbage[inserted].lines, m_garbageRandom.nextInt(Board::Width))) {
+            m_incomingGarbageCount = 0;
+            return false;
+        }
+        inserted++;
+    }
+    for (int i = inserted; i < m_incomingGarbageCount; i++) {
+        m_incomingGarbage[i - inserted] = m_incomingGarbage[i];
+    }
+    m_incomingGarbageCount -= inserted;
+    return true;
+}
+
 //for multiplayer
 void GameState::syncBoard(const Board& board) {
     for (int y = 0; y < Board::Height; y++) {
@@ -355,14 +496,15 @@ void GameState::syncPiecePosition(int x, int y, int rotation) {
 
 //spawn a new piece at the top of the board
 void GameState::spawnNewPiece() {
-    if (m_bagIndex >= m_pieceBag.size()) {
+    if (m_bagIndex >= static_cast<int>(m_pieceBag.size())) {
         refillBag();
     }
 
     m_currentPiece = Tetromino(m_pieceBag[m_bagIndex]);
     m_bagIndex++;
+    m_pieceCount++;
 
-    if (m_bagIndex >= m_pieceBag.size()) {
+    if (m_bagIndex >= static_cast<int>(m_pieceBag.size())) {
         refillBag();
     }
     m_nextPiece = Tetromino(m_pieceBag[m_bagIndex]);
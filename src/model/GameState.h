@@ -3,20 +3,66 @@
 #include "Tetromino.h"
 #include "Score.h"
 #include "GameMode.h"
-#include <vector>
+#include "InputAction.h"
+#include "Random.h"
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
 
 // Forward declaration
 class GameMode;
 
+// Garbage lines sent by the opponent, waiting to be inserted
+struct PendingGarbage {
+    int lines;
+    float delay;  // seconds left before it may be inserted
+};
+
+constexpr int MAX_PENDING_GARBAGE = 8;
+
+// Everything a GameState needs to continue exactly where it was, as plain data: save()/restore() are a
+// few hundred bytes of copying. The active game mode itself is not part of it, only its progress.
+struct GameStateSnapshot {
+    Board board;
+    Tetromino currentPiece;
+    Tetromino nextPiece;
+    std::array<TetrominoType, 7> pieceBag;
+    int bagIndex;
+    int pieceCount;
+    std::uint32_t randomState;
+    int x;
+    int y;
+    float fallTimer;
+    bool isClearingLines;
+    float clearAnimationTimer;
+    int linesToClear;
+    bool gameOver;
+    int score;
+    GameModeState mode;
+    std::array<PendingGarbage, MAX_PENDING_GARBAGE> incomingGarbage;
+    int incomingGarbageCount;
+    int outgoingGarbage;
+    std::uint32_t garbageRandomState;
+};
+
+static_assert(std::is_trivially_copyable<GameStateSnapshot>::value, "GameStateSnapshot must stay plain data");
+
 // GameState manages the overall state of the game with the current and next piece,
 // the board, score, piece movement and gravity, gamemode management.
 
 class GameState {
 public:
+    // Time between an attack and its garbage becoming insertable, the window to cancel it by clearing lines
+    static constexpr float GARBAGE_DELAY = 0.5f;
+
     GameState();
     ~GameState();
 
+    // Snapshot for rollback, replays and search: restore() expects the same game mode type as save()
+    void save(GameStateSnapshot& snapshot) const;
+    void restore(const GameStateSnapshot& snapshot);
+
     void update(float deltaTime);
 
     void moveLeft();
@@ -27,11 +73,16 @@ public:
     void softDrop();
     void hardDrop();
 
+    // Perform one player action (same effect as the matching method above)
+    void applyInput(InputAction action);
+
     void lockPiece();
 
     void updateClearingAnimation(float deltaTime);
 
     void reset(); 
+    // Reset with a known seed: two states reset with the same seed and fed the same inputs stay identical
+    void resetWithSeed(std::uint32_t seed);
     void setGameMode(std::unique_ptr<GameMode> mode);
     GameMode* getGameMode() const;
 
@@ -44,12 +95,23 @@ public:
     int score() const;
     int level() const;
     bool isGameOver() const;
+    // Pieces spawned since the last reset, the first one included
+    int pieceCount() const { return m_pieceCount; }
     
     // Animation state accessors
     bool isClearingLines() const;
     float getClearAnimationProgress() const;
     
     void addGarbageLines(int numLines);
+
+    // Versus garbage: clearing 2/3/4 lines attacks with 1/2/4 lines, which first cancel garbage still queued
+    // against us. Garbage from the opponent is inserted, one row shift per attack, at the first lock that
+    // clears nothing once its delay has passed.
+    void receiveGarbage(int lines, float delay = GARBAGE_DELAY);
+    // Attack lines produced since the last call, for the opponent
+    int takeOutgoingGarbage();
+    // Lines queued against us
+    int pendingGarbage() const;
     
     void syncBoard(const Board& board);
     
@@ -63,7 +125,7 @@ private:
     std::unique_ptr<GameMode> m_gameMode;
     bool m_isClearingLines;
     float m_clearAnimationTimer;
-    std::vector<int> m_linesToClear;
+    int m_linesToClear;  // number of rows marked -1 while the clear animation runs
     static constexpr float CLEAR_ANIMATION_DURATION = 0.5f;
 
     bool m_gameOver;
@@ -73,8 +135,19 @@ private:
 
     float m_fallTimer;
 
-    std::vector<TetrominoType> m_pieceBag;
+    std::array<TetrominoType, 7> m_pieceBag;
     int m_bagIndex;
+    int m_pieceCount;
+    Random m_random;  // pieces
+    Random m_garbageRandom;  // garbage holes, separate so both players keep the same piece sequence
+
+    std::array<PendingGarbage, MAX_PENDING_GARBAGE> m_incomingGarbage;
+    int m_incomingGarbageCount;
+    int m_outgoingGarbage;
+
+    void sendAttack(int linesCleared);
+    // Returns false if the garbage pushed blocks off the top
+    bool insertReadyGarbage();
 
     void spawnNewPiece();
 
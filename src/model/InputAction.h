@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+// Game actions a player can perform, produced by the InputHandler and exchanged in lockstep games
+enum class InputAction : std::uint8_t {
+    MOVE_LEFT,
+    MOVE_RIGHT,
+    SOFT_DROP,
+    ROTATE_CLOCKWISE,
+    ROTATE_COUNTER_CLOCKWISE,
+    HARD_DROP
+};
+
+constexpr std::uint8_t INPUT_ACTION_COUNT = 6;
@@ -14,6 +14,15 @@ int Level::current() const {
     return m_level;
 }
 
+int Level::lines() const {
+    return m_lines;
+}
+
+void Level::set(int level, int lines) {
+    m_level = level;
+    m_lines = lines;
+}
+
 float Level::fallSpeed() const {
     return 0.5f - 0.05f * m_level;
 }
@@ -9,6 +9,10 @@ public:
     int current() const;
     float fallSpeed() const;
 
+    // Lines counted toward the next level, and restoring both from a snapshot
+    int lines() const;
+    void set(int level, int lines);
+
 private:
     int m_level;
     int m_lines;
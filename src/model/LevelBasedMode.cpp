@@ -25,6 +25,18 @@ void LevelBasedMode::reset() {
     m_totalLinesCleared = 0;
 }
 
+void LevelBasedMode::saveState(GameModeState& state) const {
+    state.level = m_level.current();
+    state.levelLines = m_level.lines();
+    state.totalLinesCleared = m_totalLinesCleared;
+    state.timer = 0.0f;
+}
+
+void LevelBasedMode::restoreState(const GameModeState& state) {
+    m_level.set(state.level, state.levelLines);
+    m_totalLinesCleared = state.totalLinesCleared;
+}
+
 const char* LevelBasedMode::getModeName() const {
     return "Level Mode";
 }
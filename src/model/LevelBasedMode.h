@@ -12,6 +12,8 @@ public:
     void onLinesClear(int linesCleared, GameState& gameState) override;
     void reset() override;
     const char* getModeName() const override;
+    void saveState(GameModeState& state) const override;
+    void restoreState(const GameModeState& state) override;
 
     int getCurrentLevel() const;
     int getLinesCleared() const;
@@ -26,7 +26,7 @@ void MarathonGameMode::reset() {
     m_elapsedTimeMs = 0;
 }
 
-MultiplayerGameMode::MultiplayerGameMode(int targetLines) {
+MultiplayerGameMode::MultiplayerGameMode(int targetLines, MultiplayerRule rule) : m_rule(rule) {
     m_marathonMode = std::make_unique<MarathonGameMode>(targetLines);
 }
 
@@ -34,9 +34,23 @@ void MultiplayerGameMode::update(float deltaTime, GameState& player1, GameState&
     if (m_marathonMode) {
         m_marathonMode->update(deltaTime);
     }
+    if (m_rule == MultiplayerRule::VERSUS) {
+        exchangeGarbage(player1, player2);
+    }
+}
+
+void MultiplayerGameMode::exchangeGarbage(GameState& player1, GameState& player2) {
+    const int fromPlayer1 = player1.takeOutgoingGarbage();
+    const int fromPlayer2 = player2.takeOutgoingGarbage();
+    player1.receiveGarbage(fromPlayer2);
+    player2.receiveGarbage(fromPlayer1);
 }
 
 int MultiplayerGameMode::checkVictory(const GameState& player1, const GameState& player2) const {
+    // Versus is won by topping the opponent out, which the caller checks
+    if (m_rule == MultiplayerRule::VERSUS) {
+        return -1;
+    }
     if (m_marathonMode) {
         return m_marathonMode->checkVictory(player1, player2);
     }
@@ -44,7 +58,7 @@ int MultiplayerGameMode::checkVictory(const GameState& player1, const GameState&
 }
 
 const char* MultiplayerGameMode::getModeName() const {
-    return "Marathon";
+    return m_rule == MultiplayerRule::VERSUS ? "Versus" : "Marathon";
 }
 
 int MultiplayerGameMode::getTargetLines() const {
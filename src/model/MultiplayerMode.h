@@ -29,15 +29,25 @@ private:
 };
 
 
+// How two players compete: a race to the target lines, or versus where line clears send garbage
+enum class MultiplayerRule {
+    MARATHON,
+    VERSUS
+};
+
 class MultiplayerGameMode {
 public:
-    MultiplayerGameMode(int targetLines = 40);
+    MultiplayerGameMode(int targetLines = 40, MultiplayerRule rule = MultiplayerRule::MARATHON);
     
     //update both players
     void update(float deltaTime, GameState& player1, GameState& player2);
+    // Hand each player's attack lines to the other. Both are taken before either is delivered, so the
+    // order of the arguments does not matter (peers simulating the same match call it with swapped players).
+    static void exchangeGarbage(GameState& player1, GameState& player2);
     int checkVictory(const GameState& player1, const GameState& player2) const;
     
     const char* getModeName() const;
+    MultiplayerRule getRule() const { return m_rule; }
     int getTargetLines() const;
     int getElapsedTime() const;
     
@@ -45,4 +55,5 @@ public:
     
 private:
     std::unique_ptr<MarathonGameMode> m_marathonMode;
+    MultiplayerRule m_rule;
 };
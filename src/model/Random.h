@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// Small deterministic generator (xorshift32) so a seed gives the same pieces and garbage on every machine,
+// unlike rand() whose sequence depends on the C library
+class Random {
+public:
+    explicit Random(std::uint32_t seed = 1) { setSeed(seed); }
+
+    void setSeed(std::uint32_t seed) {
+        // xorshift never leaves 0, spread the seed so nearby seeds give unrelated sequences
+        m_state = seed * 2654435761u ^ 0x9E3779B9u;
+        if (m_state == 0) {
+            m_state = 0x9E3779B9u;
+        }
+    }
+
+    std::uint32_t next() {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    // Value in [0, bound)
+    int nextInt(int bound) { return static_cast<int>(next() % static_cast<std::uint32_t>(bound)); }
+
+    // Raw generator state, for snapshots
+    std::uint32_t state() const { return m_state; }
+    void setState(std::uint32_t state) { m_state = state != 0 ? state : 0x9E3779B9u; }
+
+private:
+    std::uint32_t m_state;
+};
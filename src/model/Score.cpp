@@ -22,6 +22,10 @@ void Score::addLineClear(int linesCleared, int level) {
 
 
 
+void Score::set(int score) {
+    m_score = score;
+}
+
 int Score::value() const {
     return m_score;
 }
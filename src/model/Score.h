@@ -13,6 +13,9 @@ public:
     // Reset score (for new game)
     void reset();
 
+    // Restore a saved score
+    void set(int score);
+
 private:
     int m_score;
 };
@@ -56,64 +56,59 @@ Tetromino::Tetromino(TetrominoType type)
         case TetrominoType::T: m_colorId = 6; break;
         case TetrominoType::Z: m_colorId = 7; break;
     }
-    
-    initializeRotations();
 }
 
-void Tetromino::initializeRotations() {
-    // Define spawn orientation (rotation 0) for each piece
-    std::vector<Point> spawn;
-    
-    switch (m_type) {
-        case TetrominoType::I:
-            spawn = {{-1,0}, {0,0}, {1,0}, {2,0}};
-            break;
-        case TetrominoType::J:
-            spawn = {{-1,-1}, {-1,0}, {0,0}, {1,0}};
-            break;
-        case TetrominoType::L:
-            spawn = {{1,-1}, {-1,0}, {0,0}, {1,0}};
-            break;
-        case TetrominoType::O:
-            spawn = {{0,0}, {1,0}, {0,1}, {1,1}};
-            break;
-        case TetrominoType::S:
-            spawn = {{0,0}, {1,0}, {-1,1}, {0,1}};
-            break;
-        case TetrominoType::T:
-            spawn = {{-1,0}, {0,0}, {1,0}, {0,1}};
-            break;
-        case TetrominoType::Z:
-            spawn = {{-1,0}, {0,0}, {0,1}, {1,1}};
-            break;
-    }
-    
-    // Store state
-    m_rotationStates[0] = spawn;
+const Tetromino::RotationTable& Tetromino::rotationTable() {
+    static const RotationTable table = buildRotationTable();
+    return table;
+}
+
+Tetromino::RotationTable Tetromino::buildRotationTable() {
+    RotationTable table;
     
-    // Generate other rotation states by rotating spawn
-    if (m_type == TetrominoType::O) {
-        // O-piece is the same in all rotations
-        m_rotationStates[1] = spawn;
-        m_rotationStates[2] = spawn;
-        m_rotationStates[3] = spawn;
-    } else {
-        // Rotate spawn to get other states
-        m_rotationStates[1] = spawn;
-        for (auto& p : m_rotationStates[1]) {
-            p = rotatePointClockwise(p);
-        }
+    for (int typeIndex = 0; typeIndex < 7; typeIndex++) {
+        const TetrominoType type = static_cast<TetrominoType>(typeIndex);
         
-        m_rotationStates[2] = m_rotationStates[1];
-        for (auto& p : m_rotationStates[2]) {
-            p = rotatePointClockwise(p);
+        // Define spawn orientation (rotation 0) for each piece
+        PieceBlocks spawn;
+        switch (type) {
+            case TetrominoType::I:
+                spawn = {{{-1,0}, {0,0}, {1,0}, {2,0}}};
+                break;
+            case TetrominoType::J:
+                spawn = {{{-1,-1}, {-1,0}, {0,0}, {1,0}}};
+                break;
+            case TetrominoType::L:
+                spawn = {{{1,-1}, {-1,0}, {0,0}, {1,0}}};
+                break;
+            case TetrominoType::O:
+                spawn = {{{0,0}, {1,0}, {0,1}, {1,1}}};
+                break;
+            case TetrominoType::S:
+                spawn = {{{0,0}, {1,0}, {-1,1}, {0,1}}};
+                break;
+            case TetrominoType::T:
+                spawn = {{{-1,0}, {0,0}, {1,0}, {0,1}}};
+                break;
+            case TetrominoType::Z:
+                spawn = {{{-1,0}, {0,0}, {0,1}, {1,1}}};
+                break;
         }
         
-        m_rotationStates[3] = m_rotationStates[2];
-        for (auto& p : m_rotationStates[3]) {
-            p = rotatePointClockwise(p);
+        auto& rotations = table[typeIndex];
+        rotations[0] = spawn;
+        for (int r = 1; r < 4; r++) {
+            rotations[r] = rotations[r - 1];
+            // O-piece is the same in all rotations
+            if (type != TetrominoType::O) {
+                for (auto& p : rotations[r]) {
+                    p = rotatePointClockwise(p);
+                }
+            }
         }
     }
+    
+    return table;
 }
 
 Point Tetromino::rotatePointClockwise(const Point& p) {
@@ -138,12 +133,12 @@ RotationState Tetromino::getRotationState() const {
     return m_rotationState;
 }
 
-const std::vector<Point>& Tetromino::getBlocks() const {
-    return m_rotationStates[static_cast<int>(m_rotationState)];
+const PieceBlocks& Tetromino::getBlocks() const {
+    return rotationTable()[static_cast<int>(m_type)][static_cast<int>(m_rotationState)];
 }
 
-const std::vector<Point>& Tetromino::getBlocks(RotationState state) const {
-    return m_rotationStates[static_cast<int>(state)];
+const PieceBlocks& Tetromino::getBlocks(RotationState state) const {
+    return rotationTable()[static_cast<int>(m_type)][static_cast<int>(state)];
 }
 
 void Tetromino::rotateClockwise() {
@@ -23,7 +23,11 @@ enum class RotationState {
     R270 = 3
 };
 
+// The 4 blocks of a piece in one rotation, relative to the piece position
+using PieceBlocks = std::array<Point, 4>;
+
 // Tetromino class representing a Tetris piece with rotation and block positions
+// (type and rotation only, the block layouts are shared tables so copying a piece is free)
 class Tetromino {
 public:
     explicit Tetromino(TetrominoType type = TetrominoType::O);
@@ -33,10 +37,10 @@ public:
     RotationState getRotationState() const;
 
     // Get blocks for current rotation state
-    const std::vector<Point>& getBlocks() const;
+    const PieceBlocks& getBlocks() const;
     
     // Get blocks for a specific rotation state
-    const std::vector<Point>& getBlocks(RotationState state) const;
+    const PieceBlocks& getBlocks(RotationState state) const;
     
     // Rotate clockwise (0->1->2->3->0)
     void rotateClockwise();
@@ -56,11 +60,10 @@ private:
     int m_colorId;
     RotationState m_rotationState;
     
-    // Store all 4 rotation states for this piece
-    std::array<std::vector<Point>, 4> m_rotationStates;
-    
-    // Initialize all rotation states for the piece type
-    void initializeRotations();
+    // All 4 rotation states of every piece type, built once
+    using RotationTable = std::array<std::array<PieceBlocks, 4>, 7>;
+    static const RotationTable& rotationTable();
+    static RotationTable buildRotationTable();
     
     // Helper to rotate a point 90° clockwise around origin
     static Point rotatePointClockwise(const Point& p);
@@ -0,0 +1,40 @@
+#include "ClockSync.h"
+#include <algorithm>
+#include <cstdlib>
+
+ClockSync::ClockSync() {
+    reset();
+}
+
+void ClockSync::reset() {
+    m_sampleCount = 0;
+    m_lastDelayUs = 0;
+    m_rttUs = 0;
+    m_jitterUs = 0;
+    m_offsetUs = 0;
+}
+
+void ClockSync::addSample(const ClockSample& sample) {
+    // Time on the wire excludes how long the peer held the ping before answering
+    const std::int64_t delayUs = std::max<std::int64_t>(
+        0, (sample.arrivalUs - sample.originUs) - (sample.transmitUs - sample.receiveUs));
+    const std::int64_t offsetUs =
+        ((sample.receiveUs - sample.originUs) + (sample.transmitUs - sample.arrivalUs)) / 2;
+
+    if (m_sampleCount == 0) {
+        m_rttUs = delayUs;
+        m_jitterUs = 0;
+    } else {
+        m_rttUs += (delayUs - m_rttUs) / 8;
+        m_jitterUs += (std::llabs(delayUs - m_lastDelayUs) - m_jitterUs) / 16;
+    }
+    m_lastDelayUs = delayUs;
+
+    m_window[m_sampleCount % SAMPLE_WINDOW] = Measurement{delayUs, offsetUs};
+    ++m_sampleCount;
+
+    const std::size_t count = std::min(m_sampleCount, SAMPLE_WINDOW);
+    const auto best = std::min_element(m_window.begin(), m_window.begin() + count,
+                                       [](const Measurement& a, const Measurement& b) { return a.delayUs < b.delayUs; });
+    m_offsetUs = best->offsetUs;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// One ping/pong exchange, all times in microseconds on the clock of whoever took them
+struct ClockSample {
+    std::int64_t originUs = 0;     // we sent the ping (local clock)
+    std::int64_t receiveUs = 0;    // the peer received it (peer clock)
+    std::int64_t transmitUs = 0;   // the peer sent the pong (peer clock)
+    std::int64_t arrivalUs = 0;    // the pong arrived (local clock)
+};
+
+// NTP-style estimator of round trip time, jitter and the offset between the peer's clock and ours.
+// The offset comes from the lowest-delay sample of the last few, since queuing delay is what skews it.
+class ClockSync {
+public:
+    static constexpr std::size_t SAMPLE_WINDOW = 8;
+
+    ClockSync();
+
+    void reset();
+    void addSample(const ClockSample& sample);
+
+    bool hasEstimate() const { return m_sampleCount > 0; }
+    std::int64_t rttUs() const { return m_rttUs; }
+    // Mean variation between consecutive round trips (RFC 3550 style)
+    std::int64_t jitterUs() const { return m_jitterUs; }
+    // Peer clock minus local clock
+    std::int64_t offsetUs() const { return m_offsetUs; }
+
+    // A time read on the peer's clock, on our timeline
+    std::int64_t toLocalTime(std::int64_t peerTimeUs) const { return peerTimeUs - m_offsetUs; }
+
+private:
+    struct Measurement {
+        std::int64_t delayUs;
+        std::int64_t offsetUs;
+    };
+
+    std::array<Measurement, SAMPLE_WINDOW> m_window;
+    std::size_t m_sampleCount;
+    std::int64_t m_lastDelayUs;
+    std::int64_t m_rttUs;
+    std::int64_t m_jitterUs;
+    std::int64_t m_offsetUs;
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stream framing of TcpTransport and tetris-server: a 4 byte big-endian length, then the frame
+// (the same layout as an sf::Packet holding raw bytes). Frames are written into and read from reused buffers,
+// so neither side allocates per message once the buffers have grown.
+// Between tetris-server and its clients:
+//  - client to server: one Protocol message, JOIN first (play or spectate), then INPUT while playing
+//  - server to client: the player slot the message is about, then one Protocol message. MATCH_START carries
+//    the receiving client's own slot (SPECTATOR_SLOT for spectators), KEYFRAME/DELTA the board of that slot.
+namespace Framing {
+
+constexpr std::size_t LENGTH_SIZE = 4;
+// Longest frame accepted from a peer, anything longer means a broken or hostile stream
+constexpr std::size_t MAX_FRAME_SIZE = 512;
+constexpr std::uint8_t SPECTATOR_SLOT = 0xFF;
+
+inline void appendLength(std::vector<std::uint8_t>& out, std::size_t length) {
+    out.push_back(static_cast<std::uint8_t>((length >> 24) & 0xFF));
+    out.push_back(static_cast<std::uint8_t>((length >> 16) & 0xFF));
+    out.push_back(static_cast<std::uint8_t>((length >> 8) & 0xFF));
+    out.push_back(static_cast<std::uint8_t>(length & 0xFF));
+}
+
+inline void appendFrame(std::vector<std::uint8_t>& out, const std::uint8_t* data, std::size_t size) {
+    appendLength(out, size);
+    out.insert(out.end(), data, data + size);
+}
+
+inline void appendFrame(std::vector<std::uint8_t>& out, const std::vector<std::uint8_t>& message) {
+    appendFrame(out, message.data(), message.size());
+}
+
+inline void appendSlotFrame(std::vector<std::uint8_t>& out, std::uint8_t slot, const std::vector<std::uint8_t>& message) {
+    appendLength(out, message.size() + 1);
+    out.push_back(slot);
+    out.insert(out.end(), message.begin(), message.end());
+}
+
+// Splits a received byte stream back into frames
+class FrameReader {
+public:
+    FrameReader() : m_offset(0) {}
+
+    std::vector<std::uint8_t>& buffer() { return m_buffer; }
+
+    // Next complete frame, false when more bytes are needed or the stream is broken (see isBroken())
+    bool next(const std::uint8_t*& frame, std::size_t& size) {
+        if (m_buffer.size() - m_offset < LENGTH_SIZE) {
+            compact();
+            return false;
+        }
+        const std::uint8_t* header = m_buffer.data() + m_offset;
+        const std::size_t length = (static_cast<std::size_t>(header[0]) << 24) | (static_cast<std::size_t>(header[1]) << 16) |
+                                   (static_cast<std::size_t>(header[2]) << 8) | header[3];
+        if (length > MAX_FRAME_SIZE) {
+            m_broken = true;
+            return false;
+        }
+        if (m_buffer.size() - m_offset < LENGTH_SIZE + length) {
+            compact();
+            return false;
+        }
+        frame = header + LENGTH_SIZE;
+        size = length;
+        m_offset += LENGTH_SIZE + length;
+        return true;
+    }
+
+    bool isBroken() const { return m_broken; }
+
+    void clear() {
+        m_buffer.clear();
+        m_offset = 0;
+        m_broken = false;
+    }
+
+private:
+    std::vector<std::uint8_t> m_buffer;
+    std::size_t m_offset;
+    bool m_broken = false;
+
+    // Drop consumed frames so the buffer does not grow with the stream
+    void compact() {
+        if (m_offset > 0) {
+            m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<std::ptrdiff_t>(m_offset));
+            m_offset = 0;
+        }
+    }
+};
+
+} // namespace Framing
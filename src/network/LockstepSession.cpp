@@ -0,0 +1,53 @@
+#include "LockstepSession.h"
+#include <algorithm>
+
+LockstepSession::LockstepSession()
+    : m_currentTick(0),
+      m_nextLocalTick(0) {
+    start();
+}
+
+void LockstepSession::start() {
+    m_currentTick = 0;
+    m_nextLocalTick = INPUT_DELAY_TICKS;
+    m_remoteReceived.fill(false);
+
+    for (std::uint32_t tick = 0; tick < WINDOW; ++tick) {
+        m_local[tick] = InputFrame();
+        m_local[tick].tick = tick;
+        m_remote[tick] = InputFrame();
+        m_remote[tick].tick = tick;
+    }
+
+    // Nobody can have pressed anything for the ticks covered by the input delay
+    for (std::uint32_t tick = 0; tick < INPUT_DELAY_TICKS; ++tick) {
+        m_remoteReceived[tick] = true;
+    }
+}
+
+const InputFrame& LockstepSession::scheduleLocalInput(const InputAction* actions, std::size_t count) {
+    InputFrame& frame = m_local[m_nextLocalTick % WINDOW];
+    frame.tick = m_nextLocalTick;
+    frame.count = static_cast<std::uint8_t>(std::min(count, InputFrame::MAX_ACTIONS));
+    std::copy(actions, actions + frame.count, frame.actions.begin());
+
+    ++m_nextLocalTick;
+    return frame;
+}
+
+bool LockstepSession::addRemoteInput(const InputFrame& frame) {
+    // Already simulated, or so far ahead it would overwrite a tick we still need
+    if (frame.tick < m_currentTick || frame.tick >= m_currentTick + WINDOW) {
+        return false;
+    }
+
+    const std::size_t slot = frame.tick % WINDOW;
+    m_remote[slot] = frame;
+    m_remoteReceived[slot] = true;
+    return true;
+}
+
+bool LockstepSession::canAdvance() const {
+    const std::size_t slot = m_currentTick % WINDOW;
+    return m_remoteReceived[slot] && m_remote[slot].tick == m_currentTick && m_nextLocalTick > m_currentTick;
+}
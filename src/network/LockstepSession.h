@@ -0,0 +1,48 @@
+#pragma once
+#include "Protocol.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Input schedule of a lockstep match.
+// Local inputs sampled now are scheduled INPUT_DELAY_TICKS ahead, which gives them time to reach the peer.
+// Tick t is simulated only once both players' inputs for t are known, so both peers run the exact same steps.
+class LockstepSession {
+public:
+    static constexpr float TICK_DURATION = 1.0f / 60.0f;
+    static constexpr std::uint32_t INPUT_DELAY_TICKS = 3;
+    // Ticks of inputs kept around, must cover the input delay plus what the peer can send ahead of us
+    static constexpr std::size_t WINDOW = 64;
+
+    LockstepSession();
+
+    // Start at tick 0, the first INPUT_DELAY_TICKS ticks have no input on either side
+    void start();
+
+    std::uint32_t currentTick() const { return m_currentTick; }
+
+    // True while the next local tick to sample is within the input delay of the simulation
+    bool needsLocalInput() const { return m_nextLocalTick <= m_currentTick + INPUT_DELAY_TICKS; }
+
+    // Schedule local actions for the next local tick, returns the frame to send to the peer
+    const InputFrame& scheduleLocalInput(const InputAction* actions, std::size_t count);
+
+    // Store the peer's inputs for a tick, false if the tick is outside the window
+    bool addRemoteInput(const InputFrame& frame);
+
+    // Both players' inputs for the current tick are known
+    bool canAdvance() const;
+
+    const InputFrame& localInput() const { return m_local[m_currentTick % WINDOW]; }
+    const InputFrame& remoteInput() const { return m_remote[m_currentTick % WINDOW]; }
+
+    // Move to the next tick once the current one has been simulated
+    void advance() { ++m_currentTick; }
+
+private:
+    std::array<InputFrame, WINDOW> m_local;
+    std::array<InputFrame, WINDOW> m_remote;
+    std::array<bool, WINDOW> m_remoteReceived;
+    std::uint32_t m_currentTick;
+    std::uint32_t m_nextLocalTick;
+};
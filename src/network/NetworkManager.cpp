@@ -1,10 +1,60 @@
 #include "NetworkManager.h"
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <random>
+#include <sstream>
 #include <stdexcept>
 
-NetworkManager::NetworkManager() 
-    : m_isHost(false), m_isConnected(false) {
+NetworkManager::NetworkManager(std::unique_ptr<Transport> transport, bool networkThread)
+    : m_isHost(false),
+      m_transport(std::move(transport)),
+      m_stateIntervalUs(MIN_STATE_INTERVAL_US),
+      m_lastStateSendUs(0),
+      m_lastPoseSendUs(0),
+      m_lastRateChangeUs(0),
+      m_seenPartialSends(0),
+      m_seenQueueDrops(0),
+      m_isConnected(false),
+      m_isReconnecting(false),
+      m_connection(0),
+      m_nextGarbageNumber(0),
+      m_networkThread(networkThread),
+      m_running(false),
+      m_transportConnected(false),
+      m_transportConnection(0),
+      m_lastPingUs(0),
+      m_lastReceiveUs(0),
+      m_peerPort(0),
+      m_sessionToken(0),
+      m_lostAtUs(0),
+      m_lastReconnectUs(0),
+      m_awaitingResume(false),
+      m_nextRemoteInputTick(0),
+      m_nextRemoteGarbage(0),
+      m_firstLoggedInputTick(0),
+      m_firstLoggedGarbage(0),
+      m_matchesSent(0),
+      m_matchesReceived(0),
+      m_trafficLogIntervalUs(DEFAULT_TRAFFIC_LOG_INTERVAL_US),
+      m_lastTrafficLogUs(0),
+      m_bytesSent(0),
+      m_bytesReceived(0),
+      m_partialSends(0),
+      m_unsentBytes(0),
+      m_hasClock(false),
+      m_rttUs(0),
+      m_jitterUs(0),
+      m_clockOffsetUs(0),
+      m_statesRead(0),
+      m_stateReads(0),
+      m_emptyStateReads(0),
+      m_sendQueueDrops(0) {
+    if (!m_transport) {
+        m_transport = createTransport("tcp");
+    }
 }
 
 NetworkManager::~NetworkManager() {
@@ -15,16 +65,11 @@ bool NetworkManager::host(unsigned short port) {
     try {
         disconnect();
         
-        m_isHost = true;
-        
-        // Set listener to non-blocking so it doesn't freeze the game
-        m_listener.setBlocking(false);
-        
-        if (m_listener.listen(port) != sf::Socket::Status::Done) {
-            std::cerr << "Error: Failed to bind to port " << port << std::endl;
-            m_isHost = false;
+        if (!m_transport->host(port)) {
             return false;
         }
+        m_isHost = true;
+        startThread();
         
         std::string localIP = getLocalIP();
         std::cout << "\n=== SERVER STARTED ===" << std::endl;
@@ -46,25 +91,14 @@ bool NetworkManager::connect(const std::string& ip, unsigned short port) {
         disconnect();
         
         m_isHost = false;
-        
-        // Try to connect (blocking for initial connection is okay)
-        m_serverSocket.setBlocking(true);
-        auto ipAddr = sf::IpAddress::resolve(ip);
-        if (!ipAddr.has_value()) {
-            std::cerr << "Error: Failed to resolve IP address: " << ip << std::endl;
-            return false;
-        }
-        
-        auto status = m_serverSocket.connect(ipAddr.value(), port, sf::seconds(5));
-        
-        if (status != sf::Socket::Status::Done) {
-            std::cerr << "Error: Failed to connect to " << ip << ":" << port << std::endl;
+        if (!m_transport->connect(ip, port)) {
             return false;
         }
-        
-        // Switch to non-blocking for game loop
-        m_serverSocket.setBlocking(false);
+        resetProtocol();
         m_isConnected = true;
+        m_peerIp = ip;
+        m_peerPort = port;
+        startThread();
         
         std::cout << "Connected to " << ip << ":" << port << std::endl;
         return true;
@@ -75,21 +109,15 @@ bool NetworkManager::connect(const std::string& ip, unsigned short port) {
 }
 
 void NetworkManager::disconnect() {
+    stopThread();
     try {
-        if (m_isHost) {
-            m_listener.close();
-            m_clientSocket.disconnect();
-        } else {
-            m_serverSocket.disconnect();
-        }
-        
-        m_isConnected = false;
-        m_isHost = false;
+        m_transport->disconnect();
     } catch (const std::exception& e) {
         std::cerr << "Error during disconnect: " << e.what() << std::endl;
-        m_isConnected = false;
-        m_isHost = false;
     }
+    m_isHost = false;
+    m_isConnected = false;
+    m_isReconnecting = false;
 }
 
 bool NetworkManager::isConnected() const {
@@ -97,29 +125,47 @@ bool NetworkManager::isConnected() const {
 }
 
 void NetworkManager::update() {
-    try {
-        // If we're hosting and not yet connected, try to accept a connection
-        if (m_isHost && !m_isConnected) {
-            auto status = m_listener.accept(m_clientSocket);
-            
-            if (status == sf::Socket::Status::Done) {
-                m_clientSocket.setBlocking(false);
-                m_isConnected = true;
-                std::cout << "Client connected!" << std::endl;
-            }
-            // Status::NotReady means no connection yet (non-blocking)
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error during network update: " << e.what() << std::endl;
+    processEvents();
+}
+
+void NetworkManager::poll() {
+    if (m_networkThread || !m_running.load(std::memory_order_acquire)) {
+        return;
     }
+    pollTransport();
 }
 
-sf::TcpSocket* NetworkManager::getActiveSocket() {
-    if (m_isHost) {
-        return &m_clientSocket;
-    } else {
-        return &m_serverSocket;
+void NetworkManager::resetProtocol() {
+    m_encoder = Protocol::StateEncoder();
+    m_stateIntervalUs = MIN_STATE_INTERVAL_US;
+    m_lastStateSendUs = 0;
+    m_lastPoseSendUs = 0;
+    m_matchStart.reset();
+    m_remoteInputs.clear();
+    // Over UDP the falling piece goes out unreliably so a lost datagram never delays it
+    m_encoder.setSeparatePose(m_transport->hasUnreliableDelivery());
+}
+
+bool NetworkManager::sendMessage(const std::vector<std::uint8_t>& message, Delivery delivery) {
+    if (message.size() > Protocol::MAX_MESSAGE_SIZE) {
+        std::cerr << "Error: Message of " << message.size() << " bytes is too large" << std::endl;
+        return false;
+    }
+    
+    OutgoingMessage outgoing;
+    outgoing.delivery = delivery;
+    return queueMessage(outgoing, message);
+}
+
+bool NetworkManager::queueMessage(OutgoingMessage& outgoing, const std::vector<std::uint8_t>& message) {
+    outgoing.size = static_cast<std::uint16_t>(message.size());
+    std::copy(message.begin(), message.end(), outgoing.data.begin());
+    if (!m_outgoing.push(outgoing)) {
+        m_sendQueueDrops.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "Warning: network send queue full, dropping message" << std::endl;
+        return false;
     }
+    return true;
 }
 
 bool NetworkManager::sendGameState(const PacketData& data) {
@@ -129,34 +175,44 @@ bool NetworkManager::sendGameState(const PacketData& data) {
     }
     
     try {
-        sf::Packet packet;
+        // Changes made before the next slot go out together with it
+        const std::int64_t nowUs = m_transport->nowUs();
+        adaptStateRate(nowUs);
+        if (nowUs - m_lastStateSendUs < m_stateIntervalUs) {
+            return true;
+        }
+        // The transport still holds messages the socket did not take: the changes go into one delta once it
+        // has caught up, rather than piling up more behind them
+        if (m_unsentBytes.load(std::memory_order_relaxed) > 0) {
+            return true;
+        }
         
-        // Serialize the PacketData
-        for (int y = 0; y < 21; y++) {
-            for (int x = 0; x < 10; x++) {
-                packet << data.grid[y][x];
+        // Unchanged state: nothing to send
+        bool sent = false;
+        if (m_encoder.encode(data, m_sendBuffer)) {
+            if (!sendMessage(m_sendBuffer)) {
+                // The peer will miss this delta, start over from a full state
+                m_encoder.requestKeyframe();
+                return false;
             }
+            sent = true;
         }
         
-        packet << data.currentPieceType;
-        packet << data.currentPieceX;
-        packet << data.currentPieceY;
-        packet << data.currentPieceRotation;
-        packet << data.score;
-        packet << data.level;
-        packet << data.isGameOver;
-        packet << data.isReady;
-        
-        auto status = getActiveSocket()->send(packet);
-        
-        if (status != sf::Socket::Status::Done) {
-            std::cerr << "Error: Failed to send game state (status: " << static_cast<int>(status) << ")" << std::endl;
-            if (status == sf::Socket::Status::Disconnected) {
-                m_isConnected = false;
+        // Newest pose wins, a lost one is superseded by the next or repeated by the heartbeat
+        if (m_transport->hasUnreliableDelivery()) {
+            if (nowUs - m_lastPoseSendUs >= POSE_HEARTBEAT_US) {
+                m_encoder.requestPose();
+            }
+            if (m_encoder.encodePose(data, m_sendBuffer)) {
+                sendMessage(m_sendBuffer, Delivery::UNRELIABLE);
+                m_lastPoseSendUs = nowUs;
+                sent = true;
             }
-            return false;
         }
         
+        if (sent) {
+            m_lastStateSendUs = nowUs;
+        }
         return true;
     } catch (const std::exception& e) {
         std::cerr << "Exception while sending game state: " << e.what() << std::endl;
@@ -164,51 +220,680 @@ bool NetworkManager::sendGameState(const PacketData& data) {
     }
 }
 
+void NetworkManager::adaptStateRate(std::int64_t nowUs) {
+    const std::uint64_t partialSends = m_partialSends.load(std::memory_order_relaxed);
+    const std::uint64_t queueDrops = m_sendQueueDrops.load(std::memory_order_relaxed);
+    const bool backpressure = m_outgoing.size() >= BACKPRESSURE_QUEUE_DEPTH || partialSends > m_seenPartialSends ||
+                              queueDrops > m_seenQueueDrops || m_unsentBytes.load(std::memory_order_relaxed) > 0;
+    m_seenPartialSends = partialSends;
+    m_seenQueueDrops = queueDrops;
+    
+    std::int64_t interval = m_stateIntervalUs;
+    if (backpressure) {
+        if (nowUs - m_lastRateChangeUs >= STATE_BACKOFF_US) {
+            interval = std::min(interval * 2, MAX_STATE_INTERVAL_US);
+        }
+    } else if (nowUs - m_lastRateChangeUs >= STATE_RECOVER_US) {
+        interval = std::max(interval / 2, MIN_STATE_INTERVAL_US);
+    }
+    if (interval == m_stateIntervalUs) {
+        return;
+    }
+    // Every change restarts both timers, a link still pushing back keeps the lower rate
+    m_lastRateChangeUs = nowUs;
+    m_stateIntervalUs = interval;
+    std::cout << "State send rate " << (backpressure ? "lowered" : "raised") << " to " << 1000000 / interval
+              << " Hz" << std::endl;
+}
+
 std::optional<PacketData> NetworkManager::receiveOpponentState() {
+    processEvents();
+    
     if (!m_isConnected) {
         std::cerr << "Error: Not connected to receive game state" << std::endl;
         return std::nullopt;
     }
     
+    // States decoded before the current connection started are stale
+    m_stateReads.fetch_add(1, std::memory_order_relaxed);
+    if (!m_states.fetch() || m_states.readBuffer().connection != m_connection) {
+        m_emptyStateReads.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    m_statesRead.fetch_add(1, std::memory_order_relaxed);
+    return m_states.readBuffer().data;
+}
+
+bool NetworkManager::sendMatchStart(const MatchStart& start) {
+    if (!m_isConnected) {
+        return false;
+    }
+    
+    // Inputs still queued belong to the previous match
+    m_remoteInputs.clear();
+    m_remoteGarbage.clear();
+    m_nextGarbageNumber = 0;
+    
+    Protocol::StateEncoder::encodeMatchStart(start, m_sendBuffer);
+    OutgoingMessage outgoing;
+    outgoing.startsMatch = true;
+    return queueMessage(outgoing, m_sendBuffer);
+}
+
+bool NetworkManager::sendInput(const InputFrame& frame) {
+    if (!m_isConnected) {
+        return false;
+    }
+    
+    Protocol::StateEncoder::encodeInput(frame, m_sendBuffer);
+    // Logged by the network thread, a peer that reconnects gets the ones it missed
+    OutgoingMessage outgoing;
+    outgoing.logged = LoggedKind::INPUT;
+    outgoing.number = frame.tick;
+    return queueMessage(outgoing, m_sendBuffer);
+}
+
+bool NetworkManager::sendGarbage(int lines) {
+    if (!m_isConnected || lines <= 0) {
+        return false;
+    }
+    
+    GarbageAttack attack;
+    attack.lines = std::min(lines, Protocol::ROWS);
+    attack.sentUs = m_transport->nowUs();
+    attack.number = m_nextGarbageNumber++;
+    Protocol::StateEncoder::encodeGarbage(attack, m_sendBuffer);
+    // Logged like inputs: an attack sent into a link that is about to drop is resent on resume
+    OutgoingMessage outgoing;
+    outgoing.logged = LoggedKind::GARBAGE;
+    outgoing.number = attack.number;
+    return queueMessage(outgoing, m_sendBuffer);
+}
+
+std::optional<MatchStart> NetworkManager::takeMatchStart() {
+    std::optional<MatchStart> start = m_matchStart;
+    m_matchStart.reset();
+    return start;
+}
+
+bool NetworkManager::popRemoteInput(InputFrame& frame) {
+    if (m_remoteInputs.empty()) {
+        return false;
+    }
+    frame = m_remoteInputs.front();
+    m_remoteInputs.pop_front();
+    return true;
+}
+
+bool NetworkManager::popGarbage(GarbageAttack& attack) {
+    if (m_remoteGarbage.empty()) {
+        return false;
+    }
+    attack = m_remoteGarbage.front();
+    m_remoteGarbage.pop_front();
+    return true;
+}
+
+// Game thread: apply events in the order the network thread produced them
+void NetworkManager::processEvents() {
+    while (auto event = m_events.pop()) {
+        switch (event->type) {
+            case NetworkEvent::Type::CONNECTED:
+                resetProtocol();
+                m_connection = event->connection;
+                m_isConnected = true;
+                m_isReconnecting = false;
+                std::cout << "Client connected!" << std::endl;
+                break;
+            case NetworkEvent::Type::DISCONNECTED:
+                m_isConnected = false;
+                m_isReconnecting = false;
+                break;
+            case NetworkEvent::Type::RECONNECTING:
+                m_isReconnecting = true;
+                break;
+            case NetworkEvent::Type::RESUMED:
+                // Same session: the match and its inputs carry on, only the board stream restarts
+                m_connection = event->connection;
+                m_isReconnecting = false;
+                m_encoder.requestKeyframe();
+                break;
+            case NetworkEvent::Type::RESYNC_REQUESTED:
+                m_encoder.requestKeyframe();
+                break;
+            case NetworkEvent::Type::MATCH_STARTED:
+                // Inputs received before this belong to the previous match
+                m_matchStart = event->matchStart;
+                m_remoteInputs.clear();
+                m_remoteGarbage.clear();
+                m_nextGarbageNumber = 0;
+                break;
+            case NetworkEvent::Type::INPUT_RECEIVED:
+                m_remoteInputs.push_back(event->input);
+                break;
+            case NetworkEvent::Type::GARBAGE_RECEIVED: {
+                // Without a clock estimate (before the first pong) the peer's clock cannot be read on ours:
+                // the attack counts as sent now
+                GarbageAttack attack = event->garbage;
+                attack.sentUs = m_hasClock.load(std::memory_order_acquire) ? peerToLocalTime(attack.sentUs)
+                                                                           : m_transport->nowUs();
+                m_remoteGarbage.push_back(attack);
+                break;
+            }
+        }
+    }
+}
+
+void NetworkManager::startThread() {
+    // The client is already connected when the thread starts, a host waits for update() to accept someone
+    // Connection numbers keep counting across sessions: a state the previous session published and nobody read
+    // carries an older number and is never shown as the new opponent's (0 matches nothing until a peer is there)
+    m_transportConnected = m_transport->isConnected();
+    if (m_transportConnected) {
+        ++m_transportConnection;
+    }
+    m_connection = m_transportConnected ? m_transportConnection : 0;
+    m_overflowEvents.clear();
+    m_sessionToken = 0;
+    m_lostAtUs = 0;
+    m_awaitingResume = false;
+    m_matchesSent = 0;
+    m_matchesReceived = 0;
+    clearMatchLog();
+    onConnectionStarted();
+    m_bytesSent.store(0, std::memory_order_relaxed);
+    m_bytesReceived.store(0, std::memory_order_relaxed);
+    
+    m_running.store(true, std::memory_order_release);
+    if (m_networkThread) {
+        m_thread = std::thread(&NetworkManager::networkLoop, this);
+    }
+}
+
+void NetworkManager::stopThread() {
+    if (!m_running.load(std::memory_order_acquire)) {
+        return;
+    }
+    m_running.store(false, std::memory_order_release);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_transportConnected) {
+        logLinkStats();
+        logTraffic();
+    }
+    
+    // With the thread gone both ends of the queues are ours, drop whatever is left
+    while (m_outgoing.pop()) {
+    }
+    while (m_events.pop()) {
+    }
+}
+
+// Network thread: poll about once per millisecond so the socket never backs up
+void NetworkManager::networkLoop() {
+    while (m_running.load(std::memory_order_acquire)) {
+        pollTransport();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Network thread (or poll()): accept, reconnect, send what was queued and receive what arrived
+void NetworkManager::pollTransport() {
     try {
-        sf::Packet packet;
-        auto status = getActiveSocket()->receive(packet);
-        
-        // NotReady means no data available (non-blocking)
-        if (status == sf::Socket::Status::NotReady) {
-            return std::nullopt;
+        if (m_transport->update()) {
+            ++m_transportConnection;
+            m_transportConnected = true;
+            onConnectionStarted();
+            // While reconnecting, the first message tells whether the dropped client is back
+            if (m_lostAtUs != 0) {
+                m_awaitingResume = true;
+            } else {
+                startSession();
+            }
         }
         
-        if (status != sf::Socket::Status::Done) {
-            // Connection lost or error
-            std::cerr << "Error: Connection lost or receive failed (status: " << static_cast<int>(status) << ")" << std::endl;
-            m_isConnected = false;
-            return std::nullopt;
+        if (m_lostAtUs != 0) {
+            updateReconnect();
         }
         
-        // Deserialize
-        PacketData data;
+        sendQueued();
+        if (m_transportConnected) {
+            if (!m_awaitingResume) {
+                sendPing();
+            }
+            receiveMessages();
+            
+            if (m_transport->isConnected() && m_transport->nowUs() - m_lastReceiveUs > LINK_TIMEOUT_US) {
+                std::cerr << "Error: No traffic from the peer for " << LINK_TIMEOUT_US / 1000 << " ms" << std::endl;
+                m_transport->dropPeer();
+            }
+        }
         
-        for (int y = 0; y < 21; y++) {
-            for (int x = 0; x < 10; x++) {
-                packet >> data.grid[y][x];
+        if (m_transportConnected && !m_transport->isConnected()) {
+            onLinkLost();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error during network update: " << e.what() << std::endl;
+    }
+    
+    m_bytesSent.store(m_transport->bytesSent(), std::memory_order_relaxed);
+    m_bytesReceived.store(m_transport->bytesReceived(), std::memory_order_relaxed);
+    m_partialSends.store(m_transport->partialSends(), std::memory_order_relaxed);
+    m_unsentBytes.store(m_transport->unsentBytes(), std::memory_order_relaxed);
+    updateTraffic();
+}
+
+void NetworkManager::sendQueued() {
+    m_trafficMetrics.observeQueueDepth(m_outgoing.size());
+    while (auto message = m_outgoing.pop()) {
+        if (message->startsMatch) {
+            clearMatchLog();
+            ++m_matchesSent;
+            m_lastMatchStart.assign(message->data.begin(), message->data.begin() + message->size);
+        }
+        if (message->logged != LoggedKind::NONE && message->size <= MAX_LOGGED_MESSAGE_SIZE) {
+            LoggedMessage logged;
+            logged.kind = message->logged;
+            logged.number = message->number;
+            logged.size = static_cast<std::uint8_t>(message->size);
+            std::copy(message->data.begin(), message->data.begin() + message->size, logged.data.begin());
+            m_matchLog.push_back(logged);
+            if (m_matchLog.size() > MATCH_LOG_SIZE) {
+                const LoggedMessage& trimmed = m_matchLog.front();
+                if (trimmed.kind == LoggedKind::INPUT) {
+                    m_firstLoggedInputTick = trimmed.number + 1;
+                } else {
+                    m_firstLoggedGarbage = trimmed.number + 1;
+                }
+                m_matchLog.pop_front();
             }
         }
         
-        packet >> data.currentPieceType;
-        packet >> data.currentPieceX;
-        packet >> data.currentPieceY;
-        packet >> data.currentPieceRotation;
-        packet >> data.score;
-        packet >> data.level;
-        packet >> data.isGameOver;
-        packet >> data.isReady;
+        // While the peer is away only the logged messages are kept, boards restart with a keyframe on resume
+        if (m_transportConnected && !m_awaitingResume) {
+            transmit(message->data.data(), message->size, message->delivery);
+        }
+    }
+}
+
+// Network thread: a new peer starts with a fresh decoder and no clock estimate
+void NetworkManager::onConnectionStarted() {
+    m_decoder.reset();
+    m_clockSync.reset();
+    m_hasClock.store(false, std::memory_order_relaxed);
+    m_lastPingUs = 0;
+    m_lastReceiveUs = m_transport->nowUs();
+    startTrafficWindow();
+}
+
+// Network thread: keep the session open for a reconnect, unless there is none to resume
+void NetworkManager::onLinkLost() {
+    m_transportConnected = false;
+    m_awaitingResume = false;
+    logLinkStats();
+    logTraffic();
+    
+    if (m_sessionToken == 0) {
+        pushEvent({NetworkEvent::Type::DISCONNECTED, m_transportConnection, {}, {}});
+        return;
+    }
+    // Lost again during the handshake: the window still counts from the first drop
+    if (m_lostAtUs == 0) {
+        m_lostAtUs = m_transport->nowUs();
+        m_lastReconnectUs = m_lostAtUs;
+        std::cout << "Connection lost, waiting up to " << RECONNECT_WINDOW_US / 1000000 << " s for it to come back"
+                  << std::endl;
+        pushEvent({NetworkEvent::Type::RECONNECTING, m_transportConnection, {}, {}});
+    }
+}
+
+// Network thread: the client dials the host again, both give up once the window is over
+void NetworkManager::updateReconnect() {
+    if (m_transportConnected) {
+        return;  // handshake in progress
+    }
+    
+    const std::int64_t nowUs = m_transport->nowUs();
+    if (nowUs - m_lostAtUs > RECONNECT_WINDOW_US) {
+        std::cerr << "Error: Peer did not reconnect in time, session ended" << std::endl;
+        endSession();
+        return;
+    }
+    if (m_isHost || nowUs - m_lastReconnectUs < RECONNECT_RETRY_US) {
+        return;  // a host waits for the client to come back through update()
+    }
+    
+    const bool connected = m_transport->connect(m_peerIp, m_peerPort);
+    m_lastReconnectUs = m_transport->nowUs();  // connect() blocks, retry a full interval after it returned
+    if (connected) {
+        ++m_transportConnection;
+        m_transportConnected = true;
+        onConnectionStarted();
+        m_awaitingResume = true;
+        sendResume();
+    }
+}
+
+// Network thread (host): a new client, with a new token
+void NetworkManager::startSession() {
+    std::random_device device;
+    std::uint64_t token = (static_cast<std::uint64_t>(device()) << 32) ^ device() ^
+                          static_cast<std::uint64_t>(m_transport->nowUs());
+    m_sessionToken = token != 0 ? token : 1;
+    m_lostAtUs = 0;
+    m_awaitingResume = false;
+    m_matchesSent = 0;
+    m_matchesReceived = 0;
+    clearMatchLog();
+    
+    Protocol::StateEncoder::encodeSession(m_sessionToken, m_controlBuffer);
+    transmit(m_controlBuffer.data(), m_controlBuffer.size(), Delivery::RELIABLE);
+    pushEvent({NetworkEvent::Type::CONNECTED, m_transportConnection, {}, {}});
+}
+
+// Network thread: the dropped session cannot be resumed, tell the game thread the peer is gone
+void NetworkManager::endSession() {
+    m_sessionToken = 0;
+    m_lostAtUs = 0;
+    m_awaitingResume = false;
+    m_matchesSent = 0;
+    m_matchesReceived = 0;
+    clearMatchLog();
+    pushEvent({NetworkEvent::Type::DISCONNECTED, m_transportConnection, {}, {}});
+}
+
+void NetworkManager::sendResume() {
+    SessionResume resume;
+    resume.token = m_sessionToken;
+    resume.nextInputTick = m_nextRemoteInputTick;
+    resume.nextGarbage = m_nextRemoteGarbage;
+    resume.matchesStarted = m_matchesReceived;
+    Protocol::StateEncoder::encodeResume(resume, m_controlBuffer);
+    transmit(m_controlBuffer.data(), m_controlBuffer.size(), Delivery::RELIABLE);
+}
+
+// Network thread: the client asks to resume (host) or the host accepted (client).
+// Returns false if the session is over instead.
+bool NetworkManager::onResumeRequested(const SessionResume& resume) {
+    if (!m_awaitingResume) {
+        return true;  // duplicate, nothing to do
+    }
+    // A peer that missed the last match start gets it again, then every message of that match
+    const bool missedMatchStart = resume.matchesStarted < m_matchesSent;
+    const std::uint32_t fromTick = missedMatchStart ? 0 : resume.nextInputTick;
+    const std::uint32_t fromGarbage = missedMatchStart ? 0 : resume.nextGarbage;
+    if (resume.token != m_sessionToken || !hasMatchMessagesFrom(fromTick, fromGarbage)) {
+        std::cerr << "Error: Cannot resume the session, the peer has to join again" << std::endl;
+        endSession();
+        if (m_isHost) {
+            startSession();  // a client with another (or an expired) token is simply a new client
+        } else {
+            m_transport->disconnect();
+            m_transportConnected = false;
+        }
+        return false;
+    }
+    
+    // The host answers with what it still needs, then both send what the other missed
+    if (m_isHost) {
+        sendResume();
+    }
+    if (missedMatchStart) {
+        transmit(m_lastMatchStart.data(), m_lastMatchStart.size(), Delivery::RELIABLE);
+    }
+    resendMatchMessages(fromTick, fromGarbage);
+    std::cout << "Session resumed after " << (m_transport->nowUs() - m_lostAtUs) / 1000 << " ms" << std::endl;
+    m_awaitingResume = false;
+    m_lostAtUs = 0;
+    pushEvent({NetworkEvent::Type::RESUMED, m_transportConnection, {}, {}});
+    return true;
+}
+
+// Network thread: a new match (or session) starts with an empty log and nothing received
+void NetworkManager::clearMatchLog() {
+    m_matchLog.clear();
+    m_firstLoggedInputTick = 0;
+    m_firstLoggedGarbage = 0;
+    m_nextRemoteInputTick = 0;
+    m_nextRemoteGarbage = 0;
+}
+
+// Network thread: whether the log still holds every input from fromTick and every attack from fromGarbage on
+bool NetworkManager::hasMatchMessagesFrom(std::uint32_t fromTick, std::uint32_t fromGarbage) const {
+    return fromTick >= m_firstLoggedInputTick && fromGarbage >= m_firstLoggedGarbage;
+}
+
+// Network thread: in the order they were first sent
+void NetworkManager::resendMatchMessages(std::uint32_t fromTick, std::uint32_t fromGarbage) {
+    for (const LoggedMessage& message : m_matchLog) {
+        if (message.number >= (message.kind == LoggedKind::INPUT ? fromTick : fromGarbage)) {
+            transmit(message.data.data(), message.size, Delivery::RELIABLE);
+        }
+    }
+}
+
+void NetworkManager::sendPing() {
+    const std::int64_t nowUs = m_transport->nowUs();
+    if (nowUs - m_lastPingUs < PING_INTERVAL_US) {
+        return;
+    }
+    m_lastPingUs = nowUs;
+    
+    Protocol::StateEncoder::encodePing(nowUs, m_controlBuffer);
+    // A lost ping is replaced by the next one, a resent one would only skew the measurement
+    transmit(m_controlBuffer.data(), m_controlBuffer.size(), Delivery::UNRELIABLE);
+}
+
+void NetworkManager::logLinkStats() const {
+    if (!m_clockSync.hasEstimate()) {
+        return;
+    }
+    std::cout << "Link: rtt " << m_clockSync.rttUs() / 1000.0 << " ms, jitter " << m_clockSync.jitterUs() / 1000.0
+              << " ms, clock offset " << m_clockSync.offsetUs() / 1000.0 << " ms" << std::endl;
+}
+
+bool NetworkManager::transmit(const std::uint8_t* data, std::size_t size, Delivery delivery) {
+    ++m_traffic.messagesSent;
+    return m_transport->send(data, size, delivery);
+}
+
+TrafficCounters NetworkManager::trafficCounters() const {
+    TrafficCounters counters = m_traffic;
+    counters.bytesSent = m_transport->bytesSent();
+    counters.bytesReceived = m_transport->bytesReceived();
+    counters.partialSends = m_transport->partialSends();
+    counters.statesRead = m_statesRead.load(std::memory_order_relaxed);
+    counters.stateReads = m_stateReads.load(std::memory_order_relaxed);
+    counters.emptyStateReads = m_emptyStateReads.load(std::memory_order_relaxed);
+    counters.sendQueueDrops = m_sendQueueDrops.load(std::memory_order_relaxed);
+    return counters;
+}
+
+// Network thread: rates restart with every connection, the transport counts from zero again
+void NetworkManager::startTrafficWindow() {
+    const std::int64_t nowUs = m_transport->nowUs();
+    m_trafficMetrics.reset(trafficCounters(), nowUs);
+    m_lastTrafficLogUs = nowUs;
+    m_trafficRates.writeBuffer() = TrafficRates();
+    m_trafficRates.publish();
+}
+
+void NetworkManager::updateTraffic() {
+    if (!m_transportConnected) {
+        return;
+    }
+    const std::int64_t nowUs = m_transport->nowUs();
+    if (m_trafficMetrics.sample(trafficCounters(), nowUs)) {
+        m_trafficRates.writeBuffer() = m_trafficMetrics.rates();
+        m_trafficRates.publish();
+    }
+    if (m_trafficLogIntervalUs > 0 && nowUs - m_lastTrafficLogUs >= m_trafficLogIntervalUs) {
+        m_lastTrafficLogUs = nowUs;
+        logTraffic();
+    }
+}
+
+void NetworkManager::logTraffic() const {
+    const TrafficRates& rates = m_trafficMetrics.rates();
+    if (!rates.valid) {
+        return;
+    }
+    // Formatted on the side, std::cout's flags are shared with every other thread
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1) << "Traffic (" << rates.windowSeconds << " s): out "
+         << rates.bytesSentPerSecond / 1024.0f << " KB/s " << rates.messagesSentPerSecond << " msg/s, in "
+         << rates.bytesReceivedPerSecond / 1024.0f << " KB/s " << rates.messagesReceivedPerSecond
+         << " msg/s, partial sends " << rates.partialSendsPerSecond << "/s, send queue max "
+         << rates.maxSendQueueDepth << " (" << rates.sendQueueDrops << " dropped), stale states "
+         << rates.staleStatesPerSecond << "/s, empty reads " << rates.emptyReadShare * 100.0f << "%";
+    std::cout << line.str() << std::endl;
+}
+
+TrafficRates NetworkManager::getTrafficRates() {
+    m_trafficRates.fetch();
+    return m_trafficRates.readBuffer();
+}
+
+void NetworkManager::setTrafficLogInterval(float seconds) {
+    m_trafficLogIntervalUs = seconds > 0.0f ? static_cast<std::int64_t>(seconds * 1e6f) : 0;
+}
+
+NetworkManager::LinkStats NetworkManager::getLinkStats() const {
+    LinkStats stats;
+    stats.valid = m_hasClock.load(std::memory_order_acquire);
+    stats.rttMs = static_cast<float>(m_rttUs.load(std::memory_order_relaxed)) / 1000.0f;
+    stats.jitterMs = static_cast<float>(m_jitterUs.load(std::memory_order_relaxed)) / 1000.0f;
+    stats.clockOffsetMs = static_cast<float>(m_clockOffsetUs.load(std::memory_order_relaxed)) / 1000.0f;
+    return stats;
+}
+
+std::int64_t NetworkManager::peerToLocalTime(std::int64_t peerTimeUs) const {
+    return peerTimeUs - m_clockOffsetUs.load(std::memory_order_relaxed);
+}
+
+// Queue events for the game thread in order; ones that do not fit wait in m_overflowEvents.
+// Returns false while anything is waiting there.
+bool NetworkManager::flushEvents() {
+    while (!m_overflowEvents.empty() && m_events.push(m_overflowEvents.front())) {
+        m_overflowEvents.pop_front();
+    }
+    return m_overflowEvents.empty();
+}
+
+bool NetworkManager::pushEvent(const NetworkEvent& event) {
+    if (flushEvents() && m_events.push(event)) {
+        return true;
+    }
+    m_overflowEvents.push_back(event);
+    return false;
+}
+
+// Read and dispatch every message the transport has (deltas build on each other, none can be skipped)
+void NetworkManager::receiveMessages() {
+    // Inputs must not be lost, stop reading while the game thread is behind (a stalled game is not a dead link)
+    if (!flushEvents()) {
+        m_lastReceiveUs = m_transport->nowUs();
+        return;
+    }
+    
+    bool stateUpdated = false;
+    while (m_transport->isConnected() && m_transport->receive(m_receiveBuffer)) {
+        ++m_traffic.messagesReceived;
+        const std::int64_t arrivalUs = m_transport->nowUs();
+        m_lastReceiveUs = arrivalUs;
+        const Protocol::DecodeResult result = m_decoder.decode(m_receiveBuffer.data(), m_receiveBuffer.size());
+        // Someone connected while we waited for the dropped client, and it is not that client: a new session
+        if (m_isHost && m_awaitingResume && result != Protocol::DecodeResult::RESUME_REQUESTED) {
+            endSession();
+            startSession();
+        }
         
-        return data;
-    } catch (const std::exception& e) {
-        std::cerr << "Exception while receiving game state: " << e.what() << std::endl;
-        m_isConnected = false;
-        return std::nullopt;
+        bool queued = true;
+        switch (result) {
+            case Protocol::DecodeResult::STATE_UPDATED:
+                ++m_traffic.statesReceived;
+                stateUpdated = true;
+                break;
+            case Protocol::DecodeResult::RESYNC_REQUESTED:
+                queued = pushEvent({NetworkEvent::Type::RESYNC_REQUESTED, m_transportConnection, {}, {}});
+                break;
+            case Protocol::DecodeResult::NEED_RESYNC: {
+                Protocol::StateEncoder::encodeResyncRequest(m_controlBuffer);
+                transmit(m_controlBuffer.data(), m_controlBuffer.size(), Delivery::RELIABLE);
+                break;
+            }
+            case Protocol::DecodeResult::MATCH_STARTED:
+                clearMatchLog();
+                ++m_matchesReceived;
+                queued = pushEvent({NetworkEvent::Type::MATCH_STARTED, m_transportConnection, m_decoder.matchStart(), {}});
+                break;
+            case Protocol::DecodeResult::INPUT_RECEIVED:
+                m_nextRemoteInputTick = m_decoder.input().tick + 1;
+                queued = pushEvent({NetworkEvent::Type::INPUT_RECEIVED, m_transportConnection, {}, m_decoder.input()});
+                break;
+            case Protocol::DecodeResult::GARBAGE_RECEIVED:
+                // Attacks sent again on resume that had arrived before the link dropped
+                if (m_decoder.garbage().number < m_nextRemoteGarbage) {
+                    break;
+                }
+                m_nextRemoteGarbage = m_decoder.garbage().number + 1u;
+                queued = pushEvent({NetworkEvent::Type::GARBAGE_RECEIVED, m_transportConnection, {}, {}, m_decoder.garbage()});
+                break;
+            case Protocol::DecodeResult::PING_RECEIVED: {
+                ClockSample sample = m_decoder.clock();
+                sample.receiveUs = arrivalUs;
+                sample.transmitUs = m_transport->nowUs();
+                Protocol::StateEncoder::encodePong(sample, m_controlBuffer);
+                transmit(m_controlBuffer.data(), m_controlBuffer.size(), Delivery::UNRELIABLE);
+                break;
+            }
+            case Protocol::DecodeResult::PONG_RECEIVED: {
+                ClockSample sample = m_decoder.clock();
+                sample.arrivalUs = arrivalUs;
+                m_clockSync.addSample(sample);
+                m_rttUs.store(m_clockSync.rttUs(), std::memory_order_relaxed);
+                m_jitterUs.store(m_clockSync.jitterUs(), std::memory_order_relaxed);
+                m_clockOffsetUs.store(m_clockSync.offsetUs(), std::memory_order_relaxed);
+                m_hasClock.store(true, std::memory_order_release);
+                break;
+            }
+            case Protocol::DecodeResult::SESSION_STARTED:
+                if (!m_isHost && m_awaitingResume) {
+                    // The host started over (restarted, or the window ran out on its side)
+                    std::cerr << "Error: Host did not resume the session" << std::endl;
+                    endSession();
+                    m_transport->disconnect();
+                    m_transportConnected = false;
+                    return;
+                }
+                if (!m_isHost) {
+                    m_sessionToken = m_decoder.session().token;
+                }
+                break;
+            case Protocol::DecodeResult::RESUME_REQUESTED:
+                if (!onResumeRequested(m_decoder.session()) && !m_isHost) {
+                    return;
+                }
+                break;
+            case Protocol::DecodeResult::JOIN_REQUESTED:  // only meant for tetris-server
+            case Protocol::DecodeResult::IGNORED:
+                break;
+            case Protocol::DecodeResult::INVALID:
+                std::cerr << "Warning: Ignoring invalid network message" << std::endl;
+                break;
+        }
+        if (!queued) {
+            break;
+        }
+    }
+    
+    // Only the newest state is handed over, however many arrived since the last loop
+    if (stateUpdated) {
+        ReceivedState& slot = m_states.writeBuffer();
+        slot.connection = m_transportConnection;
+        slot.data = m_decoder.state();
+        m_states.publish();
     }
 }
 
@@ -1,41 +1,35 @@
 #pragma once
+#include "Protocol.h"
+#include "TrafficMetrics.h"
+#include "Transport.h"
+#include "../util/SpscQueue.h"
+#include "../util/TripleBuffer.h"
 #include <SFML/Network.hpp>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <optional>
 #include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
 
-// simple game state for network transmission (880 bytes fixed size)
-struct PacketData {
-    int32_t grid[21][10];
-    int32_t currentPieceType;
-    int32_t currentPieceX;
-    int32_t currentPieceY;
-    int32_t currentPieceRotation;
-    int32_t score;
-    int32_t level;
-    bool isGameOver;
-    bool isReady;
-    
-    PacketData() {
-        for (int y = 0; y < 21; y++) {
-            for (int x = 0; x < 10; x++) {
-                grid[y][x] = 0;
-            }
-        }
-        currentPieceType = 0;
-        currentPieceX = 0;
-        currentPieceY = 0;
-        currentPieceRotation = 0;
-        score = 0;
-        level = 1;
-        isGameOver = false;
-        isReady = false;
-    }
-};
-
-// NetworkManager handles LAN multiplayer for Tetris with non-blocking TCP sockets for real-time game state sync
+// NetworkManager handles LAN multiplayer for Tetris: real-time game state sync over a Transport
+// (non-blocking TCP by default, or UDP with selective reliability).
+// While hosting or connected, a network thread owns the transport: it sends what the game thread queued,
+// drains the socket continuously and hands results back through lock-free queues, so no call made from
+// the game thread ever touches a socket (except the blocking connect() itself).
+// The host gives every client a session token. When the link dies mid-session (no traffic for
+// LINK_TIMEOUT_US, or the transport reports it) the client keeps reconnecting for RECONNECT_WINDOW_US and
+// both sides resume where they left off: each resends the match messages the other missed (match start,
+// inputs, garbage) and the board stream restarts with a keyframe. Only when the window expires is the peer reported as disconnected.
+// Every time the manager reads or hands out is on the transport's clock (nowUs()).
 class NetworkManager {
 public:
-    NetworkManager();
+    // Without a network thread, the owner drives the transport by calling poll() (tetris-netsim steps matches on a
+    // simulated clock this way)
+    explicit NetworkManager(std::unique_ptr<Transport> transport = nullptr, bool networkThread = true);
     ~NetworkManager();
     
     // Host a game
@@ -47,34 +41,247 @@ public:
     // Disconnect and cleanup
     void disconnect();
     
-    // Check if we're connected
+    // Check if we're connected (as of the last update()/receiveOpponentState())
     bool isConnected() const;
     
+    // The peer dropped and we are waiting for it to come back; isConnected() stays true meanwhile
+    bool isReconnecting() const { return m_isReconnecting; }
+    
     // Check if we're the host
     bool isHost() const { return m_isHost; }
     
-    // Send our game state to opponent
+    // Send our game state to opponent: only what changed since the last message, nothing if unchanged.
+    // Meant to be called every simulation step, messages are paced to the current state send rate.
     bool sendGameState(const PacketData& data);
     
-    // Receive opponent's game state
+    // State messages per second allowed right now (lowered while the link pushes back)
+    float getStateSendRate() const { return 1e6f / static_cast<float>(m_stateIntervalUs); }
+    
+    // Newest opponent game state received since the last call, intermediate ones are skipped
     std::optional<PacketData> receiveOpponentState();
     
-    // Update networking
+    // Match start (host to client) and lockstep inputs
+    bool sendMatchStart(const MatchStart& start);
+    bool sendInput(const InputFrame& frame);
+    std::optional<MatchStart> takeMatchStart();
+    bool popRemoteInput(InputFrame& frame);
+    
+    // Garbage of a mirrored versus match; popped attacks carry their send time on our clock (their receive time
+    // until the clock offset is known)
+    bool sendGarbage(int lines);
+    bool popGarbage(GarbageAttack& attack);
+    
+    // Round trip, jitter and clock offset measured with ping/pong every PING_INTERVAL_US
+    struct LinkStats {
+        bool valid = false;        // false until the first pong of this connection
+        float rttMs = 0.0f;
+        float jitterMs = 0.0f;
+        float clockOffsetMs = 0.0f;  // peer clock minus ours
+    };
+    LinkStats getLinkStats() const;
+    
+    // A time read on the peer's clock (e.g. carried in a message) on our timeline (nowUs())
+    std::int64_t peerToLocalTime(std::int64_t peerTimeUs) const;
+    
+    // Traffic counters including transport framing and headers
+    std::uint64_t getBytesSent() const { return m_bytesSent.load(std::memory_order_relaxed); }
+    std::uint64_t getBytesReceived() const { return m_bytesReceived.load(std::memory_order_relaxed); }
+    
+    // Bytes and messages per second, stale states, empty reads and send queue depth of the current connection
+    // over the last few seconds (refreshed every TrafficMetrics::SAMPLE_INTERVAL_US by the network thread)
+    TrafficRates getTrafficRates();
+    
+    // Seconds between "Traffic:" log lines while connected, 0 turns them off; call before host()/connect()
+    void setTrafficLogInterval(float seconds);
+    
+    // Apply what the network thread received (connection changes, match start, inputs, resync requests)
     void update();
     
+    // One pass of the network thread's loop on the calling thread, only for a manager created without one
+    void poll();
+    
+    // Microseconds on the transport's clock, the timeline of popped garbage and peerToLocalTime()
+    std::int64_t nowUs() const { return m_transport->nowUs(); }
+    
     // Get local IP for LAN play
     static std::string getLocalIP();
     
 private:
+    static constexpr std::size_t QUEUE_SIZE = 256;
+    static constexpr std::int64_t PING_INTERVAL_US = 250000;
+    // Pings flow both ways, this long without any message means the link is dead even if the socket is not
+    static constexpr std::int64_t LINK_TIMEOUT_US = 2000000;
+    static constexpr std::int64_t RECONNECT_WINDOW_US = 10000000;
+    static constexpr std::int64_t RECONNECT_RETRY_US = 200000;
+    // Sent inputs and garbage kept for resending after a reconnect, 17 s of 60 Hz ticks
+    static constexpr std::size_t MATCH_LOG_SIZE = 1024;
+    static constexpr std::size_t MAX_LOGGED_MESSAGE_SIZE = 32;
+    static constexpr std::int64_t DEFAULT_TRAFFIC_LOG_INTERVAL_US = 10000000;
+    // State send pacing: at most 60 Hz, down to 4 Hz while the send queue backs up or the socket takes
+    // partial sends (or still holds unsent bytes); halved at most every STATE_BACKOFF_US, doubled back every STATE_RECOVER_US without trouble
+    static constexpr std::int64_t MIN_STATE_INTERVAL_US = 1000000 / 60;
+    static constexpr std::int64_t MAX_STATE_INTERVAL_US = 250000;
+    static constexpr std::int64_t STATE_BACKOFF_US = 100000;
+    static constexpr std::int64_t STATE_RECOVER_US = 1000000;
+    static constexpr std::size_t BACKPRESSURE_QUEUE_DEPTH = 16;
+    // Over unreliable delivery the pose is repeated this often while nothing changes, in case the last one was lost
+    static constexpr std::int64_t POSE_HEARTBEAT_US = 1000000;
+    
+    // Match messages the peer must get even if the link drops before they arrive
+    enum class LoggedKind : std::uint8_t {
+        NONE,
+        INPUT,
+        GARBAGE
+    };
+    
+    // Message encoded by the game thread, sent by the network thread
+    struct OutgoingMessage {
+        Delivery delivery = Delivery::RELIABLE;
+        std::uint16_t size = 0;
+        std::array<std::uint8_t, Protocol::MAX_MESSAGE_SIZE> data{};
+        LoggedKind logged = LoggedKind::NONE;
+        std::uint32_t number = 0;  // input tick or garbage number of a logged message
+        bool startsMatch = false;  // logged messages and received ticks so far belong to the previous match
+    };
+    
+    // A match message that must arrive, as sent, for resending after a reconnect
+    struct LoggedMessage {
+        LoggedKind kind = LoggedKind::INPUT;
+        std::uint32_t number = 0;
+        std::uint8_t size = 0;
+        std::array<std::uint8_t, MAX_LOGGED_MESSAGE_SIZE> data{};
+    };
+    
+    // Something the network thread tells the game thread, in arrival order
+    struct NetworkEvent {
+        enum class Type : std::uint8_t {
+            CONNECTED,
+            DISCONNECTED,
+            RECONNECTING,
+            RESUMED,
+            RESYNC_REQUESTED,
+            MATCH_STARTED,
+            INPUT_RECEIVED,
+            GARBAGE_RECEIVED
+        };
+        Type type = Type::CONNECTED;
+        std::uint32_t connection = 0;
+        MatchStart matchStart;
+        InputFrame input;
+        GarbageAttack garbage;
+    };
+    
+    // Newest decoded opponent state, tagged with the connection it came from
+    struct ReceivedState {
+        std::uint32_t connection = 0;
+        PacketData data;
+    };
+    
     bool m_isHost;
+    std::unique_ptr<Transport> m_transport;
+    
+    // Game thread side, restarted with a keyframe on every new connection
+    Protocol::StateEncoder m_encoder;
+    std::vector<std::uint8_t> m_sendBuffer;
+    std::int64_t m_stateIntervalUs;
+    std::int64_t m_lastStateSendUs;
+    std::int64_t m_lastPoseSendUs;
+    std::int64_t m_lastRateChangeUs;
+    std::uint64_t m_seenPartialSends;
+    std::uint64_t m_seenQueueDrops;
     bool m_isConnected;
+    bool m_isReconnecting;
+    std::uint32_t m_connection;
+    std::optional<MatchStart> m_matchStart;
+    std::deque<InputFrame> m_remoteInputs;
+    std::deque<GarbageAttack> m_remoteGarbage;
+    std::uint16_t m_nextGarbageNumber;
+    
+    // Network thread side
+    bool m_networkThread;  // false when the owner calls poll() instead
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    Protocol::StateDecoder m_decoder;
+    std::vector<std::uint8_t> m_receiveBuffer;
+    std::vector<std::uint8_t> m_controlBuffer;  // pings, pongs, resync and session messages
+    bool m_transportConnected;
+    std::uint32_t m_transportConnection;
+    std::deque<NetworkEvent> m_overflowEvents;  // did not fit in m_events yet, receiving pauses meanwhile
+    ClockSync m_clockSync;
+    std::int64_t m_lastPingUs;
+    std::int64_t m_lastReceiveUs;
+    
+    // Session resume, network thread side
+    std::string m_peerIp;  // where a client reconnects to
+    unsigned short m_peerPort;
+    std::uint64_t m_sessionToken;    // 0 until the host assigned one
+    std::int64_t m_lostAtUs;         // when the link died, 0 while not reconnecting
+    std::int64_t m_lastReconnectUs;
+    bool m_awaitingResume;           // new transport connection, RESUME handshake not done yet
+    std::uint32_t m_nextRemoteInputTick;
+    std::uint32_t m_nextRemoteGarbage;
+    std::deque<LoggedMessage> m_matchLog;
+    std::uint32_t m_firstLoggedInputTick;  // older inputs and garbage were trimmed from the log
+    std::uint32_t m_firstLoggedGarbage;
+    std::uint32_t m_matchesSent;           // MATCH_START messages sent and received in this session
+    std::uint32_t m_matchesReceived;
+    std::vector<std::uint8_t> m_lastMatchStart;
+    
+    // Traffic counting, network thread side
+    TrafficCounters m_traffic;  // message and state counts, the rest is filled in when sampling
+    TrafficMetrics m_trafficMetrics;
+    std::int64_t m_trafficLogIntervalUs;
+    std::int64_t m_lastTrafficLogUs;
     
-    // For host
-    sf::TcpListener m_listener;
-    sf::TcpSocket m_clientSocket;
+    // Handover between the two
+    SpscQueue<OutgoingMessage, QUEUE_SIZE> m_outgoing;
+    SpscQueue<NetworkEvent, QUEUE_SIZE> m_events;
+    TripleBuffer<ReceivedState> m_states;
+    std::atomic<std::uint64_t> m_bytesSent;
+    std::atomic<std::uint64_t> m_bytesReceived;
+    std::atomic<std::uint64_t> m_partialSends;
+    std::atomic<std::size_t> m_unsentBytes;
+    std::atomic<bool> m_hasClock;
+    std::atomic<std::int64_t> m_rttUs;
+    std::atomic<std::int64_t> m_jitterUs;
+    std::atomic<std::int64_t> m_clockOffsetUs;
+    TripleBuffer<TrafficRates> m_trafficRates;
+    // Counted by the game thread
+    std::atomic<std::uint64_t> m_statesRead;
+    std::atomic<std::uint64_t> m_stateReads;
+    std::atomic<std::uint64_t> m_emptyStateReads;
+    std::atomic<std::uint64_t> m_sendQueueDrops;
     
-    // For client
-    sf::TcpSocket m_serverSocket;
+    void resetProtocol();
+    // Slow state messages down under backpressure, speed back up once it is gone
+    void adaptStateRate(std::int64_t nowUs);
+    bool sendMessage(const std::vector<std::uint8_t>& message, Delivery delivery = Delivery::RELIABLE);
+    bool queueMessage(OutgoingMessage& outgoing, const std::vector<std::uint8_t>& message);
+    void processEvents();
     
-    sf::TcpSocket* getActiveSocket();
+    void startThread();
+    void stopThread();
+    void networkLoop();
+    void pollTransport();
+    void sendQueued();
+    bool transmit(const std::uint8_t* data, std::size_t size, Delivery delivery);
+    void sendPing();
+    void onConnectionStarted();
+    void onLinkLost();
+    void updateReconnect();
+    void startSession();
+    void endSession();
+    void sendResume();
+    bool onResumeRequested(const SessionResume& resume);
+    void clearMatchLog();
+    bool hasMatchMessagesFrom(std::uint32_t fromTick, std::uint32_t fromGarbage) const;
+    void resendMatchMessages(std::uint32_t fromTick, std::uint32_t fromGarbage);
+    void logLinkStats() const;
+    TrafficCounters trafficCounters() const;
+    void startTrafficWindow();
+    void updateTraffic();
+    void logTraffic() const;
+    void receiveMessages();
+    bool flushEvents();
+    bool pushEvent(const NetworkEvent& event);
 };
@@ -0,0 +1,122 @@
+#include "NetworkMatch.h"
+#include "../model/LevelBasedMode.h"
+#include "../model/MultiplayerMode.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+NetworkMatch::NetworkMatch()
+    : m_syncMode(SyncMode::MIRROR),
+      m_versus(false),
+      m_accumulator(0.0f),
+      m_endTick(std::numeric_limits<std::uint32_t>::max()) {}
+
+void NetworkMatch::start(const MatchStart& start, GameState& local, GameState& remote) {
+    m_syncMode = start.syncMode;
+    m_versus = start.versus;
+
+    local.setGameMode(std::make_unique<LevelBasedMode>());
+    remote.setGameMode(std::make_unique<LevelBasedMode>());
+    local.resetWithSeed(start.seed);
+    remote.resetWithSeed(start.seed);
+
+    m_lockstep.start();
+    m_rollback.start(local, remote, m_versus);
+    m_accumulator = 0.0f;
+    m_stats = Stats();
+}
+
+bool NetworkMatch::update(float deltaTime, GameState& local, GameState& remote, NetworkManager& network,
+                          const InputSampler& sampleInput) {
+    if (m_syncMode == SyncMode::MIRROR) {
+        return false;
+    }
+
+    InputFrame remoteFrame;
+    while (network.popRemoteInput(remoteFrame)) {
+        const bool stored = m_syncMode == SyncMode::LOCKSTEP ? m_lockstep.addRemoteInput(remoteFrame)
+                                                             : m_rollback.addRemoteInput(remoteFrame);
+        if (!stored) {
+            ++m_stats.droppedInputs;
+            std::cerr << "Warning: Dropping " << (m_syncMode == SyncMode::LOCKSTEP ? "lockstep" : "rollback")
+                      << " input for tick " << remoteFrame.tick << std::endl;
+        }
+    }
+
+    m_accumulator = std::min(m_accumulator + deltaTime, MAX_CATCH_UP);
+    const bool localInputApplied = m_syncMode == SyncMode::LOCKSTEP
+                                       ? updateLockstep(local, remote, network, sampleInput)
+                                       : updateRollback(local, remote, network, sampleInput);
+    // A tick was still due: the opponent held it up
+    if (m_accumulator >= LockstepSession::TICK_DURATION && currentTick() < m_endTick) {
+        m_stats.stalledSeconds += deltaTime;
+    }
+    return localInputApplied;
+}
+
+std::uint32_t NetworkMatch::currentTick() const {
+    return m_syncMode == SyncMode::ROLLBACK ? m_rollback.currentTick() : m_lockstep.currentTick();
+}
+
+// Lockstep: both boards advance one tick at a time, and only once both players' inputs for that tick are known
+bool NetworkMatch::updateLockstep(GameState& local, GameState& remote, NetworkManager& network,
+                                  const InputSampler& sampleInput) {
+    bool localInputApplied = false;
+    while (m_accumulator >= LockstepSession::TICK_DURATION && m_lockstep.currentTick() < m_endTick) {
+        // Sample local input for a tick INPUT_DELAY_TICKS ahead and send it right away
+        if (m_lockstep.needsLocalInput()) {
+            const InputFrame sampled = sampleInput();
+            network.sendInput(m_lockstep.scheduleLocalInput(sampled.actions.data(), sampled.count));
+        }
+
+        // Opponent's inputs not here yet: hold both boards rather than let them diverge
+        if (!m_lockstep.canAdvance()) {
+            break;
+        }
+
+        const InputFrame& localFrame = m_lockstep.localInput();
+        const InputFrame& opponentFrame = m_lockstep.remoteInput();
+        for (std::uint8_t i = 0; i < localFrame.count; ++i) {
+            local.applyInput(localFrame.actions[i]);
+        }
+        for (std::uint8_t i = 0; i < opponentFrame.count; ++i) {
+            remote.applyInput(opponentFrame.actions[i]);
+        }
+        local.update(LockstepSession::TICK_DURATION);
+        remote.update(LockstepSession::TICK_DURATION);
+        if (m_versus) {
+            MultiplayerGameMode::exchangeGarbage(local, remote);
+        }
+
+        localInputApplied = localInputApplied || localFrame.count > 0;
+        m_lockstep.advance();
+        m_accumulator -= LockstepSession::TICK_DURATION;
+    }
+    return localInputApplied;
+}
+
+// Rollback: the local board never waits, the opponent's board is predicted and corrected when inputs arrive
+bool NetworkMatch::updateRollback(GameState& local, GameState& remote, NetworkManager& network,
+                                  const InputSampler& sampleInput) {
+    const std::uint32_t resimulated = m_rollback.reconcile(local, remote);
+    m_stats.resimulatedTicks += resimulated;
+    m_stats.longestRollback = std::max(m_stats.longestRollback, resimulated);
+
+    bool localInputApplied = false;
+    while (m_accumulator >= RollbackSession::TICK_DURATION && m_rollback.currentTick() < m_endTick) {
+        // Opponent too far behind to keep predicting: wait for them
+        if (!m_rollback.canAdvance()) {
+            break;
+        }
+
+        InputFrame localFrame = sampleInput();
+        localFrame.tick = m_rollback.currentTick();
+        network.sendInput(localFrame);
+        m_rollback.advance(local, remote, localFrame);
+
+        localInputApplied = localInputApplied || localFrame.count > 0;
+        m_accumulator -= RollbackSession::TICK_DURATION;
+    }
+    return localInputApplied;
+}
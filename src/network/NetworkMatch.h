@@ -0,0 +1,62 @@
+#pragma once
+#include "LockstepSession.h"
+#include "NetworkManager.h"
+#include "Protocol.h"
+#include "RollbackSession.h"
+#include "../model/GameState.h"
+#include <cstdint>
+#include <functional>
+
+// The boards and tick loop of a network match, shared by GameController and tetris-netsim.
+// start() sets up both boards from the host's seed. In lockstep and rollback, update() then runs both of them on
+// fixed ticks from both players' inputs, which go through the NetworkManager; a mirror match is driven by the
+// caller instead (each peer streams its own board), update() does nothing there.
+class NetworkMatch {
+public:
+    // Most time caught up on in one update after a hitch, the rest is dropped rather than simulated in a burst
+    static constexpr float MAX_CATCH_UP = 0.25f;
+
+    // Local player's inputs for the next tick
+    using InputSampler = std::function<InputFrame()>;
+
+    // What the sync cost so far, for tetris-netsim
+    struct Stats {
+        std::uint64_t resimulatedTicks = 0;
+        std::uint32_t longestRollback = 0;
+        float stalledSeconds = 0.0f;  // time of updates that had ticks due but waited for the opponent
+        std::uint64_t droppedInputs = 0;  // opponent inputs outside the session's window
+    };
+
+    NetworkMatch();
+
+    // Both boards get the same seed: identical piece sequences, and in lockstep and rollback identical boards
+    void start(const MatchStart& start, GameState& local, GameState& remote);
+
+    // Take the opponent's inputs, then run the ticks that are due and can be run. True if one of them applied
+    // local inputs.
+    bool update(float deltaTime, GameState& local, GameState& remote, NetworkManager& network,
+                const InputSampler& sampleInput);
+
+    // Ticks are not run past this one (tetris-netsim plays matches of a fixed length), no limit by default
+    void setEndTick(std::uint32_t tick) { m_endTick = tick; }
+
+    SyncMode syncMode() const { return m_syncMode; }
+    bool isVersus() const { return m_versus; }
+    std::uint32_t currentTick() const;
+    // Every tick run so far used the opponent's real inputs, so the outcome cannot change anymore
+    bool isConfirmed() const { return m_syncMode != SyncMode::ROLLBACK || m_rollback.isConfirmed(); }
+
+    const Stats& stats() const { return m_stats; }
+
+private:
+    SyncMode m_syncMode;
+    bool m_versus;  // the host chose versus: line clears send garbage to the opponent
+    LockstepSession m_lockstep;
+    RollbackSession m_rollback;
+    float m_accumulator;
+    std::uint32_t m_endTick;
+    Stats m_stats;
+
+    bool updateLockstep(GameState& local, GameState& remote, NetworkManager& network, const InputSampler& sampleInput);
+    bool updateRollback(GameState& local, GameState& remote, NetworkManager& network, const InputSampler& sampleInput);
+};
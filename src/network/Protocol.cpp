@@ -0,0 +1,579 @@
+#include "Protocol.h"
+#include <cstring>
+
+namespace Protocol {
+
+namespace {
+
+constexpr std::uint8_t CLEARING_NIBBLE = 0x0F;  // cell value -1 (line being cleared)
+
+// Field mask of a delta message
+constexpr std::uint8_t FIELD_POSE = 1 << 0;
+constexpr std::uint8_t FIELD_SCORE = 1 << 1;
+constexpr std::uint8_t FIELD_LEVEL = 1 << 2;
+constexpr std::uint8_t FIELD_FLAGS = 1 << 3;
+
+constexpr std::uint8_t FLAG_GAME_OVER = 1 << 0;
+constexpr std::uint8_t FLAG_READY = 1 << 1;
+
+std::uint8_t cellToNibble(std::int32_t cell) {
+    return cell < 0 ? CLEARING_NIBBLE : static_cast<std::uint8_t>(cell & 0x0F);
+}
+
+std::int32_t nibbleToCell(std::uint8_t nibble) {
+    return nibble == CLEARING_NIBBLE ? -1 : static_cast<std::int32_t>(nibble);
+}
+
+void writeHeader(std::vector<std::uint8_t>& out, MessageType type, std::uint16_t sequence) {
+    // Messages are built in reused vectors: room for the largest one is reserved once, then never again
+    out.reserve(MAX_MESSAGE_SIZE);
+    out.push_back(VERSION);
+    out.push_back(static_cast<std::uint8_t>(type));
+    out.push_back(static_cast<std::uint8_t>(sequence & 0xFF));
+    out.push_back(static_cast<std::uint8_t>(sequence >> 8));
+}
+
+void writeRow(std::vector<std::uint8_t>& out, const std::int32_t (&row)[COLUMNS]) {
+    for (int x = 0; x < COLUMNS; x += 2) {
+        out.push_back(static_cast<std::uint8_t>(cellToNibble(row[x]) | (cellToNibble(row[x + 1]) << 4)));
+    }
+}
+
+// Unsigned LEB128, scores stay at 1-3 bytes
+void writeVarint(std::vector<std::uint8_t>& out, std::uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void writePose(std::vector<std::uint8_t>& out, const PacketData& state) {
+    out.push_back(static_cast<std::uint8_t>(static_cast<std::int8_t>(state.currentPieceType)));
+    out.push_back(static_cast<std::uint8_t>(static_cast<std::int8_t>(state.currentPieceX)));
+    out.push_back(static_cast<std::uint8_t>(static_cast<std::int8_t>(state.currentPieceY)));
+    out.push_back(static_cast<std::uint8_t>(static_cast<std::int8_t>(state.currentPieceRotation)));
+}
+
+void writeUint64(std::vector<std::uint8_t>& out, std::uint64_t bits) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<std::uint8_t>((bits >> shift) & 0xFF));
+    }
+}
+
+void writeTimestamp(std::vector<std::uint8_t>& out, std::int64_t timeUs) {
+    writeUint64(out, static_cast<std::uint64_t>(timeUs));
+}
+
+std::uint8_t packFlags(const PacketData& state) {
+    return static_cast<std::uint8_t>((state.isGameOver ? FLAG_GAME_OVER : 0) | (state.isReady ? FLAG_READY : 0));
+}
+
+bool samePose(const PacketData& a, const PacketData& b) {
+    return a.currentPieceType == b.currentPieceType && a.currentPieceX == b.currentPieceX &&
+           a.currentPieceY == b.currentPieceY && a.currentPieceRotation == b.currentPieceRotation;
+}
+
+void copyPose(PacketData& to, const PacketData& from) {
+    to.currentPieceType = from.currentPieceType;
+    to.currentPieceX = from.currentPieceX;
+    to.currentPieceY = from.currentPieceY;
+    to.currentPieceRotation = from.currentPieceRotation;
+}
+
+bool sameRow(const std::int32_t (&a)[COLUMNS], const std::int32_t (&b)[COLUMNS]) {
+    return std::memcmp(a, b, sizeof(a)) == 0;
+}
+
+// Bounds checked cursor over a received message
+class ByteReader {
+public:
+    ByteReader(const std::uint8_t* data, std::size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+    bool readByte(std::uint8_t& value) {
+        if (m_pos >= m_size) {
+            return false;
+        }
+        value = m_data[m_pos++];
+        return true;
+    }
+
+    bool readVarint(std::uint32_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            std::uint8_t byte;
+            if (!readByte(byte)) {
+                return false;
+            }
+            value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readRow(std::int32_t (&row)[COLUMNS]) {
+        for (int x = 0; x < COLUMNS; x += 2) {
+            std::uint8_t packed;
+            if (!readByte(packed)) {
+                return false;
+            }
+            row[x] = nibbleToCell(packed & 0x0F);
+            row[x + 1] = nibbleToCell(packed >> 4);
+        }
+        return true;
+    }
+
+    bool readPose(PacketData& state) {
+        std::uint8_t bytes[4];
+        for (std::uint8_t& byte : bytes) {
+            if (!readByte(byte)) {
+                return false;
+            }
+        }
+        state.currentPieceType = static_cast<std::int8_t>(bytes[0]);
+        state.currentPieceX = static_cast<std::int8_t>(bytes[1]);
+        state.currentPieceY = static_cast<std::int8_t>(bytes[2]);
+        state.currentPieceRotation = static_cast<std::int8_t>(bytes[3]);
+        return true;
+    }
+
+    bool readFlags(PacketData& state) {
+        std::uint8_t flags;
+        if (!readByte(flags)) {
+            return false;
+        }
+        state.isGameOver = (flags & FLAG_GAME_OVER) != 0;
+        state.isReady = (flags & FLAG_READY) != 0;
+        return true;
+    }
+
+    bool readUint64(std::uint64_t& bits) {
+        bits = 0;
+        for (int shift = 0; shift < 64; shift += 8) {
+            std::uint8_t byte;
+            if (!readByte(byte)) {
+                return false;
+            }
+            bits |= static_cast<std::uint64_t>(byte) << shift;
+        }
+        return true;
+    }
+
+    bool readTimestamp(std::int64_t& timeUs) {
+        std::uint64_t bits;
+        if (!readUint64(bits)) {
+            return false;
+        }
+        timeUs = static_cast<std::int64_t>(bits);
+        return true;
+    }
+
+    bool atEnd() const { return m_pos == m_size; }
+
+private:
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+    std::size_t m_pos;
+};
+
+} // namespace
+
+StateEncoder::StateEncoder()
+    : m_needKeyframe(true),
+      m_hasSent(false),
+      m_sequence(0),
+      m_separatePose(false),
+      m_hasSentPose(false),
+      m_poseSequence(0) {}
+
+void StateEncoder::writeKeyframe(const PacketData& state, std::uint16_t sequence, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::KEYFRAME, sequence);
+    for (int y = 0; y < ROWS; ++y) {
+        writeRow(out, state.grid[y]);
+    }
+    writePose(out, state);
+    writeVarint(out, static_cast<std::uint32_t>(state.score));
+    writeVarint(out, static_cast<std::uint32_t>(state.level));
+    out.push_back(packFlags(state));
+}
+
+bool StateEncoder::encode(const PacketData& state, std::vector<std::uint8_t>& out) {
+    out.clear();
+
+    if (m_needKeyframe) {
+        writeKeyframe(state, m_sequence++, out);
+        m_lastSent = state;
+        m_needKeyframe = false;
+        m_hasSent = true;
+        return true;
+    }
+
+    // Most states only move the piece, one compare of the whole grid skips the row scan
+    std::uint32_t rowMask = 0;
+    if (std::memcmp(state.grid, m_lastSent.grid, sizeof(state.grid)) != 0) {
+        for (int y = 0; y < ROWS; ++y) {
+            if (!sameRow(state.grid[y], m_lastSent.grid[y])) {
+                rowMask |= 1u << y;
+            }
+        }
+    }
+
+    std::uint8_t fieldMask = 0;
+    if (!m_separatePose && !samePose(state, m_lastSent)) fieldMask |= FIELD_POSE;
+    if (state.score != m_lastSent.score) fieldMask |= FIELD_SCORE;
+    if (state.level != m_lastSent.level) fieldMask |= FIELD_LEVEL;
+    if (packFlags(state) != packFlags(m_lastSent)) fieldMask |= FIELD_FLAGS;
+
+    // Nothing to tell the peer
+    if (rowMask == 0 && fieldMask == 0) {
+        return false;
+    }
+
+    writeHeader(out, MessageType::DELTA, m_sequence++);
+    out.push_back(static_cast<std::uint8_t>(rowMask & 0xFF));
+    out.push_back(static_cast<std::uint8_t>((rowMask >> 8) & 0xFF));
+    out.push_back(static_cast<std::uint8_t>((rowMask >> 16) & 0xFF));
+    for (int y = 0; y < ROWS; ++y) {
+        if (rowMask & (1u << y)) {
+            writeRow(out, state.grid[y]);
+        }
+    }
+
+    out.push_back(fieldMask);
+    if (fieldMask & FIELD_POSE) writePose(out, state);
+    if (fieldMask & FIELD_SCORE) writeVarint(out, static_cast<std::uint32_t>(state.score));
+    if (fieldMask & FIELD_LEVEL) writeVarint(out, static_cast<std::uint32_t>(state.level));
+    if (fieldMask & FIELD_FLAGS) out.push_back(packFlags(state));
+
+    m_lastSent = state;
+    return true;
+}
+
+bool StateEncoder::encodeLatestKeyframe(std::vector<std::uint8_t>& out) const {
+    if (!m_hasSent) {
+        out.clear();
+        return false;
+    }
+    // Same sequence as the last message: a decoder starting here accepts the next delta
+    writeKeyframe(m_lastSent, static_cast<std::uint16_t>(m_sequence - 1), out);
+    return true;
+}
+
+bool StateEncoder::encodePose(const PacketData& state, std::vector<std::uint8_t>& out) {
+    out.clear();
+    if (m_hasSentPose && samePose(state, m_lastPose)) {
+        return false;
+    }
+
+    writeHeader(out, MessageType::POSE, m_poseSequence++);
+    writePose(out, state);
+    m_lastPose = state;
+    m_hasSentPose = true;
+    return true;
+}
+
+void StateEncoder::encodeResyncRequest(std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::RESYNC_REQUEST, 0);
+}
+
+void StateEncoder::encodeMatchStart(const MatchStart& start, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::MATCH_START, 0);
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<std::uint8_t>((start.seed >> shift) & 0xFF));
+    }
+    out.push_back(static_cast<std::uint8_t>(start.syncMode));
+    out.push_back(start.versus ? 1 : 0);
+}
+
+void StateEncoder::encodeInput(const InputFrame& frame, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::INPUT, 0);
+    writeVarint(out, frame.tick);
+    out.push_back(frame.count);
+    for (std::uint8_t i = 0; i < frame.count; ++i) {
+        out.push_back(static_cast<std::uint8_t>(frame.actions[i]));
+    }
+}
+
+void StateEncoder::encodePing(std::int64_t originUs, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::PING, 0);
+    writeTimestamp(out, originUs);
+}
+
+void StateEncoder::encodePong(const ClockSample& sample, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::PONG, 0);
+    writeTimestamp(out, sample.originUs);
+    writeTimestamp(out, sample.receiveUs);
+    writeTimestamp(out, sample.transmitUs);
+}
+
+void StateEncoder::encodeJoin(JoinRole role, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::JOIN, 0);
+    out.push_back(static_cast<std::uint8_t>(role));
+}
+
+void StateEncoder::encodeSession(std::uint64_t token, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::SESSION, 0);
+    writeUint64(out, token);
+}
+
+void StateEncoder::encodeResume(const SessionResume& resume, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::RESUME, 0);
+    writeUint64(out, resume.token);
+    writeVarint(out, resume.nextInputTick);
+    writeVarint(out, resume.nextGarbage);
+    writeVarint(out, resume.matchesStarted);
+}
+
+void StateEncoder::encodeGarbage(const GarbageAttack& attack, std::vector<std::uint8_t>& out) {
+    out.clear();
+    writeHeader(out, MessageType::GARBAGE, attack.number);
+    writeVarint(out, static_cast<std::uint32_t>(attack.lines));
+    writeTimestamp(out, attack.sentUs);
+}
+
+StateDecoder::StateDecoder()
+    : m_joinRole(JoinRole::PLAYER),
+      m_hasKeyframe(false), m_awaitingKeyframe(false), m_expectedSequence(0), m_hasPose(false), m_lastPoseSequence(0) {}
+
+void StateDecoder::reset() {
+    m_state = PacketData();
+    m_hasKeyframe = false;
+    m_awaitingKeyframe = false;
+    m_expectedSequence = 0;
+    m_hasPose = false;
+    m_lastPoseSequence = 0;
+}
+
+DecodeResult StateDecoder::decode(const std::uint8_t* data, std::size_t size) {
+    if (size < HEADER_SIZE || data[0] != VERSION) {
+        return DecodeResult::INVALID;
+    }
+
+    const auto type = static_cast<MessageType>(data[1]);
+    const std::uint16_t sequence = static_cast<std::uint16_t>(data[2] | (data[3] << 8));
+    ByteReader reader(data + HEADER_SIZE, size - HEADER_SIZE);
+
+    if (type == MessageType::RESYNC_REQUEST) {
+        return DecodeResult::RESYNC_REQUESTED;
+    }
+
+    if (type == MessageType::JOIN) {
+        std::uint8_t role;
+        if (!reader.readByte(role) || role > static_cast<std::uint8_t>(JoinRole::SPECTATOR) || !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        m_joinRole = static_cast<JoinRole>(role);
+        return DecodeResult::JOIN_REQUESTED;
+    }
+
+    if (type == MessageType::SESSION) {
+        SessionResume session;
+        if (!reader.readUint64(session.token) || session.token == 0 || !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        m_session = session;
+        return DecodeResult::SESSION_STARTED;
+    }
+
+    if (type == MessageType::RESUME) {
+        SessionResume resume;
+        if (!reader.readUint64(resume.token) || !reader.readVarint(resume.nextInputTick) ||
+            !reader.readVarint(resume.nextGarbage) || !reader.readVarint(resume.matchesStarted) || !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        m_session = resume;
+        return DecodeResult::RESUME_REQUESTED;
+    }
+
+    if (type == MessageType::MATCH_START) {
+        MatchStart start;
+        for (int shift = 0; shift < 32; shift += 8) {
+            std::uint8_t byte;
+            if (!reader.readByte(byte)) {
+                return DecodeResult::INVALID;
+            }
+            start.seed |= static_cast<std::uint32_t>(byte) << shift;
+        }
+        std::uint8_t mode;
+        std::uint8_t versus;
+        if (!reader.readByte(mode) || mode > static_cast<std::uint8_t>(SyncMode::ROLLBACK) ||
+            !reader.readByte(versus) || versus > 1 || !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        start.syncMode = static_cast<SyncMode>(mode);
+        start.versus = versus != 0;
+        m_matchStart = start;
+        return DecodeResult::MATCH_STARTED;
+    }
+
+    if (type == MessageType::INPUT) {
+        InputFrame frame;
+        std::uint8_t count;
+        if (!reader.readVarint(frame.tick) || !reader.readByte(count) || count > InputFrame::MAX_ACTIONS) {
+            return DecodeResult::INVALID;
+        }
+        for (std::uint8_t i = 0; i < count; ++i) {
+            std::uint8_t action;
+            if (!reader.readByte(action) || action >= INPUT_ACTION_COUNT) {
+                return DecodeResult::INVALID;
+            }
+            frame.actions[i] = static_cast<InputAction>(action);
+        }
+        if (!reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        frame.count = count;
+        m_input = frame;
+        return DecodeResult::INPUT_RECEIVED;
+    }
+
+    if (type == MessageType::PING) {
+        ClockSample sample;
+        if (!reader.readTimestamp(sample.originUs) || !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        m_clock = sample;
+        return DecodeResult::PING_RECEIVED;
+    }
+
+    if (type == MessageType::PONG) {
+        ClockSample sample;
+        if (!reader.readTimestamp(sample.originUs) || !reader.readTimestamp(sample.receiveUs) ||
+            !reader.readTimestamp(sample.transmitUs) || !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        m_clock = sample;
+        return DecodeResult::PONG_RECEIVED;
+    }
+
+    if (type == MessageType::GARBAGE) {
+        GarbageAttack attack;
+        std::uint32_t lines = 0;
+        if (!reader.readVarint(lines) || lines == 0 || lines > ROWS || !reader.readTimestamp(attack.sentUs) ||
+            !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        attack.lines = static_cast<int>(lines);
+        attack.number = sequence;
+        m_garbage = attack;
+        return DecodeResult::GARBAGE_RECEIVED;
+    }
+
+    if (type == MessageType::POSE) {
+        PacketData pose;
+        if (!reader.readPose(pose) || !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        // Late or duplicated datagram, a newer pose is already applied
+        if (m_hasPose && static_cast<std::int16_t>(static_cast<std::uint16_t>(sequence - m_lastPoseSequence)) <= 0) {
+            return DecodeResult::IGNORED;
+        }
+        m_hasPose = true;
+        m_lastPoseSequence = sequence;
+        copyPose(m_state, pose);
+        return m_hasKeyframe ? DecodeResult::STATE_UPDATED : DecodeResult::IGNORED;
+    }
+
+    if (type == MessageType::KEYFRAME) {
+        PacketData state;
+        for (int y = 0; y < ROWS; ++y) {
+            if (!reader.readRow(state.grid[y])) {
+                return DecodeResult::INVALID;
+            }
+        }
+        std::uint32_t score = 0;
+        std::uint32_t level = 0;
+        if (!reader.readPose(state) || !reader.readVarint(score) || !reader.readVarint(level) ||
+            !reader.readFlags(state) || !reader.atEnd()) {
+            return DecodeResult::INVALID;
+        }
+        state.score = static_cast<std::int32_t>(score);
+        state.level = static_cast<std::int32_t>(level);
+        if (m_hasPose) {
+            copyPose(state, m_state);
+        }
+
+        m_state = state;
+        m_hasKeyframe = true;
+        m_awaitingKeyframe = false;
+        m_expectedSequence = static_cast<std::uint16_t>(sequence + 1);
+        return DecodeResult::STATE_UPDATED;
+    }
+
+    if (type != MessageType::DELTA) {
+        return DecodeResult::INVALID;
+    }
+
+    // A delta only makes sense on top of the exact previous message
+    if (!m_hasKeyframe || sequence != m_expectedSequence) {
+        m_hasKeyframe = false;
+        if (m_awaitingKeyframe) {
+            return DecodeResult::IGNORED;  // resync already requested, wait for the keyframe
+        }
+        m_awaitingKeyframe = true;
+        return DecodeResult::NEED_RESYNC;
+    }
+
+    // Apply to a copy so a truncated message leaves the state untouched
+    PacketData state = m_state;
+    std::uint8_t maskBytes[3];
+    for (std::uint8_t& byte : maskBytes) {
+        if (!reader.readByte(byte)) {
+            return DecodeResult::INVALID;
+        }
+    }
+    const std::uint32_t rowMask = maskBytes[0] | (maskBytes[1] << 8) | (static_cast<std::uint32_t>(maskBytes[2]) << 16);
+    for (int y = 0; y < ROWS; ++y) {
+        if ((rowMask & (1u << y)) && !reader.readRow(state.grid[y])) {
+            return DecodeResult::INVALID;
+        }
+    }
+
+    std::uint8_t fieldMask;
+    if (!reader.readByte(fieldMask)) {
+        return DecodeResult::INVALID;
+    }
+    if ((fieldMask & FIELD_POSE) && !reader.readPose(state)) {
+        return DecodeResult::INVALID;
+    }
+    if (fieldMask & FIELD_SCORE) {
+        std::uint32_t score;
+        if (!reader.readVarint(score)) {
+            return DecodeResult::INVALID;
+        }
+        state.score = static_cast<std::int32_t>(score);
+    }
+    if (fieldMask & FIELD_LEVEL) {
+        std::uint32_t level;
+        if (!reader.readVarint(level)) {
+            return DecodeResult::INVALID;
+        }
+        state.level = static_cast<std::int32_t>(level);
+    }
+    if ((fieldMask & FIELD_FLAGS) && !reader.readFlags(state)) {
+        return DecodeResult::INVALID;
+    }
+    if (!reader.atEnd()) {
+        return DecodeResult::INVALID;
+    }
+    if (m_hasPose) {
+        copyPose(state, m_state);
+    }
+
+    m_state = state;
+    m_expectedSequence = static_cast<std::uint16_t>(sequence + 1);
+    return DecodeResult::STATE_UPDATED;
+}
+
+} // namespace Protocol
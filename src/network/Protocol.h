@@ -0,0 +1,226 @@
+#pragma once
+#include "ClockSync.h"
+#include "../model/InputAction.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// simple game state for network transmission (what the opponent view needs, see the wire format below)
+struct PacketData {
+    int32_t grid[21][10];
+    int32_t currentPieceType;
+    int32_t currentPieceX;
+    int32_t currentPieceY;
+    int32_t currentPieceRotation;
+    int32_t score;
+    int32_t level;
+    bool isGameOver;
+    bool isReady;
+    
+    PacketData() {
+        for (int y = 0; y < 21; y++) {
+            for (int x = 0; x < 10; x++) {
+                grid[y][x] = 0;
+            }
+        }
+        currentPieceType = 0;
+        currentPieceX = 0;
+        currentPieceY = 0;
+        currentPieceRotation = 0;
+        score = 0;
+        level = 1;
+        isGameOver = false;
+        isReady = false;
+    }
+};
+
+// Actions one player performed during one lockstep tick
+struct InputFrame {
+    static constexpr std::size_t MAX_ACTIONS = 16;
+
+    std::uint32_t tick = 0;
+    std::uint8_t count = 0;
+    std::array<InputAction, MAX_ACTIONS> actions{};
+};
+
+// How a network match keeps the opponent's board up to date
+enum class SyncMode : std::uint8_t {
+    MIRROR = 0,    // each peer streams its own state (keyframes/deltas) and the other copies it
+    LOCKSTEP = 1,  // peers only exchange inputs and both simulate both players from a shared seed
+    ROLLBACK = 2   // like LOCKSTEP, but local inputs apply at once and the opponent is predicted, then corrected
+};
+
+// Settings of a network match chosen by the host
+struct MatchStart {
+    std::uint32_t seed = 0;
+    SyncMode syncMode = SyncMode::MIRROR;
+    bool versus = false;  // line clears send garbage to the opponent
+};
+
+// Garbage lines one player sends the other in a mirrored versus match
+struct GarbageAttack {
+    int lines = 0;
+    std::int64_t sentUs = 0;   // on the sender's clock
+    std::uint16_t number = 0;  // counts the attacks of a match, so a resent one is applied once
+};
+
+// Identifies a LAN session across reconnects (SESSION/RESUME messages)
+struct SessionResume {
+    std::uint64_t token = 0;           // chosen by the host, 0 means none
+    std::uint32_t nextInputTick = 0;   // first input tick the sender has not received yet
+    std::uint32_t nextGarbage = 0;     // first garbage attack number the sender has not received yet
+    std::uint32_t matchesStarted = 0;  // MATCH_START messages the sender received in this session
+};
+
+// Binary game state protocol (version 1), independent of the transport.
+//
+// Every message starts with a 4 byte header: version, message type, 16-bit sequence number (little endian).
+//  - KEYFRAME: the whole board at 4 bits per cell followed by the piece pose and stats, sent on join and resync
+//  - DELTA: bitmask of changed rows, those rows packed at 4 bits per cell, a mask of changed fields and their values
+//  - RESYNC_REQUEST: the receiver lost track (sequence gap, delta before any keyframe) and asks for a keyframe
+//  - MATCH_START: sent by the host when both players are ready, carries the shared seed, sync mode and rule
+//  - INPUT: one lockstep tick of one player (varint tick, action count, one byte per action)
+//  - POSE: the falling piece only, sent unreliably over transports that can; the newest sequence wins
+//  - PING / PONG: clock samples for round trip and clock offset estimation (64-bit microsecond timestamps)
+//  - GARBAGE: attack lines of a mirrored versus match (varint lines, send timestamp), numbered from 0 in each
+//    match through the sequence field; lockstep and rollback derive garbage from the inputs instead
+//  - JOIN: first message to tetris-server, whether the client plays or spectates (one byte role)
+//  - SESSION: the host's 64-bit session token, sent to a newly connected client
+//  - RESUME: sent by a client reconnecting within the reconnect window and answered by the host: the session
+//    token, then the next input tick and garbage number each side still needs and the match starts it got
+//    (varints), so both resend only the match messages lost in between
+// KEYFRAME/DELTA, POSE and GARBAGE each have their own sequence numbers, the other messages carry 0.
+// Deltas are relative to the previous message, so they need RELIABLE (ordered) delivery.
+namespace Protocol {
+
+constexpr std::uint8_t VERSION = 1;
+constexpr std::size_t HEADER_SIZE = 4;
+constexpr int ROWS = 21;
+constexpr int COLUMNS = 10;
+constexpr std::size_t PACKED_ROW_SIZE = COLUMNS / 2;
+// Upper bound of any encoded message (a keyframe is about 120 bytes)
+constexpr std::size_t MAX_MESSAGE_SIZE = 256;
+
+enum class MessageType : std::uint8_t {
+    KEYFRAME = 1,
+    DELTA = 2,
+    RESYNC_REQUEST = 3,
+    MATCH_START = 4,
+    INPUT = 5,
+    POSE = 6,
+    PING = 7,
+    PONG = 8,
+    GARBAGE = 9,
+    JOIN = 10,
+    SESSION = 11,
+    RESUME = 12
+};
+
+// What a client of tetris-server joins as
+enum class JoinRole : std::uint8_t {
+    PLAYER = 0,
+    SPECTATOR = 1
+};
+
+
+// Outcome of decoding one message
+enum class DecodeResult {
+    STATE_UPDATED,      // state() holds the sender's latest state
+    RESYNC_REQUESTED,   // the peer wants a keyframe from us
+    MATCH_STARTED,      // matchStart() holds the host's match settings
+    INPUT_RECEIVED,     // input() holds one tick of the peer's inputs
+    PING_RECEIVED,      // clock().originUs holds the peer's ping time, answer with a pong
+    PONG_RECEIVED,      // clock() holds origin, receive and transmit times (arrival is up to the caller)
+    GARBAGE_RECEIVED,   // garbage() holds the lines the peer sent us
+    JOIN_REQUESTED,     // joinRole() holds whether the client plays or spectates
+    SESSION_STARTED,    // session().token holds the host's session token
+    RESUME_REQUESTED,   // session() holds the peer's token and the next input tick it needs
+    NEED_RESYNC,        // we missed something, send a resync request
+    IGNORED,            // delta dropped while waiting for the requested keyframe
+    INVALID             // malformed or unsupported message, ignored
+};
+
+// Turns successive game states into keyframe/delta messages, one per call
+class StateEncoder {
+public:
+    StateEncoder();
+
+    // Encode state into out. Returns false (and leaves out empty) when nothing changed since the last message.
+    bool encode(const PacketData& state, std::vector<std::uint8_t>& out);
+
+    // Next encode() sends a keyframe (join, or the peer asked for a resync)
+    void requestKeyframe() { m_needKeyframe = true; }
+
+    // Keyframe of the last state sent, for a receiver joining the stream late (spectators). It does not
+    // change the stream: the receiver continues with the deltas encode() produces next.
+    // Returns false when nothing was sent yet (the first encode() is a keyframe anyway).
+    bool encodeLatestKeyframe(std::vector<std::uint8_t>& out) const;
+
+    // Leave the piece pose out of deltas, it is sent with encodePose() instead
+    void setSeparatePose(bool separate) { m_separatePose = separate; }
+
+    // Encode the piece pose into out. Returns false when it did not change since the last pose message.
+    bool encodePose(const PacketData& state, std::vector<std::uint8_t>& out);
+
+    // Next encodePose() sends the pose even if unchanged (the last one may have been lost)
+    void requestPose() { m_hasSentPose = false; }
+
+    static void encodeResyncRequest(std::vector<std::uint8_t>& out);
+    static void encodeMatchStart(const MatchStart& start, std::vector<std::uint8_t>& out);
+    static void encodeInput(const InputFrame& frame, std::vector<std::uint8_t>& out);
+    static void encodePing(std::int64_t originUs, std::vector<std::uint8_t>& out);
+    static void encodePong(const ClockSample& sample, std::vector<std::uint8_t>& out);
+    static void encodeGarbage(const GarbageAttack& attack, std::vector<std::uint8_t>& out);
+    static void encodeJoin(JoinRole role, std::vector<std::uint8_t>& out);
+    static void encodeSession(std::uint64_t token, std::vector<std::uint8_t>& out);
+    static void encodeResume(const SessionResume& resume, std::vector<std::uint8_t>& out);
+
+private:
+    PacketData m_lastSent;
+    bool m_needKeyframe;
+    bool m_hasSent;
+    std::uint16_t m_sequence;
+    bool m_separatePose;
+    PacketData m_lastPose;
+    bool m_hasSentPose;
+    std::uint16_t m_poseSequence;
+
+    static void writeKeyframe(const PacketData& state, std::uint16_t sequence, std::vector<std::uint8_t>& out);
+};
+
+// Rebuilds the sender's game state from keyframe/delta messages
+class StateDecoder {
+public:
+    StateDecoder();
+
+    DecodeResult decode(const std::uint8_t* data, std::size_t size);
+
+    const PacketData& state() const { return m_state; }
+    const MatchStart& matchStart() const { return m_matchStart; }
+    const InputFrame& input() const { return m_input; }
+    const ClockSample& clock() const { return m_clock; }
+    const GarbageAttack& garbage() const { return m_garbage; }
+    JoinRole joinRole() const { return m_joinRole; }
+    const SessionResume& session() const { return m_session; }
+
+    // Forget everything received, the next message must be a keyframe
+    void reset();
+
+private:
+    PacketData m_state;
+    MatchStart m_matchStart;
+    InputFrame m_input;
+    ClockSample m_clock;
+    GarbageAttack m_garbage;
+    JoinRole m_joinRole;
+    SessionResume m_session;
+    bool m_hasKeyframe;
+    bool m_awaitingKeyframe;
+    std::uint16_t m_expectedSequence;
+    // Once POSE messages arrive they own the pose, older poses inside keyframes/deltas are not applied
+    bool m_hasPose;
+    std::uint16_t m_lastPoseSequence;
+};
+
+} // namespace Protocol
@@ -0,0 +1,240 @@
+#include "ReliableChannel.h"
+#include <algorithm>
+
+namespace {
+
+// Signed distance between 16-bit ids, correct across wraparound
+std::int16_t idDistance(std::uint16_t from, std::uint16_t to) {
+    return static_cast<std::int16_t>(static_cast<std::uint16_t>(to - from));
+}
+
+void writeU16(std::vector<std::uint8_t>& out, std::uint16_t value) {
+    out.push_back(static_cast<std::uint8_t>(value & 0xFF));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+}
+
+std::uint16_t readU16(const std::uint8_t* data) {
+    return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+}
+
+} // namespace
+
+ReliableChannel::ReliableChannel() {
+    reset();
+}
+
+void ReliableChannel::reset() {
+    m_pending.clear();
+    m_nextSendId = 0;
+    m_lastSendUs = 0;
+    m_smoothedRttUs = 50000;
+    m_resendCount = 0;
+
+    m_nextExpectedId = 0;
+    for (BufferedMessage& message : m_received) {
+        message.present = false;
+    }
+    m_delivered.clear();
+    m_payloads.clear();
+    m_ackOwed = false;
+    m_ackOwedSinceUs = 0;
+}
+
+void ReliableChannel::writeHeader(std::vector<std::uint8_t>& datagram, DatagramKind kind, std::uint16_t id,
+                                  std::uint16_t ackNext, std::uint32_t ackBits) {
+    datagram.clear();
+    writeU16(datagram, MAGIC);
+    datagram.push_back(static_cast<std::uint8_t>(kind));
+    writeU16(datagram, id);
+    writeU16(datagram, ackNext);
+    for (int shift = 0; shift < 32; shift += 8) {
+        datagram.push_back(static_cast<std::uint8_t>((ackBits >> shift) & 0xFF));
+    }
+}
+
+bool ReliableChannel::readKind(const std::uint8_t* data, std::size_t size, DatagramKind& kind) {
+    if (size < HEADER_SIZE || readU16(data) != MAGIC || data[2] < static_cast<std::uint8_t>(DatagramKind::HELLO) ||
+        data[2] > static_cast<std::uint8_t>(DatagramKind::ACK)) {
+        return false;
+    }
+    kind = static_cast<DatagramKind>(data[2]);
+    return true;
+}
+
+// Bit i set: reliable id m_nextExpectedId + 1 + i is already buffered
+std::uint32_t ReliableChannel::ackBits() const {
+    std::uint32_t bits = 0;
+    for (std::uint16_t i = 0; i + 1 < WINDOW; ++i) {
+        const std::uint16_t id = static_cast<std::uint16_t>(m_nextExpectedId + 1 + i);
+        if (m_received[id % WINDOW].present) {
+            bits |= 1u << i;
+        }
+    }
+    return bits;
+}
+
+void ReliableChannel::writeDatagram(std::vector<std::uint8_t>& datagram, DatagramKind kind, std::uint16_t id,
+                                    const std::uint8_t* payload, std::size_t size, std::int64_t nowUs) {
+    writeHeader(datagram, kind, id, m_nextExpectedId, ackBits());
+    datagram.insert(datagram.end(), payload, payload + size);
+    // Every datagram carries the current acks
+    m_lastSendUs = nowUs;
+    m_ackOwed = false;
+}
+
+bool ReliableChannel::inWindow(std::uint16_t id) const {
+    return !m_pending.empty() && idDistance(m_pending.front().id, id) < static_cast<std::int16_t>(WINDOW);
+}
+
+std::int64_t ReliableChannel::resendTimeoutUs(std::uint32_t sendCount) const {
+    // Back off on every resend so a dead link does not flood
+    const std::int64_t base = std::max(MIN_RESEND_US, 2 * m_smoothedRttUs);
+    const std::uint32_t backoff = std::min<std::uint32_t>(sendCount > 0 ? sendCount - 1 : 0, 4);
+    return std::min(MAX_RESEND_US, base << backoff);
+}
+
+bool ReliableChannel::writeMessage(const std::uint8_t* data, std::size_t size, Delivery delivery, std::int64_t nowUs,
+                                   std::vector<std::uint8_t>& datagram) {
+    if (size > MAX_PAYLOAD_SIZE) {
+        return false;
+    }
+
+    if (delivery == Delivery::UNRELIABLE) {
+        writeDatagram(datagram, DatagramKind::UNRELIABLE, 0, data, size, nowUs);
+        return true;
+    }
+
+    Payloads::Handle payload;
+    if (!m_payloads.acquire(data, size, payload)) {
+        return false;
+    }
+    m_pending.push_back({m_nextSendId++, payload, 0, 0});
+
+    PendingMessage& pending = m_pending.back();
+    if (!inWindow(pending.id)) {
+        return false;
+    }
+    pending.sentAtUs = nowUs;
+    pending.sendCount = 1;
+    writeDatagram(datagram, DatagramKind::RELIABLE, pending.id, m_payloads.data(pending.payload),
+                  m_payloads.size(pending.payload), nowUs);
+    return true;
+}
+
+bool ReliableChannel::nextDatagram(std::int64_t nowUs, std::vector<std::uint8_t>& datagram) {
+    for (PendingMessage& pending : m_pending) {
+        if (!inWindow(pending.id)) {
+            break;
+        }
+
+        const bool firstSend = pending.sendCount == 0;
+        if (firstSend || nowUs - pending.sentAtUs >= resendTimeoutUs(pending.sendCount)) {
+            if (!firstSend) {
+                ++m_resendCount;
+            }
+            pending.sentAtUs = nowUs;
+            ++pending.sendCount;
+            writeDatagram(datagram, DatagramKind::RELIABLE, pending.id, m_payloads.data(pending.payload),
+                          m_payloads.size(pending.payload), nowUs);
+            return true;
+        }
+    }
+
+    const bool ackDue = m_ackOwed && nowUs - m_ackOwedSinceUs >= ACK_DELAY_US;
+    if (ackDue || nowUs - m_lastSendUs >= KEEPALIVE_US) {
+        writeDatagram(datagram, DatagramKind::ACK, 0, nullptr, 0, nowUs);
+        return true;
+    }
+    return false;
+}
+
+bool ReliableChannel::onDatagram(const std::uint8_t* data, std::size_t size, std::int64_t nowUs) {
+    DatagramKind kind;
+    if (!readKind(data, size, kind)) {
+        return false;
+    }
+    if (kind == DatagramKind::HELLO || kind == DatagramKind::WELCOME) {
+        return true;
+    }
+
+    const std::uint16_t id = readU16(data + 3);
+    const std::uint16_t ackNext = readU16(data + 5);
+    const std::uint32_t bits = data[7] | (data[8] << 8) | (data[9] << 16) | (static_cast<std::uint32_t>(data[10]) << 24);
+    processAcks(ackNext, bits, nowUs);
+
+    const std::uint8_t* payload = data + HEADER_SIZE;
+    const std::size_t payloadSize = size - HEADER_SIZE;
+    if (kind == DatagramKind::RELIABLE) {
+        receiveReliable(id, payload, payloadSize, nowUs);
+    } else if (kind == DatagramKind::UNRELIABLE) {
+        Payloads::Handle handle;
+        if (m_payloads.acquire(payload, payloadSize, handle)) {
+            m_delivered.push_back(handle);
+        }
+    }
+    return true;
+}
+
+void ReliableChannel::processAcks(std::uint16_t ackNext, std::uint32_t bits, std::int64_t nowUs) {
+    const auto acked = [&](const PendingMessage& pending) {
+        if (pending.sendCount == 0) {
+            return false;
+        }
+        const std::int16_t distance = idDistance(ackNext, pending.id);
+        if (distance < 0) {
+            return true;
+        }
+        return distance >= 1 && distance <= 32 && (bits & (1u << (distance - 1))) != 0;
+    };
+
+    for (const PendingMessage& pending : m_pending) {
+        if (!acked(pending)) {
+            continue;
+        }
+        // Only messages sent once give an unambiguous round trip
+        if (pending.sendCount == 1) {
+            const std::int64_t sample = nowUs - pending.sentAtUs;
+            m_smoothedRttUs += (sample - m_smoothedRttUs) / 8;
+        }
+        m_payloads.release(pending.payload);
+    }
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), acked), m_pending.end());
+}
+
+void ReliableChannel::receiveReliable(std::uint16_t id, const std::uint8_t* payload, std::size_t size,
+                                      std::int64_t nowUs) {
+    if (!m_ackOwed) {
+        m_ackOwed = true;
+        m_ackOwedSinceUs = nowUs;
+    }
+
+    // Duplicates are only acked again, ids too far ahead are dropped and will be resent
+    const std::int16_t distance = idDistance(m_nextExpectedId, id);
+    if (distance < 0 || distance >= static_cast<std::int16_t>(WINDOW)) {
+        return;
+    }
+
+    BufferedMessage& slot = m_received[id % WINDOW];
+    if (!slot.present && m_payloads.acquire(payload, size, slot.payload)) {
+        slot.present = true;
+    }
+
+    while (m_received[m_nextExpectedId % WINDOW].present) {
+        BufferedMessage& next = m_received[m_nextExpectedId % WINDOW];
+        m_delivered.push_back(next.payload);
+        next.present = false;
+        ++m_nextExpectedId;
+    }
+}
+
+bool ReliableChannel::receive(std::vector<std::uint8_t>& message) {
+    if (m_delivered.empty()) {
+        return false;
+    }
+    // Copied into the caller's buffer, which keeps its capacity from one message to the next
+    const Payloads::Handle payload = m_delivered.front();
+    message.assign(m_payloads.data(payload), m_payloads.data(payload) + m_payloads.size(payload));
+    m_payloads.release(payload);
+    m_delivered.pop_front();
+    return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "Transport.h"
+#include "../util/BufferPool.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Selective reliability on top of datagrams, independent of the socket (times are passed in).
+//
+// Every datagram carries an 11 byte header: magic, kind, message id, then the receiver's acks as
+// "next reliable id expected" plus a bitmask of the 32 ids after it that already arrived.
+//  - RELIABLE messages get consecutive ids, are resent until acked and delivered in id order
+//  - UNRELIABLE messages are delivered as they arrive, a lost one is never resent
+//  - ACK datagrams carry no message, they are sent when acks are owed and nothing else went out
+// A lost datagram therefore only holds back later RELIABLE messages, never UNRELIABLE ones.
+// Message payloads waiting to be acked or delivered live in a buffer pool, not in one vector each.
+class ReliableChannel {
+public:
+    enum class DatagramKind : std::uint8_t {
+        HELLO = 1,       // client asks to join (handled by the transport)
+        WELCOME = 2,     // host accepted the client (handled by the transport)
+        RELIABLE = 3,
+        UNRELIABLE = 4,
+        ACK = 5
+    };
+
+    static constexpr std::uint16_t MAGIC = 0x5454;
+    static constexpr std::size_t HEADER_SIZE = 11;
+    static constexpr std::size_t MAX_DATAGRAM_SIZE = 1200;
+    static constexpr std::size_t MAX_PAYLOAD_SIZE = MAX_DATAGRAM_SIZE - HEADER_SIZE;
+    // Reliable messages in flight, and how far ahead of the next expected id the receiver buffers
+    static constexpr std::uint16_t WINDOW = 32;
+
+    ReliableChannel();
+
+    // Forget everything (new peer)
+    void reset();
+
+    // Build the datagram for a new message. Returns false when nothing should be sent right now: the message
+    // is too large, or it is RELIABLE and the window is full (it goes out from nextDatagram() later).
+    bool writeMessage(const std::uint8_t* data, std::size_t size, Delivery delivery, std::int64_t nowUs,
+                      std::vector<std::uint8_t>& datagram);
+
+    // Next datagram that is due (resend, queued reliable message, owed acks or keepalive), false when none
+    bool nextDatagram(std::int64_t nowUs, std::vector<std::uint8_t>& datagram);
+
+    // Process a datagram from the peer, false if it is not one of ours
+    bool onDatagram(const std::uint8_t* data, std::size_t size, std::int64_t nowUs);
+
+    // Next message delivered by onDatagram(), false when none is waiting
+    bool receive(std::vector<std::uint8_t>& message);
+
+    // Smoothed round trip of reliable messages, used for the resend timeout
+    std::int64_t smoothedRttUs() const { return m_smoothedRttUs; }
+    std::uint64_t resendCount() const { return m_resendCount; }
+
+    // Header without a message, also used by the transport for its handshake
+    static void writeHeader(std::vector<std::uint8_t>& datagram, DatagramKind kind, std::uint16_t id,
+                            std::uint16_t ackNext, std::uint32_t ackBits);
+    static bool readKind(const std::uint8_t* data, std::size_t size, DatagramKind& kind);
+
+private:
+    // Owed acks go out on their own after ACK_DELAY_US, and an ACK is sent after KEEPALIVE_US of silence
+    static constexpr std::int64_t ACK_DELAY_US = 5000;
+    static constexpr std::int64_t KEEPALIVE_US = 250000;
+    static constexpr std::int64_t MIN_RESEND_US = 20000;
+    static constexpr std::int64_t MAX_RESEND_US = 1000000;
+
+    using Payloads = BufferPool<MAX_PAYLOAD_SIZE>;
+
+    struct PendingMessage {
+        std::uint16_t id;
+        Payloads::Handle payload;
+        std::int64_t sentAtUs;   // 0 while waiting for room in the window
+        std::uint32_t sendCount;
+    };
+
+    struct BufferedMessage {
+        bool present = false;
+        Payloads::Handle payload = 0;
+    };
+
+    Payloads m_payloads;
+
+    // Sending side, oldest unacked first
+    std::deque<PendingMessage> m_pending;
+    std::uint16_t m_nextSendId;
+    std::int64_t m_lastSendUs;
+    std::int64_t m_smoothedRttUs;
+    std::uint64_t m_resendCount;
+
+    // Receiving side
+    std::uint16_t m_nextExpectedId;
+    std::array<BufferedMessage, WINDOW> m_received;
+    std::deque<Payloads::Handle> m_delivered;
+    bool m_ackOwed;
+    std::int64_t m_ackOwedSinceUs;
+
+    std::uint32_t ackBits() const;
+    void writeDatagram(std::vector<std::uint8_t>& datagram, DatagramKind kind, std::uint16_t id,
+                       const std::uint8_t* payload, std::size_t size, std::int64_t nowUs);
+    void processAcks(std::uint16_t ackNext, std::uint32_t bits, std::int64_t nowUs);
+    void receiveReliable(std::uint16_t id, const std::uint8_t* payload, std::size_t size, std::int64_t nowUs);
+    std::int64_t resendTimeoutUs(std::uint32_t sendCount) const;
+    bool inWindow(std::uint16_t id) const;
+};
@@ -0,0 +1,102 @@
+#include "RollbackSession.h"
+#include "../model/MultiplayerMode.h"
+
+RollbackSession::RollbackSession()
+    : m_currentTick(0),
+      m_confirmedTick(0),
+      m_rollbackFrom(NO_ROLLBACK),
+      m_versus(false) {
+    m_remoteReceived.fill(false);
+}
+
+void RollbackSession::start(const GameState& local, const GameState& remote, bool versus) {
+    m_versus = versus;
+    m_currentTick = 0;
+    m_confirmedTick = 0;
+    m_rollbackFrom = NO_ROLLBACK;
+    m_remoteReceived.fill(false);
+    local.save(m_saved[0].local);
+    remote.save(m_saved[0].remote);
+}
+
+bool RollbackSession::hasRemoteInput(std::uint32_t tick) const {
+    const std::size_t slot = tick % WINDOW;
+    return m_remoteReceived[slot] && m_remoteInputs[slot].tick == tick;
+}
+
+void RollbackSession::advance(GameState& local, GameState& remote, const InputFrame& localFrame) {
+    const std::size_t slot = m_currentTick % WINDOW;
+    local.save(m_saved[slot].local);
+    remote.save(m_saved[slot].remote);
+    m_localInputs[slot] = localFrame;
+    m_localInputs[slot].tick = m_currentTick;
+
+    simulateTick(local, remote, m_currentTick);
+    ++m_currentTick;
+}
+
+bool RollbackSession::addRemoteInput(const InputFrame& frame) {
+    // Already confirmed, or so far ahead it would overwrite a tick we still need
+    if (frame.tick < m_confirmedTick || frame.tick >= m_confirmedTick + WINDOW) {
+        return false;
+    }
+
+    const std::size_t slot = frame.tick % WINDOW;
+    m_remoteInputs[slot] = frame;
+    m_remoteReceived[slot] = true;
+
+    // The tick was simulated predicting no input, it has to be replayed if there was any
+    if (frame.tick < m_currentTick && frame.count > 0 && frame.tick < m_rollbackFrom) {
+        m_rollbackFrom = frame.tick;
+    }
+
+    while (hasRemoteInput(m_confirmedTick)) {
+        ++m_confirmedTick;
+    }
+    return true;
+}
+
+std::uint32_t RollbackSession::reconcile(GameState& local, GameState& remote) {
+    if (m_rollbackFrom == NO_ROLLBACK) {
+        return 0;
+    }
+
+    const std::uint32_t from = m_rollbackFrom;
+    m_rollbackFrom = NO_ROLLBACK;
+
+    const SavedTick& saved = m_saved[from % WINDOW];
+    local.restore(saved.local);
+    remote.restore(saved.remote);
+
+    for (std::uint32_t tick = from; tick < m_currentTick; ++tick) {
+        const std::size_t slot = tick % WINDOW;
+        if (tick != from) {
+            local.save(m_saved[slot].local);
+            remote.save(m_saved[slot].remote);
+        }
+        simulateTick(local, remote, tick);
+    }
+    return m_currentTick - from;
+}
+
+// One tick: inputs first, then gravity and animations, in the same order on both peers
+void RollbackSession::simulateTick(GameState& local, GameState& remote, std::uint32_t tick) {
+    const InputFrame& localFrame = m_localInputs[tick % WINDOW];
+    for (std::uint8_t i = 0; i < localFrame.count; ++i) {
+        local.applyInput(localFrame.actions[i]);
+    }
+
+    // Without the opponent's input yet, predict that they pressed nothing
+    if (hasRemoteInput(tick)) {
+        const InputFrame& remoteFrame = m_remoteInputs[tick % WINDOW];
+        for (std::uint8_t i = 0; i < remoteFrame.count; ++i) {
+            remote.applyInput(remoteFrame.actions[i]);
+        }
+    }
+
+    local.update(TICK_DURATION);
+    remote.update(TICK_DURATION);
+    if (m_versus) {
+        MultiplayerGameMode::exchangeGarbage(local, remote);
+    }
+}
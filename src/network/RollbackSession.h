@@ -0,0 +1,62 @@
+#pragma once
+#include "Protocol.h"
+#include "../model/GameState.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Rollback sync of a network match.
+// Local inputs are applied on the tick they are pressed, the opponent is predicted to press nothing until
+// their real inputs arrive. Both boards are saved at the start of every tick; when a late input shows the
+// prediction was wrong, both boards go back to that tick and are re-simulated with the real inputs.
+class RollbackSession {
+public:
+    static constexpr float TICK_DURATION = 1.0f / 60.0f;
+    // How far the simulation may run ahead of the last confirmed opponent input before it waits
+    static constexpr std::uint32_t MAX_PREDICTION_TICKS = 30;
+    // Ticks of saved states and inputs, must be larger than MAX_PREDICTION_TICKS
+    static constexpr std::size_t WINDOW = 64;
+
+    RollbackSession();
+
+    // Start at tick 0 from the current boards; in versus, line clears send garbage between them every tick
+    void start(const GameState& local, const GameState& remote, bool versus = false);
+
+    std::uint32_t currentTick() const { return m_currentTick; }
+
+    // False when the opponent is too far behind to keep predicting
+    bool canAdvance() const { return m_currentTick < m_confirmedTick + MAX_PREDICTION_TICKS; }
+
+    // Every tick simulated so far used the opponent's real inputs
+    bool isConfirmed() const { return m_confirmedTick >= m_currentTick && m_rollbackFrom == NO_ROLLBACK; }
+
+    // Simulate the current tick with the local inputs and the opponent's inputs (known or predicted)
+    void advance(GameState& local, GameState& remote, const InputFrame& localFrame);
+
+    // Store the opponent's inputs for a tick, false if it is outside the window
+    bool addRemoteInput(const InputFrame& frame);
+
+    // Re-simulate from the earliest mispredicted tick if a late input needs it, returns the ticks re-simulated
+    std::uint32_t reconcile(GameState& local, GameState& remote);
+
+private:
+    static constexpr std::uint32_t NO_ROLLBACK = 0xFFFFFFFFu;
+
+    // Snapshots of both games at the start of a tick
+    struct SavedTick {
+        GameStateSnapshot local;
+        GameStateSnapshot remote;
+    };
+
+    std::array<SavedTick, WINDOW> m_saved;
+    std::array<InputFrame, WINDOW> m_localInputs;
+    std::array<InputFrame, WINDOW> m_remoteInputs;
+    std::array<bool, WINDOW> m_remoteReceived;
+    std::uint32_t m_currentTick;
+    std::uint32_t m_confirmedTick;  // first tick whose opponent input has not arrived
+    std::uint32_t m_rollbackFrom;
+    bool m_versus;
+
+    bool hasRemoteInput(std::uint32_t tick) const;
+    void simulateTick(GameState& local, GameState& remote, std::uint32_t tick);
+};
@@ -0,0 +1,234 @@
+#include "SimulatedNetwork.h"
+#include "../util/Timestamp.h"
+#include <algorithm>
+#include <cstring>
+
+SimulatedNetwork::SimulatedNetwork() : SimulatedNetwork(LinkSettings()) {}
+
+SimulatedNetwork::SimulatedNetwork(const LinkSettings& settings, bool manualClock)
+    : m_settings(settings),
+      m_random(settings.seed),
+      m_manualClock(manualClock),
+      m_manualNowUs(0),
+      m_startUs(nowMicroseconds()),
+      m_nextEndpoint(1),
+      m_nextSequence(0) {}
+
+std::shared_ptr<SimulatedNetwork> SimulatedNetwork::shared() {
+    static std::shared_ptr<SimulatedNetwork> network = std::make_shared<SimulatedNetwork>();
+    return network;
+}
+
+void SimulatedNetwork::setSettings(const LinkSettings& settings) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (settings.seed != m_settings.seed) {
+        m_random.setSeed(settings.seed);
+    }
+    m_settings = settings;
+}
+
+SimulatedNetwork::LinkSettings SimulatedNetwork::settings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+SimulatedNetwork::Stats SimulatedNetwork::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::int64_t SimulatedNetwork::nowUs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return nowUsLocked();
+}
+
+// The manual clock starts at 1 s so "0" keeps meaning "never" for the channel's timestamps
+std::int64_t SimulatedNetwork::nowUsLocked() const {
+    return m_manualClock ? 1000000 + m_manualNowUs : nowMicroseconds() - m_startUs + 1000000;
+}
+
+void SimulatedNetwork::advance(std::int64_t us) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_manualClock && us > 0) {
+        m_manualNowUs += us;
+    }
+}
+
+SimulatedNetwork::EndpointId SimulatedNetwork::open() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const EndpointId id = m_nextEndpoint++;
+    m_endpoints[id];
+    return id;
+}
+
+void SimulatedNetwork::close(EndpointId endpoint) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(endpoint);
+    if (it == m_endpoints.end()) {
+        return;
+    }
+    unpair(endpoint);
+    clearInbox(it->second);
+    m_endpoints.erase(it);
+}
+
+bool SimulatedNetwork::listen(EndpointId endpoint, unsigned short port) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_endpoints) {
+        if (entry.second.listenPort == port) {
+            return false;
+        }
+    }
+    auto it = m_endpoints.find(endpoint);
+    if (it == m_endpoints.end()) {
+        return false;
+    }
+    it->second.listenPort = port;
+    return true;
+}
+
+bool SimulatedNetwork::connect(EndpointId endpoint, unsigned short port) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto client = m_endpoints.find(endpoint);
+    if (client == m_endpoints.end()) {
+        return false;
+    }
+    for (auto& entry : m_endpoints) {
+        Endpoint& host = entry.second;
+        if (host.listenPort != port || entry.first == endpoint) {
+            continue;
+        }
+        if (host.peer != 0) {
+            return false;
+        }
+        host.peer = endpoint;
+        host.accepted = true;
+        host.peerLost = false;
+        client->second.peer = entry.first;
+        client->second.peerLost = false;
+        return true;
+    }
+    return false;
+}
+
+void SimulatedNetwork::dropPeer(EndpointId endpoint) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    unpair(endpoint);
+}
+
+void SimulatedNetwork::unpair(EndpointId endpoint) {
+    auto it = m_endpoints.find(endpoint);
+    if (it == m_endpoints.end() || it->second.peer == 0) {
+        return;
+    }
+    auto peer = m_endpoints.find(it->second.peer);
+    if (peer != m_endpoints.end()) {
+        peer->second.peer = 0;
+        peer->second.accepted = false;
+        peer->second.peerLost = true;
+        clearInbox(peer->second);
+    }
+    it->second.peer = 0;
+    it->second.accepted = false;
+    clearInbox(it->second);
+}
+
+void SimulatedNetwork::clearInbox(Endpoint& endpoint) {
+    while (!endpoint.inbox.empty()) {
+        m_payloads.release(endpoint.inbox.top().payload);
+        endpoint.inbox.pop();
+    }
+}
+
+bool SimulatedNetwork::takeAccepted(EndpointId endpoint) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(endpoint);
+    if (it == m_endpoints.end() || !it->second.accepted) {
+        return false;
+    }
+    it->second.accepted = false;
+    return true;
+}
+
+bool SimulatedNetwork::takePeerLost(EndpointId endpoint) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(endpoint);
+    if (it == m_endpoints.end() || !it->second.peerLost) {
+        return false;
+    }
+    it->second.peerLost = false;
+    return true;
+}
+
+bool SimulatedNetwork::chance(float rate) {
+    if (rate <= 0.0f) {
+        return false;
+    }
+    return static_cast<float>(m_random.next() % 1000000u) < rate * 1000000.0f;
+}
+
+bool SimulatedNetwork::send(EndpointId endpoint, const std::uint8_t* data, std::size_t size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto from = m_endpoints.find(endpoint);
+    if (from == m_endpoints.end() || from->second.peer == 0) {
+        return false;
+    }
+    auto to = m_endpoints.find(from->second.peer);
+    if (to == m_endpoints.end() || size > ReliableChannel::MAX_DATAGRAM_SIZE) {
+        return false;
+    }
+
+    ++m_stats.datagrams;
+    m_stats.bytes += size;
+    const std::int64_t nowUs = nowUsLocked();
+
+    // The bandwidth cap serializes datagrams one after the other, what waits too long is dropped at the tail
+    std::int64_t departUs = nowUs;
+    if (m_settings.bandwidthBytesPerSecond > 0) {
+        const std::int64_t startUs = std::max(nowUs, from->second.sendBusyUntilUs);
+        const std::uint64_t backlogBytes =
+            static_cast<std::uint64_t>(startUs - nowUs) * m_settings.bandwidthBytesPerSecond / 1000000;
+        if (backlogBytes + size > m_settings.queueLimitBytes) {
+            ++m_stats.queueDrops;
+            return true;
+        }
+        departUs = startUs + static_cast<std::int64_t>(size * 1000000 / m_settings.bandwidthBytesPerSecond);
+        from->second.sendBusyUntilUs = departUs;
+    }
+
+    if (chance(m_settings.lossRate)) {
+        ++m_stats.lost;
+        return true;
+    }
+
+    std::int64_t deliverAtUs = departUs + m_settings.latencyUs;
+    if (m_settings.jitterUs > 0) {
+        deliverAtUs += static_cast<std::int64_t>(m_random.next() % static_cast<std::uint32_t>(m_settings.jitterUs + 1));
+    }
+    if (chance(m_settings.reorderRate)) {
+        deliverAtUs += std::max<std::int64_t>(m_settings.latencyUs, 1000);
+        ++m_stats.reordered;
+    }
+
+    Payloads::Handle payload;
+    if (!m_payloads.acquire(data, size, payload)) {
+        return false;
+    }
+    to->second.inbox.push(InFlight{deliverAtUs, m_nextSequence++, payload});
+    return true;
+}
+
+bool SimulatedNetwork::receive(EndpointId endpoint, std::uint8_t* buffer, std::size_t capacity, std::size_t& size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(endpoint);
+    if (it == m_endpoints.end() || it->second.inbox.empty() || it->second.inbox.top().deliverAtUs > nowUsLocked()) {
+        return false;
+    }
+    const InFlight datagram = it->second.inbox.top();
+    it->second.inbox.pop();
+    size = std::min(capacity, m_payloads.size(datagram.payload));
+    std::memcpy(buffer, m_payloads.data(datagram.payload), size);
+    m_payloads.release(datagram.payload);
+    ++m_stats.delivered;
+    return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "ReliableChannel.h"
+#include "../model/Random.h"
+#include "../util/BufferPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// An in-process stand-in for the LAN: endpoints listen on and connect to ports, then exchange datagrams
+// over a link with latency, jitter, loss, reordering and a bandwidth cap. SimulatedTransport runs on top.
+// Time is either the real clock, or a manual one moved with advance() so a match can be simulated as fast
+// as the CPU allows. Loss, jitter and reordering come from a seeded generator, so a manual-clock run with
+// the same seed and the same calls replays exactly. Thread-safe: each endpoint may live on its own thread.
+class SimulatedNetwork {
+public:
+    using EndpointId = std::uint32_t;
+
+    // Applies to both directions
+    struct LinkSettings {
+        std::int64_t latencyUs = 20000;           // one way
+        std::int64_t jitterUs = 0;                // extra delay, uniform in [0, jitterUs]
+        float lossRate = 0.0f;                    // 0..1, share of datagrams dropped
+        float reorderRate = 0.0f;                 // 0..1, share held back one more latency so later ones overtake
+        std::uint64_t bandwidthBytesPerSecond = 0;  // 0 for unlimited
+        std::size_t queueLimitBytes = 64 * 1024;  // bytes waiting for the bandwidth cap, beyond that tail drop
+        std::uint32_t seed = 1;
+    };
+
+    struct Stats {
+        std::uint64_t datagrams = 0;  // handed to the link
+        std::uint64_t bytes = 0;
+        std::uint64_t lost = 0;
+        std::uint64_t queueDrops = 0;
+        std::uint64_t reordered = 0;
+        std::uint64_t delivered = 0;
+    };
+
+    SimulatedNetwork();
+    explicit SimulatedNetwork(const LinkSettings& settings, bool manualClock = false);
+
+    // Real-time network shared by every SimulatedTransport created without one (createTransport("sim"))
+    static std::shared_ptr<SimulatedNetwork> shared();
+
+    void setSettings(const LinkSettings& settings);
+    LinkSettings settings() const;
+    Stats stats() const;
+
+    // Microseconds on the network's clock
+    std::int64_t nowUs() const;
+    // Move a manual clock forward (ignored on the real clock)
+    void advance(std::int64_t us);
+
+    // Endpoints, used by SimulatedTransport
+    EndpointId open();
+    void close(EndpointId endpoint);
+    // Accept the next connect() to port, false if another endpoint listens there
+    bool listen(EndpointId endpoint, unsigned short port);
+    // Pair with the endpoint listening on port, false if nobody listens or it already has a peer
+    bool connect(EndpointId endpoint, unsigned short port);
+    // Forget the peer (both sides), datagrams still in flight between them are dropped
+    void dropPeer(EndpointId endpoint);
+    // A peer connected to this listening endpoint since the last call
+    bool takeAccepted(EndpointId endpoint);
+    // The peer closed or dropped us since the last call
+    bool takePeerLost(EndpointId endpoint);
+
+    // Put a datagram on the link to the peer, false if there is no peer (a lost datagram still returns true)
+    bool send(EndpointId endpoint, const std::uint8_t* data, std::size_t size);
+    // Next datagram that has arrived by now, false when none
+    bool receive(EndpointId endpoint, std::uint8_t* buffer, std::size_t capacity, std::size_t& size);
+
+private:
+    using Payloads = BufferPool<ReliableChannel::MAX_DATAGRAM_SIZE>;
+
+    struct InFlight {
+        std::int64_t deliverAtUs;
+        std::uint64_t sequence;  // keeps datagrams with the same arrival time in send order
+        Payloads::Handle payload;
+    };
+
+    struct Later {
+        bool operator()(const InFlight& a, const InFlight& b) const {
+            return a.deliverAtUs != b.deliverAtUs ? a.deliverAtUs > b.deliverAtUs : a.sequence > b.sequence;
+        }
+    };
+
+    struct Endpoint {
+        unsigned short listenPort = 0;
+        EndpointId peer = 0;
+        bool accepted = false;
+        bool peerLost = false;
+        std::int64_t sendBusyUntilUs = 0;  // when the bandwidth cap lets the next datagram leave
+        std::priority_queue<InFlight, std::vector<InFlight>, Later> inbox;
+    };
+
+    mutable std::mutex m_mutex;
+    LinkSettings m_settings;
+    Random m_random;
+    bool m_manualClock;
+    std::int64_t m_manualNowUs;
+    std::int64_t m_startUs;
+    EndpointId m_nextEndpoint;
+    std::uint64_t m_nextSequence;
+    std::unordered_map<EndpointId, Endpoint> m_endpoints;
+    Payloads m_payloads;
+    Stats m_stats;
+
+    std::int64_t nowUsLocked() const;
+    bool chance(float rate);
+    void clearInbox(Endpoint& endpoint);
+    void unpair(EndpointId endpoint);
+};
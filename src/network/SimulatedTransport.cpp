@@ -0,0 +1,144 @@
+#include "SimulatedTransport.h"
+#include <iostream>
+
+SimulatedTransport::SimulatedTransport(std::shared_ptr<SimulatedNetwork> network)
+    : m_network(std::move(network)),
+      m_endpoint(0),
+      m_isHost(false),
+      m_isConnected(false),
+      m_bytesSent(0),
+      m_bytesReceived(0) {}
+
+SimulatedTransport::~SimulatedTransport() {
+    disconnect();
+}
+
+bool SimulatedTransport::host(unsigned short port) {
+    disconnect();
+
+    m_endpoint = m_network->open();
+    if (!m_network->listen(m_endpoint, port)) {
+        std::cerr << "Error: Port " << port << " is already in use on the simulated network" << std::endl;
+        disconnect();
+        return false;
+    }
+    m_isHost = true;
+    return true;
+}
+
+bool SimulatedTransport::connect(const std::string& ip, unsigned short port) {
+    disconnect();
+
+    m_endpoint = m_network->open();
+    if (!m_network->connect(m_endpoint, port)) {
+        std::cerr << "Error: Failed to connect to " << ip << ":" << port << " (nobody free on the simulated network)"
+                  << std::endl;
+        disconnect();
+        return false;
+    }
+    startSession();
+    return true;
+}
+
+void SimulatedTransport::disconnect() {
+    if (m_endpoint != 0) {
+        m_network->close(m_endpoint);
+    }
+    m_endpoint = 0;
+    m_isHost = false;
+    m_isConnected = false;
+    m_channel.reset();
+}
+
+void SimulatedTransport::dropPeer() {
+    if (!m_isHost) {
+        disconnect();
+        return;
+    }
+    // Still listening, the next connect() to the port starts a new session
+    m_network->dropPeer(m_endpoint);
+    m_isConnected = false;
+}
+
+void SimulatedTransport::startSession() {
+    m_isConnected = true;
+    m_channel.reset();
+    m_bytesSent = 0;
+    m_bytesReceived = 0;
+}
+
+bool SimulatedTransport::update() {
+    if (m_endpoint == 0) {
+        return false;
+    }
+
+    const bool accepted = m_isHost && m_network->takeAccepted(m_endpoint);
+    if (accepted) {
+        startSession();
+    }
+
+    if (m_network->takePeerLost(m_endpoint) && m_isConnected) {
+        std::cerr << "Error: Connection lost (simulated peer closed)" << std::endl;
+        m_isConnected = false;
+        if (!m_isHost) {
+            disconnect();
+        }
+        return false;
+    }
+
+    receiveDatagrams();
+    sendDue();
+    return accepted;
+}
+
+void SimulatedTransport::receiveDatagrams() {
+    if (!m_isConnected) {
+        return;
+    }
+    std::size_t received = 0;
+    while (m_network->receive(m_endpoint, m_receiveBuffer.data(), m_receiveBuffer.size(), received)) {
+        m_bytesReceived += received;
+        m_channel.onDatagram(m_receiveBuffer.data(), received, m_network->nowUs());
+    }
+}
+
+// Resends, window-delayed reliable messages, acks and keepalives
+void SimulatedTransport::sendDue() {
+    if (!m_isConnected) {
+        return;
+    }
+    const std::int64_t nowUs = m_network->nowUs();
+    while (m_channel.nextDatagram(nowUs, m_datagram)) {
+        sendDatagram(m_datagram);
+    }
+}
+
+void SimulatedTransport::sendDatagram(const std::vector<std::uint8_t>& datagram) {
+    if (m_network->send(m_endpoint, datagram.data(), datagram.size())) {
+        m_bytesSent += datagram.size();
+    }
+}
+
+bool SimulatedTransport::send(const std::uint8_t* data, std::size_t size, Delivery delivery) {
+    if (!m_isConnected) {
+        return false;
+    }
+
+    if (size > ReliableChannel::MAX_PAYLOAD_SIZE) {
+        std::cerr << "Error: Message of " << size << " bytes does not fit in a datagram" << std::endl;
+        return false;
+    }
+
+    if (m_channel.writeMessage(data, size, delivery, m_network->nowUs(), m_datagram)) {
+        sendDatagram(m_datagram);
+    }
+    return true;
+}
+
+bool SimulatedTransport::receive(std::vector<std::uint8_t>& message) {
+    if (m_channel.receive(message)) {
+        return true;
+    }
+    receiveDatagrams();
+    return m_channel.receive(message);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "ReliableChannel.h"
+#include "SimulatedNetwork.h"
+#include "Transport.h"
+#include <array>
+#include <memory>
+
+// Transport over a SimulatedNetwork instead of sockets, with the same ReliableChannel as UdpTransport, so
+// RELIABLE and UNRELIABLE messages behave as they would over a lossy LAN. The ip of connect() is ignored,
+// only the port picks the host. Connecting is immediate, the host sees the peer in its next update().
+// Closing either side is noticed by the other in its next update(), like a TCP reset.
+class SimulatedTransport : public Transport {
+public:
+    explicit SimulatedTransport(std::shared_ptr<SimulatedNetwork> network = SimulatedNetwork::shared());
+    ~SimulatedTransport() override;
+
+    bool host(unsigned short port) override;
+    bool connect(const std::string& ip, unsigned short port) override;
+    void disconnect() override;
+    void dropPeer() override;
+    bool isConnected() const override { return m_isConnected; }
+    bool update() override;
+    bool hasUnreliableDelivery() const override { return true; }
+    bool send(const std::uint8_t* data, std::size_t size, Delivery delivery) override;
+    bool receive(std::vector<std::uint8_t>& message) override;
+    std::uint64_t bytesSent() const override { return m_bytesSent; }
+    std::uint64_t bytesReceived() const override { return m_bytesReceived; }
+    std::uint64_t partialSends() const override { return 0; }  // the link takes every datagram (or loses it)
+    std::size_t unsentBytes() const override { return 0; }
+    std::int64_t nowUs() const override { return m_network->nowUs(); }
+
+    std::uint64_t resendCount() const { return m_channel.resendCount(); }
+
+private:
+    std::shared_ptr<SimulatedNetwork> m_network;
+    SimulatedNetwork::EndpointId m_endpoint;  // 0 while closed
+    bool m_isHost;
+    bool m_isConnected;
+
+    ReliableChannel m_channel;
+    std::vector<std::uint8_t> m_datagram;
+    std::array<std::uint8_t, ReliableChannel::MAX_DATAGRAM_SIZE> m_receiveBuffer;
+
+    std::uint64_t m_bytesSent;
+    std::uint64_t m_bytesReceived;
+
+    void startSession();
+    void receiveDatagrams();
+    void sendDue();
+    void sendDatagram(const std::vector<std::uint8_t>& datagram);
+};
@@ -0,0 +1,178 @@
+#include "TcpTransport.h"
+#include <iostream>
+
+TcpTransport::TcpTransport()
+    : m_isHost(false), m_isConnected(false), m_bytesSent(0), m_bytesReceived(0), m_partialSends(0) {
+}
+
+bool TcpTransport::host(unsigned short port) {
+    disconnect();
+    m_isHost = true;
+
+    // Set listener to non-blocking so it doesn't freeze the game
+    m_listener.setBlocking(false);
+
+    if (m_listener.listen(port) != sf::Socket::Status::Done) {
+        std::cerr << "Error: Failed to bind to port " << port << std::endl;
+        m_isHost = false;
+        return false;
+    }
+    return true;
+}
+
+bool TcpTransport::connect(const std::string& ip, unsigned short port) {
+    disconnect();
+    m_isHost = false;
+
+    // Try to connect (blocking for initial connection is okay)
+    m_serverSocket.setBlocking(true);
+    auto ipAddr = sf::IpAddress::resolve(ip);
+    if (!ipAddr.has_value()) {
+        std::cerr << "Error: Failed to resolve IP address: " << ip << std::endl;
+        return false;
+    }
+
+    if (m_serverSocket.connect(ipAddr.value(), port, sf::seconds(5)) != sf::Socket::Status::Done) {
+        std::cerr << "Error: Failed to connect to " << ip << ":" << port << std::endl;
+        return false;
+    }
+
+    // Switch to non-blocking for game loop
+    m_serverSocket.setBlocking(false);
+    startConnection();
+    return true;
+}
+
+void TcpTransport::startConnection() {
+    m_isConnected = true;
+    m_bytesSent = 0;
+    m_bytesReceived = 0;
+    m_partialSends = 0;
+    m_unsent.clear();
+    m_reader.clear();
+}
+
+void TcpTransport::disconnect() {
+    if (m_isHost) {
+        m_listener.close();
+        m_clientSocket.disconnect();
+    } else {
+        m_serverSocket.disconnect();
+    }
+    m_isConnected = false;
+    m_isHost = false;
+}
+
+void TcpTransport::dropPeer() {
+    if (!m_isHost) {
+        disconnect();
+        return;
+    }
+    // The listener stays open, update() accepts the next connection
+    m_clientSocket.disconnect();
+    m_isConnected = false;
+}
+
+bool TcpTransport::update() {
+    if (m_isConnected) {
+        flush();
+        return false;
+    }
+
+    // If we're hosting and not yet connected, try to accept a connection
+    if (!m_isHost) {
+        return false;
+    }
+
+    // Status::NotReady means no connection yet (non-blocking)
+    if (m_listener.accept(m_clientSocket) != sf::Socket::Status::Done) {
+        return false;
+    }
+
+    m_clientSocket.setBlocking(false);
+    startConnection();
+    return true;
+}
+
+bool TcpTransport::send(const std::uint8_t* data, std::size_t size, Delivery) {
+    if (!m_isConnected) {
+        return false;
+    }
+
+    // Behind whatever is still queued, so frames reach the stream whole and in order
+    Framing::appendFrame(m_unsent, data, size);
+    if (!flush()) {
+        return false;
+    }
+    if (!m_unsent.empty()) {
+        ++m_partialSends;
+    }
+    return true;
+}
+
+bool TcpTransport::flush() {
+    std::size_t offset = 0;
+    while (offset < m_unsent.size()) {
+        std::size_t sent = 0;
+        const auto status = activeSocket().send(m_unsent.data() + offset, m_unsent.size() - offset, sent);
+        offset += sent;
+        m_bytesSent += sent;
+        if (status == sf::Socket::Status::Done || (status == sf::Socket::Status::Partial && sent > 0)) {
+            continue;
+        }
+        if (status == sf::Socket::Status::Partial || status == sf::Socket::Status::NotReady) {
+            break;  // send buffer full, the rest goes out on a later call once the peer has read some
+        }
+        std::cerr << "Error: Failed to send message (status: " << static_cast<int>(status) << ")" << std::endl;
+        m_isConnected = false;
+        m_unsent.clear();
+        return false;
+    }
+    m_unsent.erase(m_unsent.begin(), m_unsent.begin() + static_cast<std::ptrdiff_t>(offset));
+    if (m_unsent.size() > MAX_UNSENT_BYTES) {
+        std::cerr << "Error: Peer stopped reading, " << m_unsent.size() << " bytes could not be sent" << std::endl;
+        m_isConnected = false;
+        m_unsent.clear();
+        return false;
+    }
+    return true;
+}
+
+bool TcpTransport::receive(std::vector<std::uint8_t>& message) {
+    if (!m_isConnected) {
+        return false;
+    }
+
+    // Read until a whole frame is buffered
+    const std::uint8_t* frame = nullptr;
+    std::size_t size = 0;
+    while (!m_reader.next(frame, size)) {
+        if (m_reader.isBroken()) {
+            std::cerr << "Error: Received a frame longer than " << Framing::MAX_FRAME_SIZE << " bytes" << std::endl;
+            m_isConnected = false;
+            return false;
+        }
+
+        std::size_t received = 0;
+        auto status = activeSocket().receive(m_receiveChunk.data(), m_receiveChunk.size(), received);
+
+        // NotReady means no more data available (non-blocking)
+        if (status == sf::Socket::Status::NotReady) {
+            return false;
+        }
+
+        if (status != sf::Socket::Status::Done) {
+            // Connection lost or error
+            std::cerr << "Error: Connection lost or receive failed (status: " << static_cast<int>(status) << ")" << std::endl;
+            m_isConnected = false;
+            return false;
+        }
+
+        m_bytesReceived += received;
+        std::vector<std::uint8_t>& buffer = m_reader.buffer();
+        buffer.insert(buffer.end(), m_receiveChunk.data(), m_receiveChunk.data() + received);
+    }
+
+    message.assign(frame, frame + size);
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "Framing.h"
+#include "Transport.h"
+#include <SFML/Network.hpp>
+#include <array>
+
+// Length-prefixed messages (the sf::Packet layout, see Framing.h) over a non-blocking TCP connection.
+// Everything is delivered reliably and in order, so a lost segment holds back every later message until it
+// is retransmitted. Frames are built and split in reused buffers and go through the raw socket calls,
+// nothing is allocated per message. What the socket does not take right away (a full send buffer) stays
+// queued and is written, never split or dropped, before the next frame and on every update().
+class TcpTransport : public Transport {
+public:
+    // Queued beyond this (seconds of match traffic), the peer is taken to have stopped reading and the
+    // connection is dropped
+    static constexpr std::size_t MAX_UNSENT_BYTES = 256 * 1024;
+
+    TcpTransport();
+
+    bool host(unsigned short port) override;
+    bool connect(const std::string& ip, unsigned short port) override;
+    void disconnect() override;
+    void dropPeer() override;
+    bool isConnected() const override { return m_isConnected; }
+    bool update() override;
+    bool hasUnreliableDelivery() const override { return false; }
+    bool send(const std::uint8_t* data, std::size_t size, Delivery delivery) override;
+    bool receive(std::vector<std::uint8_t>& message) override;
+    std::uint64_t bytesSent() const override { return m_bytesSent; }
+    std::uint64_t bytesReceived() const override { return m_bytesReceived; }
+    std::uint64_t partialSends() const override { return m_partialSends; }
+    std::size_t unsentBytes() const override { return m_unsent.size(); }
+
+private:
+    bool m_isHost;
+    bool m_isConnected;
+
+    // For host
+    sf::TcpListener m_listener;
+    sf::TcpSocket m_clientSocket;
+
+    // For client
+    sf::TcpSocket m_serverSocket;
+
+    std::uint64_t m_bytesSent;
+    std::uint64_t m_bytesReceived;
+    std::uint64_t m_partialSends;
+
+    std::vector<std::uint8_t> m_unsent;  // frames, or the tail of one, the socket has not taken yet
+    Framing::FrameReader m_reader;
+    std::array<std::uint8_t, 4096> m_receiveChunk;
+
+    // A new connection starts with empty buffers and counters
+    void startConnection();
+    // Write as much of m_unsent as the socket takes without blocking, false if the connection is gone
+    bool flush();
+    sf::TcpSocket& activeSocket() { return m_isHost ? m_clientSocket : m_serverSocket; }
+};
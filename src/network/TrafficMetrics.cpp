@@ -0,0 +1,85 @@
+#include "TrafficMetrics.h"
+#include <algorithm>
+
+namespace {
+
+// Per second between two readings of a counter, 0 if it went backwards (transport restarted its count)
+float perSecond(std::uint64_t from, std::uint64_t to, float seconds) {
+    return to > from ? static_cast<float>(to - from) / seconds : 0.0f;
+}
+
+} // namespace
+
+TrafficMetrics::TrafficMetrics() : m_next(0), m_count(0), m_queueDepth(0) {}
+
+void TrafficMetrics::reset(const TrafficCounters& counters, std::int64_t nowUs) {
+    m_samples[0].timeUs = nowUs;
+    m_samples[0].counters = counters;
+    m_samples[0].maxQueueDepth = 0;
+    m_next = 1;
+    m_count = 1;
+    m_queueDepth = 0;
+    m_rates = TrafficRates();
+}
+
+void TrafficMetrics::observeQueueDepth(std::size_t depth) {
+    m_queueDepth = std::max(m_queueDepth, static_cast<int>(depth));
+}
+
+bool TrafficMetrics::sample(const TrafficCounters& counters, std::int64_t nowUs) {
+    if (m_count == 0) {
+        reset(counters, nowUs);
+        return false;
+    }
+    const std::size_t newest = (m_next + m_samples.size() - 1) % m_samples.size();
+    if (nowUs - m_samples[newest].timeUs < SAMPLE_INTERVAL_US) {
+        return false;
+    }
+
+    Sample& sample = m_samples[m_next];
+    sample.timeUs = nowUs;
+    sample.counters = counters;
+    sample.maxQueueDepth = m_queueDepth;
+    m_queueDepth = 0;
+    m_next = (m_next + 1) % m_samples.size();
+    m_count = std::min(m_count + 1, m_samples.size());
+    computeRates();
+    return true;
+}
+
+void TrafficMetrics::computeRates() {
+    const std::size_t size = m_samples.size();
+    const std::size_t oldest = (m_next + size - m_count) % size;
+    const std::size_t newest = (m_next + size - 1) % size;
+    const Sample& first = m_samples[oldest];
+    const Sample& last = m_samples[newest];
+    const float seconds = static_cast<float>(last.timeUs - first.timeUs) / 1e6f;
+    if (m_count < 2 || seconds <= 0.0f) {
+        return;
+    }
+
+    const TrafficCounters& a = first.counters;
+    const TrafficCounters& b = last.counters;
+    TrafficRates rates;
+    rates.valid = true;
+    rates.windowSeconds = seconds;
+    rates.bytesSentPerSecond = perSecond(a.bytesSent, b.bytesSent, seconds);
+    rates.bytesReceivedPerSecond = perSecond(a.bytesReceived, b.bytesReceived, seconds);
+    rates.messagesSentPerSecond = perSecond(a.messagesSent, b.messagesSent, seconds);
+    rates.messagesReceivedPerSecond = perSecond(a.messagesReceived, b.messagesReceived, seconds);
+    rates.partialSendsPerSecond = perSecond(a.partialSends, b.partialSends, seconds);
+    // A state is stale when a newer one replaced it before the game read it
+    const std::uint64_t staleBefore = a.statesReceived > a.statesRead ? a.statesReceived - a.statesRead : 0;
+    const std::uint64_t staleNow = b.statesReceived > b.statesRead ? b.statesReceived - b.statesRead : 0;
+    rates.staleStatesPerSecond = perSecond(staleBefore, staleNow, seconds);
+    const std::uint64_t reads = b.stateReads > a.stateReads ? b.stateReads - a.stateReads : 0;
+    const std::uint64_t emptyReads = b.emptyStateReads > a.emptyStateReads ? b.emptyStateReads - a.emptyStateReads : 0;
+    rates.emptyReadShare = reads > 0 ? static_cast<float>(emptyReads) / static_cast<float>(reads) : 0.0f;
+    rates.sendQueueDrops = b.sendQueueDrops > a.sendQueueDrops ? b.sendQueueDrops - a.sendQueueDrops : 0;
+
+    // The oldest sample's interval ended before the window started
+    for (std::size_t i = 1; i < m_count; ++i) {
+        rates.maxSendQueueDepth = std::max(rates.maxSendQueueDepth, m_samples[(oldest + i) % size].maxQueueDepth);
+    }
+    m_rates = rates;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Running totals of one connection, as counted by NetworkManager and its transport
+struct TrafficCounters {
+    std::uint64_t bytesSent = 0;        // on the wire, framing and transport headers included
+    std::uint64_t bytesReceived = 0;
+    std::uint64_t messagesSent = 0;
+    std::uint64_t messagesReceived = 0;
+    std::uint64_t partialSends = 0;     // sends the socket did not take in one go
+    std::uint64_t statesReceived = 0;   // opponent board states decoded
+    std::uint64_t statesRead = 0;       // ... and picked up by the game, the rest were superseded (stale)
+    std::uint64_t stateReads = 0;       // receiveOpponentState() calls
+    std::uint64_t emptyStateReads = 0;  // ... that found nothing new
+    std::uint64_t sendQueueDrops = 0;   // messages lost because the send queue was full
+};
+
+// Rates over the last WINDOW_US, from counters sampled every SAMPLE_INTERVAL_US
+struct TrafficRates {
+    bool valid = false;  // false until two samples of the current connection exist
+    float windowSeconds = 0.0f;
+    float bytesSentPerSecond = 0.0f;
+    float bytesReceivedPerSecond = 0.0f;
+    float messagesSentPerSecond = 0.0f;
+    float messagesReceivedPerSecond = 0.0f;
+    float partialSendsPerSecond = 0.0f;
+    float staleStatesPerSecond = 0.0f;
+    float emptyReadShare = 0.0f;  // 0..1 of receiveOpponentState() calls
+    int maxSendQueueDepth = 0;    // deepest the send queue got during the window
+    std::uint64_t sendQueueDrops = 0;  // during the window
+};
+
+// Rolling window over TrafficCounters. Counters only grow within a connection; reset() starts over
+// when a new one begins.
+class TrafficMetrics {
+public:
+    static constexpr std::int64_t SAMPLE_INTERVAL_US = 250000;
+    static constexpr std::size_t WINDOW_SAMPLES = 20;  // 5 s
+    static constexpr std::int64_t WINDOW_US = SAMPLE_INTERVAL_US * static_cast<std::int64_t>(WINDOW_SAMPLES);
+
+    TrafficMetrics();
+
+    void reset(const TrafficCounters& counters, std::int64_t nowUs);
+
+    // Send queue depth seen right now, the window keeps the deepest
+    void observeQueueDepth(std::size_t depth);
+
+    // Take a sample if SAMPLE_INTERVAL_US has passed, returns true when rates() changed
+    bool sample(const TrafficCounters& counters, std::int64_t nowUs);
+
+    const TrafficRates& rates() const { return m_rates; }
+
+private:
+    struct Sample {
+        std::int64_t timeUs = 0;
+        TrafficCounters counters;
+        int maxQueueDepth = 0;  // during the interval that ended with this sample
+    };
+
+    // Oldest first once full, m_next is where the next sample goes
+    std::array<Sample, WINDOW_SAMPLES + 1> m_samples;
+    std::size_t m_next;
+    std::size_t m_count;
+    int m_queueDepth;
+    TrafficRates m_rates;
+
+    void computeRates();
+};
@@ -0,0 +1,19 @@
+#include "Transport.h"
+#include "SimulatedTransport.h"
+#include "TcpTransport.h"
+#include "UdpTransport.h"
+#include "../util/Timestamp.h"
+
+std::int64_t Transport::nowUs() const {
+    return nowMicroseconds();
+}
+
+std::unique_ptr<Transport> createTransport(const std::string& name) {
+    if (name == "udp") {
+        return std::make_unique<UdpTransport>();
+    }
+    if (name == "sim") {
+        return std::make_unique<SimulatedTransport>();
+    }
+    return std::make_unique<TcpTransport>();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// How a message has to reach the peer
+enum class Delivery {
+    RELIABLE,    // delivered exactly once, in the order sent
+    UNRELIABLE   // may be lost, duplicated or reordered; only for state where the newest copy wins
+};
+
+// Moves whole protocol messages between the two peers of a LAN match.
+// NetworkManager owns one and does not know whether it runs over TCP or UDP.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    // Wait for a peer on a port (non-blocking, the peer shows up in a later update())
+    virtual bool host(unsigned short port) = 0;
+
+    // Connect to a host, blocking for at most a few seconds
+    virtual bool connect(const std::string& ip, unsigned short port) = 0;
+
+    virtual void disconnect() = 0;
+    virtual bool isConnected() const = 0;
+
+    // Give up on the current peer (its link went silent), a host keeps listening for the next one
+    virtual void dropPeer() = 0;
+
+    // Accept a pending peer and do periodic work (resends, acks, timeouts).
+    // Returns true when a peer connected during this call.
+    virtual bool update() = 0;
+
+    // Whether UNRELIABLE really skips retransmission (otherwise it is delivered like RELIABLE)
+    virtual bool hasUnreliableDelivery() const = 0;
+
+    // Queue one message, false if the connection is gone
+    virtual bool send(const std::uint8_t* data, std::size_t size, Delivery delivery) = 0;
+
+    // Next received message, false when none is waiting
+    virtual bool receive(std::vector<std::uint8_t>& message) = 0;
+
+    // Bytes on the wire including framing and transport headers
+    virtual std::uint64_t bytesSent() const = 0;
+    virtual std::uint64_t bytesReceived() const = 0;
+
+    // Sends the socket did not take in one go (TCP partial writes, datagrams refused by a full buffer)
+    virtual std::uint64_t partialSends() const = 0;
+
+    // Bytes of sent messages still waiting for the socket to take them, retried on every update()
+    virtual std::size_t unsentBytes() const = 0;
+
+    // Microseconds on the clock the link runs on, nowMicroseconds() unless the network is simulated
+    virtual std::int64_t nowUs() const;
+};
+
+// "tcp" or "udp", or "sim" for the in-process SimulatedNetwork::shared(); anything else falls back to tcp
+std::unique_ptr<Transport> createTransport(const std::string& name);
@@ -0,0 +1,228 @@
+#include "UdpTransport.h"
+#include "../util/Timestamp.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+UdpTransport::UdpTransport()
+    : m_isHost(false),
+      m_isBound(false),
+      m_isConnected(false),
+      m_peerPort(0),
+      m_lastReceiveUs(0),
+      m_bytesSent(0),
+      m_bytesReceived(0),
+      m_refusedSends(0) {
+    m_socket.setBlocking(false);
+}
+
+bool UdpTransport::host(unsigned short port) {
+    disconnect();
+
+    if (m_socket.bind(port) != sf::Socket::Status::Done) {
+        std::cerr << "Error: Failed to bind UDP port " << port << std::endl;
+        return false;
+    }
+    m_isBound = true;
+    m_isHost = true;
+    return true;
+}
+
+bool UdpTransport::connect(const std::string& ip, unsigned short port) {
+    disconnect();
+
+    auto ipAddr = sf::IpAddress::resolve(ip);
+    if (!ipAddr.has_value()) {
+        std::cerr << "Error: Failed to resolve IP address: " << ip << std::endl;
+        return false;
+    }
+    if (m_socket.bind(sf::Socket::AnyPort) != sf::Socket::Status::Done) {
+        std::cerr << "Error: Failed to bind a UDP port" << std::endl;
+        return false;
+    }
+    m_isBound = true;
+    m_peerAddress = ipAddr;
+    m_peerPort = port;
+
+    // Blocking handshake like the TCP connect: repeat HELLO until the host answers or we give up
+    const std::int64_t startUs = nowMicroseconds();
+    std::int64_t lastHelloUs = startUs - HELLO_INTERVAL_US;
+    while (nowMicroseconds() - startUs < CONNECT_TIMEOUT_US) {
+        if (nowMicroseconds() - lastHelloUs >= HELLO_INTERVAL_US) {
+            sendControl(ReliableChannel::DatagramKind::HELLO);
+            lastHelloUs = nowMicroseconds();
+        }
+
+        std::size_t received = 0;
+        std::optional<sf::IpAddress> sender;
+        unsigned short senderPort = 0;
+        if (m_socket.receive(m_receiveBuffer.data(), m_receiveBuffer.size(), received, sender, senderPort) ==
+                sf::Socket::Status::Done &&
+            sender == m_peerAddress && senderPort == m_peerPort) {
+            ReliableChannel::DatagramKind kind;
+            if (ReliableChannel::readKind(m_receiveBuffer.data(), received, kind) &&
+                kind == ReliableChannel::DatagramKind::WELCOME) {
+                m_bytesReceived = received;
+                startSession(*sender, senderPort);
+                return true;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    std::cerr << "Error: Failed to connect to " << ip << ":" << port << " (no answer over UDP)" << std::endl;
+    disconnect();
+    return false;
+}
+
+void UdpTransport::disconnect() {
+    if (m_isBound) {
+        m_socket.unbind();
+    }
+    m_isBound = false;
+    m_isHost = false;
+    m_isConnected = false;
+    m_peerAddress.reset();
+    m_peerPort = 0;
+    m_channel.reset();
+}
+
+void UdpTransport::dropPeer() {
+    if (!m_isHost) {
+        disconnect();
+        return;
+    }
+    // The port stays bound, the next HELLO starts a new session
+    m_isConnected = false;
+}
+
+void UdpTransport::startSession(const sf::IpAddress& address, unsigned short port) {
+    m_peerAddress = address;
+    m_peerPort = port;
+    m_isConnected = true;
+    m_lastReceiveUs = nowMicroseconds();
+    m_channel.reset();
+    m_bytesSent = 0;
+    m_bytesReceived = 0;
+    m_refusedSends = 0;
+}
+
+bool UdpTransport::update() {
+    if (!m_isBound) {
+        return false;
+    }
+
+    const bool accepted = receiveDatagrams();
+
+    if (m_isConnected && nowMicroseconds() - m_lastReceiveUs > TIMEOUT_US) {
+        std::cerr << "Error: Connection lost (no UDP traffic from the peer)" << std::endl;
+        m_isConnected = false;
+        // A host keeps its port and accepts the next HELLO
+        if (!m_isHost) {
+            disconnect();
+        }
+        return false;
+    }
+
+    sendDue();
+    return accepted;
+}
+
+bool UdpTransport::receiveDatagrams() {
+    bool accepted = false;
+
+    while (true) {
+        std::size_t received = 0;
+        std::optional<sf::IpAddress> sender;
+        unsigned short senderPort = 0;
+        auto status = m_socket.receive(m_receiveBuffer.data(), m_receiveBuffer.size(), received, sender, senderPort);
+        if (status != sf::Socket::Status::Done || !sender.has_value()) {
+            // NotReady means no more datagrams (non-blocking)
+            break;
+        }
+
+        ReliableChannel::DatagramKind kind;
+        if (!ReliableChannel::readKind(m_receiveBuffer.data(), received, kind)) {
+            continue;
+        }
+
+        // A waiting host takes the first client that says HELLO
+        if (m_isHost && !m_isConnected && kind == ReliableChannel::DatagramKind::HELLO) {
+            startSession(*sender, senderPort);
+            accepted = true;
+        }
+
+        if (!m_isConnected || sender != m_peerAddress || senderPort != m_peerPort) {
+            continue;
+        }
+
+        m_bytesReceived += received;
+        m_lastReceiveUs = nowMicroseconds();
+
+        if (kind == ReliableChannel::DatagramKind::HELLO) {
+            // Our WELCOME may have been lost, the client keeps asking until it gets one
+            sendControl(ReliableChannel::DatagramKind::WELCOME);
+        } else {
+            m_channel.onDatagram(m_receiveBuffer.data(), received, m_lastReceiveUs);
+        }
+    }
+
+    return accepted;
+}
+
+// Resends, window-delayed reliable messages, acks and keepalives
+void UdpTransport::sendDue() {
+    if (!m_isConnected) {
+        return;
+    }
+    const std::int64_t nowUs = nowMicroseconds();
+    while (m_channel.nextDatagram(nowUs, m_datagram)) {
+        if (!sendDatagram(m_datagram)) {
+            break;
+        }
+    }
+}
+
+bool UdpTransport::sendDatagram(const std::vector<std::uint8_t>& datagram) {
+    auto status = m_socket.send(datagram.data(), datagram.size(), *m_peerAddress, m_peerPort);
+    if (status != sf::Socket::Status::Done) {
+        // Treated like a lost datagram, RELIABLE messages are resent anyway
+        ++m_refusedSends;
+        return false;
+    }
+    m_bytesSent += datagram.size();
+    return true;
+}
+
+void UdpTransport::sendControl(ReliableChannel::DatagramKind kind) {
+    ReliableChannel::writeHeader(m_datagram, kind, 0, 0, 0);
+    sendDatagram(m_datagram);
+}
+
+bool UdpTransport::send(const std::uint8_t* data, std::size_t size, Delivery delivery) {
+    if (!m_isConnected) {
+        return false;
+    }
+
+    if (size > ReliableChannel::MAX_DATAGRAM_SIZE - ReliableChannel::HEADER_SIZE) {
+        std::cerr << "Error: Message of " << size << " bytes does not fit in a datagram" << std::endl;
+        return false;
+    }
+
+    // A full reliable window keeps the message queued in the channel, it goes out from update()
+    if (m_channel.writeMessage(data, size, delivery, nowMicroseconds(), m_datagram)) {
+        sendDatagram(m_datagram);
+    }
+    return true;
+}
+
+bool UdpTransport::receive(std::vector<std::uint8_t>& message) {
+    if (m_channel.receive(message)) {
+        return true;
+    }
+    if (!m_isConnected) {
+        return false;
+    }
+    receiveDatagrams();
+    return m_channel.receive(message);
+}
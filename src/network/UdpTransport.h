@@ -0,0 +1,60 @@
+#pragma once
+#include "ReliableChannel.h"
+#include "Transport.h"
+#include <SFML/Network.hpp>
+#include <array>
+#include <optional>
+
+// One datagram per message over a non-blocking UDP socket, with ReliableChannel providing acks and resends
+// for RELIABLE messages. UNRELIABLE messages are never held back by a lost datagram.
+// The client joins with HELLO datagrams until the host answers WELCOME; the peer is considered gone after
+// TIMEOUT_US without any datagram (both sides send keepalives while idle).
+class UdpTransport : public Transport {
+public:
+    static constexpr std::int64_t TIMEOUT_US = 5000000;
+
+    UdpTransport();
+
+    bool host(unsigned short port) override;
+    bool connect(const std::string& ip, unsigned short port) override;
+    void disconnect() override;
+    void dropPeer() override;
+    bool isConnected() const override { return m_isConnected; }
+    bool update() override;
+    bool hasUnreliableDelivery() const override { return true; }
+    bool send(const std::uint8_t* data, std::size_t size, Delivery delivery) override;
+    bool receive(std::vector<std::uint8_t>& message) override;
+    std::uint64_t bytesSent() const override { return m_bytesSent; }
+    std::uint64_t bytesReceived() const override { return m_bytesReceived; }
+    std::uint64_t partialSends() const override { return m_refusedSends; }
+    std::size_t unsentBytes() const override { return 0; }  // a refused datagram counts as lost
+
+    std::uint64_t resendCount() const { return m_channel.resendCount(); }
+
+private:
+    static constexpr std::int64_t HELLO_INTERVAL_US = 200000;
+    static constexpr std::int64_t CONNECT_TIMEOUT_US = 5000000;
+
+    sf::UdpSocket m_socket;
+    bool m_isHost;
+    bool m_isBound;
+    bool m_isConnected;
+    std::optional<sf::IpAddress> m_peerAddress;
+    unsigned short m_peerPort;
+    std::int64_t m_lastReceiveUs;
+
+    ReliableChannel m_channel;
+    std::vector<std::uint8_t> m_datagram;
+    std::array<std::uint8_t, ReliableChannel::MAX_DATAGRAM_SIZE> m_receiveBuffer;
+
+    std::uint64_t m_bytesSent;
+    std::uint64_t m_bytesReceived;
+    std::uint64_t m_refusedSends;
+
+    // Returns true when a new peer was accepted
+    bool receiveDatagrams();
+    void sendDue();
+    bool sendDatagram(const std::vector<std::uint8_t>& datagram);
+    void sendControl(ReliableChannel::DatagramKind kind);
+    void startSession(const sf::IpAddress& address, unsigned short port);
+};
@@ -0,0 +1,25 @@
+#include "CorpusFormat.h"
+
+namespace Corpus {
+
+void packBoard(const Board& board, PieceRecord& record) {
+    for (int y = 0; y < Board::Height; ++y) {
+        std::uint16_t row = 0;
+        for (int x = 0; x < Board::Width; ++x) {
+            if (!board.isEmpty(x, y)) {
+                row |= static_cast<std::uint16_t>(1u << x);
+            }
+        }
+        record.rows[y] = row;
+    }
+}
+
+void unpackBoard(const PieceRecord& record, Board& board, int fillColor) {
+    for (int y = 0; y < Board::Height; ++y) {
+        for (int x = 0; x < Board::Width; ++x) {
+            board.setCell(x, y, isFilled(record, x, y) ? fillColor : 0);
+        }
+    }
+}
+
+} // namespace Corpus
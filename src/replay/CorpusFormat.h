@@ -0,0 +1,87 @@
+#pragma once
+#include "ReplayFormat.h"
+#include "../model/Board.h"
+#include <cstddef>
+#include <cstdint>
+
+// Corpus files: many AI games in one file, for analysis tools and weight tuning. Unlike a replay, a corpus stores
+// the board before every piece, so nothing has to be simulated to read it, and every record has a fixed size, so
+// the file is mapped and its structs are used in place (CorpusReader).
+//
+//   FileHeader    at 0
+//   PieceRecord   x pieceCount at piecesOffset, the pieces of every game one after the other, in game order
+//   GameEntry     x gameCount at indexOffset (8 byte aligned), one per game, pointing at its first piece
+//
+// Everything is stored in the byte order of the machine that wrote it, checked with FileHeader::byteOrder.
+// The writer fills the header in last, so a corpus cut short by a crash has indexOffset 0 and is refused.
+namespace Corpus {
+
+constexpr std::uint8_t MAGIC[4] = {'T', 'C', 'R', 'P'};
+constexpr std::uint32_t VERSION = 1;
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+struct FileHeader {
+    std::uint8_t magic[4];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t pieceRecordSize;
+    std::uint32_t gameEntrySize;
+    std::uint32_t reserved;
+    std::uint64_t gameCount;
+    std::uint64_t pieceCount;
+    std::uint64_t piecesOffset;
+    std::uint64_t indexOffset;
+    std::uint64_t createdAt;  // unix seconds
+};
+
+// One piece of a game: the settled board it was dropped on, the piece, and what the AI did with it
+struct PieceRecord {
+    std::uint16_t rows[Board::Height];  // bit x set when cell (x, row) is filled, top row first
+    std::uint8_t piece;                 // TetrominoType
+    std::uint8_t nextPiece;
+    std::uint8_t rotation;              // clockwise turns from the spawn rotation
+    std::int8_t column;                 // pieceX the piece was dropped at
+    std::uint8_t linesCleared;          // by this piece
+    std::uint8_t reserved;
+    std::uint32_t scoreGained;          // by this piece
+};
+
+struct GameEntry {
+    std::uint64_t firstPiece;  // index of its first PieceRecord
+    std::uint32_t pieceCount;
+    std::uint32_t seed;
+    std::uint32_t score;
+    std::uint32_t linesCleared;
+    std::uint8_t mode;         // Replay::Mode
+    std::uint8_t gameOver;     // 0 when stopped at the piece limit
+    std::uint8_t reserved[6];
+};
+
+static_assert(sizeof(FileHeader) == 64, "corpus header layout changed");
+static_assert(sizeof(PieceRecord) == 52, "corpus piece layout changed");
+static_assert(sizeof(GameEntry) == 32, "corpus index layout changed");
+
+// Read only view of consecutive records of a mapped corpus
+template <typename T>
+class Range {
+public:
+    Range() : m_data(nullptr), m_size(0) {}
+    Range(const T* data, std::size_t size) : m_data(data), m_size(size) {}
+
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const T& operator[](std::size_t i) const { return m_data[i]; }
+
+private:
+    const T* m_data;
+    std::size_t m_size;
+};
+
+// Settled board of a record and back (cells hold a block's color id, records only whether they are filled)
+void packBoard(const Board& board, PieceRecord& record);
+void unpackBoard(const PieceRecord& record, Board& board, int fillColor = 1);
+inline bool isFilled(const PieceRecord& record, int x, int y) { return (record.rows[y] >> x) & 1u; }
+
+} // namespace Corpus
@@ -0,0 +1,136 @@
+#include "CorpusReader.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TETRIS_CORPUS_MMAP 1
+#endif
+
+CorpusReader::CorpusReader() : m_data(nullptr), m_size(0), m_mapped(false), m_header(nullptr) {}
+
+CorpusReader::~CorpusReader() {
+    close();
+}
+
+bool CorpusReader::open(const std::string& path) {
+    close();
+    if (!load(path)) {
+        return false;
+    }
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CorpusReader::close() {
+#ifdef TETRIS_CORPUS_MMAP
+    if (m_mapped) {
+        munmap(const_cast<std::uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_copy.clear();
+    m_copy.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_header = nullptr;
+    m_games = Corpus::Range<Corpus::GameEntry>();
+    m_pieces = Corpus::Range<Corpus::PieceRecord>();
+}
+
+bool CorpusReader::load(const std::string& path) {
+#ifdef TETRIS_CORPUS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open corpus file " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(Corpus::FileHeader))) {
+        ::close(fd);
+        std::cerr << path << " is not a corpus file" << std::endl;
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // the mapping keeps the file
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Could not map corpus file " << path << std::endl;
+        return false;
+    }
+    // Analysis passes read front to back: let the kernel read ahead aggressively
+    madvise(mapping, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+    m_data = static_cast<const std::uint8_t*>(mapping);
+    m_size = static_cast<std::size_t>(info.st_size);
+    m_mapped = true;
+    return true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not open corpus file " << path << std::endl;
+        return false;
+    }
+    m_copy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (m_copy.size() < sizeof(Corpus::FileHeader)) {
+        std::cerr << path << " is not a corpus file" << std::endl;
+        return false;
+    }
+    m_data = m_copy.data();
+    m_size = m_copy.size();
+    return true;
+#endif
+}
+
+bool CorpusReader::validate(const std::string& path) {
+    m_header = reinterpret_cast<const Corpus::FileHeader*>(m_data);
+    const Corpus::FileHeader& header = *m_header;
+    if (!std::equal(std::begin(Corpus::MAGIC), std::end(Corpus::MAGIC), header.magic)) {
+        std::cerr << path << " is not a corpus file" << std::endl;
+        return false;
+    }
+    if (header.byteOrder != Corpus::BYTE_ORDER_MARK || header.version != Corpus::VERSION ||
+        header.pieceRecordSize != sizeof(Corpus::PieceRecord) || header.gameEntrySize != sizeof(Corpus::GameEntry)) {
+        std::cerr << "Corpus " << path << " has version " << header.version
+                  << " or a layout this build does not read" << std::endl;
+        return false;
+    }
+    if (header.indexOffset == 0) {
+        std::cerr << "Corpus " << path << " was not finished" << std::endl;
+        return false;
+    }
+
+    // Sections in order, inside the file and aligned for in place access
+    const std::uint64_t size = m_size;
+    const bool piecesFit = header.piecesOffset >= sizeof(Corpus::FileHeader) &&
+                           header.piecesOffset % alignof(Corpus::PieceRecord) == 0 && header.piecesOffset <= size &&
+                           header.pieceCount <= (size - header.piecesOffset) / sizeof(Corpus::PieceRecord);
+    const bool indexFits = piecesFit &&
+                           header.indexOffset >= header.piecesOffset + header.pieceCount * sizeof(Corpus::PieceRecord) &&
+                           header.indexOffset % alignof(Corpus::GameEntry) == 0 && header.indexOffset <= size &&
+                           header.gameCount <= (size - header.indexOffset) / sizeof(Corpus::GameEntry);
+    if (!indexFits) {
+        std::cerr << "Corpus " << path << " is damaged (sections out of range)" << std::endl;
+        return false;
+    }
+    m_pieces = Corpus::Range<Corpus::PieceRecord>(
+        reinterpret_cast<const Corpus::PieceRecord*>(m_data + header.piecesOffset),
+        static_cast<std::size_t>(header.pieceCount));
+    m_games = Corpus::Range<Corpus::GameEntry>(reinterpret_cast<const Corpus::GameEntry*>(m_data + header.indexOffset),
+                                               static_cast<std::size_t>(header.gameCount));
+
+    // One pass over the index so that pieces(game) never points outside the file
+    for (const Corpus::GameEntry& game : m_games) {
+        if (game.firstPiece > header.pieceCount || game.pieceCount > header.pieceCount - game.firstPiece) {
+            std::cerr << "Corpus " << path << " is damaged (game with pieces out of range)" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
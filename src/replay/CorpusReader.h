@@ -0,0 +1,46 @@
+#pragma once
+#include "CorpusFormat.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Maps a corpus file read only and hands out its records in place: iterating over games and pieces copies
+// nothing and parses nothing, the page cache is the only buffer. Where mmap is not available the file is read
+// into memory instead, with the same interface.
+class CorpusReader {
+public:
+    CorpusReader();
+    ~CorpusReader();
+
+    CorpusReader(const CorpusReader&) = delete;
+    CorpusReader& operator=(const CorpusReader&) = delete;
+
+    // Map the file and check its header and index, false (and an error on std::cerr) if it is not a finished
+    // corpus of this build's layout
+    bool open(const std::string& path);
+    void close();
+
+    // Valid after a successful open()
+    const Corpus::FileHeader& header() const { return *m_header; }
+    std::size_t fileSize() const { return m_size; }
+
+    Corpus::Range<Corpus::GameEntry> games() const { return m_games; }
+    // Every piece of every game, in file order
+    Corpus::Range<Corpus::PieceRecord> pieces() const { return m_pieces; }
+    // The pieces of one game
+    Corpus::Range<Corpus::PieceRecord> pieces(const Corpus::GameEntry& game) const {
+        return Corpus::Range<Corpus::PieceRecord>(m_pieces.begin() + game.firstPiece, game.pieceCount);
+    }
+
+private:
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+    bool m_mapped;                      // m_data is a mapping, otherwise it points into m_copy
+    std::vector<std::uint8_t> m_copy;
+    const Corpus::FileHeader* m_header;
+    Corpus::Range<Corpus::GameEntry> m_games;
+    Corpus::Range<Corpus::PieceRecord> m_pieces;
+
+    bool load(const std::string& path);
+    bool validate(const std::string& path);
+};
@@ -0,0 +1,75 @@
+#include "CorpusWriter.h"
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+
+CorpusWriter::CorpusWriter() : m_pieceCount(0) {}
+
+CorpusWriter::~CorpusWriter() {
+    if (isOpen()) {
+        std::cerr << "Corpus " << m_path << " was not finished and cannot be read" << std::endl;
+    }
+}
+
+bool CorpusWriter::open(const std::string& path) {
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cerr << "Could not create corpus file " << path << std::endl;
+        return false;
+    }
+    m_path = path;
+    m_index.clear();
+    m_pieceCount = 0;
+
+    // Zeroed header for now (indexOffset 0 marks an unfinished corpus), finish() writes the real one
+    const Corpus::FileHeader header{};
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return m_file.good();
+}
+
+void CorpusWriter::addGame(Corpus::GameEntry game, const std::vector<Corpus::PieceRecord>& pieces) {
+    if (!isOpen()) {
+        return;
+    }
+    game.firstPiece = m_pieceCount;
+    game.pieceCount = static_cast<std::uint32_t>(pieces.size());
+    m_file.write(reinterpret_cast<const char*>(pieces.data()),
+                 static_cast<std::streamsize>(pieces.size() * sizeof(Corpus::PieceRecord)));
+    m_index.push_back(game);
+    m_pieceCount += pieces.size();
+}
+
+bool CorpusWriter::finish() {
+    if (!isOpen()) {
+        return false;
+    }
+    Corpus::FileHeader header{};
+    std::copy(std::begin(Corpus::MAGIC), std::end(Corpus::MAGIC), header.magic);
+    header.version = Corpus::VERSION;
+    header.byteOrder = Corpus::BYTE_ORDER_MARK;
+    header.pieceRecordSize = sizeof(Corpus::PieceRecord);
+    header.gameEntrySize = sizeof(Corpus::GameEntry);
+    header.gameCount = m_index.size();
+    header.pieceCount = m_pieceCount;
+    header.piecesOffset = sizeof(Corpus::FileHeader);
+    header.createdAt = static_cast<std::uint64_t>(std::time(nullptr));
+
+    // The index holds 64 bit fields, align it for the reader's in place access
+    std::uint64_t end = header.piecesOffset + m_pieceCount * sizeof(Corpus::PieceRecord);
+    const std::uint64_t padding = (8 - end % 8) % 8;
+    const char zeros[8] = {};
+    m_file.write(zeros, static_cast<std::streamsize>(padding));
+    header.indexOffset = end + padding;
+    m_file.write(reinterpret_cast<const char*>(m_index.data()),
+                 static_cast<std::streamsize>(m_index.size() * sizeof(Corpus::GameEntry)));
+
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.close();
+    if (m_file.fail()) {
+        std::cerr << "Could not write corpus file " << m_path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "CorpusFormat.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Writes a corpus file game by game. Pieces go straight to the file, the index stays in memory (32 bytes a game)
+// until finish() writes it and the header. A corpus that was not finished cannot be opened.
+class CorpusWriter {
+public:
+    CorpusWriter();
+    ~CorpusWriter();
+
+    CorpusWriter(const CorpusWriter&) = delete;
+    CorpusWriter& operator=(const CorpusWriter&) = delete;
+
+    // Create the file, false (and an error on std::cerr) if it cannot be created
+    bool open(const std::string& path);
+    bool isOpen() const { return m_file.is_open(); }
+
+    // Append one game; firstPiece and pieceCount of the entry are filled in here
+    void addGame(Corpus::GameEntry game, const std::vector<Corpus::PieceRecord>& pieces);
+
+    // Write the index and the header, then close. False if any write failed.
+    bool finish();
+
+    std::uint64_t gameCount() const { return m_index.size(); }
+    std::uint64_t pieceCount() const { return m_pieceCount; }
+
+private:
+    std::ofstream m_file;
+    std::string m_path;
+    std::vector<Corpus::GameEntry> m_index;
+    std::uint64_t m_pieceCount;
+};
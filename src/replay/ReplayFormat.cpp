@@ -0,0 +1,275 @@
+#include "ReplayFormat.h"
+#include "../model/GameState.h"
+#include <cstring>
+
+namespace Replay {
+
+namespace {
+
+constexpr std::uint32_t FNV_OFFSET = 2166136261u;
+constexpr std::uint32_t FNV_PRIME = 16777619u;
+
+void mix(std::uint32_t& hash, std::int32_t value) {
+    const std::uint32_t bits = static_cast<std::uint32_t>(value);
+    for (int shift = 0; shift < 32; shift += 8) {
+        hash ^= (bits >> shift) & 0xFF;
+        hash *= FNV_PRIME;
+    }
+}
+
+// Board cells are -1 (line being cleared) to 8 (garbage), stored as cell + 1
+constexpr int CELL_MIN = -1;
+constexpr int CELL_MAX = Board::GarbageCell;
+
+void writeSigned(std::vector<std::uint8_t>& out, std::int32_t value) {
+    writeVarint(out, (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31));
+}
+
+void writeUint32(std::vector<std::uint8_t>& out, std::uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<std::uint8_t>(value >> shift));
+    }
+}
+
+void writeFloat(std::vector<std::uint8_t>& out, float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    writeUint32(out, bits);
+}
+
+// Bounds checked cursor over a keyframe payload
+class SnapshotReader {
+public:
+    SnapshotReader(const std::uint8_t* data, std::size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+    bool readByte(std::uint8_t& value) {
+        if (m_pos >= m_size) {
+            return false;
+        }
+        value = m_data[m_pos++];
+        return true;
+    }
+
+    bool readVarint(std::uint32_t& value) { return Replay::readVarint(m_data, m_size, m_pos, value); }
+
+    bool readSigned(std::int32_t& value) {
+        std::uint32_t bits;
+        if (!readVarint(bits)) {
+            return false;
+        }
+        value = static_cast<std::int32_t>(bits >> 1) ^ -static_cast<std::int32_t>(bits & 1);
+        return true;
+    }
+
+    bool readInt(int& value, int min, int max) {
+        std::int32_t read;
+        if (!readSigned(read) || read < min || read > max) {
+            return false;
+        }
+        value = read;
+        return true;
+    }
+
+    bool readBool(bool& value) {
+        std::uint8_t byte;
+        if (!readByte(byte) || byte > 1) {
+            return false;
+        }
+        value = byte == 1;
+        return true;
+    }
+
+    bool readUint32(std::uint32_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            std::uint8_t byte;
+            if (!readByte(byte)) {
+                return false;
+            }
+            value |= static_cast<std::uint32_t>(byte) << shift;
+        }
+        return true;
+    }
+
+    bool readFloat(float& value) {
+        std::uint32_t bits;
+        if (!readUint32(bits)) {
+            return false;
+        }
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+
+    bool readPiece(Tetromino& piece) {
+        std::uint8_t packed;
+        if (!readByte(packed) || (packed & 0x0F) > static_cast<int>(TetrominoType::Z) || (packed >> 4) > 3) {
+            return false;
+        }
+        piece = Tetromino(static_cast<TetrominoType>(packed & 0x0F));
+        piece.setRotationState(static_cast<RotationState>(packed >> 4));
+        return true;
+    }
+
+    bool atEnd() const { return m_pos == m_size; }
+
+private:
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+    std::size_t m_pos;
+};
+
+void writePiece(std::vector<std::uint8_t>& out, const Tetromino& piece) {
+    out.push_back(static_cast<std::uint8_t>(static_cast<int>(piece.getType()) |
+                                            static_cast<int>(piece.getRotationState()) << 4));
+}
+
+} // namespace
+
+const char* modeName(Mode mode) {
+    switch (mode) {
+        case Mode::LEVEL:
+            return "level";
+        case Mode::SIMPLE_AI:
+            return "simple-ai";
+        case Mode::ADVANCED_AI:
+            return "advanced-ai";
+    }
+    return "unknown";
+}
+
+bool parseMode(const std::string& name, Mode& mode) {
+    for (std::uint32_t i = 0; i < MODE_COUNT; ++i) {
+        if (name == modeName(static_cast<Mode>(i))) {
+            mode = static_cast<Mode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeVarint(std::vector<std::uint8_t>& out, std::uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+bool readVarint(const std::uint8_t* data, std::size_t size, std::size_t& pos, std::uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < size; shift += 7) {
+        const std::uint8_t byte = data[pos++];
+        value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeSnapshot(std::vector<std::uint8_t>& out, const GameStateSnapshot& snapshot) {
+    for (int y = 0; y < Board::Height; ++y) {
+        for (int x = 0; x < Board::Width; x += 2) {
+            const int low = snapshot.board.getCell(x, y) - CELL_MIN;
+            const int high = snapshot.board.getCell(x + 1, y) - CELL_MIN;
+            out.push_back(static_cast<std::uint8_t>(low | high << 4));
+        }
+    }
+    writePiece(out, snapshot.currentPiece);
+    writePiece(out, snapshot.nextPiece);
+    for (TetrominoType type : snapshot.pieceBag) {
+        out.push_back(static_cast<std::uint8_t>(type));
+    }
+    writeSigned(out, snapshot.bagIndex);
+    writeSigned(out, snapshot.pieceCount);
+    writeUint32(out, snapshot.randomState);
+    writeSigned(out, snapshot.x);
+    writeSigned(out, snapshot.y);
+    writeFloat(out, snapshot.fallTimer);
+    out.push_back(snapshot.isClearingLines ? 1 : 0);
+    writeFloat(out, snapshot.clearAnimationTimer);
+    writeSigned(out, snapshot.linesToClear);
+    out.push_back(snapshot.gameOver ? 1 : 0);
+    writeSigned(out, snapshot.score);
+    writeSigned(out, snapshot.mode.level);
+    writeSigned(out, snapshot.mode.levelLines);
+    writeSigned(out, snapshot.mode.totalLinesCleared);
+    writeFloat(out, snapshot.mode.timer);
+    writeSigned(out, snapshot.incomingGarbageCount);
+    for (int i = 0; i < snapshot.incomingGarbageCount; ++i) {
+        writeSigned(out, snapshot.incomingGarbage[i].lines);
+        writeFloat(out, snapshot.incomingGarbage[i].delay);
+    }
+    writeSigned(out, snapshot.outgoingGarbage);
+    writeUint32(out, snapshot.garbageRandomState);
+}
+
+bool readSnapshot(const std::uint8_t* data, std::size_t size, GameStateSnapshot& snapshot) {
+    SnapshotReader reader(data, size);
+    snapshot.board.clear();
+    for (int y = 0; y < Board::Height; ++y) {
+        for (int x = 0; x < Board::Width; x += 2) {
+            std::uint8_t packed;
+            if (!reader.readByte(packed)) {
+                return false;
+            }
+            const int low = packed & 0x0F;
+            const int high = packed >> 4;
+            if (low > CELL_MAX - CELL_MIN || high > CELL_MAX - CELL_MIN) {
+                return false;
+            }
+            snapshot.board.setCell(x, y, low + CELL_MIN);
+            snapshot.board.setCell(x + 1, y, high + CELL_MIN);
+        }
+    }
+    if (!reader.readPiece(snapshot.currentPiece) || !reader.readPiece(snapshot.nextPiece)) {
+        return false;
+    }
+    for (TetrominoType& type : snapshot.pieceBag) {
+        std::uint8_t value;
+        if (!reader.readByte(value) || value > static_cast<int>(TetrominoType::Z)) {
+            return false;
+        }
+        type = static_cast<TetrominoType>(value);
+    }
+    const int bagSize = static_cast<int>(snapshot.pieceBag.size());
+    const int maxValue = 1 << 30;
+    if (!reader.readInt(snapshot.bagIndex, 0, bagSize) || !reader.readInt(snapshot.pieceCount, 0, maxValue) ||
+        !reader.readUint32(snapshot.randomState) || !reader.readInt(snapshot.x, -Board::Width, 2 * Board::Width) ||
+        !reader.readInt(snapshot.y, -Board::Height, 2 * Board::Height) || !reader.readFloat(snapshot.fallTimer) ||
+        !reader.readBool(snapshot.isClearingLines) || !reader.readFloat(snapshot.clearAnimationTimer) ||
+        !reader.readInt(snapshot.linesToClear, 0, Board::Height) || !reader.readBool(snapshot.gameOver) ||
+        !reader.readInt(snapshot.score, 0, maxValue) || !reader.readInt(snapshot.mode.level, 0, maxValue) ||
+        !reader.readInt(snapshot.mode.levelLines, 0, maxValue) ||
+        !reader.readInt(snapshot.mode.totalLinesCleared, 0, maxValue) || !reader.readFloat(snapshot.mode.timer) ||
+        !reader.readInt(snapshot.incomingGarbageCount, 0, MAX_PENDING_GARBAGE)) {
+        return false;
+    }
+    for (int i = 0; i < snapshot.incomingGarbageCount; ++i) {
+        if (!reader.readInt(snapshot.incomingGarbage[i].lines, 0, Board::Height) ||
+            !reader.readFloat(snapshot.incomingGarbage[i].delay)) {
+            return false;
+        }
+    }
+    return reader.readInt(snapshot.outgoingGarbage, 0, maxValue) && reader.readUint32(snapshot.garbageRandomState) &&
+           reader.atEnd();
+}
+
+std::uint32_t checksum(const GameState& state) {
+    std::uint32_t hash = FNV_OFFSET;
+    for (int y = 0; y < Board::Height; ++y) {
+        for (int x = 0; x < Board::Width; ++x) {
+            mix(hash, state.board().getCell(x, y));
+        }
+    }
+    mix(hash, static_cast<std::int32_t>(state.currentPiece().getType()));
+    mix(hash, static_cast<std::int32_t>(state.currentPiece().getRotationState()));
+    mix(hash, static_cast<std::int32_t>(state.nextPiece().getType()));
+    mix(hash, state.pieceX());
+    mix(hash, state.pieceY());
+    mix(hash, state.score());
+    mix(hash, state.isGameOver() ? 1 : 0);
+    return hash;
+}
+
+} // namespace Replay
@@ -0,0 +1,81 @@
+#pragma once
+#include "../model/InputAction.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GameState;
+struct GameStateSnapshot;
+
+// Replay files: a header, then one record per input and the odd keyframe, then an end record.
+//
+//   header:  "TRPL" magic, then varints: version, mode, seed, tick rate (Hz), start time (unix seconds)
+//   record:  varint (ticks since the previous record << 3 | code)
+//            code 0-5 is an InputAction, applied after that many simulation steps of the game
+//            code 6 is a keyframe: varint size, then the GameState at the start of that tick (writeSnapshot)
+//            code 7 ends the game, followed by varints: score, checksum of the final state
+//
+// A tick is one fixed simulation step (1 / tick rate seconds). Inputs of one tick keep their order, AI moves
+// are logged as the actions they are made of, so a replay does not depend on the AI that played it.
+// A file cut short (crash) still plays up to its last complete record.
+//
+// Keyframes come every KEYFRAME_PIECES pieces and at least every KEYFRAME_SECONDS, so seeking restores the
+// nearest one and never simulates more than KEYFRAME_SECONDS of play. They cost about 150 bytes each.
+// Version 1 files have no keyframes and still play, seeking in them simulates from the start.
+namespace Replay {
+
+constexpr std::uint8_t MAGIC[4] = {'T', 'R', 'P', 'L'};
+constexpr std::uint32_t VERSION = 2;
+
+constexpr std::uint32_t CODE_BITS = 3;
+constexpr std::uint32_t CODE_KEYFRAME = 6;
+constexpr std::uint32_t CODE_END = 7;
+
+constexpr int KEYFRAME_PIECES = 50;
+constexpr std::uint32_t KEYFRAME_SECONDS = 30;
+
+// Simulation rate of the headless tools (the game's default simulation_rate)
+constexpr std::uint32_t TICK_RATE = 120;
+
+// Which solo game was recorded
+enum class Mode : std::uint8_t {
+    LEVEL = 0,
+    SIMPLE_AI = 1,
+    ADVANCED_AI = 2
+};
+
+constexpr std::uint32_t MODE_COUNT = 3;
+
+struct Header {
+    std::uint32_t version = VERSION;
+    Mode mode = Mode::LEVEL;
+    std::uint32_t seed = 0;
+    std::uint32_t tickRate = TICK_RATE;
+    std::uint32_t startTime = 0;
+};
+
+// One logged input: applied once `tick` simulation steps have run
+struct Input {
+    std::uint32_t tick = 0;
+    InputAction action = InputAction::MOVE_LEFT;
+};
+
+const char* modeName(Mode mode);
+// The mode modeName() gives name, false if there is none
+bool parseMode(const std::string& name, Mode& mode);
+
+// Unsigned LEB128
+void writeVarint(std::vector<std::uint8_t>& out, std::uint32_t value);
+// Reads at pos and moves past it, false if the data ends first or the value is too long
+bool readVarint(const std::uint8_t* data, std::size_t size, std::size_t& pos, std::uint32_t& value);
+
+// Keyframe payload: every GameStateSnapshot field, floats bit for bit, the board at 4 bits per cell
+void writeSnapshot(std::vector<std::uint8_t>& out, const GameStateSnapshot& snapshot);
+// False if the payload is short or holds values a GameState cannot have
+bool readSnapshot(const std::uint8_t* data, std::size_t size, GameStateSnapshot& snapshot);
+
+// FNV-1a over what the player sees (board, piece, score, game over), stored in the end record
+std::uint32_t checksum(const GameState& state);
+
+} // namespace Replay
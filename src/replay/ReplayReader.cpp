@@ -0,0 +1,216 @@
+#include "ReplayReader.h"
+#include "../model/AIMode.h"
+#include "../model/GameState.h"
+#include "../model/LevelBasedMode.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+
+ReplayReader::ReplayReader()
+    : m_recordsStart(0),
+      m_length(0),
+      m_damaged(false),
+      m_hasEnd(false),
+      m_endScore(0),
+      m_endChecksum(0),
+      m_pos(0),
+      m_recordTick(0),
+      m_hasNext(false),
+      m_tick(0) {}
+
+bool ReplayReader::open(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not open replay file " << path << std::endl;
+        return false;
+    }
+    m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    m_header = Replay::Header();
+    m_keyframes.clear();
+    m_length = 0;
+    m_damaged = false;
+    m_hasEnd = false;
+
+    const std::size_t size = m_data.size();
+    std::size_t pos = sizeof(Replay::MAGIC);
+    std::uint32_t mode = 0;
+    if (size < pos || !std::equal(std::begin(Replay::MAGIC), std::end(Replay::MAGIC), m_data.begin()) ||
+        !Replay::readVarint(m_data.data(), size, pos, m_header.version)) {
+        std::cerr << path << " is not a replay file" << std::endl;
+        return false;
+    }
+    if (m_header.version == 0 || m_header.version > Replay::VERSION) {
+        std::cerr << "Replay " << path << " has version " << m_header.version << ", this build plays up to version "
+                  << Replay::VERSION << std::endl;
+        return false;
+    }
+    if (!Replay::readVarint(m_data.data(), size, pos, mode) || mode >= Replay::MODE_COUNT ||
+        !Replay::readVarint(m_data.data(), size, pos, m_header.seed) ||
+        !Replay::readVarint(m_data.data(), size, pos, m_header.tickRate) || m_header.tickRate == 0 ||
+        !Replay::readVarint(m_data.data(), size, pos, m_header.startTime)) {
+        std::cerr << "Replay " << path << " has a damaged header" << std::endl;
+        return false;
+    }
+    m_header.mode = static_cast<Replay::Mode>(mode);
+    m_recordsStart = pos;
+
+    // One pass over the log for its length, keyframes and end record (a long game is a few tens of KB)
+    std::uint32_t tick = 0;
+    Record record;
+    while (readRecord(pos, tick, record)) {
+        m_length = record.tick;
+        if (record.code == Replay::CODE_KEYFRAME) {
+            m_keyframes.push_back(Keyframe{record.tick, record.payload, record.payloadSize, pos});
+        } else if (record.code == Replay::CODE_END) {
+            std::size_t endPos = record.payload;
+            m_hasEnd = Replay::readVarint(m_data.data(), size, endPos, m_endScore) &&
+                       Replay::readVarint(m_data.data(), size, endPos, m_endChecksum);
+            break;
+        }
+    }
+    if (m_damaged) {
+        std::cerr << "Replay " << path << " is damaged after " << m_length << " ticks" << std::endl;
+    }
+    return true;
+}
+
+bool ReplayReader::readRecord(std::size_t& pos, std::uint32_t& tick, Record& record) {
+    const std::size_t size = m_data.size();
+    std::uint32_t value = 0;
+    // A record cut short by a crash ends the log like the end of the file
+    if (pos >= size || !Replay::readVarint(m_data.data(), size, pos, value)) {
+        return false;
+    }
+    tick += value >> Replay::CODE_BITS;
+    record.tick = tick;
+    record.code = value & ((1u << Replay::CODE_BITS) - 1);
+    record.payload = pos;
+    record.payloadSize = 0;
+
+    if (record.code == Replay::CODE_KEYFRAME) {
+        std::uint32_t payloadSize = 0;
+        if (!Replay::readVarint(m_data.data(), size, pos, payloadSize) || payloadSize > size - pos) {
+            return false;
+        }
+        record.payload = pos;
+        record.payloadSize = payloadSize;
+        pos += payloadSize;
+    } else if (record.code != Replay::CODE_END && record.code >= INPUT_ACTION_COUNT) {
+        m_damaged = true;
+        return false;
+    }
+    return true;
+}
+
+void ReplayReader::fetchInput() {
+    m_hasNext = false;
+    Record record;
+    while (readRecord(m_pos, m_recordTick, record) && record.code != Replay::CODE_END) {
+        if (record.code < INPUT_ACTION_COUNT) {
+            m_next.tick = record.tick;
+            m_next.action = static_cast<InputAction>(record.code);
+            m_hasNext = true;
+            return;
+        }
+    }
+    // Nothing left: park the cursor at the end
+    m_pos = m_data.size();
+}
+
+void ReplayReader::prepare(GameState& state) const {
+    switch (m_header.mode) {
+        case Replay::Mode::LEVEL:
+            state.setGameMode(std::make_unique<LevelBasedMode>());
+            break;
+        case Replay::Mode::SIMPLE_AI:
+            state.setGameMode(std::make_unique<AIMode>(false, false));
+            break;
+        case Replay::Mode::ADVANCED_AI:
+            state.setGameMode(std::make_unique<AIMode>(true, false));
+            break;
+    }
+    state.resetWithSeed(m_header.seed);
+}
+
+void ReplayReader::start(GameState& state) {
+    prepare(state);
+    m_pos = m_recordsStart;
+    m_recordTick = 0;
+    m_tick = 0;
+    fetchInput();
+    applyFinalInputs(state);
+}
+
+bool ReplayReader::step(GameState& state) {
+    if (atEnd()) {
+        return false;
+    }
+    while (m_hasNext && m_next.tick == m_tick) {
+        state.applyInput(m_next.action);
+        fetchInput();
+    }
+    // Same step as the game loop in main.cpp
+    state.update(1.0f / static_cast<float>(m_header.tickRate));
+    ++m_tick;
+    applyFinalInputs(state);
+    return true;
+}
+
+void ReplayReader::applyFinalInputs(GameState& state) {
+    if (!atEnd()) {
+        return;
+    }
+    while (m_hasNext && m_next.tick == m_tick) {
+        state.applyInput(m_next.action);
+        fetchInput();
+    }
+}
+
+bool ReplayReader::restore(const Keyframe& keyframe, GameState& state) {
+    GameStateSnapshot snapshot;
+    if (!Replay::readSnapshot(m_data.data() + keyframe.offset, keyframe.size, snapshot)) {
+        std::cerr << "Damaged replay keyframe at tick " << keyframe.tick << std::endl;
+        return false;
+    }
+    // The mode's type comes from the header, its progress from the snapshot
+    prepare(state);
+    state.restore(snapshot);
+    m_pos = keyframe.next;
+    m_recordTick = keyframe.tick;
+    m_tick = keyframe.tick;
+    fetchInput();
+    applyFinalInputs(state);
+    return true;
+}
+
+void ReplayReader::seek(std::uint32_t tick, GameState& state) {
+    tick = std::min(tick, m_length);
+
+    // Latest keyframe at or before the target
+    auto after = std::upper_bound(
+        m_keyframes.begin(), m_keyframes.end(), tick,
+        [](std::uint32_t target, const Keyframe& keyframe) { return target < keyframe.tick; });
+    const Keyframe* keyframe = after != m_keyframes.begin() ? &*(after - 1) : nullptr;
+    const std::uint32_t keyframeTick = keyframe ? keyframe->tick : 0;
+
+    // Going back, or a keyframe closer than the current position: jump, otherwise simulate on from here
+    if (tick < m_tick || keyframeTick > m_tick) {
+        if (!keyframe || !restore(*keyframe, state)) {
+            start(state);
+        }
+    }
+    while (m_tick < tick && step(state)) {
+    }
+}
+
+bool ReplayReader::play(GameState& state) {
+    start(state);
+    while (step(state)) {
+    }
+    if (m_damaged) {
+        return false;
+    }
+    return !m_hasEnd || (state.score() == endScore() && Replay::checksum(state) == m_endChecksum);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "ReplayFormat.h"
+#include <string>
+#include <vector>
+
+// Reads a replay file and plays it back through a GameState, step for step as it was recorded.
+// Playback is a cursor: the GameState passed to start(), step() and seek() holds the game at the start of tick().
+class ReplayReader {
+public:
+    ReplayReader();
+
+    // Load the file, check its header and index its keyframes, false (and an error on std::cerr) if it is not a
+    // replay we can play
+    bool open(const std::string& path);
+
+    const Replay::Header& header() const { return m_header; }
+    std::size_t fileSize() const { return m_data.size(); }
+    std::size_t keyframeCount() const { return m_keyframes.size(); }
+
+    // Ticks the replay lasts: up to its end record, or its last record for a recording cut short
+    std::uint32_t length() const { return m_length; }
+
+    // Whether the end record was read (false for a recording cut short), and what it holds
+    bool hasEnd() const { return m_hasEnd; }
+    int endScore() const { return static_cast<int>(m_endScore); }
+    std::uint32_t endChecksum() const { return m_endChecksum; }
+
+    // Put state at the start of the game: mode and seed of the recording, on a fresh board. The AI modes do not
+    // play on their own here, their moves are in the log.
+    void start(GameState& state);
+
+    // One simulation step: the inputs of tick(), then the update. Returns false (and does nothing) at the end.
+    bool step(GameState& state);
+
+    // Move to the start of tick (clamped to length()), from the nearest keyframe at or before it or by stepping on
+    // from tick() when that is closer. Never simulates more than a keyframe interval, whatever the length.
+    void seek(std::uint32_t tick, GameState& state);
+
+    std::uint32_t tick() const { return m_tick; }
+    bool atEnd() const { return m_tick >= m_length; }
+
+    // Play the whole replay into state from the start. Returns false if the final state differs from the one
+    // recorded (or the log is damaged); a replay without end record plays to its last input and passes.
+    bool play(GameState& state);
+
+private:
+    struct Keyframe {
+        std::uint32_t tick;
+        std::size_t offset;  // snapshot payload
+        std::size_t size;
+        std::size_t next;    // first record after it
+    };
+
+    // One parsed record
+    struct Record {
+        std::uint32_t tick = 0;
+        std::uint32_t code = 0;
+        std::size_t payload = 0;  // keyframe snapshot
+        std::size_t payloadSize = 0;
+    };
+
+    std::vector<std::uint8_t> m_data;
+    Replay::Header m_header;
+    std::size_t m_recordsStart;
+    std::vector<Keyframe> m_keyframes;
+    std::uint32_t m_length;
+    bool m_damaged;
+    bool m_hasEnd;
+    std::uint32_t m_endScore;
+    std::uint32_t m_endChecksum;
+
+    // Cursor: the next input not applied yet
+    std::size_t m_pos;
+    std::uint32_t m_recordTick;
+    Replay::Input m_next;
+    bool m_hasNext;
+    std::uint32_t m_tick;
+
+    // Parse the record at pos and move past it, false at the end of the log or on a damaged record
+    bool readRecord(std::size_t& pos, std::uint32_t& tick, Record& record);
+    // Load the next input into m_next, skipping keyframes
+    void fetchInput();
+    void prepare(GameState& state) const;
+    bool restore(const Keyframe& keyframe, GameState& state);
+    // At the last tick, its inputs complete the game as it was recorded
+    void applyFinalInputs(GameState& state);
+};
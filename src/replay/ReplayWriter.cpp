@@ -0,0 +1,106 @@
+#include "ReplayWriter.h"
+#include "../model/GameState.h"
+#include <iostream>
+
+ReplayWriter::ReplayWriter() : m_lastTick(0), m_keyframeTicks(0), m_lastKeyframeTick(0), m_lastKeyframePieces(0) {
+    m_buffer.reserve(FLUSH_BYTES + 256);
+    m_keyframe.reserve(256);
+}
+
+ReplayWriter::~ReplayWriter() {
+    close();
+}
+
+bool ReplayWriter::open(const std::string& path, const Replay::Header& header) {
+    close();
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cerr << "Could not create replay file " << path << std::endl;
+        return false;
+    }
+    m_path = path;
+    m_lastTick = 0;
+    m_keyframeTicks = Replay::KEYFRAME_SECONDS * header.tickRate;
+    m_lastKeyframeTick = 0;
+    m_lastKeyframePieces = 1;  // a new game starts with its first piece, no keyframe needed there
+
+    m_buffer.clear();
+    for (std::uint8_t byte : Replay::MAGIC) {
+        m_buffer.push_back(byte);
+    }
+    Replay::writeVarint(m_buffer, header.version);
+    Replay::writeVarint(m_buffer, static_cast<std::uint32_t>(header.mode));
+    Replay::writeVarint(m_buffer, header.seed);
+    Replay::writeVarint(m_buffer, header.tickRate);
+    Replay::writeVarint(m_buffer, header.startTime);
+    // The header goes out at once, so even an aborted recording is a valid (empty) replay
+    flush();
+    return isOpen();
+}
+
+void ReplayWriter::record(std::uint32_t tick, InputAction action) {
+    if (!isOpen()) {
+        return;
+    }
+    writeRecord(tick, static_cast<std::uint32_t>(action));
+    if (m_buffer.size() >= FLUSH_BYTES) {
+        flush();
+    }
+}
+
+void ReplayWriter::keyframeIfDue(std::uint32_t tick, const GameState& state) {
+    if (!isOpen() || (state.pieceCount() - m_lastKeyframePieces < Replay::KEYFRAME_PIECES &&
+                      tick - m_lastKeyframeTick < m_keyframeTicks)) {
+        return;
+    }
+    m_lastKeyframeTick = tick;
+    m_lastKeyframePieces = state.pieceCount();
+
+    GameStateSnapshot snapshot;
+    state.save(snapshot);
+    m_keyframe.clear();
+    Replay::writeSnapshot(m_keyframe, snapshot);
+    writeRecord(tick, Replay::CODE_KEYFRAME);
+    Replay::writeVarint(m_buffer, static_cast<std::uint32_t>(m_keyframe.size()));
+    m_buffer.insert(m_buffer.end(), m_keyframe.begin(), m_keyframe.end());
+    if (m_buffer.size() >= FLUSH_BYTES) {
+        flush();
+    }
+}
+
+void ReplayWriter::finish(std::uint32_t tick, const GameState& state) {
+    if (!isOpen()) {
+        return;
+    }
+    writeRecord(tick, Replay::CODE_END);
+    Replay::writeVarint(m_buffer, static_cast<std::uint32_t>(state.score()));
+    Replay::writeVarint(m_buffer, Replay::checksum(state));
+    close();
+}
+
+void ReplayWriter::close() {
+    if (!isOpen()) {
+        return;
+    }
+    flush();
+    m_file.close();
+}
+
+void ReplayWriter::writeRecord(std::uint32_t tick, std::uint32_t code) {
+    const std::uint32_t delta = tick > m_lastTick ? tick - m_lastTick : 0;
+    m_lastTick += delta;
+    Replay::writeVarint(m_buffer, delta << Replay::CODE_BITS | code);
+}
+
+void ReplayWriter::flush() {
+    if (m_buffer.empty()) {
+        return;
+    }
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+    m_file.flush();
+    m_buffer.clear();
+    if (!m_file) {
+        std::cerr << "Error writing replay file " << m_path << ", recording stopped" << std::endl;
+        m_file.close();
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "ReplayFormat.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Records a solo game into a replay file while it is played. Records are encoded into a memory buffer and
+// appended to the file in whole-record chunks of FLUSH_BYTES (minutes of play), so recording costs the
+// simulation thread a few bytes per input and a rare small write.
+class ReplayWriter {
+public:
+    static constexpr std::size_t FLUSH_BYTES = 4096;
+
+    ReplayWriter();
+    ~ReplayWriter();
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    // Create the file and write the header, false (and an error on std::cerr) if it cannot be created
+    bool open(const std::string& path, const Replay::Header& header);
+    bool isOpen() const { return m_file.is_open(); }
+
+    // Log an action applied after `tick` simulation steps; ticks never go backwards
+    void record(std::uint32_t tick, InputAction action);
+
+    // Called after each simulation step with the state at the start of `tick` (before that tick's inputs),
+    // writes a keyframe when Replay::KEYFRAME_PIECES pieces or Replay::KEYFRAME_SECONDS passed since the last
+    void keyframeIfDue(std::uint32_t tick, const GameState& state);
+
+    // End record with the final state, then close. Without it (close() alone) the replay still plays, unverified.
+    void finish(std::uint32_t tick, const GameState& state);
+    void close();
+
+    const std::string& path() const { return m_path; }
+
+private:
+    std::ofstream m_file;
+    std::string m_path;
+    std::vector<std::uint8_t> m_buffer;
+    std::vector<std::uint8_t> m_keyframe;
+    std::uint32_t m_lastTick;
+    std::uint32_t m_keyframeTicks;  // at most this long between two keyframes
+    std::uint32_t m_lastKeyframeTick;
+    int m_lastKeyframePieces;
+
+    void writeRecord(std::uint32_t tick, std::uint32_t code);
+    void flush();
+};
@@ -0,0 +1,43 @@
+#include "SoloGame.h"
+#include "../model/AIMode.h"
+#include "../model/LevelBasedMode.h"
+#include <memory>
+
+namespace {
+
+constexpr float STEP = 1.0f / static_cast<float>(Replay::TICK_RATE);
+
+} // namespace
+
+SoloGame::SoloGame(Replay::Mode mode, std::uint32_t seed, bool autoPlay, const AIWeights& weights)
+    : m_aiMode(nullptr), m_tick(0) {
+    if (mode == Replay::Mode::LEVEL) {
+        m_state.setGameMode(std::make_unique<LevelBasedMode>());
+    } else {
+        auto aiMode = std::make_unique<AIMode>(mode == Replay::Mode::ADVANCED_AI, autoPlay, weights);
+        m_aiMode = aiMode.get();
+        m_state.setGameMode(std::move(aiMode));
+    }
+    m_state.resetWithSeed(seed);
+}
+
+const std::vector<InputAction>& SoloGame::step() {
+    m_state.update(STEP);
+    ++m_tick;
+    return m_aiMode != nullptr ? m_aiMode->lastMove() : m_noMove;
+}
+
+bool SoloGame::playMove() {
+    finishClearing();
+    if (m_aiMode == nullptr || m_state.isGameOver()) {
+        return false;
+    }
+    m_aiMode->playMove(m_state);
+    return true;
+}
+
+void SoloGame::finishClearing() {
+    while (m_state.isClearingLines() && !m_state.isGameOver()) {
+        step();
+    }
+}
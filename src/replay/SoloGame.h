@@ -0,0 +1,39 @@
+#pragma once
+#include "ReplayFormat.h"
+#include "../ai/AIWeights.h"
+#include "../model/GameState.h"
+#include <vector>
+
+class AIMode;
+
+// A headless solo game of one replay mode, stepped like the solo loop of GameController at Replay::TICK_RATE.
+// The tools that play games on their own (recording, corpus generation, tuning) run them through this.
+class SoloGame {
+public:
+    // The AI modes play with weights, on their own (as in the game) with autoPlay, only through playMove() without
+    SoloGame(Replay::Mode mode, std::uint32_t seed, bool autoPlay = true,
+             const AIWeights& weights = AIWeights::configured());
+
+    SoloGame(const SoloGame&) = delete;
+    SoloGame& operator=(const SoloGame&) = delete;
+
+    GameState& state() { return m_state; }
+    const GameState& state() const { return m_state; }
+    // nullptr in the level mode
+    const AIMode* aiMode() const { return m_aiMode; }
+    // Simulation steps played so far
+    std::uint32_t tick() const { return m_tick; }
+
+    // One simulation step, returns the actions of the AI move it made (empty if none)
+    const std::vector<InputAction>& step();
+    // AI modes: the next move right away, once the lines being cleared are gone. False at game over.
+    bool playMove();
+    // Step until the lines being cleared are gone, so that they count
+    void finishClearing();
+
+private:
+    GameState m_state;
+    AIMode* m_aiMode;
+    std::uint32_t m_tick;
+    std::vector<InputAction> m_noMove;
+};
@@ -0,0 +1,402 @@
+#include "../model/Random.h"
+#include "../network/Framing.h"
+#include "../network/Protocol.h"
+#include "../util/Timestamp.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// tetris-loadgen: bot clients for tetris-server, to measure how many matches a core can hold.
+// Usage: tetris-loadgen [--host 127.0.0.1] [--port 53100] [--bots 200] [--spectators 0] [--threads 1] [--seconds 30]
+// Bots join, play random inputs at 60 Hz, decode every board they receive and queue up again after each match.
+// Spectators join running matches late, so a wrong keyframe or delta shows up as a resync.
+
+static std::atomic<bool> g_running(true);
+
+static void handleSignal(int) {
+    g_running.store(false);
+}
+
+// Totals of all fleets, printed once a second by the main thread
+struct LoadStats {
+    std::atomic<int> connected{0};
+    std::atomic<int> playing{0};
+    std::atomic<int> watching{0};
+    std::atomic<std::uint64_t> matchesJoined{0};
+    std::atomic<std::uint64_t> boardsDecoded{0};
+    std::atomic<std::uint64_t> resyncs{0};
+    std::atomic<std::uint64_t> disconnects{0};
+    std::atomic<std::uint64_t> bytesIn{0};
+    std::atomic<std::uint64_t> bytesOut{0};
+};
+
+// The bots of one thread, driven by one epoll loop
+class BotFleet {
+public:
+    BotFleet(const sockaddr_in& server, int bots, int spectators, std::uint32_t seed, LoadStats& stats)
+        : m_server(server), m_epollFd(epoll_create1(0)), m_random(seed), m_stats(stats) {
+        m_bots.resize(static_cast<std::size_t>(bots + spectators));
+        for (std::size_t i = static_cast<std::size_t>(bots); i < m_bots.size(); ++i) {
+            m_bots[i].spectator = true;
+        }
+    }
+
+    ~BotFleet() {
+        for (Bot& bot : m_bots) {
+            if (bot.fd >= 0) {
+                close(bot.fd);
+            }
+        }
+        close(m_epollFd);
+    }
+
+    void run() {
+        for (std::size_t i = 0; i < m_bots.size(); ++i) {
+            connectBot(i);
+        }
+
+        epoll_event events[256];
+        const std::int64_t tickUs = 1000000 / 60;
+        std::int64_t nextTickUs = nowMicroseconds();
+        while (g_running.load(std::memory_order_relaxed)) {
+            const std::int64_t waitUs = nextTickUs - nowMicroseconds();
+            const int count = epoll_wait(m_epollFd, events, 256, waitUs > 0 ? static_cast<int>((waitUs + 999) / 1000) : 0);
+            for (int i = 0; i < count; ++i) {
+                const std::size_t index = events[i].data.u64;
+                Bot& bot = m_bots[index];
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    dropBot(index);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    if (bot.connected) {
+                        flush(index);
+                    } else {
+                        onConnected(index);
+                    }
+                }
+                if (bot.connected && (events[i].events & EPOLLIN)) {
+                    onReadable(index);
+                }
+            }
+
+            const std::int64_t nowUs = nowMicroseconds();
+            if (nowUs >= nextTickUs) {
+                for (std::size_t i = 0; i < m_bots.size(); ++i) {
+                    playTick(i);
+                }
+                nextTickUs = std::max(nextTickUs + tickUs, nowUs - tickUs);
+            }
+        }
+    }
+
+private:
+    // Most input a bot keeps queued while the server does not read it, more and the bot gives up
+    static constexpr std::size_t MAX_UNSENT_BYTES = 64 * 1024;
+
+    struct Bot {
+        int fd = -1;
+        bool spectator = false;
+        bool connected = false;
+        bool playing = false;  // in a match, as a player or a spectator
+        Framing::FrameReader input;
+        std::vector<Protocol::StateDecoder> boards;  // one per slot of the current match
+        std::uint32_t tick = 0;
+        std::vector<std::uint8_t> unsent;  // frames the socket did not take yet, sent once it is writable
+        bool waitingToWrite = false;  // registered for EPOLLOUT
+    };
+
+    sockaddr_in m_server;
+    int m_epollFd;
+    Random m_random;
+    LoadStats& m_stats;
+    std::vector<Bot> m_bots;
+    std::vector<std::uint8_t> m_message;
+    Protocol::StateDecoder m_control;  // spectator MATCH_START, not about any board
+
+    void connectBot(std::size_t index) {
+        Bot& bot = m_bots[index];
+        bot.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        int enable = 1;
+        setsockopt(bot.fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        if (connect(bot.fd, reinterpret_cast<const sockaddr*>(&m_server), sizeof(m_server)) < 0 && errno != EINPROGRESS) {
+            std::cerr << "Error: Bot failed to connect: " << std::strerror(errno) << std::endl;
+            close(bot.fd);
+            bot.fd = -1;
+            return;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.u64 = index;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, bot.fd, &event);
+        bot.waitingToWrite = true;
+    }
+
+    void onConnected(std::size_t index) {
+        Bot& bot = m_bots[index];
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(bot.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            std::cerr << "Error: Bot failed to connect: " << std::strerror(error) << std::endl;
+            dropBot(index);
+            return;
+        }
+        bot.connected = true;
+        m_stats.connected++;
+        Protocol::StateEncoder::encodeJoin(bot.spectator ? Protocol::JoinRole::SPECTATOR : Protocol::JoinRole::PLAYER, m_message);
+        // Sending also stops waiting for writability once nothing is left
+        sendFrame(index);
+    }
+
+    void dropBot(std::size_t index) {
+        Bot& bot = m_bots[index];
+        if (bot.fd < 0) {
+            return;
+        }
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, bot.fd, nullptr);
+        close(bot.fd);
+        if (bot.connected) {
+            m_stats.connected--;
+        }
+        if (bot.playing) {
+            (bot.spectator ? m_stats.watching : m_stats.playing)--;
+        }
+        m_stats.disconnects++;
+        const bool spectator = bot.spectator;
+        bot = Bot();
+        bot.spectator = spectator;
+    }
+
+    void onReadable(std::size_t index) {
+        Bot& bot = m_bots[index];
+        std::vector<std::uint8_t>& buffer = bot.input.buffer();
+        while (true) {
+            const std::size_t oldSize = buffer.size();
+            buffer.resize(oldSize + 16384);
+            const ssize_t received = recv(bot.fd, buffer.data() + oldSize, 16384, 0);
+            buffer.resize(oldSize + static_cast<std::size_t>(std::max<ssize_t>(received, 0)));
+            if (received > 0) {
+                m_stats.bytesIn += static_cast<std::uint64_t>(received);
+                continue;
+            }
+            if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                dropBot(index);
+                return;
+            }
+            break;
+        }
+
+        const std::uint8_t* frame = nullptr;
+        std::size_t size = 0;
+        while (bot.input.next(frame, size)) {
+            if (size < 1) {
+                continue;
+            }
+            const std::uint8_t slot = frame[0];
+            Protocol::StateDecoder* decoder = &m_control;
+            if (slot != Framing::SPECTATOR_SLOT) {
+                if (slot >= bot.boards.size()) {
+                    bot.boards.resize(slot + 1u);
+                }
+                decoder = &bot.boards[slot];
+            }
+            switch (decoder->decode(frame + 1, size - 1)) {
+                case Protocol::DecodeResult::MATCH_STARTED:
+                    // A new match: boards of the previous one are gone
+                    bot.boards.clear();
+                    bot.tick = 0;
+                    if (!bot.playing) {
+                        (bot.spectator ? m_stats.watching : m_stats.playing)++;
+                    }
+                    bot.playing = true;
+                    m_stats.matchesJoined++;
+                    break;
+                case Protocol::DecodeResult::STATE_UPDATED:
+                    m_stats.boardsDecoded++;
+                    break;
+                case Protocol::DecodeResult::NEED_RESYNC:
+                    // TCP loses nothing, so this means the server's stream is wrong
+                    m_stats.resyncs++;
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (bot.input.isBroken()) {
+            dropBot(index);
+        }
+    }
+
+    // Random play: a move or rotation now and then, a hard drop about twice a second
+    void playTick(std::size_t index) {
+        Bot& bot = m_bots[index];
+        if (!bot.playing || bot.spectator) {
+            return;
+        }
+
+        InputFrame frame;
+        frame.tick = bot.tick++;
+        const int roll = m_random.nextInt(100);
+        if (roll < 3) {
+            frame.actions[frame.count++] = InputAction::HARD_DROP;
+        } else if (roll < 20) {
+            frame.actions[frame.count++] = static_cast<InputAction>(m_random.nextInt(5));
+        }
+
+        Protocol::StateEncoder::encodeInput(frame, m_message);
+        sendFrame(index);
+    }
+
+    // Queue m_message as one frame and send what the socket takes
+    void sendFrame(std::size_t index) {
+        Framing::appendFrame(m_bots[index].unsent, m_message);
+        flush(index);
+    }
+
+    // TCP takes part of a frame when the socket is full: the rest stays queued and goes out on EPOLLOUT, dropping
+    // it would cut the frame and break the server's framing for everything after it
+    void flush(std::size_t index) {
+        Bot& bot = m_bots[index];
+        std::size_t offset = 0;
+        while (offset < bot.unsent.size()) {
+            const ssize_t sent = send(bot.fd, bot.unsent.data() + offset, bot.unsent.size() - offset, MSG_NOSIGNAL);
+            if (sent > 0) {
+                offset += static_cast<std::size_t>(sent);
+                m_stats.bytesOut += static_cast<std::uint64_t>(sent);
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                dropBot(index);
+                return;
+            }
+            break;
+        }
+        bot.unsent.erase(bot.unsent.begin(), bot.unsent.begin() + static_cast<std::ptrdiff_t>(offset));
+        if (bot.unsent.size() > MAX_UNSENT_BYTES) {
+            std::cerr << "Error: Server stopped reading, " << bot.unsent.size() << " bytes could not be sent" << std::endl;
+            dropBot(index);
+            return;
+        }
+
+        // Wait for writability only while something is queued
+        const bool waitToWrite = !bot.unsent.empty();
+        if (waitToWrite != bot.waitingToWrite) {
+            epoll_event event{};
+            event.events = waitToWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+            event.data.u64 = index;
+            epoll_ctl(m_epollFd, EPOLL_CTL_MOD, bot.fd, &event);
+            bot.waitingToWrite = waitToWrite;
+        }
+    }
+};
+
+static void printUsage() {
+    std::cerr << "Usage: tetris-loadgen [--host 127.0.0.1] [--port 53100] [--bots 200] [--spectators 0] [--threads 1] "
+                 "[--seconds 30]"
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string host = "127.0.0.1";
+    unsigned short port = 53100;
+    int bots = 200;
+    int spectators = 0;
+    int threads = 1;
+    int seconds = 30;
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << std::endl;
+            printUsage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (option == "--host") {
+            host = value;
+        } else if (option == "--port") {
+            port = static_cast<unsigned short>(std::atoi(value));
+        } else if (option == "--bots") {
+            bots = std::max(1, std::atoi(value));
+        } else if (option == "--spectators") {
+            spectators = std::max(0, std::atoi(value));
+        } else if (option == "--threads") {
+            threads = std::max(1, std::atoi(value));
+        } else if (option == "--seconds") {
+            seconds = std::max(1, std::atoi(value));
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &server.sin_addr) != 1) {
+        std::cerr << "Error: Invalid server address: " << host << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    LoadStats stats;
+    std::vector<std::thread> fleets;
+    for (int i = 0; i < threads; ++i) {
+        const int fleetBots = bots / threads + (i < bots % threads ? 1 : 0);
+        const int fleetSpectators = spectators / threads + (i < spectators % threads ? 1 : 0);
+        const std::uint32_t seed = static_cast<std::uint32_t>(nowMicroseconds()) + static_cast<std::uint32_t>(i);
+        fleets.emplace_back([&server, fleetBots, fleetSpectators, seed, &stats]() {
+            BotFleet fleet(server, fleetBots, fleetSpectators, seed, stats);
+            fleet.run();
+        });
+    }
+
+    std::cout << "tetris-loadgen: " << bots << " bots and " << spectators << " spectators on " << threads << " thread(s) against " << host << ":" << port
+              << " for " << seconds << " s" << std::endl;
+
+    std::uint64_t lastBoards = 0;
+    std::uint64_t lastIn = 0;
+    std::uint64_t lastOut = 0;
+    for (int second = 0; second < seconds && g_running.load(); ++second) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        const std::uint64_t boards = stats.boardsDecoded.load();
+        const std::uint64_t in = stats.bytesIn.load();
+        const std::uint64_t out = stats.bytesOut.load();
+        std::cout << std::fixed << std::setprecision(1) << "[" << second + 1 << "s] " << stats.connected.load() << " connected, "
+                  << stats.playing.load() << " playing, " << stats.watching.load() << " watching, "
+                  << stats.matchesJoined.load() << " match joins | "
+                  << boards - lastBoards << " boards/s, in " << (in - lastIn) / 1024.0 << " KiB/s, out "
+                  << (out - lastOut) / 1024.0 << " KiB/s | " << stats.resyncs.load() << " resyncs, "
+                  << stats.disconnects.load() << " disconnects" << std::endl;
+        lastBoards = boards;
+        lastIn = in;
+        lastOut = out;
+    }
+
+    g_running.store(false);
+    for (auto& fleet : fleets) {
+        fleet.join();
+    }
+    return stats.resyncs.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,619 @@
+#include "MatchServer.h"
+#include "../util/Timestamp.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MatchServer::Lobby::Lobby(int loops) : m_arrivals(static_cast<std::size_t>(std::max(1, loops))) {}
+
+MatchServer::Lobby::~Lobby() {
+    for (const Connection& connection : m_players) {
+        close(connection.fd);
+    }
+    for (const Connection& connection : m_idleSpectators) {
+        close(connection.fd);
+    }
+    for (const auto& arrivals : m_arrivals) {
+        for (const Connection& connection : arrivals) {
+            close(connection.fd);
+        }
+    }
+}
+
+void MatchServer::Lobby::queuePlayer(Connection&& connection) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_players.push_back(std::move(connection));
+}
+
+bool MatchServer::Lobby::takePlayers(std::size_t count, std::vector<Connection>& players) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_players.size() < count) {
+        return false;
+    }
+    players.clear();
+    for (std::size_t i = 0; i < count; ++i) {
+        players.push_back(std::move(m_players.front()));
+        m_players.pop_front();
+    }
+    return true;
+}
+
+void MatchServer::Lobby::requeuePlayers(std::vector<Connection>& players) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (std::size_t i = players.size(); i-- > 0;) {
+        m_players.push_front(std::move(players[i]));
+    }
+    players.clear();
+}
+
+std::size_t MatchServer::Lobby::waitingPlayers() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_players.size();
+}
+
+void MatchServer::Lobby::matchStarted(int loop, std::uint32_t id, std::vector<Connection>& idleSpectators) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running.emplace_back(loop, id);
+    idleSpectators.swap(m_idleSpectators);
+    m_idleSpectators.clear();
+}
+
+void MatchServer::Lobby::matchFinished(int loop, std::uint32_t id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running.erase(std::remove(m_running.begin(), m_running.end(), std::make_pair(loop, id)), m_running.end());
+}
+
+int MatchServer::Lobby::newestMatchLoop() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running.empty() ? -1 : m_running.back().first;
+}
+
+void MatchServer::Lobby::sendSpectator(int loop, Connection&& connection) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The match may have ended meanwhile: then the spectator waits for the next one like any other
+    if (loop < 0 || m_running.empty()) {
+        m_idleSpectators.push_back(std::move(connection));
+    } else {
+        m_arrivals[static_cast<std::size_t>(loop)].push_back(std::move(connection));
+    }
+}
+
+void MatchServer::Lobby::takeSpectators(int loop, std::vector<Connection>& spectators) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    spectators.swap(m_arrivals[static_cast<std::size_t>(loop)]);
+    m_arrivals[static_cast<std::size_t>(loop)].clear();
+}
+
+MatchServer::MatchServer(const Settings& settings, Lobby& lobby)
+    : m_settings(settings),
+      m_lobby(lobby),
+      m_listenFd(-1),
+      m_epollFd(-1),
+      m_nextMatchId(1),
+      m_random(static_cast<std::uint32_t>(nowMicroseconds()) ^ static_cast<std::uint32_t>(settings.id * 7919)),
+      m_statsStartUs(0) {}
+
+MatchServer::~MatchServer() {
+    for (auto& entry : m_connections) {
+        close(entry.first);
+    }
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+    }
+}
+
+bool MatchServer::start() {
+    m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (m_listenFd < 0) {
+        std::cerr << "Error: Failed to create the server socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Every loop binds the same port, the kernel balances incoming connections between them
+    int enable = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(m_settings.port);
+    if (bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(m_listenFd, SOMAXCONN) < 0) {
+        std::cerr << "Error: Failed to listen on port " << m_settings.port << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_epollFd = epoll_create1(0);
+    if (m_epollFd < 0) {
+        std::cerr << "Error: Failed to create epoll instance: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = m_listenFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &event) < 0) {
+        std::cerr << "Error: Failed to watch the server socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void MatchServer::run(const std::atomic<bool>& running) {
+    epoll_event events[MAX_EVENTS];
+    std::int64_t nextTickUs = nowMicroseconds() + TICK_US;
+    m_statsStartUs = nowMicroseconds();
+    const std::int64_t statsIntervalUs = static_cast<std::int64_t>(m_settings.statsInterval * 1000000.0f);
+
+    while (running.load(std::memory_order_relaxed)) {
+        // Sleep until the next tick unless sockets need attention first
+        const std::int64_t waitUs = nextTickUs - nowMicroseconds();
+        const int timeoutMs = waitUs > 0 ? static_cast<int>((waitUs + 999) / 1000) : 0;
+        const int count = epoll_wait(m_epollFd, events, MAX_EVENTS, timeoutMs);
+        const std::int64_t wokeUs = nowMicroseconds();
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "Error: epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == m_listenFd) {
+                acceptConnections();
+                continue;
+            }
+            auto it = m_connections.find(fd);
+            if (it == m_connections.end()) {
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(fd);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && !flush(it->second)) {
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                onReadable(it->second);
+            }
+        }
+        startMatches();
+
+        std::int64_t nowUs = nowMicroseconds();
+        if (nowUs - nextTickUs > MAX_CATCH_UP_US) {
+            // Too far behind (stalled or overloaded): skip ticks rather than burst through them
+            nextTickUs = nowUs;
+        }
+        while (nowUs >= nextTickUs) {
+            const std::int64_t tickStartUs = nowMicroseconds();
+            tickMatches();
+            const std::int64_t tickUs = nowMicroseconds() - tickStartUs;
+            m_stats.ticks++;
+            m_stats.tickTimeUs += tickUs;
+            m_stats.maxTickUs = std::max(m_stats.maxTickUs, tickUs);
+            nextTickUs += TICK_US;
+            nowUs = nowMicroseconds();
+        }
+
+        m_stats.busyUs += nowUs - wokeUs;
+        if (nowUs - m_statsStartUs >= statsIntervalUs) {
+            logStats(nowUs);
+        }
+    }
+}
+
+void MatchServer::acceptConnections() {
+    while (true) {
+        const int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Warning: accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        // Boards are small and sent every tick, never wait to coalesce them
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            continue;
+        }
+        // Queued once it says whether it plays or watches
+        m_connections[fd].fd = fd;
+    }
+}
+
+void MatchServer::onReadable(Connection& connection) {
+    std::vector<std::uint8_t>& buffer = connection.input.buffer();
+    while (true) {
+        const std::size_t oldSize = buffer.size();
+        buffer.resize(oldSize + 4096);
+        const ssize_t received = recv(connection.fd, buffer.data() + oldSize, 4096, 0);
+        buffer.resize(oldSize + static_cast<std::size_t>(std::max<ssize_t>(received, 0)));
+        if (received > 0) {
+            m_stats.bytesIn += static_cast<std::uint64_t>(received);
+            continue;
+        }
+        if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            closeConnection(connection.fd);
+            return;
+        }
+        break;
+    }
+
+    const int fd = connection.fd;
+    const std::uint8_t* frame = nullptr;
+    std::size_t size = 0;
+    while (connection.input.next(frame, size)) {
+        onFrame(connection, frame, size);
+        if (m_connections.find(fd) == m_connections.end()) {
+            return;
+        }
+    }
+    if (connection.input.isBroken()) {
+        std::cerr << "Warning: Dropping a client that sent an oversized frame" << std::endl;
+        closeConnection(fd);
+    }
+}
+
+void MatchServer::onFrame(Connection& connection, const std::uint8_t* frame, std::size_t size) {
+    switch (m_decoder.decode(frame, size)) {
+        case Protocol::DecodeResult::INPUT_RECEIVED: {
+            // Inputs sent before the match started, or after the player left it, are meaningless
+            auto it = m_matches.find(connection.match);
+            if (!connection.spectator && it != m_matches.end() &&
+                !it->second.match->queueInput(connection.slot, m_decoder.input())) {
+                m_stats.droppedInputs++;
+            }
+            break;
+        }
+        case Protocol::DecodeResult::JOIN_REQUESTED:
+            // Only once, a player cannot walk out of a running match into the stands
+            if (connection.joined) {
+                break;
+            }
+            connection.joined = true;
+            if (m_decoder.joinRole() == Protocol::JoinRole::SPECTATOR) {
+                connection.spectator = true;
+                m_stats.spectatorJoins++;
+                attachSpectator(connection);
+            } else {
+                // Queued in the lobby by startMatches(), not from inside this read loop
+                m_waiting.push_back(connection.fd);
+            }
+            break;
+        case Protocol::DecodeResult::INVALID:
+            std::cerr << "Warning: Dropping a client that sent an invalid message" << std::endl;
+            closeConnection(connection.fd);
+            break;
+        default:
+            // Clients have nothing else to say to the server
+            break;
+    }
+}
+
+void MatchServer::closeConnection(int fd) {
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end()) {
+        return;
+    }
+
+    if (it->second.spectator) {
+        detachSpectator(it->second);
+    } else {
+        auto match = m_matches.find(it->second.match);
+        if (match != m_matches.end()) {
+            match->second.match->removePlayer(it->second.slot);
+            match->second.fds[it->second.slot] = -1;
+        }
+        m_waiting.erase(std::remove(m_waiting.begin(), m_waiting.end(), fd), m_waiting.end());
+    }
+
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    m_connections.erase(it);
+}
+
+MatchServer::Connection MatchServer::park(int fd) {
+    auto it = m_connections.find(fd);
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    Connection connection = std::move(it->second);
+    m_connections.erase(it);
+    connection.waitingForWrite = false;
+    return connection;
+}
+
+bool MatchServer::adopt(Connection&& parked) {
+    const int fd = parked.fd;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        close(fd);
+        return false;
+    }
+    Connection& connection = m_connections[fd];
+    connection = std::move(parked);
+
+    // Nobody read it while it was parked: a client that left is closed now, inputs sent meanwhile are dropped
+    onReadable(connection);
+    auto it = m_connections.find(fd);
+    return it != m_connections.end() && flush(it->second);
+}
+
+SharedBuffer MatchServer::share(std::vector<std::uint8_t>& data) {
+    auto buffer = std::make_shared<std::vector<std::uint8_t>>(std::move(data));
+    data.clear();
+    return buffer;
+}
+
+bool MatchServer::flush(Connection& connection) {
+    const ssize_t sent = connection.output.writeTo(connection.fd);
+    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        closeConnection(connection.fd);
+        return false;
+    }
+    if (sent > 0) {
+        m_stats.bytesOut += static_cast<std::uint64_t>(sent);
+    }
+
+    if (connection.output.pendingBytes() > MAX_OUTPUT_BYTES) {
+        std::cerr << "Warning: Dropping a client that stopped reading" << std::endl;
+        closeConnection(connection.fd);
+        return false;
+    }
+    setWriteInterest(connection, !connection.output.empty());
+    return true;
+}
+
+void MatchServer::setWriteInterest(Connection& connection, bool enabled) {
+    if (connection.waitingForWrite == enabled) {
+        return;
+    }
+    epoll_event event{};
+    event.events = enabled ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.fd = connection.fd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.waitingForWrite = enabled;
+}
+
+// Group the waiting players of all loops into matches, first come first served
+void MatchServer::startMatches() {
+    for (const int fd : m_waiting) {
+        m_lobby.queuePlayer(park(fd));
+    }
+    m_waiting.clear();
+
+    // Spectators other loops sent here to watch one of this loop's matches
+    std::vector<Connection> spectators;
+    m_lobby.takeSpectators(m_settings.id, spectators);
+    adoptSpectators(spectators);
+
+    const std::size_t players = static_cast<std::size_t>(m_settings.playersPerMatch);
+    std::vector<Connection> group;
+    std::vector<int> fds;
+    while (m_lobby.takePlayers(players, group)) {
+        fds.clear();
+        for (Connection& player : group) {
+            const int fd = player.fd;
+            if (adopt(std::move(player))) {
+                fds.push_back(fd);
+            }
+        }
+        group.clear();
+        if (fds.size() < players) {
+            // Someone left while waiting: the others keep their places for the next group
+            for (const int fd : fds) {
+                group.push_back(park(fd));
+            }
+            m_lobby.requeuePlayers(group);
+            continue;
+        }
+
+        const std::uint32_t id = m_nextMatchId++;
+        MatchEntry& entry = m_matches[id];
+        entry.match = std::make_unique<ServerMatch>(m_random.next(), m_settings.playersPerMatch, m_settings.rule,
+                                                    m_settings.targetLines);
+        Protocol::StateEncoder::encodeMatchStart(entry.match->matchStart(), m_message);
+
+        for (std::size_t slot = 0; slot < players; ++slot) {
+            const int fd = fds[slot];
+            entry.fds.push_back(fd);
+            Connection& connection = m_connections[fd];
+            connection.match = id;
+            connection.slot = static_cast<int>(slot);
+
+            // Each player learns its own slot
+            m_broadcast.clear();
+            Framing::appendSlotFrame(m_broadcast, static_cast<std::uint8_t>(slot), m_message);
+            connection.output.push(share(m_broadcast));
+        }
+        Framing::appendSlotFrame(m_broadcast, Framing::SPECTATOR_SLOT, m_message);
+        entry.spectatorStart = share(m_broadcast);
+
+        for (const int fd : entry.fds) {
+            auto it = m_connections.find(fd);
+            if (it != m_connections.end()) {
+                flush(it->second);
+            }
+        }
+        m_stats.matchesStarted++;
+
+        // The newest match is the one to watch: spectators waiting for a match come here
+        m_lobby.matchStarted(m_settings.id, id, spectators);
+        adoptSpectators(spectators);
+    }
+}
+
+void MatchServer::adoptSpectators(std::vector<Connection>& spectators) {
+    for (Connection& spectator : spectators) {
+        const int fd = spectator.fd;
+        if (adopt(std::move(spectator))) {
+            attachSpectator(m_connections[fd]);
+        }
+    }
+    spectators.clear();
+}
+
+void MatchServer::tickMatches() {
+    for (auto& item : m_matches) {
+        MatchEntry& entry = item.second;
+        m_broadcast.clear();
+        entry.match->tick(m_broadcast);
+        // Keyframes for late spectators are only valid until this tick's deltas
+        entry.keyframes.reset();
+
+        // Everyone in the match sees every board: one buffer, queued for each of them
+        if (!m_broadcast.empty()) {
+            const SharedBuffer frames = share(m_broadcast);
+            for (const int fd : entry.fds) {
+                auto connection = m_connections.find(fd);
+                if (connection != m_connections.end()) {
+                    connection->second.output.push(frames);
+                    flush(connection->second);
+                }
+            }
+            // Backwards: a spectator whose flush fails is closed and removed from the list
+            for (std::size_t i = entry.spectators.size(); i-- > 0;) {
+                auto connection = m_connections.find(entry.spectators[i]);
+                if (connection != m_connections.end()) {
+                    connection->second.output.push(frames);
+                    flush(connection->second);
+                }
+            }
+        }
+
+        if (entry.match->isFinished()) {
+            m_finished.push_back(item.first);
+        }
+    }
+
+    for (const std::uint32_t id : m_finished) {
+        finishMatch(id);
+    }
+    m_finished.clear();
+}
+
+// Players still connected queue up again for the next match, spectators move on to another match
+void MatchServer::finishMatch(std::uint32_t id) {
+    auto it = m_matches.find(id);
+    if (it == m_matches.end()) {
+        return;
+    }
+    MatchEntry entry = std::move(it->second);
+    m_matches.erase(it);
+    m_lobby.matchFinished(m_settings.id, id);
+
+    for (const int fd : entry.fds) {
+        auto connection = m_connections.find(fd);
+        if (connection != m_connections.end() && connection->second.match == id) {
+            connection->second.match = 0;
+            connection->second.slot = -1;
+            m_waiting.push_back(fd);
+        }
+    }
+    for (const int fd : entry.spectators) {
+        auto connection = m_connections.find(fd);
+        if (connection != m_connections.end()) {
+            connection->second.match = 0;
+            attachSpectator(connection->second);
+        }
+    }
+    m_stats.matchesFinished++;
+}
+
+void MatchServer::attachSpectator(Connection& connection) {
+    // The newest match may run on another loop, which then serves this spectator
+    const int loop = m_lobby.newestMatchLoop();
+    if (loop != m_settings.id) {
+        m_lobby.sendSpectator(loop, park(connection.fd));
+        return;
+    }
+
+    // Match ids only grow, the largest one started last
+    MatchEntry* newest = nullptr;
+    std::uint32_t newestId = 0;
+    for (auto& item : m_matches) {
+        if (item.first > newestId) {
+            newestId = item.first;
+            newest = &item.second;
+        }
+    }
+    if (!newest) {
+        m_lobby.sendSpectator(-1, park(connection.fd));
+        return;
+    }
+
+    // Encoded once per tick, however many spectators join during it
+    if (!newest->keyframes) {
+        m_broadcast.clear();
+        newest->match->encodeKeyframes(m_broadcast);
+        newest->keyframes = share(m_broadcast);
+    }
+    connection.match = newestId;
+    newest->spectators.push_back(connection.fd);
+    connection.output.push(newest->spectatorStart);
+    connection.output.push(newest->keyframes);
+    flush(connection);
+}
+
+void MatchServer::detachSpectator(Connection& connection) {
+    auto match = m_matches.find(connection.match);
+    if (match != m_matches.end()) {
+        std::vector<int>& spectators = match->second.spectators;
+        spectators.erase(std::remove(spectators.begin(), spectators.end(), connection.fd), spectators.end());
+    }
+    connection.match = 0;
+}
+
+void MatchServer::logStats(std::int64_t nowUs) {
+    const double seconds = static_cast<double>(nowUs - m_statsStartUs) / 1000000.0;
+    const double busy = static_cast<double>(m_stats.busyUs) / static_cast<double>(nowUs - m_statsStartUs);
+    const double averageTickUs = m_stats.ticks > 0 ? static_cast<double>(m_stats.tickTimeUs) / m_stats.ticks : 0.0;
+    std::size_t spectators = 0;
+    for (const auto& item : m_matches) {
+        spectators += item.second.spectators.size();
+    }
+    std::size_t players = 0;
+    for (const auto& item : m_matches) {
+        players += static_cast<std::size_t>(std::count_if(item.second.fds.begin(), item.second.fds.end(),
+                                                          [](int fd) { return fd >= 0; }));
+    }
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1) << "[loop " << m_settings.id << "] " << m_matches.size() << " matches, "
+         << players << " playing, " << m_lobby.waitingPlayers() << " waiting in the lobby, " << spectators << " watching ("
+         << m_stats.spectatorJoins << " joined), " << m_stats.matchesStarted << " started, "
+         << m_stats.matchesFinished << " finished | tick avg " << averageTickUs << " us, max " << m_stats.maxTickUs
+         << " us | busy " << busy * 100.0 << "%";
+    // Matches this core could hold at the current cost per match
+    if (busy > 0.0 && !m_matches.empty()) {
+        line << " (~" << static_cast<long>(m_matches.size() / busy) << " matches per core)";
+    }
+    line << " | in " << m_stats.bytesIn / seconds / 1024.0 << " KiB/s, out " << m_stats.bytesOut / seconds / 1024.0
+         << " KiB/s";
+    if (m_stats.droppedInputs > 0) {
+        line << " | " << m_stats.droppedInputs << " inputs dropped";
+    }
+    // One write per line, loops on other threads log too
+    std::cout << line.str() << std::endl;
+
+    m_stats = Stats();
+    m_statsStartUs = nowUs;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include "OutputQueue.h"
+#include "ServerMatch.h"
+#include "../model/Random.h"
+#include "../network/Framing.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// One event loop of tetris-server (Linux, epoll). It accepts players on its own SO_REUSEPORT socket and
+// ticks every match it owns at 60 Hz. Several loops can share the port, one per core: the kernel spreads new
+// connections over them, and the only thing loops share is the Lobby where players wait for opponents.
+// Clients first JOIN as player or spectator. Players are grouped into matches in arrival order, whichever loop
+// they connected to; the loop that completes a group takes its connections over and runs the match.
+// Spectators watch the newest match of any loop and follow on to the next one when it ends;
+// every tick's boards are encoded once and the same buffer is queued for all players and spectators.
+class MatchServer {
+public:
+    struct Settings {
+        unsigned short port = 53100;
+        int playersPerMatch = 2;
+        MultiplayerRule rule = MultiplayerRule::VERSUS;
+        int targetLines = 40;
+        float statsInterval = 5.0f;  // seconds between statistics lines
+        int id = 0;                  // loop number (0 to loops - 1)
+    };
+
+    // Where connections wait between loops, shared by all of them (defined below)
+    class Lobby;
+
+    MatchServer(const Settings& settings, Lobby& lobby);
+    ~MatchServer();
+
+    // Bind and listen, false on error
+    bool start();
+
+    // Serve until running turns false
+    void run(const std::atomic<bool>& running);
+
+private:
+    static constexpr std::int64_t TICK_US = 1000000 / 60;
+    static constexpr std::int64_t MAX_CATCH_UP_US = 250000;
+    // A client that lets this much pile up is not reading, it is dropped
+    static constexpr std::size_t MAX_OUTPUT_BYTES = 256 * 1024;
+    static constexpr int MAX_EVENTS = 256;
+
+    struct Connection {
+        int fd = -1;
+        Framing::FrameReader input;
+        OutputQueue output;
+        bool waitingForWrite = false;  // EPOLLOUT registered
+        bool joined = false;           // sent JOIN, before that it is neither player nor spectator
+        bool spectator = false;
+        std::uint32_t match = 0;       // 0 while waiting for opponents (or, for a spectator, for a match)
+        int slot = -1;
+    };
+
+    struct MatchEntry {
+        std::unique_ptr<ServerMatch> match;
+        std::vector<int> fds;  // per slot, -1 once the player left
+        std::vector<int> spectators;
+        SharedBuffer spectatorStart;  // MATCH_START as spectators see it
+        SharedBuffer keyframes;       // for spectators joining before the next tick, then dropped
+    };
+
+    // Counters of the current statistics interval
+    struct Stats {
+        std::uint64_t matchesStarted = 0;
+        std::uint64_t matchesFinished = 0;
+        std::uint64_t ticks = 0;
+        std::int64_t tickTimeUs = 0;
+        std::int64_t maxTickUs = 0;
+        std::int64_t busyUs = 0;
+        std::uint64_t bytesIn = 0;
+        std::uint64_t bytesOut = 0;
+        std::uint64_t droppedInputs = 0;
+        std::uint64_t spectatorJoins = 0;
+    };
+
+    Settings m_settings;
+    Lobby& m_lobby;
+    int m_listenFd;
+    int m_epollFd;
+    std::unordered_map<int, Connection> m_connections;
+    std::unordered_map<std::uint32_t, MatchEntry> m_matches;
+    std::vector<int> m_waiting;  // players done with a match or just joined, queued in the lobby by startMatches()
+    std::vector<std::uint32_t> m_finished;
+    std::uint32_t m_nextMatchId;
+    Random m_random;
+    Protocol::StateDecoder m_decoder;
+    std::vector<std::uint8_t> m_broadcast;
+    std::vector<std::uint8_t> m_message;
+    Stats m_stats;
+    std::int64_t m_statsStartUs;
+
+    void acceptConnections();
+    void onReadable(Connection& connection);
+    void onFrame(Connection& connection, const std::uint8_t* frame, std::size_t size);
+    void closeConnection(int fd);
+
+    // Hand a connection to the lobby: it leaves this loop's epoll and connection table
+    Connection park(int fd);
+    // Take over a connection from the lobby, false if it turned out closed
+    bool adopt(Connection&& connection);
+
+    // Move freshly encoded bytes into a buffer that can be queued on many connections
+    SharedBuffer share(std::vector<std::uint8_t>& data);
+    // Write what the socket takes now, the rest waits for EPOLLOUT. False if the connection was closed.
+    bool flush(Connection& connection);
+    void setWriteInterest(Connection& connection, bool enabled);
+
+    void startMatches();
+    void adoptSpectators(std::vector<Connection>& spectators);
+    void tickMatches();
+    void finishMatch(std::uint32_t id);
+
+    // Watch the newest match of any loop, or wait for one
+    void attachSpectator(Connection& connection);
+    void detachSpectator(Connection& connection);
+
+    void logStats(std::int64_t nowUs);
+};
+
+// Connections between loops, shared by all of them: players waiting for opponents, spectators waiting for a
+// match, and connections handed to the loop that will serve them. A connection parked here belongs to no
+// loop; the one that takes it out registers it with its own epoll.
+class MatchServer::Lobby {
+public:
+    explicit Lobby(int loops);
+    ~Lobby();
+
+    // Players wait in one queue in arrival order, taken in groups of a match's size
+    void queuePlayer(Connection&& connection);
+    bool takePlayers(std::size_t count, std::vector<Connection>& players);
+    // Players of an incomplete group (others left while waiting) get their places back
+    void requeuePlayers(std::vector<Connection>& players);
+    std::size_t waitingPlayers() const;
+
+    // Running matches of all loops, in the order they started. A new match also takes every spectator
+    // that was waiting for one.
+    void matchStarted(int loop, std::uint32_t id, std::vector<Connection>& idleSpectators);
+    void matchFinished(int loop, std::uint32_t id);
+    // Loop of the newest running match, -1 if none runs
+    int newestMatchLoop() const;
+
+    // A spectator for another loop, or for whichever loop starts the next match when loop is -1
+    void sendSpectator(int loop, Connection&& connection);
+    void takeSpectators(int loop, std::vector<Connection>& spectators);
+
+private:
+    mutable std::mutex m_mutex;
+    std::deque<Connection> m_players;
+    std::vector<std::pair<int, std::uint32_t>> m_running;  // loop and match id
+    std::vector<Connection> m_idleSpectators;
+    std::vector<std::vector<Connection>> m_arrivals;  // per loop
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+// Encoded frames shared by every connection that has to send them (players and spectators of a match).
+// Encoded once, referenced by each queue until its socket took the bytes.
+using SharedBuffer = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+// Bytes waiting for one socket, kept as references to shared buffers rather than copies
+class OutputQueue {
+public:
+    OutputQueue() : m_offset(0), m_pending(0) {}
+
+    void push(SharedBuffer buffer) {
+        if (buffer && !buffer->empty()) {
+            m_pending += buffer->size();
+            m_chunks.push_back(std::move(buffer));
+        }
+    }
+
+    bool empty() const { return m_chunks.empty(); }
+    std::size_t pendingBytes() const { return m_pending; }
+
+    // Hand as much as the socket takes to the kernel, several buffers per call.
+    // Returns the bytes written, or -1 with errno set (EAGAIN when the socket is full).
+    ssize_t writeTo(int fd) {
+        ssize_t total = 0;
+        while (!m_chunks.empty()) {
+            iovec parts[MAX_PARTS];
+            int count = 0;
+            std::size_t offset = m_offset;
+            for (auto it = m_chunks.begin(); it != m_chunks.end() && count < MAX_PARTS; ++it) {
+                parts[count].iov_base = const_cast<std::uint8_t*>((*it)->data() + offset);
+                parts[count].iov_len = (*it)->size() - offset;
+                offset = 0;
+                ++count;
+            }
+
+            msghdr message{};
+            message.msg_iov = parts;
+            message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(count);
+            const ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return total > 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? total : -1;
+            }
+            consume(static_cast<std::size_t>(sent));
+            total += sent;
+        }
+        return total;
+    }
+
+    void clear() {
+        m_chunks.clear();
+        m_offset = 0;
+        m_pending = 0;
+    }
+
+private:
+    static constexpr int MAX_PARTS = 64;
+
+    std::deque<SharedBuffer> m_chunks;
+    std::size_t m_offset;   // bytes of the front buffer already written
+    std::size_t m_pending;
+
+    void consume(std::size_t bytes) {
+        m_pending -= bytes;
+        while (bytes > 0) {
+            const std::size_t left = m_chunks.front()->size() - m_offset;
+            if (bytes < left) {
+                m_offset += bytes;
+                return;
+            }
+            bytes -= left;
+            m_chunks.pop_front();
+            m_offset = 0;
+        }
+    }
+};
@@ -0,0 +1,92 @@
+#include "MatchServer.h"
+#include "../ConfigManager.h"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// tetris-server: headless host for many concurrent matches.
+// Usage: tetris-server [--config file] [--port N] [--threads N] [--players N]
+// Command line options override the [Server] section of the config file.
+
+static std::atomic<bool> g_running(true);
+
+static void handleSignal(int) {
+    g_running.store(false);
+}
+
+int main(int argc, char** argv) {
+    std::string configPath = "config.ini";
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--config") == 0) {
+            configPath = argv[i + 1];
+        }
+    }
+    ConfigManager& config = ConfigManager::getInstance();
+    config.load(configPath);
+
+    MatchServer::Settings settings;
+    settings.port = config.getServerPort();
+    settings.playersPerMatch = config.getPlayersPerMatch();
+    settings.rule = config.getMultiplayerMode() == "versus" ? MultiplayerRule::VERSUS : MultiplayerRule::MARATHON;
+    settings.targetLines = config.getDefaultTargetLines();
+    settings.statsInterval = config.getServerStatsInterval();
+    int threads = config.getServerThreads();
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return 1;
+        }
+        const int value = std::atoi(argv[++i]);
+        if (option == "--port") {
+            settings.port = static_cast<unsigned short>(value);
+        } else if (option == "--threads") {
+            threads = value;
+        } else if (option == "--players") {
+            settings.playersPerMatch = value < 2 ? 2 : (value > 8 ? 8 : value);
+        } else if (option != "--config") {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    // One event loop per thread, all listening on the same port and matching players through one lobby
+    MatchServer::Lobby lobby(threads);
+    std::vector<std::unique_ptr<MatchServer>> loops;
+    for (int i = 0; i < threads; ++i) {
+        settings.id = i;
+        loops.push_back(std::make_unique<MatchServer>(settings, lobby));
+        if (!loops.back()->start()) {
+            return 1;
+        }
+    }
+
+    std::cout << "tetris-server listening on port " << settings.port << " with " << threads << " loop(s), "
+              << settings.playersPerMatch << " players per " << (settings.rule == MultiplayerRule::VERSUS ? "versus" : "marathon")
+              << " match" << std::endl;
+
+    std::vector<std::thread> workers;
+    for (auto& loop : loops) {
+        workers.emplace_back([&loop]() { loop->run(g_running); });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::cout << "tetris-server stopped" << std::endl;
+    return 0;
+}
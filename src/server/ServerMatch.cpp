@@ -0,0 +1,138 @@
+#include "ServerMatch.h"
+#include "../network/Framing.h"
+#include "../model/LevelBasedMode.h"
+
+ServerMatch::ServerMatch(std::uint32_t seed, int players, MultiplayerRule rule, int targetLines)
+    : m_rule(rule), m_targetLines(targetLines), m_finished(false), m_winner(-1) {
+    m_start.seed = seed;
+    m_start.syncMode = SyncMode::MIRROR;  // clients only receive boards, they never simulate
+    m_start.versus = rule == MultiplayerRule::VERSUS;
+
+    for (int i = 0; i < players; ++i) {
+        auto player = std::make_unique<Player>();
+        player->state.setGameMode(std::make_unique<LevelBasedMode>());
+        player->state.resetWithSeed(seed);
+        m_players.push_back(std::move(player));
+    }
+    m_attacks.resize(m_players.size());
+}
+
+bool ServerMatch::queueInput(int slot, const InputFrame& frame) {
+    Player& player = *m_players[slot];
+    if (player.inputs.size() >= MAX_QUEUED_INPUTS) {
+        return false;
+    }
+    player.inputs.push_back(frame);
+    return true;
+}
+
+void ServerMatch::removePlayer(int slot) {
+    m_players[slot]->connected = false;
+    m_players[slot]->inputs.clear();
+}
+
+void ServerMatch::tick(std::vector<std::uint8_t>& broadcast) {
+    if (m_finished) {
+        return;
+    }
+
+    for (auto& player : m_players) {
+        if (!player->connected) {
+            continue;
+        }
+        // Everything received since the last tick applies now, in arrival order
+        while (!player->inputs.empty()) {
+            const InputFrame& frame = player->inputs.front();
+            for (std::uint8_t i = 0; i < frame.count; ++i) {
+                player->state.applyInput(frame.actions[i]);
+            }
+            player->inputs.pop_front();
+        }
+        player->state.update(TICK_DURATION);
+    }
+
+    if (m_rule == MultiplayerRule::VERSUS) {
+        routeGarbage();
+    }
+    checkFinished();
+
+    for (int slot = 0; slot < playerCount(); ++slot) {
+        encodeBoard(slot, broadcast);
+    }
+}
+
+void ServerMatch::encodeKeyframes(std::vector<std::uint8_t>& out) {
+    for (int slot = 0; slot < playerCount(); ++slot) {
+        if (m_players[slot]->encoder.encodeLatestKeyframe(m_message)) {
+            Framing::appendSlotFrame(out, static_cast<std::uint8_t>(slot), m_message);
+        }
+    }
+}
+
+void ServerMatch::routeGarbage() {
+    const int count = playerCount();
+    for (int i = 0; i < count; ++i) {
+        m_attacks[i] = m_players[i]->state.takeOutgoingGarbage();
+    }
+    for (int i = 0; i < count; ++i) {
+        if (m_attacks[i] == 0) {
+            continue;
+        }
+        // The next player still in the game, players who left are skipped like those who topped out
+        for (int step = 1; step < count; ++step) {
+            Player& target = *m_players[(i + step) % count];
+            if (target.connected && !target.state.isGameOver()) {
+                target.state.receiveGarbage(m_attacks[i]);
+                break;
+            }
+        }
+    }
+}
+
+// Versus ends with one player standing, marathon also when someone reaches the target lines
+void ServerMatch::checkFinished() {
+    int standing = 0;
+    int lastStanding = -1;
+    for (int slot = 0; slot < playerCount(); ++slot) {
+        const Player& player = *m_players[slot];
+        // Leaving the match counts as topping out
+        if (player.connected && !player.state.isGameOver()) {
+            ++standing;
+            lastStanding = slot;
+        }
+        if (m_rule == MultiplayerRule::MARATHON && player.connected && player.state.getGameMode() &&
+            player.state.getGameMode()->getLinesCleared() >= m_targetLines) {
+            m_finished = true;
+            m_winner = slot;
+            return;
+        }
+    }
+
+    if (standing <= 1) {
+        m_finished = true;
+        m_winner = lastStanding;
+    }
+}
+
+void ServerMatch::encodeBoard(int slot, std::vector<std::uint8_t>& broadcast) {
+    Player& player = *m_players[slot];
+    const GameState& state = player.state;
+    const Board& board = state.board();
+    for (int y = 0; y < Board::Height; ++y) {
+        for (int x = 0; x < Board::Width; ++x) {
+            m_packet.grid[y][x] = board.getCell(x, y);
+        }
+    }
+    m_packet.currentPieceType = static_cast<int>(state.currentPiece().getType());
+    m_packet.currentPieceX = state.pieceX();
+    m_packet.currentPieceY = state.pieceY();
+    m_packet.currentPieceRotation = static_cast<int>(state.currentPiece().getRotationState());
+    m_packet.score = state.score();
+    m_packet.level = state.level();
+    m_packet.isGameOver = state.isGameOver();
+
+    // Unchanged boards cost nothing
+    if (player.encoder.encode(m_packet, m_message)) {
+        Framing::appendSlotFrame(broadcast, static_cast<std::uint8_t>(slot), m_message);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "../model/GameState.h"
+#include "../model/MultiplayerMode.h"
+#include "../network/Protocol.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// One match hosted by tetris-server, simulated authoritatively: clients only send inputs, the server applies
+// them on its next tick and streams every board back to every player of the match.
+class ServerMatch {
+public:
+    static constexpr float TICK_DURATION = 1.0f / 60.0f;
+    // Input frames a player may have waiting, more means the client floods us and the excess is dropped
+    static constexpr std::size_t MAX_QUEUED_INPUTS = 32;
+
+    ServerMatch(std::uint32_t seed, int players, MultiplayerRule rule, int targetLines);
+
+    int playerCount() const { return static_cast<int>(m_players.size()); }
+    const MatchStart& matchStart() const { return m_start; }
+
+    // False if the player's input backlog is full
+    bool queueInput(int slot, const InputFrame& frame);
+
+    // A disconnected player counts as topped out
+    void removePlayer(int slot);
+
+    // Advance every board one tick and append the changed boards, framed for the clients, to broadcast
+    void tick(std::vector<std::uint8_t>& broadcast);
+
+    // Framed keyframes of every board as last broadcast, for a spectator joining now; the next tick's
+    // broadcast continues from them
+    void encodeKeyframes(std::vector<std::uint8_t>& out);
+
+    bool isFinished() const { return m_finished; }
+    // Slot of the winner, -1 for a draw
+    int winner() const { return m_winner; }
+
+private:
+    struct Player {
+        GameState state;
+        Protocol::StateEncoder encoder;
+        std::deque<InputFrame> inputs;
+        bool connected = true;
+    };
+
+    std::vector<std::unique_ptr<Player>> m_players;
+    MatchStart m_start;
+    MultiplayerRule m_rule;
+    int m_targetLines;
+    bool m_finished;
+    int m_winner;
+    std::vector<int> m_attacks;
+    std::vector<std::uint8_t> m_message;
+    PacketData m_packet;
+
+    // Each attack goes to the next player still standing, for two players that is the opponent
+    void routeGarbage();
+    void checkFinished();
+    void encodeBoard(int slot, std::vector<std::uint8_t>& broadcast);
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+// Fixed-capacity byte buffers handed out by handle and recycled through a free list. The pool only grows
+// until it holds as many buffers as were ever in use at once, after that storing a message never allocates.
+// Not thread-safe, each pool belongs to one thread.
+template <std::size_t Capacity>
+class BufferPool {
+public:
+    using Handle = std::uint32_t;
+
+    // Copy size bytes into a free buffer, false (and nothing stored) if they are more than Capacity
+    bool acquire(const std::uint8_t* data, std::size_t size, Handle& handle) {
+        if (size > Capacity) {
+            return false;
+        }
+        if (m_free.empty()) {
+            handle = static_cast<Handle>(m_buffers.size());
+            m_buffers.emplace_back();
+        } else {
+            handle = m_free.back();
+            m_free.pop_back();
+        }
+        Buffer& buffer = m_buffers[handle];
+        buffer.size = size;
+        std::memcpy(buffer.bytes.data(), data, size);
+        return true;
+    }
+
+    void release(Handle handle) { m_free.push_back(handle); }
+
+    const std::uint8_t* data(Handle handle) const { return m_buffers[handle].bytes.data(); }
+    std::size_t size(Handle handle) const { return m_buffers[handle].size; }
+
+    // Buffers allocated so far, in use or free
+    std::size_t allocated() const { return m_buffers.size(); }
+
+    // Every buffer is free again, the storage is kept
+    void clear() {
+        m_free.clear();
+        for (Handle handle = 0; handle < m_buffers.size(); ++handle) {
+            m_free.push_back(handle);
+        }
+    }
+
+private:
+    struct Buffer {
+        std::size_t size = 0;
+        std::array<std::uint8_t, Capacity> bytes;
+    };
+
+    std::deque<Buffer> m_buffers;  // growing a deque never moves the buffers already handed out
+    std::vector<Handle> m_free;
+};
@@ -0,0 +1,119 @@
+#include "LatencyTracker.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+LatencyHistogram::LatencyHistogram()
+    : m_overflow(0), m_count(0), m_totalUs(0), m_maxUs(0) {
+    m_buckets.fill(0);
+}
+
+void LatencyHistogram::add(std::int64_t latencyUs) {
+    latencyUs = std::max<std::int64_t>(0, latencyUs);
+    std::int64_t index = latencyUs / BUCKET_US;
+    if (index < BUCKET_COUNT) {
+        m_buckets[static_cast<std::size_t>(index)]++;
+    } else {
+        m_overflow++;
+    }
+    m_count++;
+    m_totalUs += latencyUs;
+    m_maxUs = std::max(m_maxUs, latencyUs);
+}
+
+double LatencyHistogram::meanMs() const {
+    return m_count == 0 ? 0.0 : static_cast<double>(m_totalUs) / static_cast<double>(m_count) / 1000.0;
+}
+
+double LatencyHistogram::maxMs() const {
+    return static_cast<double>(m_maxUs) / 1000.0;
+}
+
+double LatencyHistogram::percentileMs(double percentile) const {
+    if (m_count == 0) {
+        return 0.0;
+    }
+    const double target = percentile / 100.0 * static_cast<double>(m_count);
+    std::uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i];
+        if (static_cast<double>(seen) >= target) {
+            return static_cast<double>((i + 1) * BUCKET_US) / 1000.0;
+        }
+    }
+    return maxMs();
+}
+
+LatencyTracker::LatencyTracker() : m_waitingCount(0) {}
+
+void LatencyTracker::onFramePresented(LatencySampleQueue& queue, std::uint64_t presentedInputId,
+                                      std::int64_t displayedUs) {
+    while (m_waitingCount < m_waiting.size()) {
+        auto sample = queue.pop();
+        if (!sample) {
+            break;
+        }
+        m_waiting[m_waitingCount++] = *sample;
+    }
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < m_waitingCount; ++i) {
+        InputLatencySample& sample = m_waiting[i];
+        if (sample.inputId <= presentedInputId) {
+            sample.displayedUs = displayedUs;
+            addSample(sample);
+        } else {
+            m_waiting[kept++] = sample;
+        }
+    }
+    m_waitingCount = kept;
+}
+
+void LatencyTracker::addSample(const InputLatencySample& sample) {
+    m_pollToHandle.add(sample.handledUs - sample.polledUs);
+    m_handleToMutation.add(sample.mutatedUs - sample.handledUs);
+    m_mutationToDisplay.add(sample.displayedUs - sample.mutatedUs);
+    m_total.add(sample.displayedUs - sample.polledUs);
+}
+
+bool LatencyTracker::writeCsv(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not write latency histogram to " << filename << std::endl;
+        return false;
+    }
+
+    file << "bucket_ms,poll_to_handle,handle_to_state,state_to_display,total\n";
+    for (int i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+        file << static_cast<double>((i + 1) * LatencyHistogram::BUCKET_US) / 1000.0 << ','
+             << m_pollToHandle.bucket(i) << ','
+             << m_handleToMutation.bucket(i) << ','
+             << m_mutationToDisplay.bucket(i) << ','
+             << m_total.bucket(i) << '\n';
+    }
+    file << "overflow,"
+         << m_pollToHandle.overflow() << ','
+         << m_handleToMutation.overflow() << ','
+         << m_mutationToDisplay.overflow() << ','
+         << m_total.overflow() << '\n';
+
+    std::cout << "Wrote input latency histogram (" << sampleCount() << " samples) to " << filename << std::endl;
+    return true;
+}
+
+void LatencyTracker::printSummary(std::ostream& out) const {
+    const auto printStage = [&out](const char* name, const LatencyHistogram& histogram) {
+        out << "  " << std::left << std::setw(18) << name << std::right << std::fixed << std::setprecision(2)
+            << " mean " << histogram.meanMs() << " ms"
+            << "  p50 " << histogram.percentileMs(50.0) << " ms"
+            << "  p99 " << histogram.percentileMs(99.0) << " ms"
+            << "  max " << histogram.maxMs() << " ms" << std::endl;
+    };
+
+    out << "Input latency over " << sampleCount() << " key presses:" << std::endl;
+    printStage("poll -> handle", m_pollToHandle);
+    printStage("handle -> state", m_handleToMutation);
+    printStage("state -> display", m_mutationToDisplay);
+    printStage("total", m_total);
+}
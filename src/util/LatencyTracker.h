@@ -0,0 +1,73 @@
+#pragma once
+#include "SpscQueue.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Timestamps of one gameplay key press on its way from the OS to the screen (microseconds)
+struct InputLatencySample {
+    std::uint64_t inputId = 0;
+    std::int64_t polledUs = 0;     // window.pollEvent() returned it (window thread)
+    std::int64_t handledUs = 0;    // GameController passed it to the InputHandler (simulation thread)
+    std::int64_t mutatedUs = 0;    // the GameState was updated with it (simulation thread)
+    std::int64_t displayedUs = 0;  // window.display() returned for the first frame showing it (window thread)
+};
+
+// Samples travel from the simulation thread to the window thread once the game state has them
+using LatencySampleQueue = SpscQueue<InputLatencySample, 256>;
+
+// Fixed bucket histogram of latencies, 0.25 ms buckets up to 100 ms plus an overflow bucket
+class LatencyHistogram {
+public:
+    static constexpr int BUCKET_US = 250;
+    static constexpr int BUCKET_COUNT = 400;
+
+    LatencyHistogram();
+
+    void add(std::int64_t latencyUs);
+
+    std::uint64_t count() const { return m_count; }
+    std::uint64_t bucket(int index) const { return m_buckets[index]; }
+    std::uint64_t overflow() const { return m_overflow; }
+    double meanMs() const;
+    double maxMs() const;
+    // Upper bound of the bucket holding the given percentile (0-100)
+    double percentileMs(double percentile) const;
+
+private:
+    std::array<std::uint64_t, BUCKET_COUNT> m_buckets;
+    std::uint64_t m_overflow;
+    std::uint64_t m_count;
+    std::int64_t m_totalUs;
+    std::int64_t m_maxUs;
+};
+
+// Aggregates completed samples per stage, lives on the window thread
+class LatencyTracker {
+public:
+    LatencyTracker();
+
+    // Call right after window.display(): every queued sample whose input is part of the frame
+    // just presented (id <= presentedInputId) gets its display time and is added to the histograms
+    void onFramePresented(LatencySampleQueue& queue, std::uint64_t presentedInputId, std::int64_t displayedUs);
+
+    void addSample(const InputLatencySample& sample);
+
+    std::uint64_t sampleCount() const { return m_total.count(); }
+
+    // One row per bucket with the count of each stage, then the overflow row
+    bool writeCsv(const std::string& filename) const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    // Samples already applied to the game state but not part of a presented frame yet
+    std::array<InputLatencySample, 64> m_waiting;
+    std::size_t m_waitingCount;
+
+    LatencyHistogram m_pollToHandle;
+    LatencyHistogram m_handleToMutation;
+    LatencyHistogram m_mutationToDisplay;
+    LatencyHistogram m_total;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Storage is allocated once with the queue, push() fails instead of growing when it is full.
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() : m_head(0), m_tail(0) {}
+
+    // Producer side
+    bool push(const T& value) {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_slots[head & (Capacity - 1)].emplace(value);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    std::optional<T> pop() {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        std::optional<T>& slot = m_slots[tail & (Capacity - 1)];
+        std::optional<T> value = std::move(slot);
+        slot.reset();
+        m_tail.store(tail + 1, std::memory_order_release);
+        return value;
+    }
+
+    // Approximate when called from a third thread, exact from either end
+    std::size_t size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<std::optional<T>, Capacity> m_slots;
+    alignas(64) std::atomic<std::size_t> m_head;  // next slot to write, owned by the producer
+    alignas(64) std::atomic<std::size_t> m_tail;  // next slot to read, owned by the consumer
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for handing the latest value from one producer thread to one consumer thread.
+// The producer fills writeBuffer() then publish()es it; the consumer calls fetch() to swap in the newest
+// published value and reads it through readBuffer(). Neither side ever waits on the other, intermediate
+// values the consumer did not get to are simply skipped.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : m_shared(1), m_writeIndex(0), m_readIndex(2) {}
+
+    // Producer side
+    T& writeBuffer() { return m_buffers[m_writeIndex]; }
+
+    void publish() {
+        // Hand our slot over as the fresh shared slot and take back whatever was shared before
+        std::uint8_t previous = m_shared.exchange(static_cast<std::uint8_t>(m_writeIndex | FRESH_BIT),
+                                                  std::memory_order_acq_rel);
+        m_writeIndex = previous & INDEX_MASK;
+    }
+
+    // Consumer side, returns true if a newer value was swapped in
+    bool fetch() {
+        if ((m_shared.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+            return false;
+        }
+        std::uint8_t previous = m_shared.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    const T& readBuffer() const { return m_buffers[m_readIndex]; }
+
+private:
+    static constexpr std::uint8_t INDEX_MASK = 0x3;
+    static constexpr std::uint8_t FRESH_BIT = 0x4;
+
+    std::array<T, 3> m_buffers;
+    std::atomic<std::uint8_t> m_shared;  // index of the slot in between, plus FRESH_BIT once published
+    std::uint8_t m_writeIndex;           // only touched by the producer
+    std::uint8_t m_readIndex;            // only touched by the consumer
+};
@@ -1,15 +1,19 @@
 #include "GameView.h"
-#include "../model/LevelBasedMode.h"
-#include "../model/AIMode.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <string>
 #include <iostream>
 #include <stdexcept>
 
 
+GameView::HudTexts::HudTexts(const sf::Font& font)
+    : score(font, 24), mode(font, 20), level(font, 20), lines(font, 20) {}
+
 // Initialize the view
-GameView::GameView() : m_fontLoaded(false), m_localPlayerReady(false), m_remotePlayerReady(false) {
+GameView::GameView()
+    : m_fontLoaded(false),
+      m_textCache(m_font), m_hud{HudTexts(m_font), HudTexts(m_font)}, m_networkText(m_font, 14), m_replayText(m_font, 14) {
     // Initialize texture manager for block textures
     m_textureManager = std::make_unique<TextureManager>();
     
@@ -29,24 +33,23 @@ GameView::GameView() : m_fontLoaded(false), m_localPlayerReady(false), m_remoteP
         std::cerr << "Exception loading font: " << e.what() << std::endl;
         m_fontLoaded = false;
     }
+
+    // Rasterize the HUD glyphs now rather than on the first game frame
+    if (m_fontLoaded) {
+        m_textCache.prewarm({20, 24, 28});
+    }
 }
 
 // Main render function that draws everything to the screen
-void GameView::render(sf::RenderWindow& window, const GameState& state,
-                      const MenuView& menuView, MenuState menuState, int selectedOption,
-                      bool isMultiplayer, const GameState* remoteState,
-                      int winnerId, const std::string& winnerName,
-                      bool isNetworkConnected, const std::string& localIP,
-                      bool localPlayerReady, bool remotePlayerReady, float musicVolume) {
-    // Store ready status for NETWORK_READY menu rendering
-    m_localPlayerReady = localPlayerReady;
-    m_remotePlayerReady = remotePlayerReady;
-    
+void GameView::render(sf::RenderWindow& window, const RenderSnapshot& snapshot, const MenuView& menuView) {
+    const MenuState menuState = snapshot.menuState;
+    const int selectedOption = snapshot.selectedOption;
+
     // Clear the window with black background
     window.clear(sf::Color::Black);
 
     // Always render the game in the background (even if menu is showing)
-    renderGame(window, state, isMultiplayer, remoteState);
+    renderGame(window, snapshot);
 
     // Then render menu on top if a menu is active
     if (menuState != MenuState::NONE) {
@@ -70,49 +73,48 @@ void GameView::render(sf::RenderWindow& window, const GameState& state,
                 menuView.renderLANMultiplayerMenu(window, selectedOption);
                 break;
             case MenuState::HOST_GAME:
-                menuView.renderHostGame(window, localIP, isNetworkConnected);
+                menuView.renderHostGame(window, snapshot.localIP, snapshot.isNetworkConnected);
                 break;
             case MenuState::JOIN_GAME:
-                menuView.renderJoinGame(window, selectedOption, m_ipInput);
+                menuView.renderJoinGame(window, selectedOption, snapshot.ipInput);
                 break;
             case MenuState::NETWORK_READY:
-                menuView.renderNetworkReady(window, selectedOption, m_localPlayerReady, m_remotePlayerReady);
+                menuView.renderNetworkReady(window, selectedOption, snapshot.localPlayerReady, snapshot.remotePlayerReady);
                 break;
             case MenuState::PAUSE_MENU:
-                menuView.renderPauseMenu(window, selectedOption, musicVolume);
+                menuView.renderPauseMenu(window, selectedOption, snapshot.musicVolume);
                 break;
             case MenuState::SETTINGS_MENU:
-                menuView.renderSettingsMenu(window, selectedOption, musicVolume);
+                menuView.renderSettingsMenu(window, selectedOption, snapshot.musicVolume);
                 break;
             case MenuState::GAME_OVER: {
-                int player1Lines = 0;
-                if (state.getGameMode()) {
-                    player1Lines = state.getGameMode()->getLinesCleared();
-                }
-
                 int player2Lines = 0;
                 int player2Score = 0;
-                if (remoteState && remoteState->getGameMode()) {
-                    player2Lines = remoteState->getGameMode()->getLinesCleared();
-                    player2Score = remoteState->score();
+                if (snapshot.isMultiplayer) {
+                    player2Lines = snapshot.remote.linesCleared;
+                    player2Score = snapshot.remote.score;
                 }
 
-                menuView.renderGameOver(window, state.score(), player1Lines, selectedOption,
-                                       isMultiplayer, winnerId, winnerName,
+                menuView.renderGameOver(window, snapshot.local.score, snapshot.local.linesCleared, selectedOption,
+                                       snapshot.isMultiplayer, snapshot.winnerId, snapshot.winnerName,
                                        player2Score, player2Lines);
                 break;
             }
             default:
                 break;
         }
+    } else if (snapshot.isNetworkReconnecting) {
+        menuView.renderReconnecting(window);
     }
 
     window.display();
 }
 
 // Render the actual game (board, pieces, UI)
-void GameView::renderGame(sf::RenderWindow& window, const GameState& state, bool isMultiplayer, const GameState* remoteState) {
-    if (isMultiplayer && remoteState) {
+void GameView::renderGame(sf::RenderWindow& window, const RenderSnapshot& snapshot) {
+    const PlayerSnapshot& state = snapshot.local;
+    if (snapshot.isMultiplayer) {
+        const PlayerSnapshot& remoteState = snapshot.remote;
         // Split-screen multiplayer mode - show both players side by side
         float windowWidth = static_cast<float>(window.getSize().x);
         float windowHeight = static_cast<float>(window.getSize().y);
@@ -124,35 +126,42 @@ void GameView::renderGame(sf::RenderWindow& window, const GameState& state, bool
         
         // Left board (local player)
         float leftX = startX - BoardOffsetX;
-        drawBoard(window, state.board(), state, leftX, 0.0f);
-        if (!state.isClearingLines()) {
+        drawBoard(window, state, 0, leftX, 0.0f);
+        if (!state.isClearingLines) {
             drawCurrentPiece(window, state, leftX, 0.0f);
         }
         float previewLeftX = leftX + (Board::Width * CellSize - 4 * CellSize) / 2.0f;
-        drawNextPiece(window, state.nextPiece(), previewLeftX - 250, 0.0f);
-        drawUI(window, state, leftX - BoardOffsetX - 150, "You");
+        drawNextPiece(window, state.nextPiece, previewLeftX - 250, 0.0f);
+        drawUI(window, state, 0, leftX - BoardOffsetX - 150, "You");
         
         // Right board (remote player)
         float rightX = startX + boardWidth + spacing - BoardOffsetX;
-        drawBoard(window, remoteState->board(), *remoteState, rightX, 0.0f);
-        if (!remoteState->isClearingLines()) {
-            drawCurrentPiece(window, *remoteState, rightX, 0.0f);
+        drawBoard(window, remoteState, 1, rightX, 0.0f);
+        if (!remoteState.isClearingLines) {
+            drawCurrentPiece(window, remoteState, rightX, 0.0f);
         }
         float previewRightX = rightX + (Board::Width * CellSize - 4 * CellSize) / 2.0f;
-        drawNextPiece(window, remoteState->nextPiece(), previewRightX + 250, 0.0f);
-        drawUI(window, *remoteState, rightX + BoardOffsetX + 300, "Opponent");
+        drawNextPiece(window, remoteState.nextPiece, previewRightX + 250, 0.0f);
+        drawUI(window, remoteState, 1, rightX + BoardOffsetX + 300, "Opponent");
         
+        if (snapshot.showNetworkStats) {
+            drawNetworkStats(window, snapshot);
+        }
     } else {
         // Solo mode
-        drawBoard(window, state.board(), state);
+        drawBoard(window, state, 0);
         
-        if (!state.isClearingLines()) {
+        if (!state.isClearingLines) {
             drawCurrentPiece(window, state);
         }
         
         float nextPieceX = BoardOffsetX + Board::Width * CellSize + 50.0f;
-        drawNextPiece(window, state.nextPiece(), nextPieceX - BoardOffsetX, 0.0f);
-        drawUI(window, state);
+        drawNextPiece(window, state.nextPiece, nextPieceX - BoardOffsetX, 0.0f);
+        drawUI(window, state, 0);
+
+        if (snapshot.showReplay) {
+            drawReplayStatus(window, snapshot);
+        }
     }
 }
 
@@ -169,45 +178,100 @@ sf::Color GameView::colorForId(int colorId) const {
     }
 }
 
-void GameView::drawBoard(sf::RenderWindow& window, const Board& board, const GameState& state,
-                         float offsetX, float offsetY) {
+void GameView::drawCells(sf::RenderTarget& target, const Board& board, float originX, float originY) {
     sf::RectangleShape cell;
     cell.setSize(sf::Vector2f(static_cast<float>(CellSize - 1),
                               static_cast<float>(CellSize - 1)));
-
-    float boardX = BoardOffsetX + offsetX;
-    float boardY = BoardOffsetY + offsetY;
-    float animationProgress = state.isClearingLines() ? state.getClearAnimationProgress() : 0.0f;
+    cell.setFillColor(sf::Color(30, 30, 30));
 
     for (int y = 0; y < Board::Height; ++y) {
         for (int x = 0; x < Board::Width; ++x) {
             const int value = board.getCell(x, y);
-            
-            // Vérifier si c'est une ligne en cours de suppression (valeur -1)
+
+            // Lines being cleared (value -1) are animated every frame on top of the layer
             if (value == -1) {
-                //on utilise un sinus pour l'animation de disparition
-                float pulse = 0.5f + 0.5f * std::sin(animationProgress * 3.14159f * 4.0f);
-                unsigned char alpha = static_cast<unsigned char>(255 * (1.0f - animationProgress) * pulse);
-                cell.setFillColor(sf::Color(255, 255, 255, alpha));
-                cell.setPosition({boardX + static_cast<float>(x * CellSize),
-                                  boardY + static_cast<float>(y * CellSize)});
-                window.draw(cell);
+                continue;
             } else if (value == 0) {
-                cell.setFillColor(sf::Color(30, 30, 30));
-                cell.setPosition({boardX + static_cast<float>(x * CellSize),
-                                  boardY + static_cast<float>(y * CellSize)});
-                window.draw(cell);
+                cell.setPosition({originX + static_cast<float>(x * CellSize),
+                                  originY + static_cast<float>(y * CellSize)});
+                target.draw(cell);
             } else {
                 // Draw textured block
                 sf::Sprite blockSprite(m_textureManager->getBlockTexture(value));
                 blockSprite.setScale({static_cast<float>(CellSize - 1) / 32.0f,
                                     static_cast<float>(CellSize - 1) / 32.0f});
-                blockSprite.setPosition({boardX + static_cast<float>(x * CellSize),
-                                        boardY + static_cast<float>(y * CellSize)});
-                window.draw(blockSprite);
+                blockSprite.setPosition({originX + static_cast<float>(x * CellSize),
+                                        originY + static_cast<float>(y * CellSize)});
+                target.draw(blockSprite);
             }
         }
     }
+}
+
+bool GameView::updateBoardLayer(BoardLayer& layer, const Board& board) {
+    if (layer.failed) {
+        return false;
+    }
+    if (layer.valid && layer.version == board.version()) {
+        return true;
+    }
+
+    if (!layer.valid) {
+        if (!layer.texture.resize({static_cast<unsigned int>(Board::Width * CellSize),
+                                   static_cast<unsigned int>(Board::Height * CellSize)})) {
+            std::cerr << "Warning: Could not create board render texture, drawing cells directly" << std::endl;
+            layer.failed = true;
+            return false;
+        }
+    }
+
+    layer.texture.clear(sf::Color::Transparent);
+    drawCells(layer.texture, board, 0.0f, 0.0f);
+    layer.texture.display();
+    layer.version = board.version();
+    layer.valid = true;
+    return true;
+}
+
+void GameView::drawBoard(sf::RenderWindow& window, const PlayerSnapshot& player, int layerIndex,
+                         float offsetX, float offsetY) {
+    const Board& board = player.board;
+    float boardX = BoardOffsetX + offsetX;
+    float boardY = BoardOffsetY + offsetY;
+
+    // Settled stack: one sprite blit unless a lock, clear or garbage changed the board
+    BoardLayer& layer = m_boardLayers[layerIndex];
+    if (updateBoardLayer(layer, board)) {
+        sf::Sprite layerSprite(layer.texture.getTexture());
+        layerSprite.setPosition({boardX, boardY});
+        window.draw(layerSprite);
+    } else {
+        drawCells(window, board, boardX, boardY);
+    }
+
+    // Line clear animation is the only per-frame part of the board
+    // (mirrored remote boards may carry -1 rows without the clearing flag, so scan rows directly)
+    float animationProgress = player.isClearingLines ? player.clearAnimationProgress : 0.0f;
+    //on utilise un sinus pour l'animation de disparition
+    float pulse = 0.5f + 0.5f * std::sin(animationProgress * 3.14159f * 4.0f);
+    unsigned char alpha = static_cast<unsigned char>(255 * (1.0f - animationProgress) * pulse);
+
+    sf::RectangleShape cell;
+    cell.setSize(sf::Vector2f(static_cast<float>(CellSize - 1),
+                              static_cast<float>(CellSize - 1)));
+    cell.setFillColor(sf::Color(255, 255, 255, alpha));
+
+    for (int y = 0; y < Board::Height; ++y) {
+        // Cleared lines are marked across the whole row
+        if (board.getCell(0, y) != -1) {
+            continue;
+        }
+        for (int x = 0; x < Board::Width; ++x) {
+            cell.setPosition({boardX + static_cast<float>(x * CellSize),
+                              boardY + static_cast<float>(y * CellSize)});
+            window.draw(cell);
+        }
+    }
 
     // Board border
     sf::RectangleShape border;
@@ -220,25 +284,25 @@ void GameView::drawBoard(sf::RenderWindow& window, const Board& board, const Gam
     window.draw(border);
 }
 
-void GameView::drawCurrentPiece(sf::RenderWindow& window, const GameState& state,
+void GameView::drawCurrentPiece(sf::RenderWindow& window, const PlayerSnapshot& player,
                                  float offsetX, float offsetY) {
-    const Tetromino& piece = state.currentPiece();
-    const int baseX = state.pieceX();
-    const int baseY = state.pieceY();
+    const PieceSnapshot& piece = player.currentPiece;
+    const int baseX = player.pieceX;
+    const int baseY = player.pieceY;
 
     float boardX = BoardOffsetX + offsetX;
     float boardY = BoardOffsetY + offsetY;
 
     // Draw Ghost Piece
-    int ghostY = state.getGhostY();
+    int ghostY = player.ghostY;
     sf::Color ghostColor = sf::Color::White;
     ghostColor.a = 64; // Semi-transparent
 
-    for (const auto& offset : piece.getBlocks()) {
+    for (const auto& offset : piece.blocks) {
         const int x = baseX + offset.x;
         const int y = ghostY + offset.y;
         if (x >= 0 && x < Board::Width && y >= 0 && y < Board::Height) {
-            sf::Sprite ghostSprite(m_textureManager->getBlockTexture(piece.getColorId()));
+            sf::Sprite ghostSprite(m_textureManager->getBlockTexture(piece.colorId));
             ghostSprite.setColor(ghostColor);
             ghostSprite.setScale({static_cast<float>(CellSize - 1) / 32.0f,
                                 static_cast<float>(CellSize - 1) / 32.0f});
@@ -249,7 +313,7 @@ void GameView::drawCurrentPiece(sf::RenderWindow& window, const GameState& state
     }
 
     // Draw actual piece with texture and outline
-    sf::Sprite blockSprite(m_textureManager->getBlockTexture(piece.getColorId()));
+    sf::Sprite blockSprite(m_textureManager->getBlockTexture(piece.colorId));
     blockSprite.setScale({static_cast<float>(CellSize - 1) / 32.0f,
                         static_cast<float>(CellSize - 1) / 32.0f});
 
@@ -261,7 +325,7 @@ void GameView::drawCurrentPiece(sf::RenderWindow& window, const GameState& state
     outline.setOutlineThickness(1.0f);
     outline.setOutlineColor(sf::Color(255, 255, 255, 128));
 
-    for (const auto& offset : piece.getBlocks()) {
+    for (const auto& offset : piece.blocks) {
         const int x = baseX + offset.x;
         const int y = baseY + offset.y;
 
@@ -278,15 +342,14 @@ void GameView::drawCurrentPiece(sf::RenderWindow& window, const GameState& state
     }
 }
 
-void GameView::drawNextPiece(sf::RenderWindow& window, const Tetromino& nextPiece,
+void GameView::drawNextPiece(sf::RenderWindow& window, const PieceSnapshot& nextPiece,
                              float offsetX, float offsetY) {
     float previewX = BoardOffsetX + offsetX;
     float previewY = BoardOffsetY + offsetY;
 
     // Label "NEXT"
     if (m_fontLoaded) {
-        sf::Text label(m_font, "NEXT");
-        label.setCharacterSize(20);
+        sf::Text& label = m_textCache.get("NEXT", 20);
         label.setFillColor(sf::Color::White);
         label.setPosition({static_cast<float>(previewX), static_cast<float>(previewY - 30)});
         window.draw(label);
@@ -294,7 +357,7 @@ void GameView::drawNextPiece(sf::RenderWindow& window, const Tetromino& nextPiec
 
     // Determine bounding box to center the preview
     int minX = 999, minY = 999, maxX = -999, maxY = -999;
-    for (const auto& block : nextPiece.getBlocks()) {
+    for (const auto& block : nextPiece.blocks) {
         minX = std::min(minX, block.x);
         minY = std::min(minY, block.y);
         maxX = std::max(maxX, block.x);
@@ -307,11 +370,11 @@ void GameView::drawNextPiece(sf::RenderWindow& window, const Tetromino& nextPiec
     const float pieceOffsetX = previewX + (4 - width) * CellSize / 2.0f;
     const float pieceOffsetY = previewY + (4 - height) * CellSize / 2.0f;
 
-    sf::Sprite blockSprite(m_textureManager->getBlockTexture(nextPiece.getColorId()));
+    sf::Sprite blockSprite(m_textureManager->getBlockTexture(nextPiece.colorId));
     blockSprite.setScale({static_cast<float>(CellSize - 1) / 32.0f,
                         static_cast<float>(CellSize - 1) / 32.0f});
 
-    for (const auto& b : nextPiece.getBlocks()) {
+    for (const auto& b : nextPiece.blocks) {
         const int x = b.x - minX;
         const int y = b.y - minY;
         blockSprite.setPosition({pieceOffsetX + static_cast<float>(x * CellSize),
@@ -320,7 +383,7 @@ void GameView::drawNextPiece(sf::RenderWindow& window, const Tetromino& nextPiec
     }
 }
 
-void GameView::drawUI(sf::RenderWindow& window, const GameState& state,
+void GameView::drawUI(sf::RenderWindow& window, const PlayerSnapshot& player, int hudIndex,
                       float offsetX, const std::string& playerLabel) {
     if (!m_fontLoaded) return; // Pas de police, pas d'UI texte
 
@@ -336,44 +399,33 @@ void GameView::drawUI(sf::RenderWindow& window, const GameState& state,
     float uiY = BoardOffsetY + 200.0f;
     const float lineHeight = playerLabel.empty() ? 30.0f : 28.0f;
 
+    HudTexts& hud = m_hud[hudIndex];
+
     // Player label (for multiplayer)
     if (!playerLabel.empty()) {
-        sf::Text labelText(m_font, playerLabel);
-        labelText.setCharacterSize(28);
+        sf::Text& labelText = m_textCache.get(playerLabel, 28);
         labelText.setFillColor(sf::Color::Yellow);
         labelText.setPosition({uiX, uiY - 40.0f});
         window.draw(labelText);
     }
 
     // Score
-    sf::Text scoreText(m_font, "Score: " + std::to_string(state.score()));
-    scoreText.setCharacterSize(24);
+    sf::Text& scoreText = hud.score.setValue("Score: ", player.score);
     scoreText.setFillColor(sf::Color::White);
     scoreText.setPosition({uiX, uiY});
     window.draw(scoreText);
 
     // Mode name and mode-specific info
     uiY += lineHeight;
-    const char* modeName = state.getGameMode() ? state.getGameMode()->getModeName() : "Unknown";
-    sf::Text modeText(m_font, std::string("Mode: ") + modeName);
-    modeText.setCharacterSize(20);
+    sf::Text& modeText = hud.mode.setText("Mode: ", player.modeName);
     modeText.setFillColor(sf::Color::Cyan);
     modeText.setPosition({uiX, uiY});
     window.draw(modeText);
 
     // Show level
     uiY += lineHeight;
-    const auto* levelMode = dynamic_cast<const LevelBasedMode*>(state.getGameMode());
-    const auto* aiMode = dynamic_cast<const AIMode*>(state.getGameMode());
-    if (levelMode) {
-        sf::Text levelText(m_font, "Level: " + std::to_string(levelMode->getCurrentLevel()));
-        levelText.setCharacterSize(20);
-        levelText.setFillColor(sf::Color::Green);
-        levelText.setPosition({uiX, uiY});
-        window.draw(levelText);
-    } else if (aiMode) {
-        sf::Text levelText(m_font, "Level: " + std::to_string(aiMode->getCurrentLevel()));
-        levelText.setCharacterSize(20);
+    if (player.hasLevel) {
+        sf::Text& levelText = hud.level.setValue("Level: ", player.level);
         levelText.setFillColor(sf::Color::Green);
         levelText.setPosition({uiX, uiY});
         window.draw(levelText);
@@ -381,13 +433,53 @@ void GameView::drawUI(sf::RenderWindow& window, const GameState& state,
     
     // Show lines cleared for all modes
     uiY += lineHeight;
-    if (state.getGameMode()) {
-        sf::Text linesText(m_font, "Lines: " + std::to_string(state.getGameMode()->getLinesCleared()));
-        linesText.setCharacterSize(20);
-        linesText.setFillColor(sf::Color::Yellow);
-        linesText.setPosition({uiX, uiY});
-        window.draw(linesText);
+    sf::Text& linesText = hud.lines.setValue("Lines: ", player.linesCleared);
+    linesText.setFillColor(sf::Color::Yellow);
+    linesText.setPosition({uiX, uiY});
+    window.draw(linesText);
+}
+
+void GameView::drawNetworkStats(sf::RenderWindow& window, const RenderSnapshot& snapshot) {
+    if (!m_fontLoaded) return;
+
+    const TrafficRates& traffic = snapshot.networkTraffic;
+    char line[192];
+    if (!traffic.valid) {
+        std::snprintf(line, sizeof(line), "measuring...");
+    } else {
+        std::snprintf(line, sizeof(line),
+                      "out %.1f KB/s %.0f msg/s | in %.1f KB/s %.0f msg/s | stale %.1f/s | empty reads %.0f%% | queue %d",
+                      traffic.bytesSentPerSecond / 1024.0f, traffic.messagesSentPerSecond,
+                      traffic.bytesReceivedPerSecond / 1024.0f, traffic.messagesReceivedPerSecond,
+                      traffic.staleStatesPerSecond, traffic.emptyReadShare * 100.0f, traffic.maxSendQueueDepth);
+    }
+    std::string text = line;
+    if (snapshot.networkRttMs >= 0.0f) {
+        std::snprintf(line, sizeof(line), " | rtt %.0f ms", snapshot.networkRttMs);
+        text += line;
     }
+
+    sf::Text& networkText = m_networkText.setText("Net: ", text);
+    networkText.setFillColor(sf::Color(160, 160, 160));
+    networkText.setPosition({10.0f, static_cast<float>(window.getSize().y) - 22.0f});
+    window.draw(networkText);
+}
+
+void GameView::drawReplayStatus(sf::RenderWindow& window, const RenderSnapshot& snapshot) {
+    if (!m_fontLoaded) return;
+
+    const std::uint32_t rate = std::max<std::uint32_t>(snapshot.replayTickRate, 1);
+    const std::uint32_t seconds = snapshot.replayTick / rate;
+    const std::uint32_t total = snapshot.replayLength / rate;
+    char line[192];
+    std::snprintf(line, sizeof(line), "%u:%02u / %u:%02u | %dx%s | Up/Down speed, Left/Right 10 s, Space pause, Esc menu",
+                  seconds / 60, seconds % 60, total / 60, total % 60, snapshot.replaySpeed,
+                  snapshot.replayPaused ? " | paused" : (snapshot.replayTick >= snapshot.replayLength ? " | end" : ""));
+
+    sf::Text& replayText = m_replayText.setText("Replay: ", line);
+    replayText.setFillColor(sf::Color(160, 160, 160));
+    replayText.setPosition({10.0f, static_cast<float>(window.getSize().y) - 22.0f});
+    window.draw(replayText);
 }
 
 void GameView::drawGameOverScreen(sf::RenderWindow& window, int finalScore) {
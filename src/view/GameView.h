@@ -1,37 +1,24 @@
 #pragma once
 #include <SFML/Graphics.hpp>
-#include "../model/GameState.h"
-#include "../model/GameMode.h"
+#include "RenderSnapshot.h"
 #include "MenuView.h"
 #include "TextureManager.h"
+#include "TextCache.h"
+#include <array>
+#include <cstdint>
 #include <memory>
 
 // Handles rendering the game state to the window.
+// Runs on the render thread and only reads RenderSnapshots published by the simulation thread.
 class GameView {
 public:
     GameView();
 
     // Render the entire game scene (game or menu)
-    void render(sf::RenderWindow& window, const GameState& state, 
-               const MenuView& menuView, MenuState menuState, int selectedOption,
-               bool isMultiplayer = false, const GameState* remoteState = nullptr,
-               int winnerId = -1, const std::string& winnerName = "",
-               bool isNetworkConnected = false, const std::string& localIP = "",
-               bool localPlayerReady = false, bool remotePlayerReady = false,
-               float musicVolume = 50.0f);
+    void render(sf::RenderWindow& window, const RenderSnapshot& snapshot, const MenuView& menuView);
 
     // Render just the game (without menu overlay)
-    void renderGame(sf::RenderWindow& window, const GameState& state, 
-                   bool isMultiplayer = false, const GameState* remoteState = nullptr);
-    
-    // Set IP input for JOIN_GAME menu
-    void setIPInput(const std::string& ipInput) { m_ipInput = ipInput; }
-    
-    // Set ready status for NETWORK_READY menu
-    void setNetworkReadyStatus(bool localReady, bool remoteReady) {
-        m_localPlayerReady = localReady;
-        m_remotePlayerReady = remoteReady;
-    }
+    void renderGame(sf::RenderWindow& window, const RenderSnapshot& snapshot);
 
 private:
     static constexpr int CellSize = 30;
@@ -40,20 +27,48 @@ private:
 
     sf::Font m_font;
     bool m_fontLoaded;
-    std::string m_ipInput;  // For JOIN_GAME menu
-    bool m_localPlayerReady;  // For NETWORK_READY menu
-    bool m_remotePlayerReady;  // For NETWORK_READY menu
     std::unique_ptr<TextureManager> m_textureManager;  // For block textures
 
+    // Settled stack of one player's board, re-rendered only when the board version changes
+    struct BoardLayer {
+        sf::RenderTexture texture;
+        std::uint32_t version = 0;
+        bool valid = false;
+        bool failed = false;  // render texture could not be created, draw cells directly
+    };
+    std::array<BoardLayer, 2> m_boardLayers;  // 0 = local player, 1 = remote player
+
+    // HUD texts of one player, re-laid out only when the shown values change
+    struct HudTexts {
+        explicit HudTexts(const sf::Font& font);
+        DynamicText score;
+        DynamicText mode;
+        DynamicText level;
+        DynamicText lines;
+    };
+    TextCache m_textCache;
+    std::array<HudTexts, 2> m_hud;  // same indices as m_boardLayers
+    DynamicText m_networkText;
+    DynamicText m_replayText;
+
     sf::Color colorForId(int colorId) const;
 
-    void drawBoard(sf::RenderWindow& window, const Board& board, const GameState& state, 
+    // Draw the settled cells (empty and locked blocks, not the clearing animation) at the given origin
+    void drawCells(sf::RenderTarget& target, const Board& board, float originX, float originY);
+    // Refresh the cached layer if the board changed since it was last rendered
+    bool updateBoardLayer(BoardLayer& layer, const Board& board);
+
+    void drawBoard(sf::RenderWindow& window, const PlayerSnapshot& player, int layerIndex,
                    float offsetX = 0.0f, float offsetY = 0.0f);
-    void drawCurrentPiece(sf::RenderWindow& window, const GameState& state, 
+    void drawCurrentPiece(sf::RenderWindow& window, const PlayerSnapshot& player,
                           float offsetX = 0.0f, float offsetY = 0.0f);
-    void drawNextPiece(sf::RenderWindow& window, const Tetromino& nextPiece, 
+    void drawNextPiece(sf::RenderWindow& window, const PieceSnapshot& nextPiece,
                        float offsetX = 0.0f, float offsetY = 0.0f);
-    void drawUI(sf::RenderWindow& window, const GameState& state, 
+    void drawUI(sf::RenderWindow& window, const PlayerSnapshot& player, int hudIndex,
                 float offsetX = 0.0f, const std::string& playerLabel = "");
     void drawGameOverScreen(sf::RenderWindow& window, int finalScore);
+    // One line of LAN traffic at the bottom of the window
+    void drawNetworkStats(sf::RenderWindow& window, const RenderSnapshot& snapshot);
+    // Position, speed and keys of a replay, at the same place
+    void drawReplayStatus(sf::RenderWindow& window, const RenderSnapshot& snapshot);
 };
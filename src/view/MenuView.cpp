@@ -2,7 +2,13 @@
 #include <string>
 
 //default constructor
-MenuView::MenuView() : m_fontLoaded(false) {
+MenuView::MenuView()
+    : m_fontLoaded(false),
+      m_textCache(m_font),
+      m_pauseVolumeText(m_font, 20),
+      m_settingsVolumeText(m_font, 28),
+      m_hostIPText(m_font, static_cast<unsigned int>(OPTION_SIZE)),
+      m_ipInputText(m_font, 32) {
     // Try to load a system font (different paths for different operating systems)
     if (!m_font.openFromFile("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf") &&  // Linux
         !m_font.openFromFile("/System/Library/Fonts/Arial.ttf") &&  // macOS
@@ -11,6 +17,11 @@ MenuView::MenuView() : m_fontLoaded(false) {
     } else {
         m_fontLoaded = true;  // Successfully loaded a font
     }
+
+    // Rasterize every size used by the menus up front so the first frame of a menu does not hitch
+    if (m_fontLoaded) {
+        m_textCache.prewarm({20, 24, 28, 30, 32, 36, 44, 48});
+    }
 }
 
 void MenuView::renderMainMenu(sf::RenderWindow& window, int selectedOption) const {
@@ -121,7 +132,9 @@ void MenuView::renderHostGame(sf::RenderWindow& window, const std::string& local
     drawCenteredText(window, "Hosting Game", 100.0f, TITLE_SIZE, sf::Color::White);
 
     // Show local IP
-    drawCenteredText(window, "Your IP: " + localIP, 200.0f, OPTION_SIZE, sf::Color::Cyan);
+    if (m_fontLoaded) {
+        drawCentered(window, m_hostIPText.setText("Your IP: ", localIP), 200.0f, sf::Color::Cyan);
+    }
 
     // Show status
     if (connected) {
@@ -161,9 +174,9 @@ void MenuView::renderJoinGame(sf::RenderWindow& window, int selectedOption, cons
 
     // Draw IP text
     if (m_fontLoaded) {
-        sf::Text ipText(m_font, ipInput.empty() ? "192.168.x.x" : ipInput, 32);
+        sf::Text& ipText = ipInput.empty() ? m_textCache.get("192.168.x.x", 32)
+                                           : m_ipInputText.setText("", ipInput);
         ipText.setFillColor(ipInput.empty() ? sf::Color(100, 100, 100) : sf::Color::White);
-        sf::FloatRect bounds = ipText.getLocalBounds();
         ipText.setPosition(sf::Vector2f(boxX + 10, boxY + 10));
         window.draw(ipText);
     }
@@ -173,6 +186,18 @@ void MenuView::renderJoinGame(sf::RenderWindow& window, int selectedOption, cons
     drawMenuOption(window, "Back", 360.0f + OPTION_SPACING, selectedOption == 1);
 }
 
+void MenuView::renderReconnecting(sf::RenderWindow& window) const {
+    // Dim the frozen boards
+    sf::RectangleShape overlay({static_cast<float>(window.getSize().x),
+                               static_cast<float>(window.getSize().y)});
+    overlay.setFillColor(sf::Color(0, 0, 0, 150));
+    window.draw(overlay);
+
+    const float centerY = window.getSize().y / 2.0f;
+    drawCenteredText(window, "Connection lost", centerY - 50.0f, OPTION_SIZE, sf::Color::Yellow);
+    drawCenteredText(window, "Reconnecting...", centerY, OPTION_SIZE - 6, sf::Color::White);
+}
+
 void MenuView::renderPauseMenu(sf::RenderWindow& window, int selectedOption, float musicVolume) const {
     // Draw semi-transparent overlay
     sf::RectangleShape overlay({static_cast<float>(window.getSize().x),
@@ -199,8 +224,7 @@ void MenuView::renderPauseMenu(sf::RenderWindow& window, int selectedOption, flo
     // Draw volume slider
     float sliderY = boxY + 100.0f;
     if (m_fontLoaded) {
-        sf::Text volumeLabel(m_font, "Music Volume");
-        volumeLabel.setCharacterSize(24);
+        sf::Text& volumeLabel = m_textCache.get("Music Volume", 24);
         volumeLabel.setFillColor(sf::Color::White);
         volumeLabel.setPosition({boxX + 50.0f, sliderY});
         window.draw(volumeLabel);
@@ -231,8 +255,7 @@ void MenuView::renderPauseMenu(sf::RenderWindow& window, int selectedOption, flo
     
     // Volume percentage
     if (m_fontLoaded) {
-        sf::Text volumeText(m_font, std::to_string(static_cast<int>(musicVolume)) + "%");
-        volumeText.setCharacterSize(20);
+        sf::Text& volumeText = m_pauseVolumeText.setValue("", static_cast<int>(musicVolume), "%");
         volumeText.setFillColor(sf::Color::White);
         volumeText.setPosition({sliderX + sliderWidth + 15.0f, sliderY - 12.0f});
         window.draw(volumeText);
@@ -257,8 +280,7 @@ void MenuView::renderSettingsMenu(sf::RenderWindow& window, int selectedOption,
     // Draw volume slider
     float sliderY = 250.0f;
     if (m_fontLoaded) {
-        sf::Text volumeLabel(m_font, "Music Volume");
-        volumeLabel.setCharacterSize(30);
+        sf::Text& volumeLabel = m_textCache.get("Music Volume", 30);
         volumeLabel.setFillColor(sf::Color::White);
         float labelWidth = volumeLabel.getLocalBounds().size.x;
         volumeLabel.setPosition({(window.getSize().x - labelWidth) / 2.0f, sliderY});
@@ -290,8 +312,7 @@ void MenuView::renderSettingsMenu(sf::RenderWindow& window, int selectedOption,
     
     // Volume percentage
     if (m_fontLoaded) {
-        sf::Text volumeText(m_font, std::to_string(static_cast<int>(musicVolume)) + "%");
-        volumeText.setCharacterSize(28);
+        sf::Text& volumeText = m_settingsVolumeText.setValue("", static_cast<int>(musicVolume), "%");
         volumeText.setFillColor(sf::Color::White);
         volumeText.setPosition({sliderX + sliderWidth + 20.0f, sliderY - 10.0f});
         window.draw(volumeText);
@@ -312,14 +333,12 @@ void MenuView::renderNetworkReady(sf::RenderWindow& window, int selectedOption,
     drawCenteredText(window, "Ready to Play?", 100.0f, TITLE_SIZE, sf::Color::White);
 
     // Show local ready status
-    std::string localStatus = localReady ? "READY" : "NOT READY";
     sf::Color localColor = localReady ? sf::Color::Green : sf::Color::Red;
-    drawCenteredText(window, "You: " + localStatus, 220.0f, OPTION_SIZE, localColor);
+    drawCenteredText(window, localReady ? "You: READY" : "You: NOT READY", 220.0f, OPTION_SIZE, localColor);
 
     // Show opponent ready status
-    std::string remoteStatus = remoteReady ? "READY" : "NOT READY";
     sf::Color remoteColor = remoteReady ? sf::Color::Green : sf::Color::Red;
-    drawCenteredText(window, "Opponent: " + remoteStatus, 280.0f, OPTION_SIZE, remoteColor);
+    drawCenteredText(window, remoteReady ? "Opponent: READY" : "Opponent: NOT READY", 280.0f, OPTION_SIZE, remoteColor);
 
     // Draw status message
     if (localReady && remoteReady) {
@@ -409,7 +428,10 @@ void MenuView::drawCenteredText(sf::RenderWindow& window, const std::string& tex
                                float y, float size, const sf::Color& color) const {
     if (!m_fontLoaded) return;
 
-    sf::Text sfText(m_font, text, static_cast<unsigned int>(size));
+    drawCentered(window, m_textCache.get(text, static_cast<unsigned int>(size)), y, color);
+}
+
+void MenuView::drawCentered(sf::RenderWindow& window, sf::Text& sfText, float y, const sf::Color& color) const {
     sfText.setFillColor(color);
     sf::FloatRect bounds = sfText.getLocalBounds();
     sfText.setPosition(
@@ -422,7 +444,7 @@ void MenuView::drawMenuOption(sf::RenderWindow& window, const std::string& text,
                              float y, bool isSelected) const {
     if (!m_fontLoaded) return;
 
-    sf::Text sfText(m_font, text, static_cast<unsigned int>(OPTION_SIZE));
+    sf::Text& sfText = m_textCache.get(text, static_cast<unsigned int>(OPTION_SIZE));
     sf::Color textColor = isSelected ? sf::Color::Yellow : sf::Color::White;
     sfText.setFillColor(textColor);
 
@@ -430,16 +452,16 @@ void MenuView::drawMenuOption(sf::RenderWindow& window, const std::string& text,
     sfText.setPosition(
         sf::Vector2f((window.getSize().x - bounds.size.x) / 2.0f, y)
     );
+    window.draw(sfText);
 
     if (isSelected) {
-        // Draw selection indicator
-        sf::Text indicator(m_font, "> ", static_cast<unsigned int>(OPTION_SIZE));
+        // Draw selection indicator (the option text is drawn first, cached references do not outlive a lookup)
+        float indicatorX = sfText.getPosition().x - 40.0f;
+        sf::Text& indicator = m_textCache.get("> ", static_cast<unsigned int>(OPTION_SIZE));
         indicator.setFillColor(sf::Color::Yellow);
         indicator.setPosition(
-            sf::Vector2f(sfText.getPosition().x - 40.0f, y)
+            sf::Vector2f(indicatorX, y)
         );
         window.draw(indicator);
     }
-
-    window.draw(sfText);
 }
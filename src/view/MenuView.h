@@ -1,5 +1,6 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include "TextCache.h"
 #include <vector>
 #include <string>
 
@@ -52,6 +53,9 @@ public:
     // Render network ready menu (waiting for both players to confirm ready)
     void renderNetworkReady(sf::RenderWindow& window, int selectedOption, bool localReady, bool remoteReady) const;
 
+    // Render the notice shown over a network match while the opponent reconnects
+    void renderReconnecting(sf::RenderWindow& window) const;
+
     // Render pause menu
     void renderPauseMenu(sf::RenderWindow& window, int selectedOption, float musicVolume) const;
 
@@ -70,6 +74,13 @@ private:
     sf::Font m_font;
     bool m_fontLoaded;
 
+    // Rendering methods are const, the caches only hold text layout between frames
+    mutable TextCache m_textCache;
+    mutable DynamicText m_pauseVolumeText;
+    mutable DynamicText m_settingsVolumeText;
+    mutable DynamicText m_hostIPText;
+    mutable DynamicText m_ipInputText;
+
     static constexpr float TITLE_SIZE = 48.0f;
     static constexpr float OPTION_SIZE = 36.0f;
     static constexpr float OPTION_SPACING = 60.0f;
@@ -77,6 +88,8 @@ private:
     void drawCenteredText(sf::RenderWindow& window, const std::string& text,
                          float y, float size, const sf::Color& color) const;
 
+    void drawCentered(sf::RenderWindow& window, sf::Text& sfText, float y, const sf::Color& color) const;
+
     void drawMenuOption(sf::RenderWindow& window, const std::string& text,
                        float y, bool isSelected) const;
 };
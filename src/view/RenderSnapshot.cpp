@@ -0,0 +1,31 @@
+#include "RenderSnapshot.h"
+#include "../model/GameState.h"
+#include "../model/LevelBasedMode.h"
+#include "../model/AIMode.h"
+
+void PieceSnapshot::capture(const Tetromino& piece) {
+    blocks = piece.getBlocks();
+    colorId = piece.getColorId();
+}
+
+void PlayerSnapshot::capture(const GameState& state) {
+    board = state.board();
+    currentPiece.capture(state.currentPiece());
+    nextPiece.capture(state.nextPiece());
+    pieceX = state.pieceX();
+    pieceY = state.pieceY();
+    ghostY = state.getGhostY();
+    score = state.score();
+
+    const GameMode* mode = state.getGameMode();
+    const auto* levelMode = dynamic_cast<const LevelBasedMode*>(mode);
+    const auto* aiMode = dynamic_cast<const AIMode*>(mode);
+    hasLevel = levelMode || aiMode;
+    level = levelMode ? levelMode->getCurrentLevel() : (aiMode ? aiMode->getCurrentLevel() : 0);
+    linesCleared = mode ? mode->getLinesCleared() : 0;
+    modeName = mode ? mode->getModeName() : "Unknown";
+
+    isClearingLines = state.isClearingLines();
+    clearAnimationProgress = state.getClearAnimationProgress();
+    isGameOver = state.isGameOver();
+}
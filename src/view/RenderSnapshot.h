@@ -0,0 +1,74 @@
+#pragma once
+#include "../model/Board.h"
+#include "../model/Tetromino.h"
+#include "../network/TrafficMetrics.h"
+#include "MenuView.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+class GameState;
+
+// Plain copy of one piece as it is drawn: block offsets of its current rotation and color
+struct PieceSnapshot {
+    PieceBlocks blocks;
+    int colorId = 0;
+
+    void capture(const Tetromino& piece);
+};
+
+// Everything the view needs to draw one player's side, copied out of a GameState
+struct PlayerSnapshot {
+    Board board;
+    PieceSnapshot currentPiece;
+    PieceSnapshot nextPiece;
+    int pieceX = 0;
+    int pieceY = 0;
+    int ghostY = 0;
+    int score = 0;
+    int level = 0;
+    bool hasLevel = false;       // only level based modes show a level
+    int linesCleared = 0;
+    const char* modeName = "Unknown";  // points to the mode's static name
+    bool isClearingLines = false;
+    float clearAnimationProgress = 0.0f;
+    bool isGameOver = false;
+
+    void capture(const GameState& state);
+};
+
+// Immutable picture of a frame produced by the simulation thread and drawn by the render thread.
+// Nothing in here points back into live game objects.
+struct RenderSnapshot {
+    PlayerSnapshot local;
+    PlayerSnapshot remote;
+    bool isMultiplayer = false;
+
+    MenuState menuState = MenuState::MAIN_MENU;
+    int selectedOption = 0;
+    int winnerId = -1;
+    std::string winnerName;
+    bool isNetworkConnected = false;
+    bool isNetworkReconnecting = false;  // match on hold until the peer is back
+    // Traffic line of the HUD during a LAN match
+    bool showNetworkStats = false;
+    TrafficRates networkTraffic;
+    float networkRttMs = -1.0f;  // negative until measured
+    std::string localIP;
+    std::string ipInput;
+    bool localPlayerReady = false;
+    bool remotePlayerReady = false;
+    float musicVolume = 50.0f;
+    // Playback line of a replay (--replay)
+    bool showReplay = false;
+    std::uint32_t replayTick = 0;
+    std::uint32_t replayLength = 0;
+    std::uint32_t replayTickRate = 120;
+    int replaySpeed = 1;
+    bool replayPaused = false;
+
+    bool shouldExit = false;
+
+    // Newest measured key press already applied to the state shown in this snapshot
+    std::uint64_t lastAppliedInputId = 0;
+};
@@ -0,0 +1,59 @@
+#include "TextCache.h"
+
+TextCache::TextCache(const sf::Font& font) : m_font(font) {}
+
+sf::Text& TextCache::get(const std::string& text, unsigned int characterSize) {
+    auto& texts = m_texts[characterSize];
+
+    auto it = texts.find(text);
+    if (it != texts.end()) {
+        return it->second;
+    }
+
+    if (texts.size() >= MAX_TEXTS_PER_SIZE) {
+        texts.clear();
+    }
+    return texts.try_emplace(text, m_font, text, characterSize).first->second;
+}
+
+void TextCache::prewarm(std::initializer_list<unsigned int> characterSizes, bool bold) const {
+    for (unsigned int size : characterSizes) {
+        for (std::uint32_t codePoint = 32; codePoint < 127; ++codePoint) {
+            m_font.getGlyph(codePoint, size, bold);
+        }
+    }
+}
+
+void TextCache::clear() {
+    m_texts.clear();
+}
+
+DynamicText::DynamicText(const sf::Font& font, unsigned int characterSize)
+    : m_text(font, "", characterSize),
+      m_prefix(nullptr),
+      m_suffix(nullptr),
+      m_value(0),
+      m_hasValue(false) {}
+
+sf::Text& DynamicText::setValue(const char* prefix, int value, const char* suffix) {
+    if (!m_hasValue || value != m_value || prefix != m_prefix || suffix != m_suffix) {
+        m_text.setString(prefix + std::to_string(value) + suffix);
+        m_prefix = prefix;
+        m_suffix = suffix;
+        m_value = value;
+        m_lastText.clear();
+        m_hasValue = true;
+    }
+    return m_text;
+}
+
+sf::Text& DynamicText::setText(const char* prefix, const std::string& text) {
+    if (!m_hasValue || prefix != m_prefix || m_suffix != nullptr || text != m_lastText) {
+        m_text.setString(prefix + text);
+        m_prefix = prefix;
+        m_suffix = nullptr;
+        m_lastText = text;
+        m_hasValue = true;
+    }
+    return m_text;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+// Keeps sf::Text instances alive between frames so static labels are laid out once instead of every frame.
+// A returned reference is only guaranteed until the next call to get(): configure and draw it right away.
+class TextCache {
+public:
+    explicit TextCache(const sf::Font& font);
+
+    // Text for the given string and size, created on first use and reused afterwards
+    sf::Text& get(const std::string& text, unsigned int characterSize);
+
+    // Rasterize printable ASCII glyphs for the given sizes so opening a menu does not stall on the first frame
+    void prewarm(std::initializer_list<unsigned int> characterSizes, bool bold = false) const;
+
+    void clear();
+
+private:
+    const sf::Font& m_font;
+    std::map<unsigned int, std::unordered_map<std::string, sf::Text>> m_texts;
+
+    // Strings built from changing values would otherwise grow the cache forever
+    static constexpr std::size_t MAX_TEXTS_PER_SIZE = 128;
+};
+
+// A single text slot for values that change during play (score, level, volume, IP).
+// The string is only rebuilt, and the text only re-laid out, when the displayed value changes.
+class DynamicText {
+public:
+    DynamicText(const sf::Font& font, unsigned int characterSize);
+
+    // "<prefix><value><suffix>", prefix and suffix are expected to be string literals
+    sf::Text& setValue(const char* prefix, int value, const char* suffix = "");
+
+    // "<prefix><text>"
+    sf::Text& setText(const char* prefix, const std::string& text);
+
+    sf::Text& text() { return m_text; }
+
+private:
+    sf::Text m_text;
+    const char* m_prefix;
+    const char* m_suffix;
+    int m_value;
+    std::string m_lastText;
+    bool m_hasValue;
+};
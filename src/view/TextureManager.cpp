@@ -2,8 +2,8 @@
 #include <cmath>
 
 TextureManager::TextureManager() : m_texturesLoaded(true) {
-    // Create textures for each tetromino color (1-7)
-    for (int colorId = 1; colorId <= 7; ++colorId) {
+    // Create textures for each tetromino color (1-7) and garbage rows (8, grey)
+    for (int colorId = 1; colorId <= 8; ++colorId) {
         sf::Image blockImage = createBlockImage(colorId, 32);
         
         sf::Texture texture;